@@ -133,6 +133,39 @@ namespace Falcor
             return VariablesBuffer::setVariableArray(name, 0, pValue, count);
         }
 
+        /** Set a variable into the buffer using a handle created by getVariableHandle().
+            The handle was validated when it was created, so this call doesn't perform any lookups.
+            \param[in] handle The variable handle
+            \param[in] value Value to set
+        */
+        template<typename T>
+        void setVariable(const VariableHandle<T>& handle, const typename VariableHandle<T>::ValueType& value)
+        {
+            return VariablesBuffer::setVariable(handle, 0, 0, value);
+        }
+
+        /** Set an array element into the buffer using a handle created by getVariableHandle().
+            \param[in] handle The variable handle
+            \param[in] arrayIndex Index of the element to set, relative to the element the handle points to
+            \param[in] value Value to set
+        */
+        template<typename T>
+        void setVariable(const VariableHandle<T>& handle, uint32_t arrayIndex, const typename VariableHandle<T>::ValueType& value)
+        {
+            return VariablesBuffer::setVariable(handle, 0, arrayIndex, value);
+        }
+
+        /** Set a variable array into the buffer using a handle created by getVariableHandle().
+            \param[in] handle The variable handle
+            \param[in] pValue Pointer to an array of values to set
+            \param[in] count pValue array size
+        */
+        template<typename T>
+        void setVariableArray(const VariableHandle<T>& handle, const typename VariableHandle<T>::ValueType* pValue, size_t count)
+        {
+            return VariablesBuffer::setVariableArray(handle, 0, 0, pValue, count);
+        }
+
         virtual bool uploadToGPU(size_t offset = 0, size_t size = -1) override;
 
         ConstantBufferView::SharedPtr getCbv() const;
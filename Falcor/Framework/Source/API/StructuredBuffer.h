@@ -131,6 +131,32 @@ namespace Falcor
         template<typename T>
         void getVariableArray(const std::string& name, size_t count, size_t elementIndex, T value[]);
 
+        /** Set a variable into the buffer using a handle created by getVariableHandle().
+            The handle was validated when it was created, so this call doesn't perform any lookups.
+            \param[in] handle The variable handle
+            \param[in] elementIndex The struct element to write into
+            \param[in] value Value to set
+        */
+        template<typename T>
+        void setVariable(const VariableHandle<T>& handle, size_t elementIndex, const typename VariableHandle<T>::ValueType& value)
+        {
+            return VariablesBuffer::setVariable(handle, elementIndex, 0, value);
+        }
+
+        /** Read a variable from the buffer using a handle created by getVariableHandle().
+            \param[in] handle The variable handle
+            \param[in] elementIndex The struct element to read from
+            \param[out] value The value read from the buffer
+        */
+        template<typename T>
+        void getVariable(const VariableHandle<T>& handle, size_t elementIndex, T& value)
+        {
+            assert(elementIndex < mElementCount);
+            if (handle.isValid() == false) return;
+            readFromGPU();
+            std::memcpy(&value, mData.data() + elementIndex * mElementSize + handle.offset, sizeof(T));
+        }
+
         /** Read a block of data from the buffer.
             If Offset + Size will result in buffer overflow, the call will be ignored and log an error.
             \param pDst Pointer to a buffer to write the data into
@@ -159,6 +185,7 @@ namespace Falcor
         const Buffer::SharedPtr& getUAVCounter() const { return mpUAVCounter; }
 
     private:
+        using VariablesBuffer::setVariable; // The name- and offset-based overloads are used by SharedPtr::Element::Var
         StructuredBuffer(const std::string& name, const ReflectionResourceType::SharedConstPtr& pReflectionType, size_t elementCount, Resource::BindFlags bindFlags);
         mutable bool mGpuCopyDirty = false;
 
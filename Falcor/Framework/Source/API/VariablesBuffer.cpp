@@ -381,6 +381,89 @@ namespace Falcor
 
 #undef set_constant_array_by_string
 
+    template<typename VarType>
+    VariablesBuffer::VariableHandle<VarType> VariablesBuffer::getVariableHandle(const ReflectionResourceType* pReflector, const std::string& name)
+    {
+        VariableHandle<VarType> handle;
+        const auto& pVar = pReflector->findMember(name);
+        if (pVar == nullptr) return handle;
+
+        const ReflectionType* pType = pVar->getType().get();
+        uint32_t arraySize = 1;
+        uint32_t arrayStride = sizeof(VarType);
+
+        if (const ReflectionArrayType* pArrayType = pType->asArrayType())
+        {
+            // The name points to an array. The handle addresses all of its elements
+            arraySize = pArrayType->getArraySize();
+            arrayStride = pArrayType->getArrayStride();
+            pType = pArrayType->getType().get();
+        }
+        else if (name.back() == ']')
+        {
+            // The name points to an array element. The handle addresses it and the elements following it
+            size_t bracketPos = name.rfind('[');
+            const auto& pParent = pReflector->findMember(name.substr(0, bracketPos));
+            const ReflectionArrayType* pArrayType = pParent ? pParent->getType()->asArrayType() : nullptr;
+            if (pArrayType)
+            {
+                uint32_t index = (uint32_t)std::stoul(name.substr(bracketPos + 1));
+                arraySize = pArrayType->getArraySize() - index;
+                arrayStride = pArrayType->getArrayStride();
+            }
+        }
+
+        ReflectionBasicType::Type callType = getReflectionTypeFromCType<VarType>();
+        const ReflectionBasicType* pBasicType = pType->asBasicType();
+        ReflectionBasicType::Type shaderType = pBasicType ? pBasicType->getType() : ReflectionBasicType::Type::Unknown;
+        if (callType != shaderType)
+        {
+            logError("Can't create a handle for variable \"" + name + "\". Type mismatch. Expecting " + to_string(shaderType) + " but the handle type is " + to_string(callType));
+            return handle;
+        }
+
+        handle.offset = pVar->getOffset();
+        handle.arraySize = arraySize;
+        handle.arrayStride = arrayStride;
+        return handle;
+    }
+
+#define get_variable_handle(_t) template VariablesBuffer::VariableHandle<_t> VariablesBuffer::getVariableHandle(const ReflectionResourceType* pReflector, const std::string& name)
+
+    get_variable_handle(bool);
+    get_variable_handle(glm::bvec2);
+    get_variable_handle(glm::bvec3);
+    get_variable_handle(glm::bvec4);
+
+    get_variable_handle(uint32_t);
+    get_variable_handle(glm::uvec2);
+    get_variable_handle(glm::uvec3);
+    get_variable_handle(glm::uvec4);
+
+    get_variable_handle(int32_t);
+    get_variable_handle(glm::ivec2);
+    get_variable_handle(glm::ivec3);
+    get_variable_handle(glm::ivec4);
+
+    get_variable_handle(float);
+    get_variable_handle(glm::vec2);
+    get_variable_handle(glm::vec3);
+    get_variable_handle(glm::vec4);
+
+    get_variable_handle(glm::mat2);
+    get_variable_handle(glm::mat2x3);
+    get_variable_handle(glm::mat2x4);
+
+    get_variable_handle(glm::mat3);
+    get_variable_handle(glm::mat3x2);
+    get_variable_handle(glm::mat3x4);
+
+    get_variable_handle(glm::mat4);
+    get_variable_handle(glm::mat4x2);
+    get_variable_handle(glm::mat4x3);
+
+#undef get_variable_handle
+
     void VariablesBuffer::setBlob(const void* pSrc, size_t offset, size_t size)
     {
         if((_LOG_ENABLED != 0) && (offset + size > mSize))
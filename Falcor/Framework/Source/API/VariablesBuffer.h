@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <cstring>
 #include "Graphics/Program/ProgramReflection.h"
 #include "Texture.h"
 #include "Buffer.h"
@@ -49,6 +50,30 @@ namespace Falcor
 
         static const size_t kInvalidOffset = -1;// ProgramReflection::kInvalidLocation;
 
+        /** A variable resolved once from its name. Setting a value through a handle doesn't require any string or reflection lookups.
+            The handle is validated against the reflection when it is created, so the value type is guaranteed to match the shader declaration.
+            If the name points to an array or an array element, the handle can also address the following elements of that array.
+            A handle created from one buffer can be used with any buffer sharing the same declaration.
+        */
+        template<typename T>
+        struct VariableHandle
+        {
+            using ValueType = T;
+            size_t offset = kInvalidOffset; ///< Byte offset of the first element inside a buffer element
+            uint32_t arraySize = 0;         ///< Number of array elements which can be accessed through the handle. 1 for non-array variables
+            uint32_t arrayStride = 0;       ///< Byte distance between consecutive array elements
+
+            bool isValid() const { return offset != kInvalidOffset; }
+        };
+
+        /** Resolve a variable name into a typed handle. See notes about naming in the VariablesBuffer class description.
+            \param[in] pReflector The buffer reflection type
+            \param[in] name The variable name. Can point to a basic type, an array of a basic type, or an element inside such an array
+            \return A valid handle if the variable exists and its type matches T. Otherwise, logs an error and returns an invalid handle
+        */
+        template<typename T>
+        static VariableHandle<T> getVariableHandle(const ReflectionResourceType* pReflector, const std::string& name);
+
         VariablesBuffer(const std::string& name, const ReflectionResourceType::SharedConstPtr& pReflectionType, size_t elementSize, size_t elementCount, BindFlags bindFlags, CpuAccess cpuAccess);
 
         virtual ~VariablesBuffer() = 0;
@@ -76,6 +101,11 @@ namespace Falcor
         */
         size_t getVariableOffset(const std::string& varName) const;
 
+        /** Resolve a variable name into a typed handle using the buffer's reflection. See getVariableHandle(const ReflectionResourceType*, const std::string&)
+        */
+        template<typename T>
+        VariableHandle<T> getVariableHandle(const std::string& name) const { return getVariableHandle<T>(mpReflector.get(), name); }
+
         size_t getElementCount() const { return mElementCount; }
 
         size_t getElementSize() const { return mElementSize; }
@@ -93,6 +123,35 @@ namespace Falcor
         template<typename T>
         void setVariableArray(const std::string& name, size_t elementIndex, const T* pValue, size_t count);
 
+        template<typename T>
+        void setVariable(const VariableHandle<T>& handle, size_t elementIndex, uint32_t arrayIndex, const T& value)
+        {
+            if (handle.isValid() == false) return;
+            assert(elementIndex < mElementCount && arrayIndex < handle.arraySize);
+            std::memcpy(mData.data() + elementIndex * mElementSize + handle.offset + arrayIndex * handle.arrayStride, &value, sizeof(T));
+            mDirty = true;
+        }
+
+        template<typename T>
+        void setVariableArray(const VariableHandle<T>& handle, size_t elementIndex, uint32_t firstArrayIndex, const T* pValue, size_t count)
+        {
+            if (handle.isValid() == false) return;
+            assert(elementIndex < mElementCount && firstArrayIndex + count <= handle.arraySize);
+            uint8_t* pDst = mData.data() + elementIndex * mElementSize + handle.offset + firstArrayIndex * handle.arrayStride;
+            if (handle.arrayStride == sizeof(T))
+            {
+                std::memcpy(pDst, pValue, count * sizeof(T));
+            }
+            else
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    std::memcpy(pDst + i * handle.arrayStride, &pValue[i], sizeof(T));
+                }
+            }
+            mDirty = true;
+        }
+
         ReflectionResourceType::SharedConstPtr mpReflector;
         std::vector<uint8_t> mData;
         mutable bool mDirty = true;
@@ -201,6 +201,9 @@ namespace Falcor
             pProg->removeDefine("HAS_COLORS");
             pProg->removeDefine("HAS_LIGHTMAP_UV");
             pProg->removeDefine("HAS_PREV_POSITION");
+            pProg->removeDefine("HAS_QUANTIZED_POSITION");
+            pProg->removeDefine("HAS_PACKED_NORMAL");
+            pProg->removeDefine("HAS_PACKED_BITANGENT");
 
             for (const auto& l : mpBufferLayouts)
             {
@@ -208,13 +211,27 @@ namespace Falcor
                 {
                     for (uint32_t i = 0; i < l->getElementCount(); i++)
                     {
+                        // Positions in normalized integers are relative to the mesh's bounding-box, and 2-channel normals and bitangents are octahedral-encoded
+                        ResourceFormat format = l->getElementFormat(i);
+                        if (l->getElementShaderLocation(i) == VERTEX_POSITION_LOC && getFormatType(format) == FormatType::Unorm)
+                        {
+                            pProg->addDefine("HAS_QUANTIZED_POSITION");
+                        }
                         if (l->getElementShaderLocation(i) == VERTEX_NORMAL_LOC)
                         {
                             pProg->addDefine("HAS_NORMAL");
+                            if (getFormatChannelCount(format) == 2)
+                            {
+                                pProg->addDefine("HAS_PACKED_NORMAL");
+                            }
                         }
                         if (l->getElementShaderLocation(i) == VERTEX_BITANGENT_LOC)
                         {
                             pProg->addDefine("HAS_BITANGENT");
+                            if (getFormatChannelCount(format) == 2)
+                            {
+                                pProg->addDefine("HAS_PACKED_BITANGENT");
+                            }
                         }
                         if (l->getElementShaderLocation(i) == VERTEX_TEXCOORD_LOC)
                         {
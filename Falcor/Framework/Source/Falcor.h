@@ -76,6 +76,7 @@
 #include "Graphics/GraphicsState.h"
 #include "Graphics/FullScreenPass.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCache.h"
 #include "Graphics/Light.h"
 #include "Graphics/LightProbe.h"
 #include "Graphics/FboHelper.h"
@@ -89,6 +90,7 @@
 #include "Graphics/Program/GraphicsProgram.h"
 #include "Graphics/Program/ComputeProgram.h"
 #include "Graphics/Program/ParameterBlock.h"
+#include "Graphics/Program/ShaderCache.h"
 
 // Material
 #include "Graphics/Material/Material.h"
@@ -97,6 +99,7 @@
 #include "Graphics/Model/Mesh.h"
 #include "Graphics/Model/Model.h"
 #include "Graphics/Model/ModelRenderer.h"
+#include "Graphics/Model/TransformStore.h"
 
 // Scene
 #include "Graphics/Scene/Scene.h"
@@ -107,6 +110,7 @@
 #include "Utils/Math/FalcorMath.h"
 #include "Utils/Math/CubicSpline.h"
 #include "Utils/Math/ParallelReduction.h"
+#include "Utils/Math/BoundingVolumeHierarchy.h"
 
 // Utils
 #include "Utils/Bitmap.h"
@@ -126,6 +130,7 @@
 #include "Utils/Platform/OS.h"
 #include "Utils/Platform/ProgressBar.h"
 #include "Utils/ThreadPool.h"
+#include "Utils/WorkerPool.h"
 
 // VR
 #include "VR/OpenVR/VRSystem.h"
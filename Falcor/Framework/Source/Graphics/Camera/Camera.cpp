@@ -31,6 +31,8 @@
 #include "Utils/AABB.h"
 #include "Utils/Math/FalcorMath.h"
 #include "API/ConstantBuffer.h"
+#include "Utils/WorkerPool.h"
+#include <emmintrin.h>
 
 namespace Falcor
 {
@@ -198,6 +200,89 @@ namespace Falcor
         return !isInside;
     }
 
+    glm::vec4 Camera::getFrustumPlane(uint32_t index) const
+    {
+        calculateCameraParameters();
+        return glm::vec4(mFrustumPlanes[index].xyz, -mFrustumPlanes[index].negW);
+    }
+
+    void Camera::cullObjects(const BoundingBoxArray& boxes, std::vector<uint32_t>& visibilityMask) const
+    {
+        calculateCameraParameters();
+
+        const uint32_t boxCount = boxes.size();
+        visibilityMask.assign((boxCount + 31) / 32, 0);
+        if (boxCount == 0) return;
+
+        // Same test as isObjectCulled(). The sign is folded into the plane, so dr = dot(center, xyz) + dot(extent, sign * xyz)
+        struct
+        {
+            __m128 x, y, z;
+            __m128 signedX, signedY, signedZ;
+            __m128 negW;
+        } planes[6];
+
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            const auto& plane = mFrustumPlanes[p];
+            planes[p].x = _mm_set1_ps(plane.xyz.x);
+            planes[p].y = _mm_set1_ps(plane.xyz.y);
+            planes[p].z = _mm_set1_ps(plane.xyz.z);
+            planes[p].signedX = _mm_set1_ps(plane.xyz.x * plane.sign.x);
+            planes[p].signedY = _mm_set1_ps(plane.xyz.y * plane.sign.y);
+            planes[p].signedZ = _mm_set1_ps(plane.xyz.z * plane.sign.z);
+            planes[p].negW = _mm_set1_ps(plane.negW);
+        }
+
+        // Every job writes whole words of the mask, so jobs never share a word
+        static const uint32_t kWordsPerJob = 32;
+        const uint32_t wordCount = (uint32_t)visibilityMask.size();
+        const uint32_t jobCount = (wordCount + kWordsPerJob - 1) / kWordsPerJob;
+        uint32_t* pMask = visibilityMask.data();
+
+        auto cullJob = [&](uint32_t job)
+        {
+            uint32_t lastWord = std::min(wordCount, (job + 1) * kWordsPerJob);
+            for (uint32_t word = job * kWordsPerJob; word < lastWord; word++)
+            {
+                uint32_t first = word * 32;
+                uint32_t last = std::min(boxCount, first + 32);
+                uint32_t bits = 0;
+                for (uint32_t i = first; i < last; i += BoundingBoxArray::kPadding)
+                {
+                    __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+                    __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+                    __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+                    __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+                    __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+                    __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+                    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                    for (const auto& plane : planes)
+                    {
+                        __m128 dr = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, plane.x), _mm_mul_ps(cy, plane.y)), _mm_mul_ps(cz, plane.z));
+                        dr = _mm_add_ps(dr, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, plane.signedX), _mm_mul_ps(ey, plane.signedY)), _mm_mul_ps(ez, plane.signedZ)));
+                        inside = _mm_and_ps(inside, _mm_cmpgt_ps(dr, plane.negW));
+                    }
+                    bits |= uint32_t(_mm_movemask_ps(inside)) << (i - first);
+                }
+
+                // Clear the bits of the padding boxes
+                uint32_t count = last - first;
+                pMask[word] = (count == 32) ? bits : (bits & ((1u << count) - 1));
+            }
+        };
+
+        if (jobCount == 1)
+        {
+            cullJob(0);
+        }
+        else
+        {
+            WorkerPool::getGlobal().parallelFor(0, jobCount, cullJob);
+        }
+    }
+
     void Camera::setRightEyeMatrices(const glm::mat4& view, const glm::mat4& proj)
     {
         mData.rightEyeViewMat = view;
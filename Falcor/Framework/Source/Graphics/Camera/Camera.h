@@ -36,6 +36,7 @@
 namespace Falcor
 {
     struct BoundingBox;
+    struct BoundingBoxArray;
     class ConstantBuffer;
 
     /** Camera class. Default transform matrices are interpreted as left eye transform during stereo rendering.
@@ -185,6 +186,21 @@ namespace Falcor
         */
         bool isObjectCulled(const BoundingBox& box) const;
 
+        /** Check a batch of objects against the frustum. The boxes are tested 4 at a time and the work is split across the worker pool.
+            \param[in] boxes Bounding boxes of the objects to check
+            \param[out] visibilityMask One bit per box, set if the object is visible. Use isVisible() to read it.
+        */
+        void cullObjects(const BoundingBoxArray& boxes, std::vector<uint32_t>& visibilityMask) const;
+
+        /** Get a frustum plane. A point p is inside the frustum if dot(plane.xyz, p) + plane.w > 0 for all 6 planes.
+            \param[in] index Plane index, in [0, 6)
+        */
+        glm::vec4 getFrustumPlane(uint32_t index) const;
+
+        /** Read a bit of a visibility mask returned from cullObjects()
+        */
+        static bool isVisible(const std::vector<uint32_t>& visibilityMask, uint32_t index) { return (visibilityMask[index >> 5] & (1u << (index & 31))) != 0; }
+
         /** Set camera data into a program's constant buffer.
             \param[in] pBuffer The constant buffer to set the parameters into.
             \param[in] varName The name of the light variable in the program.
@@ -233,6 +233,15 @@ namespace Falcor
         */
         float getOpeningAngle() const { return mData.openingAngle; }
 
+        /** Set the range of the light. The falloff is smoothly windowed to zero at this distance, which allows LightClusters to only assign the light to the clusters it reaches.
+            \param[in] range The range in world units. 0 means the light is unbounded.
+        */
+        void setRange(float range) { mData.range = glm::max(range, 0.0f); }
+
+        /** Get the range of the light. 0 means the light is unbounded.
+        */
+        float getRange() const { return mData.range; }
+
         /** IMovableObject interface
         */
         void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) override;
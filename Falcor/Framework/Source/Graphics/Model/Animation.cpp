@@ -30,9 +30,98 @@
 #include "AnimationController.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/transform.hpp"
+#include <algorithm>
+#include <emmintrin.h>
 
 namespace Falcor
 {
+    namespace
+    {
+        const float kQuatComponentRange = 0.70710678f;  // The 3 smallest components of a unit quaternion are in [-1/sqrt(2), 1/sqrt(2)]
+        const uint32_t kQuatIndexBit = 0x8000;
+        const uint32_t kQuatValueMask = 0x7fff;
+        const float kQuatValueMax = 32767.0f;
+        const float kVec3ValueMax = 65535.0f;
+
+        float keyTime(const std::vector<float>& times, float start, float step, uint32_t key)
+        {
+            return times.empty() ? start + step * key : times[key];
+        }
+
+        __m128 loadKey(const uint16_t* pValues, uint32_t mask)
+        {
+            __m128i i = _mm_set_epi32(0, pValues[2] & mask, pValues[1] & mask, pValues[0] & mask);
+            return _mm_cvtepi32_ps(i);
+        }
+
+        glm::vec3 toVec3(__m128 v)
+        {
+            alignas(16) float f[4];
+            _mm_store_ps(f, v);
+            return glm::vec3(f[0], f[1], f[2]);
+        }
+
+        glm::quat decodeQuat(const uint16_t* pValues)
+        {
+            // Dequantize the 3 stored components
+            const __m128 scale = _mm_set1_ps(2 * kQuatComponentRange / kQuatValueMax);
+            const __m128 bias = _mm_set1_ps(-kQuatComponentRange);
+            __m128 v = _mm_add_ps(_mm_mul_ps(loadKey(pValues, kQuatValueMask), scale), bias);
+
+            // Reconstruct the dropped component. It was made positive when encoding
+            __m128 sq = _mm_mul_ps(v, v);
+            float sum = _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1))), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 2, 2, 2))));
+            float largest = _mm_cvtss_f32(_mm_sqrt_ss(_mm_set_ss(std::max(0.0f, 1.0f - sum))));
+
+            alignas(16) float stored[4];
+            _mm_store_ps(stored, v);
+            uint32_t largestIndex = ((pValues[0] & kQuatIndexBit) ? 1 : 0) | ((pValues[1] & kQuatIndexBit) ? 2 : 0);
+
+            // Components are in x, y, z, w order
+            float c[4];
+            for(uint32_t i = 0, s = 0; i < 4; i++)
+            {
+                c[i] = (i == largestIndex) ? largest : stored[s++];
+            }
+            return glm::quat(c[3], c[0], c[1], c[2]);
+        }
+
+        void encodeQuat(glm::quat q, uint16_t* pValues)
+        {
+            q = glm::normalize(q);
+            float c[4] = { q.x, q.y, q.z, q.w };
+            uint32_t largestIndex = 0;
+            for(uint32_t i = 1; i < 4; i++)
+            {
+                if(std::abs(c[i]) > std::abs(c[largestIndex]))
+                {
+                    largestIndex = i;
+                }
+            }
+
+            // q and -q are the same rotation. Flip the sign so that the dropped component is positive
+            float sign = (c[largestIndex] < 0) ? -1.0f : 1.0f;
+            for(uint32_t i = 0, s = 0; i < 4; i++)
+            {
+                if(i == largestIndex) continue;
+                float n = (glm::clamp(c[i] * sign, -kQuatComponentRange, kQuatComponentRange) + kQuatComponentRange) / (2 * kQuatComponentRange);
+                pValues[s++] = (uint16_t)(n * kQuatValueMax + 0.5f);
+            }
+            pValues[0] |= (largestIndex & 1) ? kQuatIndexBit : 0;
+            pValues[1] |= (largestIndex & 2) ? kQuatIndexBit : 0;
+        }
+
+        template<typename T>
+        bool isConstant(const std::vector<Animation::AnimationKey<T>>& keys)
+        {
+            for(const auto& k : keys)
+            {
+                if(k.value != keys[0].value) return false;
+            }
+            return true;
+        }
+    }
+
     Animation::UniquePtr Animation::create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond)
     {
         return UniquePtr(new Animation(name, animationSets, duration, ticksPerSecond));
@@ -43,104 +132,192 @@ namespace Falcor
         return UniquePtr(new Animation(other));
     }
 
-    Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond) : mName(name), mAnimationSets(animationSets), mDuration(duration), mTicksPerSecond(ticksPerSecond)
+    Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond) : mName(name), mDuration(duration), mTicksPerSecond(ticksPerSecond)
     {
-
+        mTracks.reserve(animationSets.size());
+        for(const auto& set : animationSets)
+        {
+            BoneTracks tracks;
+            tracks.boneID = set.boneID;
+            tracks.translation = compressTrack(set.translation);
+            tracks.scaling = compressTrack(set.scaling);
+            tracks.rotation = compressTrack(set.rotation);
+            mTracks.push_back(std::move(tracks));
+        }
     }
 
-    Animation::Animation(const Animation& other) : mName(other.mName), mDuration(other.mDuration), mTicksPerSecond(other.mTicksPerSecond)
+    Animation::Animation(const Animation& other) : mName(other.mName), mDuration(other.mDuration), mTicksPerSecond(other.mTicksPerSecond), mTracks(other.mTracks)
     {
-        mAnimationSets = other.mAnimationSets;
     }
 
     Animation::~Animation() = default;
 
     template<typename T>
-    uint32_t findCurrentFrame(T channel, float ticks)
+    Animation::KeyTimes Animation::compressKeyTimes(const std::vector<AnimationKey<T>>& keys)
     {
-        uint32_t curKeyID = channel.lastKeyUsed;
-        while(curKeyID < channel.keys.size() - 1)
+        KeyTimes keyTimes;
+        keyTimes.count = (uint32_t)keys.size();
+        if(keys.empty()) return keyTimes;
+
+        keyTimes.start = keys[0].time;
+        if(keys.size() == 1) return keyTimes;
+
+        keyTimes.step = (keys.back().time - keys[0].time) / (keys.size() - 1);
+        bool uniform = keyTimes.step > 0;
+        for(size_t i = 0; uniform && i < keys.size(); i++)
         {
-            if(channel.keys[curKeyID + 1].time > ticks)
+            uniform = std::abs(keys[i].time - (keyTimes.start + keyTimes.step * i)) <= 1e-3f * keyTimes.step;
+        }
+
+        if(uniform == false)
+        {
+            keyTimes.times.resize(keys.size());
+            for(size_t i = 0; i < keys.size(); i++)
             {
-                break;
+                keyTimes.times[i] = keys[i].time;
             }
-            curKeyID++;
         }
-        return curKeyID;
+        return keyTimes;
     }
 
-    glm::vec3 interpolate(const glm::vec3& start, const glm::vec3& end, float ratio)
+    Animation::Vec3Track Animation::compressTrack(const AnimationChannel<glm::vec3>& channel)
     {
-        return start + ((end - start) * ratio);
-    }
+        Vec3Track track;
+        if(channel.keys.empty()) return track;
 
-    glm::quat interpolate(const glm::quat& start, const glm::quat& end, float ratio)
-    {
-        return glm::slerp(start, end, ratio);
-    }
+        // A constant channel is stored as a single key
+        std::vector<AnimationKey<glm::vec3>> constantKey;
+        const auto& keys = isConstant(channel.keys) ? (constantKey = { channel.keys[0] }) : channel.keys;
+        track.keyTimes = compressKeyTimes(keys);
 
-    template<typename KeyType>
-    KeyType Animation::calcCurrentKey(AnimationChannel<KeyType>& channel, float ticks, float lastUpdateTime)
-    {
-        KeyType curValue;
-        if(channel.keys.size() > 0)
+        glm::vec3 rangeMax = keys[0].value;
+        track.rangeMin = keys[0].value;
+        for(const auto& k : keys)
+        {
+            track.rangeMin = glm::min(track.rangeMin, k.value);
+            rangeMax = glm::max(rangeMax, k.value);
+        }
+        track.rangeScale = (rangeMax - track.rangeMin) / kVec3ValueMax;
+
+        track.values.resize(keys.size() * 3);
+        for(size_t i = 0; i < keys.size(); i++)
         {
-            if(ticks < lastUpdateTime)
+            for(uint32_t c = 0; c < 3; c++)
             {
-                channel.lastKeyUsed = 0;
+                float range = rangeMax[c] - track.rangeMin[c];
+                float n = (range > 0) ? (keys[i].value[c] - track.rangeMin[c]) / range : 0;
+                track.values[i * 3 + c] = (uint16_t)(n * kVec3ValueMax + 0.5f);
             }
+        }
+        return track;
+    }
 
-            // search for the next keyframe
-            uint32_t curKeyIndex = findCurrentFrame(channel, ticks);
-            uint32_t nextKeyIndex = (curKeyIndex + 1) % channel.keys.size();
-            const AnimationKey<KeyType>& curKey = channel.keys[curKeyIndex];
-            const AnimationKey<KeyType>& nextKey = channel.keys[nextKeyIndex];
+    Animation::QuatTrack Animation::compressTrack(const AnimationChannel<glm::quat>& channel)
+    {
+        QuatTrack track;
+        if(channel.keys.empty()) return track;
 
-            assert(ticks >= curKey.time);
-            // Interpolate between them
-            float diff = nextKey.time - curKey.time;
-            if(diff < 0)
-            {
-                diff += mDuration;
-            }
-            else if(diff == 0)
-            {
-                curValue = curKey.value;
-            }
-            else
-            {
-                float ratio = (ticks - curKey.time) / diff;
-                curValue = interpolate(curKey.value, nextKey.value, ratio);
-            }
-            channel.lastKeyUsed = curKeyIndex;
+        std::vector<AnimationKey<glm::quat>> constantKey;
+        const auto& keys = isConstant(channel.keys) ? (constantKey = { channel.keys[0] }) : channel.keys;
+        track.keyTimes = compressKeyTimes(keys);
+
+        track.values.resize(keys.size() * 3);
+        for(size_t i = 0; i < keys.size(); i++)
+        {
+            encodeQuat(keys[i].value, &track.values[i * 3]);
         }
-        return curValue;
+        return track;
     }
 
-    void Animation::animate(double totalTime, AnimationController* pAnimationController)
+    bool Animation::findKeys(const KeyTimes& keyTimes, float ticks, uint32_t& key0, uint32_t& key1, float& ratio) const
     {
-        // Calculate the relative time
-        float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
+        if(keyTimes.count == 0) return false;
+
+        key0 = key1 = 0;
+        ratio = 0;
+        if(keyTimes.count == 1) return true;
+
+        // Find the last key at or before the current time. -1 means we are before the first key
+        int32_t cur;
+        if(keyTimes.times.empty())
+        {
+            float f = (ticks - keyTimes.start) / keyTimes.step;
+            cur = (f < 0) ? -1 : (int32_t)std::min(f, float(keyTimes.count - 1));
+        }
+        else
+        {
+            cur = int32_t(std::upper_bound(keyTimes.times.begin(), keyTimes.times.end(), ticks) - keyTimes.times.begin()) - 1;
+        }
 
-        for(auto& Key : mAnimationSets)
+        const uint32_t last = keyTimes.count - 1;
+        if(cur >= 0 && (uint32_t)cur < last)
+        {
+            key0 = cur;
+            key1 = cur + 1;
+            float t0 = keyTime(keyTimes.times, keyTimes.start, keyTimes.step, key0);
+            float t1 = keyTime(keyTimes.times, keyTimes.start, keyTimes.step, key1);
+            ratio = (ticks - t0) / (t1 - t0);
+        }
+        else
         {
-            glm::mat4 translation;
-            translation[3] = glm::vec4(calcCurrentKey(Key.translation, ticks, Key.lastUpdateTime), 1);
+            // Between the last key and the first one, wrap around the end of the animation
+            key0 = last;
+            key1 = 0;
+            float t0 = keyTime(keyTimes.times, keyTimes.start, keyTimes.step, last);
+            float diff = keyTimes.start + mDuration - t0;
+            float t = (ticks < t0) ? ticks + mDuration : ticks;
+            ratio = (diff > 0) ? (t - t0) / diff : 0;
+        }
+        ratio = glm::clamp(ratio, 0.0f, 1.0f);
+        return true;
+    }
 
-            glm::mat4 scaling;
-            if (Key.scaling.keys.size() > 0)
-            {
-                glm::scale(calcCurrentKey(Key.scaling, ticks, Key.lastUpdateTime));
-            }
+    glm::vec3 Animation::sample(const Vec3Track& track, float ticks, const glm::vec3& defaultValue) const
+    {
+        uint32_t key0, key1;
+        float ratio;
+        if(findKeys(track.keyTimes, ticks, key0, key1, ratio) == false) return defaultValue;
 
-            glm::quat q = calcCurrentKey(Key.rotation, ticks, Key.lastUpdateTime);
-            glm::mat4 rotation = glm::mat4_cast(q);
+        // Interpolate the quantized values, then scale the result into the track's range
+        __m128 v0 = loadKey(&track.values[key0 * 3], 0xffff);
+        __m128 v1 = loadKey(&track.values[key1 * 3], 0xffff);
+        __m128 v = _mm_add_ps(v0, _mm_mul_ps(_mm_sub_ps(v1, v0), _mm_set1_ps(ratio)));
+        __m128 scale = _mm_set_ps(0, track.rangeScale.z, track.rangeScale.y, track.rangeScale.x);
+        __m128 bias = _mm_set_ps(0, track.rangeMin.z, track.rangeMin.y, track.rangeMin.x);
+        return toVec3(_mm_add_ps(_mm_mul_ps(v, scale), bias));
+    }
+
+    glm::quat Animation::sample(const QuatTrack& track, float ticks) const
+    {
+        uint32_t key0, key1;
+        float ratio;
+        if(findKeys(track.keyTimes, ticks, key0, key1, ratio) == false) return glm::quat(1, 0, 0, 0);
+
+        glm::quat q0 = decodeQuat(&track.values[key0 * 3]);
+        if(key0 == key1) return q0;
+        glm::quat q1 = decodeQuat(&track.values[key1 * 3]);
+        return glm::slerp(q0, q1, ratio);
+    }
 
-            Key.lastUpdateTime = ticks;
+    void Animation::animate(double totalTime, AnimationController* pAnimationController) const
+    {
+        // Calculate the relative time
+        float ticks = (float)fmod(totalTime * mTicksPerSecond, mDuration);
+
+        for(const auto& tracks : mTracks)
+        {
+            glm::vec3 translation = sample(tracks.translation, ticks, glm::vec3(0));
+            glm::vec3 scaling = sample(tracks.scaling, ticks, glm::vec3(1));
+            glm::quat q = sample(tracks.rotation, ticks);
 
-            glm::mat4 T = translation * rotation * scaling;
-            pAnimationController->setBoneLocalTransform(Key.boneID, T);
+            // T * R * S, without the full matrix multiplications
+            glm::mat3 rotation = glm::mat3_cast(q);
+            glm::mat4 T(1);
+            T[0] = glm::vec4(rotation[0] * scaling.x, 0);
+            T[1] = glm::vec4(rotation[1] * scaling.y, 0);
+            T[2] = glm::vec4(rotation[2] * scaling.z, 0);
+            T[3] = glm::vec4(translation, 1);
+            pAnimationController->setBoneLocalTransform(tracks.boneID, T);
         }
     }
 }
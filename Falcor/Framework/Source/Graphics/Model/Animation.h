@@ -39,6 +39,7 @@ namespace Falcor
     public:
         using UniquePtr = std::unique_ptr<Animation>;
         using UniqueConstPtr = std::unique_ptr<const Animation>;
+        using SharedConstPtr = std::shared_ptr<const Animation>;
 
         template<typename T>
         struct AnimationKey
@@ -50,36 +51,83 @@ namespace Falcor
         template<typename T>
         struct AnimationChannel
         {
-            std::vector<AnimationKey<T>> keys;
-            uint32_t lastKeyUsed = 0;
+            std::vector<AnimationKey<T>> keys;  ///< Sorted by time
         };
 
+        /** The keys of a single bone, used to create the animation. The animation stores them compressed.
+        */
         struct AnimationSet
         {
             uint32_t boneID;
             AnimationChannel<glm::vec3> translation;
             AnimationChannel<glm::vec3> scaling;
             AnimationChannel<glm::quat> rotation;
-            float lastUpdateTime = 0;
         };
 
         static UniquePtr create(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
         static UniquePtr create(const Animation& other);
         ~Animation();
-        void animate(double totalTime, AnimationController* pAnimationController);
+
+        /** Sample the animation and set the bones' local transforms into the controller.
+            Sampling doesn't modify the animation, so it can be called concurrently and shared between controllers playing it at different times.
+        */
+        void animate(double totalTime, AnimationController* pAnimationController) const;
         const std::string& getName() const { return mName; }
 
     private:
         Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
         Animation(const Animation& other);
-        
+
+        /** Key times of a track. Uniformly spaced keys, which is the common case for baked and captured animations, only store the first time and the spacing
+        */
+        struct KeyTimes
+        {
+            std::vector<float> times;   ///< Empty if the keys are uniformly spaced
+            float start = 0;
+            float step = 0;
+            uint32_t count = 0;
+        };
+
+        /** vec3 track. Every component is stored as a 16-bit fraction of the track's range
+        */
+        struct Vec3Track
+        {
+            KeyTimes keyTimes;
+            glm::vec3 rangeMin = glm::vec3(0);
+            glm::vec3 rangeScale = glm::vec3(0);
+            std::vector<uint16_t> values;   ///< 3 per key
+        };
+
+        /** Quaternion track using the smallest-three encoding. The largest component is dropped and the other 3 are quantized to 15 bits.
+            The index of the dropped component goes into the top bits of the first 2 values
+        */
+        struct QuatTrack
+        {
+            KeyTimes keyTimes;
+            std::vector<uint16_t> values;   ///< 3 per key
+        };
+
+        struct BoneTracks
+        {
+            uint32_t boneID;
+            Vec3Track translation;
+            Vec3Track scaling;
+            QuatTrack rotation;
+        };
+
         const std::string mName;
         float mDuration;
         float mTicksPerSecond;
 
-        std::vector<AnimationSet> mAnimationSets;
+        std::vector<BoneTracks> mTracks;
+
+        template<typename T>
+        static KeyTimes compressKeyTimes(const std::vector<AnimationKey<T>>& keys);
+        static Vec3Track compressTrack(const AnimationChannel<glm::vec3>& channel);
+        static QuatTrack compressTrack(const AnimationChannel<glm::quat>& channel);
 
-        template<typename _KeyType>
-        _KeyType calcCurrentKey(AnimationChannel<_KeyType>& channel, float ticks, float lastUpdateTime);
+        bool findKeys(const KeyTimes& keyTimes, float ticks, uint32_t& key0, uint32_t& key1, float& ratio) const;
+        glm::vec3 sample(const Vec3Track& track, float ticks, const glm::vec3& defaultValue) const;
+        glm::quat sample(const QuatTrack& track, float ticks) const;
     };
 }
\ No newline at end of file
@@ -30,7 +30,10 @@
 #include "Model.h"
 #include <fstream>
 #include "Animation.h"
+#include "Utils/WorkerPool.h"
 #include <algorithm>
+#include <xmmintrin.h>
+#include <emmintrin.h>
 
 namespace Falcor
 {
@@ -73,21 +76,57 @@ namespace Falcor
 
     AnimationController::AnimationController(const std::vector<Bone>& Bones)
     {
-        mBones = Bones;
-        mBoneTransforms.resize(mBones.size());
-        mBoneInvTransposeTransforms.resize(mBones.size());
+        size_t count = Bones.size();
+        mParentIds.resize(count);
+        mOffsets.resize(count);
+        mLocalTransforms.resize(count);
+        mOriginalLocalTransforms.resize(count);
+        mGlobalTransforms.resize(count);
+        bool isSorted = true;
+        for(size_t i = 0; i < count; i++)
+        {
+            mParentIds[i] = Bones[i].parentID;
+            mOffsets[i] = Bones[i].offset;
+            mLocalTransforms[i] = Bones[i].localTransform;
+            mOriginalLocalTransforms[i] = Bones[i].originalLocalTransform;
+            mGlobalTransforms[i] = Bones[i].globalTransform;
+            isSorted = isSorted && (mParentIds[i] == kInvalidBoneID || mParentIds[i] < i);
+        }
+
+        // The importer assigns IDs depth-first, so parents almost always come first. Otherwise, evaluate the bones breadth-first.
+        if(isSorted == false)
+        {
+            for(uint32_t i = 0; i < count; i++)
+            {
+                if(mParentIds[i] == kInvalidBoneID) mEvaluationOrder.push_back(i);
+            }
+            for(size_t next = 0; next < mEvaluationOrder.size(); next++)
+            {
+                for(uint32_t i = 0; i < count; i++)
+                {
+                    if(mParentIds[i] == mEvaluationOrder[next]) mEvaluationOrder.push_back(i);
+                }
+            }
+            assert(mEvaluationOrder.size() == count);
+        }
+
+        mBoneTransforms.resize(count);
+        mBoneInvTransposeTransforms.resize(count);
         setActiveAnimation(kBindPoseAnimationId);
     }
 
     AnimationController::AnimationController(const AnimationController& other)
     {
-        mBones = other.mBones;
+        mParentIds = other.mParentIds;
+        mOffsets = other.mOffsets;
+        mLocalTransforms = other.mLocalTransforms;
+        mOriginalLocalTransforms = other.mOriginalLocalTransforms;
+        mGlobalTransforms = other.mGlobalTransforms;
+        mEvaluationOrder = other.mEvaluationOrder;
         mBoneTransforms = other.mBoneTransforms;
         mBoneInvTransposeTransforms = other.mBoneInvTransposeTransforms;
-        for (const auto& it : other.mAnimations)
-        {
-            mAnimations.push_back(Animation::create(*it));
-        }
+        // Animations are immutable, so the copies share them
+        mAnimations = other.mAnimations;
         mActiveAnimation = other.mActiveAnimation;
     }
 
@@ -100,8 +139,99 @@ namespace Falcor
 
     void AnimationController::setBoneLocalTransform(uint32_t boneID, const glm::mat4& transform)
     {
-        assert(boneID < mBones.size());
-        mBones[boneID].localTransform = transform;
+        assert(boneID < mLocalTransforms.size());
+        mLocalTransforms[boneID] = transform;
+    }
+
+    // Bone transforms are affine, so the bottom row of every matrix is (0, 0, 0, 1). The helpers below work on the 4 columns of a glm::mat4 and skip that row.
+    namespace
+    {
+        struct Columns
+        {
+            __m128 c[4];
+        };
+
+        Columns load(const glm::mat4& m)
+        {
+            return { _mm_loadu_ps(&m[0][0]), _mm_loadu_ps(&m[1][0]), _mm_loadu_ps(&m[2][0]), _mm_loadu_ps(&m[3][0]) };
+        }
+
+        void store(const Columns& m, glm::mat4& dst)
+        {
+            for(uint32_t i = 0; i < 4; i++) _mm_storeu_ps(&dst[i][0], m.c[i]);
+        }
+
+        __m128 transformVector(const Columns& a, __m128 v)
+        {
+            __m128 r = _mm_mul_ps(a.c[0], _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+            r = _mm_add_ps(r, _mm_mul_ps(a.c[1], _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+            return _mm_add_ps(r, _mm_mul_ps(a.c[2], _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+        }
+
+        /** a * b for affine matrices. 12 multiply-adds instead of the 16 a general 4x4 product needs
+        */
+        Columns mulAffine(const Columns& a, const Columns& b)
+        {
+            Columns r;
+            r.c[0] = transformVector(a, b.c[0]);
+            r.c[1] = transformVector(a, b.c[1]);
+            r.c[2] = transformVector(a, b.c[2]);
+            r.c[3] = _mm_add_ps(transformVector(a, b.c[3]), a.c[3]);
+            return r;
+        }
+
+        __m128 cross(__m128 a, __m128 b)
+        {
+            __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+            __m128 r = _mm_sub_ps(_mm_mul_ps(a, bYZX), _mm_mul_ps(aYZX, b));
+            return _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 0, 2, 1));
+        }
+
+        __m128 dot3(__m128 a, __m128 b)
+        {
+            __m128 p = _mm_mul_ps(a, b);
+            __m128 r = _mm_add_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)));
+            return _mm_add_ps(r, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)));
+        }
+
+        /** transpose(inverse(m)) for an affine matrix. The upper 3x3 block is the cofactor matrix divided by the determinant, which only takes 3 cross products.
+            The bottom row holds the translation of the inverse, the last column is (0, 0, 0, 1).
+        */
+        Columns inverseTransposeAffine(const Columns& m)
+        {
+            Columns r;
+            r.c[0] = cross(m.c[1], m.c[2]);
+            r.c[1] = cross(m.c[2], m.c[0]);
+            r.c[2] = cross(m.c[0], m.c[1]);
+            __m128 rcpDet = _mm_div_ps(_mm_set1_ps(1.0f), dot3(m.c[0], r.c[0]));
+
+            // Column i of the result is row i of the 3x3 inverse. Its last component is -dot(row i, translation)
+            const __m128 kWMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                r.c[i] = _mm_mul_ps(r.c[i], rcpDet);
+                __m128 w = _mm_sub_ps(_mm_setzero_ps(), dot3(r.c[i], m.c[3]));
+                r.c[i] = _mm_or_ps(_mm_andnot_ps(kWMask, r.c[i]), _mm_and_ps(kWMask, w));
+            }
+            r.c[3] = _mm_set_ps(1, 0, 0, 0);
+            return r;
+        }
+    }
+
+    void AnimationController::updateBone(uint32_t boneID)
+    {
+        Columns global = load(mLocalTransforms[boneID]);
+        uint32_t parentID = mParentIds[boneID];
+        if(parentID != kInvalidBoneID)
+        {
+            global = mulAffine(load(mGlobalTransforms[parentID]), global);
+        }
+        store(global, mGlobalTransforms[boneID]);
+
+        Columns bone = mulAffine(global, load(mOffsets[boneID]));
+        store(bone, mBoneTransforms[boneID]);
+        store(inverseTransposeAffine(bone), mBoneInvTransposeTransforms[boneID]);
     }
 
     void AnimationController::animate(double currentTime)
@@ -111,16 +241,19 @@ namespace Falcor
             mAnimations[mActiveAnimation]->animate(currentTime, this);
         }
 
-        for(uint32_t i = 0; i < mBones.size(); i++)
+        if(mEvaluationOrder.empty())
         {
-            mBones[i].globalTransform = mBones[i].localTransform;
-            if(mBones[i].parentID != kInvalidBoneID)
-            {
-                mBones[i].globalTransform = mBones[mBones[i].parentID].globalTransform * mBones[i].localTransform;
-            }
-            mBoneTransforms[i] = mBones[i].globalTransform * mBones[i].offset;
-            mBoneInvTransposeTransforms[i] = transpose(inverse(mBoneTransforms[i]));
+            for(uint32_t i = 0; i < (uint32_t)mParentIds.size(); i++) updateBone(i);
         }
+        else
+        {
+            for(uint32_t i : mEvaluationOrder) updateBone(i);
+        }
+    }
+
+    void AnimationController::animate(const std::vector<AnimationController*>& controllers, double currentTime)
+    {
+        WorkerPool::getGlobal().parallelFor(0, (uint32_t)controllers.size(), [&](uint32_t i) { controllers[i]->animate(currentTime); });
     }
 
     void AnimationController::setActiveAnimation(uint32_t id)
@@ -129,10 +262,7 @@ namespace Falcor
         mActiveAnimation = id;
         if(id == kBindPoseAnimationId)
         {
-            for(auto& bone : mBones)
-            {
-                bone.localTransform = bone.originalLocalTransform;
-            }
+            mLocalTransforms = mOriginalLocalTransforms;
         }
         animate(0);
     }
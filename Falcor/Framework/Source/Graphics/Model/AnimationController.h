@@ -62,6 +62,10 @@ namespace Falcor
         void addAnimation(Animation::UniquePtr pAnimation);
         void animate(double currentTime);
 
+        /** Animate multiple controllers concurrently on the global worker pool. Animations are immutable, so controllers created from the same model can share them. A controller must appear in the list only once.
+        */
+        static void animate(const std::vector<AnimationController*>& controllers, double currentTime);
+
         uint32_t getAnimationCount() const { return uint32_t(mAnimations.size()); }
         const std::string& getAnimationName(uint32_t ID) const;
         void setActiveAnimation(uint32_t id);
@@ -69,7 +73,7 @@ namespace Falcor
 
         const std::vector<mat4>& getBoneMatrices() const { return mBoneTransforms; }
         const std::vector<mat4>& getBoneInvTransposeMatrices() const { return mBoneInvTransposeTransforms; }
-        uint32_t getBoneCount() const { return uint32_t(mBones.size()); }
+        uint32_t getBoneCount() const { return uint32_t(mParentIds.size()); }
 
         uint32_t getBoneIdFromName(const std::string& name) const;
         void setBoneLocalTransform(uint32_t boneID, const glm::mat4& transform);
@@ -78,13 +82,19 @@ namespace Falcor
         AnimationController(const std::vector<Bone>& bones);
         AnimationController(const AnimationController& other);
 
-        std::vector<Bone> mBones;
+        // Bone data in structure-of-arrays layout. All the transforms are affine.
+        std::vector<uint32_t> mParentIds;
+        std::vector<glm::mat4> mOffsets;
+        std::vector<glm::mat4> mLocalTransforms;
+        std::vector<glm::mat4> mOriginalLocalTransforms;
+        std::vector<glm::mat4> mGlobalTransforms;
+        std::vector<uint32_t> mEvaluationOrder;     // Parents before children. Empty if the bone IDs are already in that order
         std::vector<glm::mat4> mBoneTransforms;
         std::vector<glm::mat4> mBoneInvTransposeTransforms;
-        std::vector<Animation::UniquePtr> mAnimations;
+        std::vector<Animation::SharedConstPtr> mAnimations;
 
         uint32_t mActiveAnimation = kBindPoseAnimationId;
 
-        void calculateBoneTransforms();
+        void updateBone(uint32_t boneID);
     };
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "CpuSkinning.h"
+#include "Utils/WorkerPool.h"
+#include <cstring>
+#include <xmmintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kVerticesPerJob = 1024;
+
+        __m128 loadVec3(const glm::vec3& v)
+        {
+            return _mm_setr_ps(v.x, v.y, v.z, 0.0f);
+        }
+
+        void storeVec3(glm::vec3& dst, __m128 v)
+        {
+            alignas(16) float result[4];
+            _mm_store_ps(result, v);
+            dst = glm::vec3(result[0], result[1], result[2]);
+        }
+
+        // Weighted sum of the first columnCount columns of the 4 bone matrices of a vertex
+        void blendColumns(const glm::mat4* pMatrices, const uint8_t* pIds, __m128 weights[4], uint32_t columnCount, __m128 columns[4])
+        {
+            const glm::mat4& first = pMatrices[pIds[0]];
+            for (uint32_t c = 0; c < columnCount; c++)
+            {
+                columns[c] = _mm_mul_ps(_mm_loadu_ps(&first[c][0]), weights[0]);
+            }
+
+            for (uint32_t b = 1; b < 4; b++)
+            {
+                const glm::mat4& bone = pMatrices[pIds[b]];
+                for (uint32_t c = 0; c < columnCount; c++)
+                {
+                    columns[c] = _mm_add_ps(columns[c], _mm_mul_ps(_mm_loadu_ps(&bone[c][0]), weights[b]));
+                }
+            }
+        }
+
+        __m128 transformVector(const __m128 columns[4], const glm::vec3& v)
+        {
+            __m128 r = _mm_mul_ps(columns[0], _mm_set1_ps(v.x));
+            r = _mm_add_ps(r, _mm_mul_ps(columns[1], _mm_set1_ps(v.y)));
+            return _mm_add_ps(r, _mm_mul_ps(columns[2], _mm_set1_ps(v.z)));
+        }
+    }
+
+    void skinVertices(const SkinningInput& input, const glm::mat4* pBoneMatrices, const glm::mat4* pBoneInvTransposeMatrices, const SkinningOutput& output, uint32_t first, uint32_t count)
+    {
+        const bool skinPositions = output.pPositions != nullptr;
+        const bool skinNormals = input.pNormals && output.pNormals;
+        const bool skinBitangents = input.pBitangents && output.pBitangents;
+
+        for (uint32_t v = first; v < first + count; v++)
+        {
+            const uint8_t* pIds = &input.pBoneIds[v * 4];
+            const glm::vec4& w = input.pBoneWeights[v];
+            __m128 weights[4] = { _mm_set1_ps(w.x), _mm_set1_ps(w.y), _mm_set1_ps(w.z), _mm_set1_ps(w.w) };
+
+            __m128 boneMat[4];
+            blendColumns(pBoneMatrices, pIds, weights, skinPositions ? 4 : 3, boneMat);
+            if (skinPositions)
+            {
+                storeVec3(output.pPositions[v], _mm_add_ps(transformVector(boneMat, input.pPositions[v]), boneMat[3]));
+            }
+            if (skinBitangents)
+            {
+                storeVec3(output.pBitangents[v], transformVector(boneMat, input.pBitangents[v]));
+            }
+            if (skinNormals)
+            {
+                __m128 invTransposeMat[4];
+                blendColumns(pBoneInvTransposeMatrices, pIds, weights, 3, invTransposeMat);
+                storeVec3(output.pNormals[v], transformVector(invTransposeMat, input.pNormals[v]));
+            }
+        }
+    }
+
+    void scatterVertexStream(const glm::vec3* pData, uint32_t count, uint32_t stride, uint32_t offset, uint8_t* pDst)
+    {
+        assert(stride >= sizeof(glm::vec3));
+        for (uint32_t i = 0; i < count; i++)
+        {
+            std::memcpy(pDst + (size_t)i * stride + offset, &pData[i], sizeof(glm::vec3));
+        }
+    }
+
+    void skinVerticesParallel(const SkinningInput& input, const glm::mat4* pBoneMatrices, const glm::mat4* pBoneInvTransposeMatrices, const SkinningOutput& output, uint32_t vertexCount)
+    {
+        const uint32_t jobCount = (vertexCount + kVerticesPerJob - 1) / kVerticesPerJob;
+        WorkerPool::getGlobal().parallelFor(0, jobCount, [&](uint32_t job)
+        {
+            const uint32_t first = job * kVerticesPerJob;
+            skinVertices(input, pBoneMatrices, pBoneInvTransposeMatrices, output, first, std::min(kVerticesPerJob, vertexCount - first));
+        });
+    }
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <cstdint>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "glm/mat4x4.hpp"
+
+namespace Falcor
+{
+    /** Vertex streams read by CPU skinning. The layouts match the vertex buffers the importers create for skinned meshes:
+        RGB32Float positions, normals and bitangents, RGBA32Float bone weights and RGBA8Uint bone IDs.
+    */
+    struct SkinningInput
+    {
+        const glm::vec3* pPositions = nullptr;
+        const glm::vec3* pNormals = nullptr;        ///< Optional
+        const glm::vec3* pBitangents = nullptr;     ///< Optional
+        const glm::vec4* pBoneWeights = nullptr;
+        const uint8_t* pBoneIds = nullptr;          ///< 4 IDs per vertex
+    };
+
+    /** Vertex streams written by CPU skinning, in the layout of the skinned vertex buffers of SkinningCache. Null streams are skipped.
+    */
+    struct SkinningOutput
+    {
+        glm::vec3* pPositions = nullptr;
+        glm::vec3* pNormals = nullptr;
+        glm::vec3* pBitangents = nullptr;
+    };
+
+    /** Blend a range of vertices with their 4 bones on the CPU, using SSE. The results match the vertex shader and compute skinning:
+        positions and bitangents are transformed by the weighted sum of the bone matrices, and normals by the weighted sum of the inverse-transpose bone matrices.
+        \param[in] input The vertices
+        \param[in] pBoneMatrices The bone matrices, see Model::getBoneMatrices()
+        \param[in] pBoneInvTransposeMatrices The inverse-transpose bone matrices, see Model::getBoneInvTransposeMatrices()
+        \param[out] output The skinned vertices
+        \param[in] first The first vertex of the range
+        \param[in] count Number of vertices in the range
+    */
+    void skinVertices(const SkinningInput& input, const glm::mat4* pBoneMatrices, const glm::mat4* pBoneInvTransposeMatrices, const SkinningOutput& output, uint32_t first, uint32_t count);
+
+    /** Blend all the vertices of a mesh with their bones, splitting the vertices in ranges across the global worker pool. See skinVertices().
+    */
+    void skinVerticesParallel(const SkinningInput& input, const glm::mat4* pBoneMatrices, const glm::mat4* pBoneInvTransposeMatrices, const SkinningOutput& output, uint32_t vertexCount);
+
+    /** Copy a skinned stream into the layout of a vertex buffer element. The bytes between the vertices are left unchanged.
+        \param[in] pData The skinned vertices
+        \param[in] count Number of vertices
+        \param[in] stride Byte distance between vertices in the vertex buffer. At least 12
+        \param[in] offset Byte offset of the element inside a vertex
+        \param[out] pDst The vertex buffer data. Must hold at least offset + (count - 1) * stride + 12 bytes
+    */
+    void scatterVertexStream(const glm::vec3* pData, uint32_t count, uint32_t stride, uint32_t offset, uint8_t* pDst);
+}
@@ -26,8 +26,10 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #include "assimp/Importer.hpp"
+#include "assimp/Exporter.hpp"
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
+#include "assimp/version.h"
 #include "glm/matrix.hpp"
 #include "glm/common.hpp"
 #include "glm/geometric.hpp"
@@ -42,10 +44,16 @@
 #include "API/Buffer.h"
 #include "Utils/Platform/OS.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCache.h"
 #include "API/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
 #include "API/Device.h"
+#include "TangentSpaceHelper.h"
+#include "Utils/WorkerPool.h"
+#include "Graphics/Program/ShaderCache.h"
+#include <random>
+#include <sstream>
 
 namespace Falcor
 {
@@ -59,17 +67,6 @@ namespace Falcor
 
     using VertexIdsVec = std::vector<uvec8_4>;
 
-    template<typename posType>
-    void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
-        uint32_t vertexCount,
-        const posType* vertexPosData,
-        const glm::vec3* vertexNormalData,
-        const glm::vec2* texCrdData,
-        uint32_t texCrdCount,
-        glm::vec3* bitangentData);
-
-
     void loadBones(const aiMesh* pAiMesh, VertexWeightsVec& weights, VertexIdsVec& ids, uint32_t vertexCount, const std::map<std::string, uint32_t>& boneNameToIdMap)
     {
         if (pAiMesh->mNumBones > 0xff)
@@ -174,7 +171,7 @@ namespace Falcor
                 }
             }
 
-            generateSubmeshTangentData<glm::vec3>(indices, pAiMesh->mNumVertices, pPos, pNormals, (texCrdCount > 0 ? texCrd.data() : nullptr), texCrdCount, pBi);
+            generateSubmeshTangentData<glm::vec3>(indices.data(), (uint32_t)indices.size(), pAiMesh->mNumVertices, pPos, pNormals, (texCrdCount > 0 ? texCrd.data() : nullptr), texCrdCount, pBi);
         }
     }
 
@@ -268,7 +265,75 @@ namespace Falcor
         }
     }
 
-    void AssimpModelImporter::loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb)
+    void AssimpModelImporter::loadAllTextures(const aiScene* pScene, const std::string& folder, bool useSrgb)
+    {
+        struct TextureRequest
+        {
+            std::string name;
+            std::string fullpath;
+            bool isSrgb;
+            TextureFileData::UniquePtr pData;
+        };
+
+        // Collect the unique textures referenced by the materials. The first material using a texture decides its format, same as the cache lookup did before
+        std::vector<TextureRequest> requests;
+        std::unordered_set<std::string> requested;
+        for (uint32_t m = 0; m < pScene->mNumMaterials; m++)
+        {
+            const aiMaterial* pAiMaterial = pScene->mMaterials[m];
+            for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
+            {
+                aiTextureType aiType = (aiTextureType)i;
+                if (pAiMaterial->GetTextureCount(aiType) != 1) continue;
+
+                aiString path;
+                pAiMaterial->GetTexture(aiType, 0, &path);
+                std::string s(path.data);
+                if (s.empty() || mTextureCache.count(s) || requested.count(s)) continue;
+
+                requested.insert(s);
+                std::string fullpath = replaceSubstring(folder + '/' + s, "\\", "/");
+                bool isSrgb = isSrgbRequired(aiType, useSrgb);
+
+                // Textures shared with previously loaded models don't need to be decoded again
+                Texture::SharedPtr pTex = TextureCache::find(fullpath, true, isSrgb, Texture::BindFlags::ShaderResource);
+                if (pTex)
+                {
+                    mTextureCache[s] = pTex;
+                    continue;
+                }
+                requests.push_back({ s, fullpath, isSrgb, nullptr });
+            }
+        }
+
+        // Decode the files concurrently and create the API objects on this thread. Work in batches so we don't hold every decoded image in memory at once
+        WorkerPool& pool = WorkerPool::getGlobal();
+        const uint32_t batchSize = pool.getThreadCount() * 4;
+        for (uint32_t first = 0; first < (uint32_t)requests.size(); first += batchSize)
+        {
+            uint32_t last = std::min((uint32_t)requests.size(), first + batchSize);
+            pool.parallelFor(first, last, [&](uint32_t r)
+            {
+                requests[r].pData = loadTextureFile(requests[r].fullpath);
+            });
+
+            for (uint32_t r = first; r < last; r++)
+            {
+                Texture::SharedPtr pTex = createTextureFromFileData(*requests[r].pData, true, requests[r].isSrgb);
+                if (pTex)
+                {
+                    mTextureCache[requests[r].name] = pTex;
+                    TextureCache::add(requests[r].fullpath, true, requests[r].isSrgb, Texture::BindFlags::ShaderResource, pTex);
+                }
+                requests[r].pData = nullptr;
+            }
+
+            // Flush upload heap after every batch so we don't accumulate a ton of memory usage when loading a model with a lot of textures
+            gpDevice->flushAndSync();
+        }
+    }
+
+    void AssimpModelImporter::loadTextures(const aiMaterial* pAiMaterial, Material* pMaterial, bool isObjFile)
     {
         for (int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
         {
@@ -288,7 +353,6 @@ namespace Falcor
                 aiString path;
                 pAiMaterial->GetTexture(aiType, 0, &path);
                 std::string s(path.data);
-                Texture::SharedPtr pTex = nullptr;
 
                 if (s.empty())
                 {
@@ -296,34 +360,17 @@ namespace Falcor
                     continue;
                 }
 
-                // Check if the texture was already loaded
+                // The texture was loaded by loadAllTextures()
                 const auto& a = mTextureCache.find(s);
-                if (a != mTextureCache.end())
-                {
-                    pTex = a->second;
-                }
-                else
-                {
-                    // create a new texture
-                    std::string fullpath = folder + '/' + s;
-                    fullpath = replaceSubstring(fullpath, "\\", "/");
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb));
-                    if (pTex)
-                    {
-                        mTextureCache[s] = pTex;
-                    }
-                }
+                Texture::SharedPtr pTex = (a != mTextureCache.end()) ? a->second : nullptr;
 
                 assert(pTex != nullptr);
                 setTexture(aiType, isObjFile, pMaterial, pTex);
             }
         }
-
-        // Flush upload heap after every material so we don't accumulate a ton of memory usage when loading a model with a lot of textures
-        gpDevice->flushAndSync();
     }
 
-    Material::SharedPtr AssimpModelImporter::createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb)
+    Material::SharedPtr AssimpModelImporter::createMaterial(const aiMaterial* pAiMaterial, bool isObjFile)
     {
         aiString name;
         pAiMaterial->Get(AI_MATKEY_NAME, name);
@@ -331,7 +378,7 @@ namespace Falcor
         std::transform(nameStr.begin(), nameStr.end(), nameStr.begin(), ::tolower);
 
         Material::SharedPtr pMaterial = Material::create(nameStr);
-        loadTextures(pAiMaterial, folder, pMaterial.get(), isObjFile, useSrgb);
+        loadTextures(pAiMaterial, pMaterial.get(), isObjFile);
 
         // Opacity
         float opacity;
@@ -417,10 +464,12 @@ namespace Falcor
 
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
     {
+        loadAllTextures(pScene, modelFolder, useSrgb);
+
         for (uint32_t i = 0; i < pScene->mNumMaterials; i++)
         {
             const aiMaterial* pAiMaterial = pScene->mMaterials[i];
-            auto pMaterial = createMaterial(pAiMaterial, modelFolder, isObjFile, useSrgb);
+            auto pMaterial = createMaterial(pAiMaterial, isObjFile);
             if (pMaterial == nullptr)
             {
                 logError("Can't allocate memory for material");
@@ -438,7 +487,7 @@ namespace Falcor
         return true;
     }
 
-    bool AssimpModelImporter::parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, IdToMesh& aiToFalcorMesh)
+    bool AssimpModelImporter::parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, std::vector<MeshData>& meshData, IdToMesh& aiToFalcorMesh)
     {
         if (pCurrent->mNumMeshes)
         {
@@ -460,7 +509,8 @@ namespace Falcor
                 if (aiToFalcorMesh.find(aiId) == aiToFalcorMesh.end())
                 {
                     // Cache mesh
-                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId]);
+                    aiToFalcorMesh[aiId] = createMesh(pScene->mMeshes[aiId], meshData[aiId]);
+                    meshData[aiId] = MeshData();
                 }
 
                 mModel.addMeshInstance(aiToFalcorMesh[aiId], aiMatToGLM(transform));
@@ -471,26 +521,133 @@ namespace Falcor
         // visit the children
         for (uint32_t i = 0; i < pCurrent->mNumChildren; i++)
         {
-            b |= parseAiSceneNode(pCurrent->mChildren[i], pScene, aiToFalcorMesh);
+            b |= parseAiSceneNode(pCurrent->mChildren[i], pScene, meshData, aiToFalcorMesh);
         }
         return b;
     }
 
+    static void findUsedMeshes(const aiNode* pCurrent, std::vector<bool>& isUsed)
+    {
+        for (uint32_t i = 0; i < pCurrent->mNumMeshes; i++)
+        {
+            isUsed[pCurrent->mMeshes[i]] = true;
+        }
+
+        for (uint32_t i = 0; i < pCurrent->mNumChildren; i++)
+        {
+            findUsedMeshes(pCurrent->mChildren[i], isUsed);
+        }
+    }
+
     bool AssimpModelImporter::createDrawList(const aiScene* pScene)
     {
         createAnimationController(pScene);
+
+        // Meshes are independent, so build their CPU data concurrently. The API objects are created while walking the scene graph
+        std::vector<bool> isUsed(pScene->mNumMeshes, false);
+        findUsedMeshes(pScene->mRootNode, isUsed);
+        std::vector<uint32_t> usedMeshes;
+        for (uint32_t i = 0; i < pScene->mNumMeshes; i++)
+        {
+            if (isUsed[i]) usedMeshes.push_back(i);
+        }
+
+        std::vector<MeshData> meshData(pScene->mNumMeshes);
+        WorkerPool::getGlobal().parallelFor(0, (uint32_t)usedMeshes.size(), [&](uint32_t i)
+        {
+            uint32_t aiId = usedMeshes[i];
+            createMeshData(pScene->mMeshes[aiId], meshData[aiId]);
+        });
+
+        for (uint32_t aiId : usedMeshes)
+        {
+            const MeshData& data = meshData[aiId];
+            if (data.optimized)
+            {
+                mCacheReport.add(data.cacheStatsBefore, data.cacheStatsAfter, data.getIndexCount() / 3);
+            }
+        }
+
         IdToMesh aiToFalcorMeshId;
         aiNode* pRoot = pScene->mRootNode;
-        return parseAiSceneNode(pRoot, pScene, aiToFalcorMeshId);
+        return parseAiSceneNode(pRoot, pScene, meshData, aiToFalcorMeshId);
+    }
+
+    AssimpModelImporter::ParsedFile::ParsedFile() = default;
+    AssimpModelImporter::ParsedFile::~ParsedFile() = default;
+
+    // Import snapshots are post-processed scenes stored in ASSIMP's binary format. Reading them back doesn't require any post-processing,
+    // which is where most of the import time goes. Bump the version whenever the post-processing flags are changed in a way the key doesn't capture.
+    static const uint32_t kSnapshotVersion = 1;
+    static const uint64_t kSnapshotHashSeed = 14695981039346656037ull;
+
+    static bool getSnapshotFilename(const std::string& fullpath, uint32_t assimpFlags, std::string& snapshotFilename)
+    {
+        std::string content;
+        if (readFileToString(fullpath, content) == false) return false;
+        // Snapshots are post-processed and serialized by Assimp, so a different Assimp build or different post-process flags invalidate them
+        uint32_t assimpVersion[] = { aiGetVersionMajor(), aiGetVersionMinor(), aiGetVersionRevision() };
+        uint64_t key = ShaderCache::hash(&kSnapshotVersion, sizeof(kSnapshotVersion), kSnapshotHashSeed);
+        key = ShaderCache::hash(assimpVersion, sizeof(assimpVersion), key);
+        key = ShaderCache::hash(&assimpFlags, sizeof(assimpFlags), key);
+        key = ShaderCache::hash(content, key);
+
+        // OBJ materials live in separate files, which are inputs of the import as well
+        if (hasSuffix(fullpath, ".obj", false))
+        {
+            std::istringstream lines(content);
+            std::string line;
+            std::string folder = getDirectoryFromFile(fullpath);
+            while (std::getline(lines, line))
+            {
+                std::string mtlContent;
+                if (line.compare(0, 7, "mtllib ") == 0 && readFileToString(folder + "/" + removeLeadingTrailingWhitespaces(line.substr(7)), mtlContent))
+                {
+                    key = ShaderCache::hash(mtlContent, key);
+                }
+            }
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.assbin", (unsigned long long)key);
+        snapshotFilename = getExecutableDirectory() + "/ModelCache/" + name;
+        return true;
     }
 
-    bool AssimpModelImporter::initModel(const std::string& filename)
+    static void writeSnapshot(const aiScene* pScene, const std::string& snapshotFilename)
     {
-        std::string fullpath;
-        if (findFileInDataDirectories(filename, fullpath) == false)
+        std::string directory = getDirectoryFromFile(snapshotFilename);
+        if (isDirectoryExists(directory) == false && createDirectory(directory) == false && isDirectoryExists(directory) == false)
+        {
+            logWarning("Can't create the model cache directory '" + directory + "'");
+            return;
+        }
+
+        // Export to a uniquely named file and rename it into place, so that concurrent loads never read a partial snapshot
+        std::random_device rd;
+        std::string tempFilename = snapshotFilename + "." + std::to_string(rd()) + std::to_string(rd()) + ".tmp";
+        Assimp::Exporter exporter;
+        if (exporter.Export(pScene, "assbin", tempFilename) != aiReturn_SUCCESS)
+        {
+            logWarning("Can't write model snapshot '" + snapshotFilename + "'\n" + exporter.GetErrorString());
+            std::remove(tempFilename.c_str());
+            return;
+        }
+
+        if (replaceFile(tempFilename, snapshotFilename) == false)
+        {
+            std::remove(tempFilename.c_str());
+        }
+    }
+
+    AssimpModelImporter::ParsedFile::SharedPtr AssimpModelImporter::parseFile(const std::string& filename, Model::LoadFlags flags)
+    {
+        ParsedFile::SharedPtr pFile = std::make_shared<ParsedFile>();
+        pFile->filename = filename;
+        if (findFileInDataDirectories(filename, pFile->fullpath) == false)
         {
             logError(std::string("Can't find model file ") + filename, true);
-            return false;
+            return nullptr;
         }
 
         uint32_t assimpFlags = aiProcessPreset_TargetRealtime_MaxQuality |
@@ -498,27 +655,48 @@ namespace Falcor
             aiProcess_FlipUVs |
             0;
 
-        if(is_set(mFlags, Model::LoadFlags::FindDegeneratePrimitives) == false) assimpFlags &= ~aiProcess_FindDegenerates;
-        if(is_set(mFlags, Model::LoadFlags::DontMergeMeshes))                   assimpFlags &= ~aiProcess_OptimizeMeshes; // Avoid merging original meshes
-        if(is_set(mFlags, Model::LoadFlags::RemoveInstancing))                  assimpFlags |= aiProcess_PreTransformVertices;
+        if(is_set(flags, Model::LoadFlags::FindDegeneratePrimitives) == false) assimpFlags &= ~aiProcess_FindDegenerates;
+        if(is_set(flags, Model::LoadFlags::DontMergeMeshes))                   assimpFlags &= ~aiProcess_OptimizeMeshes; // Avoid merging original meshes
+        if(is_set(flags, Model::LoadFlags::RemoveInstancing))                  assimpFlags |= aiProcess_PreTransformVertices;
 
         // Never use Assimp's tangent gen code
         assimpFlags &= ~(aiProcess_CalcTangentSpace);
 
-        Assimp::Importer importer;
-        const aiScene* pScene = importer.ReadFile(fullpath, assimpFlags);
+        pFile->pImporter = std::make_unique<Assimp::Importer>();
+
+        std::string snapshotFilename;
+        bool useSnapshot = is_set(flags, Model::LoadFlags::UseImportCache) && getSnapshotFilename(pFile->fullpath, assimpFlags, snapshotFilename);
+        if (useSnapshot && doesFileExist(snapshotFilename))
+        {
+            // The snapshot was post-processed when it was written. Keep the original filename and path, textures are resolved relative to them
+            pFile->pScene = pFile->pImporter->ReadFile(snapshotFilename, 0);
+            if (pFile->pScene && verifyScene(pFile->pScene)) return pFile;
+            logWarning("Can't read model snapshot '" + snapshotFilename + "'. Importing '" + filename + "' from source.");
+            pFile->pImporter->FreeScene();
+        }
+
+        pFile->pScene = pFile->pImporter->ReadFile(pFile->fullpath, assimpFlags);
 
-        if((pScene == nullptr) || (verifyScene(pScene) == false))
+        if((pFile->pScene == nullptr) || (verifyScene(pFile->pScene) == false))
         {
             std::string str("Can't open model file '");
-            str = str + std::string(filename) + "'\n" + importer.GetErrorString();
+            str = str + std::string(filename) + "'\n" + pFile->pImporter->GetErrorString();
             logError(str, true);
-            return false;
+            return nullptr;
         }
 
+        if (useSnapshot) writeSnapshot(pFile->pScene, snapshotFilename);
+        return pFile;
+    }
+
+    bool AssimpModelImporter::initModel(const ParsedFile& file)
+    {
+        const aiScene* pScene = file.pScene;
+        const std::string& filename = file.filename;
+
         // Extract the folder name
-        auto last = fullpath.find_last_of("/\\");
-        std::string modelFolder = fullpath.substr(0, last);
+        auto last = file.fullpath.find_last_of("/\\");
+        std::string modelFolder = file.fullpath.substr(0, last);
 
         // Order of initialization matters, materials, bones and animations need to loaded before mesh initialization
         bool isObjFile = hasSuffix(filename, ".obj", false);
@@ -535,13 +713,23 @@ namespace Falcor
             return false;
         }
 
+        if (mCacheReport.getMeshCount() > 0)
+        {
+            logInfo(filename + ": " + mCacheReport.getMessage());
+        }
         return true;
     }
 
     bool AssimpModelImporter::import(Model& model, const std::string& filename, Model::LoadFlags flags)
+    {
+        ParsedFile::SharedPtr pFile = parseFile(filename, flags);
+        return pFile ? import(model, pFile, flags) : false;
+    }
+
+    bool AssimpModelImporter::import(Model& model, const ParsedFile::SharedPtr& pFile, Model::LoadFlags flags)
     {
         AssimpModelImporter loader(model, flags);
-        return loader.initModel(filename);
+        return loader.initModel(*pFile);
     }
 
     bool AssimpModelImporter::isUsedNode(const aiNode* pNode) const
@@ -744,12 +932,11 @@ namespace Falcor
         return BoundingBox::fromMinMax(boxMin, boxMax);
     }
 
-    Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh)
+    void AssimpModelImporter::createMeshData(const aiMesh* pAiMesh, MeshData& data) const
     {
         uint32_t vertexCount = pAiMesh->mNumVertices;
-        uint32_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
-        auto pIB = createIndexBuffer(pAiMesh);
-        BoundingBox boundingBox = createMeshBbox(pAiMesh);
+        data.indices = createIndexBufferData(pAiMesh);
+        data.boundingBox = createMeshBbox(pAiMesh);
 
         const bool generateTangentSpace = (pAiMesh->HasTangentsAndBitangents() == false) && (is_set(mFlags, Model::LoadFlags::DontGenerateTangentSpace) == false);
         if (generateTangentSpace)
@@ -757,74 +944,132 @@ namespace Falcor
             genTangentSpace(pAiMesh);
         }
 
-        VertexLayout::SharedPtr pLayout = createVertexLayout(pAiMesh);
-        if (pLayout == nullptr)
+        data.pLayout = createVertexLayout(pAiMesh);
+        if (data.pLayout)
         {
-            assert(0);
-            return nullptr;
-        }
+            // Initialize the bones data
+            VertexWeightsVec weights;
+            VertexIdsVec ids;
+            if (pAiMesh->HasBones())
+            {
+                loadBones(pAiMesh, weights, ids, vertexCount, mBoneNameToIdMap);
+            }
 
-        std::vector<Buffer::SharedPtr> pVBs(pLayout->getBufferCount());
+            // Create corresponding vertex buffers
+            data.vertexData.resize(data.pLayout->getBufferCount());
+            for (uint32_t i = 0; i < data.pLayout->getBufferCount(); i++)
+            {
+                const VertexBufferLayout* pVbLayout = data.pLayout->getBufferLayout(i).get();
+                data.vertexData[i] = createVertexBufferData(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
+            }
 
-        // Initialize the bones data
-        VertexWeightsVec weights;
-        VertexIdsVec ids;
-        if (pAiMesh->HasBones())
-        {
-            loadBones(pAiMesh, weights, ids, vertexCount, mBoneNameToIdMap);
+            switch (pAiMesh->mFaces[0].mNumIndices)
+            {
+            case 1:
+                data.topology = Vao::Topology::PointList;
+                break;
+            case 2:
+                data.topology = Vao::Topology::LineList;
+                break;
+            case 3:
+                data.topology = Vao::Topology::TriangleList;
+                break;
+            default:
+                logError(std::string("Error when creating mesh. Unknown topology with " + std::to_string(pAiMesh->mFaces[0].mNumIndices) + " indices."));
+                assert(0);
+            }
+
+            // Optimizing and simplifying work on a copy of the positions, which is also what the mesh keeps for ray queries and meshlet generation
+            const Model::LoadFlags keepCpuGeometryFlags = Model::LoadFlags::KeepCpuGeometry | Model::LoadFlags::GenerateMeshlets;
+            const Model::LoadFlags cpuPositionFlags = keepCpuGeometryFlags | Model::LoadFlags::OptimizeMeshes | Model::LoadFlags::GenerateLods;
+            if (data.topology == Vao::Topology::TriangleList && is_set(mFlags, cpuPositionFlags))
+            {
+                const glm::vec3* pAiPositions = (const glm::vec3*)pAiMesh->mVertices;
+                auto pPositions = std::make_shared<std::vector<glm::vec3>>(pAiPositions, pAiPositions + vertexCount);
+
+                if (is_set(mFlags, Model::LoadFlags::OptimizeMeshes))
+                {
+                    uint32_t* pIndices = data.indices.data();
+                    const uint32_t indexCount = (uint32_t)data.indices.size();
+                    data.cacheStatsBefore = analyzeVertexCache(pIndices, indexCount, vertexCount);
+
+                    optimizeVertexCache(pIndices, indexCount, vertexCount);
+                    optimizeOverdraw(pIndices, indexCount, pPositions->data(), vertexCount);
+                    std::vector<uint32_t> remap = optimizeVertexFetch(pIndices, indexCount, vertexCount);
+                    for (uint32_t i = 0; i < data.pLayout->getBufferCount(); i++)
+                    {
+                        remapVertexData(data.vertexData[i].data(), data.pLayout->getBufferLayout(i)->getStride(), remap);
+                    }
+                    remapVertexData(pPositions->data(), sizeof(glm::vec3), remap);
+
+                    data.cacheStatsAfter = analyzeVertexCache(pIndices, indexCount, vertexCount);
+                    data.optimized = true;
+                }
+
+                if (is_set(mFlags, Model::LoadFlags::GenerateLods))
+                {
+                    data.lods = generateLods(data.indices, pPositions->data(), vertexCount, Model::getLodSettings());
+                }
+                if (is_set(mFlags, keepCpuGeometryFlags))
+                {
+                    data.pPositions = pPositions;
+                }
+            }
+
+            auto materialIt = mAiMaterialToFalcor.find(pAiMesh->mMaterialIndex);
+            const Material* pMaterial = (materialIt != mAiMaterialToFalcor.end()) ? materialIt->second.get() : nullptr;
+            data.indexFormat = getIndexFormat(vertexCount, mFlags, pMaterial);
+            if (canQuantizeVertices(mFlags, pMaterial, pAiMesh->HasBones()))
+            {
+                data.pLayout = quantizeVertices(data.pLayout.get(), data.vertexData, vertexCount, data.positionScale, data.positionOffset);
+                data.quantized = true;
+            }
+            data.isValid = true;
         }
 
-        // Create corresponding vertex buffers
-        for (uint32_t i = 0; i < pLayout->getBufferCount(); i++)
+        if (generateTangentSpace)
         {
-            const VertexBufferLayout* pVbLayout = pLayout->getBufferLayout(i).get();
-            pVBs[i] = createVertexBuffer(pAiMesh, pVbLayout, (uint8_t*)ids.data(), weights.data());
+            aiMesh* pM = const_cast<aiMesh*>(pAiMesh);
+            safe_delete_array(pM->mBitangents);
         }
+    }
 
-        Vao::Topology topology = Vao::Topology::TriangleList;
-        switch (pAiMesh->mFaces[0].mNumIndices)
+    Mesh::SharedPtr AssimpModelImporter::createMesh(const aiMesh* pAiMesh, const MeshData& data)
+    {
+        if (data.isValid == false)
         {
-        case 1:
-            topology = Vao::Topology::PointList;
-            break;
-        case 2:
-            topology = Vao::Topology::LineList;
-            break;
-        case 3:
-            topology = Vao::Topology::TriangleList;
-            break;
-        default:
-            logError(std::string("Error when creating mesh. Unknown topology with " + std::to_string(pAiMesh->mFaces[0].mNumIndices) + " indices."));
             assert(0);
+            return nullptr;
         }
 
-        auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
-        assert(pMaterial);
-
-        Mesh::SharedPtr pMesh = Mesh::create(pVBs, vertexCount, pIB, indexCount, pLayout, topology, pMaterial, boundingBox, pAiMesh->HasBones());
+        auto pIB = createIndexBuffer(data.indices.data(), (uint32_t)data.indices.size(), data.indexFormat, mFlags);
 
-        if (generateTangentSpace)
+        std::vector<Buffer::SharedPtr> pVBs(data.vertexData.size());
+        for (size_t i = 0; i < data.vertexData.size(); i++)
         {
-            aiMesh* pM = const_cast<aiMesh*>(pAiMesh);
-            safe_delete_array(pM->mBitangents);
+            pVBs[i] = createVertexBuffer(data.vertexData[i]);
         }
 
-        return pMesh;
-    }
+        auto pMaterial = mAiMaterialToFalcor[pAiMesh->mMaterialIndex];
+        assert(pMaterial);
 
-    Buffer::SharedPtr AssimpModelImporter::createIndexBuffer(const aiMesh* pAiMesh)
-    {
-        std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
-        const uint32_t size = (uint32_t)(sizeof(uint32_t) * indices.size());
-        Buffer::BindFlags bindFlags = Buffer::BindFlags::Index;
-        if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
+        const uint32_t indexCount = data.getIndexCount();
+        auto pMesh = Mesh::create(pVBs, pAiMesh->mNumVertices, pIB, indexCount, data.pLayout, data.topology, pMaterial, data.boundingBox, pAiMesh->HasBones(), data.indexFormat);
+        if (data.lods.empty() == false)
         {
-            bindFlags |= Buffer::BindFlags::ShaderResource;
+            pMesh->setLods(data.lods);
         }
-        return Buffer::create(size, bindFlags, Buffer::CpuAccess::None, indices.data());;
+        if (data.quantized)
+        {
+            pMesh->setPositionQuantization(data.positionScale, data.positionOffset);
+        }
+        if (data.pPositions)
+        {
+            pMesh->setCpuGeometry(data.pPositions, std::vector<uint32_t>(data.indices.begin(), data.indices.begin() + indexCount));
+        }
+        return pMesh;
     }
 
-
     bool isElementUsed(const aiMesh* pAiMesh, uint32_t location)
     {
         switch (location)
@@ -852,7 +1097,7 @@ namespace Falcor
         }
     }
 
-    VertexLayout::SharedPtr AssimpModelImporter::createVertexLayout(const aiMesh* pAiMesh)
+    VertexLayout::SharedPtr AssimpModelImporter::createVertexLayout(const aiMesh* pAiMesh) const
     {
         static const uint32_t kMaxSupportedUVs = 2;
         // Must have position!!!
@@ -893,7 +1138,7 @@ namespace Falcor
         return pLayout;
     }
 
-    Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights)
+    std::vector<uint8_t> AssimpModelImporter::createVertexBufferData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights) const
     {
         const uint32_t vertexStride = pLayout->getStride();
         std::vector<uint8_t> initData(vertexStride * pAiMesh->mNumVertices, 0);
@@ -960,12 +1205,17 @@ namespace Falcor
                 memcpy(pDst, pSrc, size);
             }
         }
+        return initData;
+    }
+
+    Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const std::vector<uint8_t>& data)
+    {
         Buffer::BindFlags bindFlags = Buffer::BindFlags::Vertex;
         if (is_set(mFlags, Model::LoadFlags::BuffersAsShaderResource))
         {
             bindFlags |= Buffer::BindFlags::ShaderResource;
         }
 
-        return Buffer::create(vertexStride * pAiMesh->mNumVertices, bindFlags, Buffer::CpuAccess::None, initData.data());;
+        return Buffer::create((uint32_t)data.size(), bindFlags, Buffer::CpuAccess::None, data.data());
     }
 }
\ No newline at end of file
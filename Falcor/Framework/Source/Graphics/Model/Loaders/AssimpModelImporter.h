@@ -27,12 +27,16 @@
 ***************************************************************************/
 #pragma once
 #include <map>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 #include "Graphics/Model/Loaders/ModelImporter.h"
 #include "../AnimationController.h"
 #include "../Mesh.h"
 #include "../Model.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantizer.h"
 
 struct aiScene;
 struct aiNode;
@@ -65,18 +69,71 @@ namespace Falcor
         */
         static bool import(Model& model, const std::string& filename, Model::LoadFlags flags);
 
+        /** A model file parsed by ASSIMP, before any API object was created
+        */
+        struct ParsedFile
+        {
+            using SharedPtr = std::shared_ptr<ParsedFile>;
+            ParsedFile();
+            ~ParsedFile();
+
+            std::string filename;
+            std::string fullpath;
+            std::unique_ptr<Assimp::Importer> pImporter;    // Owns the scene
+            const aiScene* pScene = nullptr;
+        };
+
+        /** Parse a model file. This doesn't touch the device and can be called from any thread.
+            \param[in] filename Model's filename. Can include a full path or a relative path from a data directory
+            \param[in] flags Flags controlling model creation
+            \return The parsed file, or nullptr if the file couldn't be read
+        */
+        static ParsedFile::SharedPtr parseFile(const std::string& filename, Model::LoadFlags flags);
+
+        /** Load a model from a file parsed by parseFile()
+            \param[out] model Model object to load into
+            \param[in] pFile The parsed file
+            \param[in] flags Flags controlling model creation. Should match the flags passed to parseFile()
+            \return Whether import succeeded
+        */
+        static bool import(Model& model, const ParsedFile::SharedPtr& pFile, Model::LoadFlags flags);
+
     private:
 
         using IdToMesh = std::unordered_map<uint32_t, Mesh::SharedPtr>;
 
+        /** CPU-side mesh data. Built concurrently for all meshes, the API objects are created from it afterwards
+        */
+        struct MeshData
+        {
+            bool isValid = false;
+            std::vector<uint32_t> indices;                  // All the levels of detail, back to back
+            std::vector<Mesh::Lod> lods;                    // Empty if no LODs were generated
+            ResourceFormat indexFormat = ResourceFormat::R32Uint;
+            BoundingBox boundingBox;
+            VertexLayout::SharedPtr pLayout;
+            std::vector<std::vector<uint8_t>> vertexData;   // One entry per buffer in the layout
+            Vao::Topology topology = Vao::Topology::TriangleList;
+            Mesh::CpuPositions pPositions;                  // Triangle lists only
+            bool optimized = false;
+            VertexCacheStats cacheStatsBefore;
+            VertexCacheStats cacheStatsAfter;
+            bool quantized = false;
+            glm::vec3 positionScale;
+            glm::vec3 positionOffset;
+
+            uint32_t getIndexCount() const { return lods.empty() ? (uint32_t)indices.size() : lods[0].indexCount; }
+        };
+
         AssimpModelImporter(Model& model, Model::LoadFlags flags);
         AssimpModelImporter(const AssimpModelImporter&) = delete;
         void operator=(const AssimpModelImporter&) = delete;
 
-        bool initModel(const std::string& filename);
+        bool initModel(const ParsedFile& file);
         bool createDrawList(const aiScene* pScene);
-        bool parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, IdToMesh& aiToFalcorMesh);
+        bool parseAiSceneNode(const aiNode* pCurrent, const aiScene* pScene, std::vector<MeshData>& meshData, IdToMesh& aiToFalcorMesh);
         bool createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb);
+        void loadAllTextures(const aiScene* pScene, const std::string& folder, bool useSrgb);
 
         void createAnimationController(const aiScene* pScene);
         void initializeBones(const aiScene* pScene);
@@ -85,12 +142,13 @@ namespace Falcor
 
         Animation::UniquePtr createAnimation(const aiAnimation* pAiAnim);
 
-        Mesh::SharedPtr createMesh(const aiMesh* pAiMesh);
-        VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
-        Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights);
-        void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, Material* pMaterial, bool isObjFile, bool useSrgb);
-        Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
+        void createMeshData(const aiMesh* pAiMesh, MeshData& data) const;
+        Mesh::SharedPtr createMesh(const aiMesh* pAiMesh, const MeshData& data);
+        VertexLayout::SharedPtr createVertexLayout(const aiMesh* pAiMesh) const;
+        std::vector<uint8_t> createVertexBufferData(const aiMesh* pAiMesh, const VertexBufferLayout* pLayout, const uint8_t* pBoneIds, const vec4* pBoneWeights) const;
+        Buffer::SharedPtr createVertexBuffer(const std::vector<uint8_t>& data);
+        void loadTextures(const aiMaterial* pAiMaterial, Material* pMaterial, bool isObjFile);
+        Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, bool isObjFile);
 
         // Checks whether a node or its name corresponds to a used bone or node in the skeleton hierarchy
         bool isUsedNode(const aiNode* pNode) const;
@@ -106,5 +164,6 @@ namespace Falcor
         std::vector<Bone> mBones;
         Model::LoadFlags mFlags;
         std::map<const std::string, Texture::SharedPtr> mTextureCache;
+        VertexCacheReport mCacheReport;
     };
 }
@@ -36,6 +36,8 @@
 #include "BinaryImage.hpp"
 #include "Data/VertexAttrib.h"
 #include "API/Device.h"
+#include <algorithm>
+#include <cstring>
 
 namespace Falcor
 {
@@ -188,6 +190,7 @@ namespace Falcor
         if(writeTextures()    == false) return;
         if(writeMeshes()      == false) return;
         if(writeInstances()   == false) return;
+        if(writeSections()    == false) return;
     }
 
     bool BinaryModelExporter::prepareSubmeshes()
@@ -220,7 +223,62 @@ namespace Falcor
     bool BinaryModelExporter::writeHeader()
     {
         mStream.write("BinScene", 8);
-        mStream << (int32_t)8 << (int32_t)mpModel->getTextureCount() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount;
+        // The texture count, section count and section table offset are only known at the end. writeSections() patches them.
+        mStream << (int32_t)10 << (int32_t)mpModel->getTextureCount() << (int32_t)mMeshes.size() << (int32_t)mInstanceCount;
+        mStream << (int32_t)0 << (uint64_t)0;
+        return true;
+    }
+
+    uint32_t BinaryModelExporter::addSection(std::vector<uint8_t> data)
+    {
+        mSections.push_back(std::move(data));
+        return (uint32_t)(mSections.size() - 1);
+    }
+
+    bool BinaryModelExporter::writeSections()
+    {
+        struct SectionDesc
+        {
+            uint64_t offset;
+            uint64_t size;
+            uint32_t checksum;
+            uint32_t reserved;
+        };
+        std::vector<SectionDesc> table(mSections.size());
+
+        static const uint8_t kPadding[kBinarySectionAlignment] = {};
+        uint64_t offset = mStream.getPosition();
+        for(size_t i = 0; i < mSections.size(); i++)
+        {
+            uint64_t alignedOffset = align_to(kBinarySectionAlignment, offset);
+            mStream.write(kPadding, (size_t)(alignedOffset - offset));
+
+            const auto& data = mSections[i];
+            table[i].offset = alignedOffset;
+            table[i].size = data.size();
+            table[i].checksum = computeSectionChecksum(data.data(), data.size());
+            table[i].reserved = 0;
+            mStream.write(data.data(), data.size());
+            offset = alignedOffset + data.size();
+        }
+
+        uint64_t tableOffset = offset;
+        for(const auto& desc : table)
+        {
+            mStream << desc.offset << desc.size << desc.checksum << desc.reserved;
+        }
+
+        // Patch the header. The texture count is after the format ID and version
+        mStream.seek(12);
+        mStream << (int32_t)(mTextureHash.size() - 1);
+        mStream.seek(24);
+        mStream << (int32_t)table.size() << tableOffset;
+
+        if(mStream.isFail())
+        {
+            error("Failed writing the file");
+            return false;
+        }
         return true;
     }
 
@@ -254,19 +312,16 @@ namespace Falcor
 
     bool BinaryModelExporter::writeCommonMeshData(const Mesh::SharedPtr& pMesh, uint32_t submeshCount)
     {
+        if(pMesh->hasQuantizedPositions())
+        {
+            error("Meshes with quantized vertices can't be exported. Load the model without Model::LoadFlags::QuantizeVertices.");
+            return false;
+        }
+
         auto pVao = pMesh->getVao();
         const uint32_t vertexBufferCount = pMesh->getVao()->getVertexBuffersCount();
         mStream << (int32_t)vertexBufferCount << (int32_t)pMesh->getVertexCount() << (int32_t)submeshCount;
 
-        struct vertexBufferInfo 
-        {
-            Buffer::SharedPtr pBuffer;
-            size_t            pData; //this had the p flag because it represents the pointer to the vertex buffers data
-            uint32_t          stride;
-        };
-            
-        std::vector<vertexBufferInfo> vbInfo(vertexBufferCount);
-
         for (uint32_t i = 0; i < vertexBufferCount; i++)
         {
             const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(i).get();
@@ -286,26 +341,14 @@ namespace Falcor
                 error("Unsupported attribute format");
                 return false;
             }
-            mStream << (int32_t)type << (int32_t)format << (int32_t)channels;
-
-            vbInfo[i].pBuffer = pVao->getVertexBuffer(i);
-            vbInfo[i].stride = pLayout->getStride();
-            vbInfo[i].pData = (size_t)vbInfo[i].pBuffer->map(Buffer::MapType::Read);
-        }
 
-        // Write the vertex buffer
-        for (uint32_t i = 0; i < pMesh->getVertexCount(); ++i)
-        {
-            for (auto& a : vbInfo)
-            { 			
-                mStream.write((void*)a.pData, a.stride);
-                a.pData += a.stride;
-            }
-        }
+            // Each attribute goes into its own section, in the same layout as the vertex buffer
+            const Buffer::SharedPtr& pBuffer = pVao->getVertexBuffer(i);
+            const uint8_t* pData = (const uint8_t*)pBuffer->map(Buffer::MapType::Read);
+            std::vector<uint8_t> data(pData, pData + pLayout->getStride() * pMesh->getVertexCount());
+            pBuffer->unmap();
 
-        for (auto& a : vbInfo)
-        {
-            a.pBuffer->unmap();
+            mStream << (int32_t)type << (int32_t)format << (int32_t)channels << (int32_t)addSection(std::move(data));
         }
 
         return true;
@@ -343,12 +386,34 @@ namespace Falcor
         assert(indexCount % 3 == 0);
         uint32_t primCount = indexCount / 3;
 
-        mStream << (int32_t)primCount;
+        const BoundingBox& box = pMesh->getBoundingBox();
+        mStream << (int32_t)primCount << box.getMinPos() << box.getMaxPos();
+
+        // Output the index buffer, including the levels of detail which follow the full-detail indices
+        const Mesh::Lod& lastLod = pMesh->getLod(pMesh->getLodCount() - 1);
+        const uint32_t totalIndexCount = lastLod.firstIndex + lastLod.indexCount;
+        // The file always stores 32-bit indices
+        std::vector<uint8_t> indices(totalIndexCount * sizeof(uint32_t));
+        const Buffer::SharedPtr& pIB = pMesh->getVao()->getIndexBuffer();
+        const void* pIndices = pIB->map(Buffer::MapType::Read);
+        if(pMesh->getVao()->getIndexBufferFormat() == ResourceFormat::R16Uint)
+        {
+            const uint16_t* pShortIndices = (const uint16_t*)pIndices;
+            std::copy(pShortIndices, pShortIndices + totalIndexCount, (uint32_t*)indices.data());
+        }
+        else
+        {
+            std::memcpy(indices.data(), pIndices, indices.size());
+        }
+        pIB->unmap();
+        mStream << (int32_t)addSection(std::move(indices));
 
-        // Output the index buffer
-        const void* pIndices = pMesh->getVao()->getIndexBuffer()->map(Buffer::MapType::Read);
-        mStream.write(pIndices, indexCount * sizeof(uint32_t));
-        pMesh->getVao()->getIndexBuffer()->unmap();
+        mStream << (int32_t)(pMesh->getLodCount() - 1);
+        for(uint32_t lod = 1; lod < pMesh->getLodCount(); lod++)
+        {
+            assert(pMesh->getLod(lod).firstIndex == pMesh->getLod(lod - 1).firstIndex + pMesh->getLod(lod - 1).indexCount);
+            mStream << (int32_t)(pMesh->getLod(lod).indexCount / 3) << pMesh->getLod(lod).error;
+        }
 
         return true;
     }
@@ -436,20 +501,13 @@ namespace Falcor
 
         uint32_t width = pTexture->getWidth();
         uint32_t height = pTexture->getHeight();
-        ResourceFormat format = pTexture->getFormat();
-        uint32_t bpp = getFormatBytesPerBlock(format);
-
         int32_t formatID = getBinaryFormatID(pTexture->getFormat());
 
-        // Write the data
+        // Write the data. It goes into a section, so it can be uploaded straight from the file when importing.
         std::vector<uint8_t> data = gpDevice->getRenderContext()->readTextureSubresource(pTexture, 0);
 
         writeString(mStream, pTexture->getSourceFilename());
-        mStream.write("BinImage", 8);
-        // Version, width, height, bytes-per-pixel, channel count, FormatID, DataSize
-        mStream << (int32_t)2 << (int32_t)width << (int32_t)height << bpp << (int32_t)0 << formatID << (int32_t)data.size();
-
-        mStream.write(data.data(), data.size());
+        mStream << (int32_t)width << (int32_t)height << formatID << (int32_t)addSection(std::move(data));
         return true;
     }
 }
\ No newline at end of file
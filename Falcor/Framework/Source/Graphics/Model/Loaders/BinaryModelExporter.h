@@ -60,6 +60,12 @@ namespace Falcor
         bool writeCommonMeshData(const Mesh::SharedPtr& pMesh, uint32_t submeshCount);
         bool writeSubmesh(const Mesh::SharedPtr& pMesh);
         bool writeInstances();
+        bool writeSections();
+
+        /** Queue a blob of data to be written into its own section once the object descriptions were written
+            \return The section index
+        */
+        uint32_t addSection(std::vector<uint8_t> data);
 
         bool writeMaterialTexture(uint32_t& texID, const Texture::SharedPtr& pTexture);
         
@@ -71,6 +77,7 @@ namespace Falcor
         bool prepareSubmeshes();
         std::map<const Vao*, std::vector<uint32_t>> mMeshes; // Maps to meshID in model
         std::map<const Texture*, int32_t> mTextureHash;
+        std::vector<std::vector<uint8_t>> mSections;
         uint32_t mInstanceCount = 0; // Not the same as Model::Instance count. Model keeps the total instance count, while the binary format has a concept of meshes and submeshes, and the instance count there is the mesh instance count.
     };
 }
@@ -41,8 +41,13 @@
 #include "Graphics/Material/Material.h"
 #include "glm/geometric.hpp"
 #include "API/Device.h"
+#include "Utils/WorkerPool.h"
+#include "TangentSpaceHelper.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include <numeric>
 #include <cstring>
+#include <atomic>
 
 namespace Falcor
 {
@@ -53,126 +58,34 @@ namespace Falcor
         ResourceFormat format = ResourceFormat::Unknown;
         std::vector<uint8_t> data;
         std::string name;
-    };
-
-    bool isSpecialFloat(float f)
-    {
-        uint32_t d = *(uint32_t*)&f;
-        // Check the exponent
-        d = (d >> 23) & 0xff;
-        return d == 0xff;
-    }
 
-    static vec3 projectNormalToBitangent(const vec3& normal)
-    {
-        vec3 bitangent;
-        if (abs(normal.x) > abs(normal.y))
-        {
-            bitangent = vec3(normal.z, 0.f, -normal.x) / length(vec2(normal.x, normal.z));
-        }
-        else
-        {
-            bitangent = vec3(0.f, normal.z, -normal.y) / length(vec2(normal.y, normal.z));
-        }
-        return normalize(bitangent);
-    }
+        // Location of the image data in the file. Recorded when scanning the file, used when decoding the data
+        uint64_t fileOffset = 0;
+        uint32_t fileDataSize = 0;
+        int32_t bpp = 0;
 
-    static bool isInvalidVec(const vec3& v)
-    {
-        return isSpecialFloat(v.x) || isSpecialFloat(v.y) || isSpecialFloat(v.z);
-    }
+        // v9 files store the texels upload-ready, in which case this points into the file mapping and 'data' is empty.
+        // The mapped section is only validated when the texture is first used, so unused textures are never paged in.
+        const uint8_t* pMappedData = nullptr;
+        uint32_t mappedChecksum = 0;
+    };
 
-    template<typename posType>
-    void generateSubmeshTangentData(
-        const std::vector<uint32_t>& indices,
-        uint32_t vertexCount,
-        const posType* vertexPosData,
-        const glm::vec3* vertexNormalData,
-        const glm::vec2* texCrdData,
-        uint32_t texCrdCount,
-        glm::vec3* bitangentData)
+    struct TexSignature
     {
-        std::memset(bitangentData, 0, vertexCount * sizeof(vec3));
-
-        // calculate the tangent and bitangent for every face
-        size_t primCount = indices.size() / 3;
-        for(size_t primID = 0; primID < primCount; primID++)
-        {
-            struct Data
-            {
-                posType position;
-                glm::vec3 normal;
-                glm::vec2 uv;
-            };
-            Data V[3];
-
-            // Get the data
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                uint32_t index = indices[primID * 3 + i];
-                V[i].position = vertexPosData[index];
-                V[i].normal = vertexNormalData[index];
-                V[i].uv = texCrdData ? texCrdData[index * texCrdCount] : vec2(0);
-            }
-
-            // Position delta
-            posType posDelta[2];
-            posDelta[0] = V[1].position - V[0].position;
-            posDelta[1] = V[2].position - V[0].position;
-
-            // Texture offset
-            glm::vec2 s = V[1].uv - V[0].uv;
-            glm::vec2 t = V[2].uv - V[0].uv;
-
-            glm::vec3 tangent;
-            glm::vec3 bitangent;
-
-            // when t1, t2, t3 in same position in UV space, just use default UV direction.
-            if((s == glm::vec2(0, 0)) || (t == glm::vec2(0, 0)))
-            {
-                const glm::vec3 &normal = V[0].normal;
-                bitangent = projectNormalToBitangent(normal);
-                tangent = cross(bitangent, normal);
-            }
-            else
-            {
-                float dirCorrection = 1.0f / (s.x * t.y - s.y * t.x);
-
-                // tangent points in the direction where to positive X axis of the texture coord's would point in model space
-                // bitangent's points along the positive Y axis of the texture coord's, respectively
-                tangent   = (posDelta[0] * t.y - posDelta[1] * t.x) * dirCorrection;
-                bitangent = (posDelta[1] * s.x - posDelta[0] * s.y) * dirCorrection;
-            }
-
-            // store for every vertex of that face
-            for(uint32_t i = 0; i < 3; i++)
-            {
-                // project tangent and bitangent into the plane formed by the vertex' normal
-                glm::vec3 localTangent = tangent - V[i].normal * (glm::dot(tangent, V[i].normal));
-                localTangent = glm::normalize(localTangent);
-                glm::vec3 localBitangent = bitangent - V[i].normal * (glm::dot(bitangent, V[i].normal));
-                localBitangent = glm::normalize(localBitangent);
-                localBitangent = localBitangent - localTangent * (glm::dot(localBitangent, localTangent));
-                localBitangent = glm::normalize(localBitangent);
-
-                if (isInvalidVec(bitangent) == false)
-                {
-                    // and write it into the mesh
-                    uint32_t index = indices[primID * 3 + i];
-                    bitangentData[index] += normalize(localBitangent);
-                }
-            }
+        const uint8_t* pData;
+        ResourceFormat format;
+        bool operator<(const TexSignature& other) const 
+        { 
+            if(pData < other.pData) return true;
+            if(pData == other.pData) return format < other.format;
+            return false;
         }
+        bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
+    };
+    using TextureMap = std::map<TexSignature, Texture::SharedPtr>;
 
-        for (uint32_t v = 0; v < vertexCount; v++)
-        {
-            bitangentData[v] = normalize(bitangentData[v]);
-            if (isInvalidVec(bitangentData[v]))
-            {
-                bitangentData[v] = projectNormalToBitangent(vertexNormalData[v]);
-            }
-        }
-    }
+    // Max amount of texture data we upload before flushing the upload heap
+    static const size_t kTextureUploadBudget = 256 * 1024 * 1024;
 
     static void setTexture(Material* pMaterial, Texture::SharedPtr pTexture, TextureType texType, const std::string& modelName)
     {
@@ -364,7 +277,7 @@ namespace Falcor
         return std::string(charVec.data());
     }
 
-    bool loadBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
+    static bool readBinaryTextureHeader(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
     {
         // ImageHeader.
         char tag[9];
@@ -444,28 +357,49 @@ namespace Falcor
             formatId = format.getID();
         data.format = getTextureFormat(FW::ImageFormat::ID(formatId));
 
-        // Image data.
+        // Image data. We only record where it is, decoding happens later
         const int32_t texelCount = data.width * data.height;
         if(dataSize == -1)
         {
             dataSize = bpp * texelCount;
         }
-        size_t storageSize = dataSize;
-        if(bpp == 3)
+        data.bpp = bpp;
+        data.fileDataSize = dataSize;
+        data.fileOffset = stream.getPosition();
+        stream.skip(dataSize);
+
+        return true;
+    }
+
+    static bool decodeBinaryTextureData(BinaryFileStream& stream, const std::string& modelName, TextureData& data)
+    {
+        const uint32_t texelCount = data.width * data.height;
+        size_t storageSize = data.fileDataSize;
+        if(data.bpp == 3)
             storageSize = 4 * texelCount;
 
         data.data.resize(storageSize);
-        stream.read(data.data.data(), dataSize);
+        stream.seek(data.fileOffset);
+        stream.read(data.data.data(), data.fileDataSize);
+        if(stream.isFail())
+        {
+            logError("Error when loading model " + modelName + ".\nBinary image data of texture " + data.name + " is truncated.");
+            return false;
+        }
 
-        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
-        if(bpp == 3)
+        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding. Going backwards lets us do it in place.
+        if(data.bpp == 3)
         {
-            for(int32_t i=texelCount-1;i>=0;--i)
+            uint8_t* pData = data.data.data();
+            for(int64_t i = (int64_t)texelCount - 1; i >= 0; --i)
             {
-                data.data[i * 4 + 0] = data.data[i * 3 + 0];
-                data.data[i * 4 + 1] = data.data[i * 3 + 1];
-                data.data[i * 4 + 2] = data.data[i * 3 + 2];
-                data.data[i * 4 + 3] = 0xff;
+                uint8_t r = pData[i * 3 + 0];
+                uint8_t g = pData[i * 3 + 1];
+                uint8_t b = pData[i * 3 + 2];
+                pData[i * 4 + 0] = r;
+                pData[i * 4 + 1] = g;
+                pData[i * 4 + 2] = b;
+                pData[i * 4 + 3] = 0xff;
             }
         }
 
@@ -476,19 +410,31 @@ namespace Falcor
     {
         textures.assign(textureCount, TextureData());
 
-        bool success = true;
+        // First pass - sequentially scan the headers. This is cheap, the image data itself is skipped
         for(uint32_t i = 0; i < textureCount; i++)
         {
             textures[i].name = readString(stream);
-            if(loadBinaryTextureData(stream, modelName, textures[i]) == false)
+            if(readBinaryTextureHeader(stream, modelName, textures[i]) == false)
             {
-                success = false;
-                break;
+                return false;
             }
         }
 
-        // Flush upload heap after every material so we don't accumulate a ton of memory usage when loading a model with a lot of textures
-        gpDevice->flushAndSync();
+        // Second pass - read and convert the image data in parallel. Each worker opens its own stream, so they don't fight over the read position, and decodes every streamCount-th texture with it
+        std::atomic<bool> success(true);
+        const uint32_t streamCount = std::min(textureCount, WorkerPool::getGlobal().getThreadCount() + 1);
+        WorkerPool::getGlobal().parallelFor(0, streamCount, [&](uint32_t s)
+        {
+            BinaryFileStream workerStream(modelName, BinaryFileStream::Mode::Read);
+            for(uint32_t i = s; i < textureCount; i += streamCount)
+            {
+                if(decodeBinaryTextureData(workerStream, modelName, textures[i]) == false)
+                {
+                    success = false;
+                }
+            }
+        });
+
         return success;
     }
 
@@ -513,7 +459,7 @@ namespace Falcor
     {
         if(std::string(formatID) == "BinScene")
         {
-            if(version < 6 || version > 8)
+            if(version < 6 || version > 10)
             {
                 std::string Msg = "Error when loading model " + modelName + ".\nUnsupported binary scene version " + std::to_string(version);
                 logError(Msg);
@@ -556,6 +502,186 @@ namespace Falcor
         }
     }
     
+    // Check that a mapped texture section holds the full top level and wasn't corrupted
+    static bool validateMappedTexture(const TextureData& tex, const std::string& modelName)
+    {
+        const uint64_t widthInBlocks = (tex.width + getFormatWidthCompressionRatio(tex.format) - 1) / getFormatWidthCompressionRatio(tex.format);
+        const uint64_t heightInBlocks = (tex.height + getFormatHeightCompressionRatio(tex.format) - 1) / getFormatHeightCompressionRatio(tex.format);
+        if(tex.fileDataSize < widthInBlocks * heightInBlocks * getFormatBytesPerBlock(tex.format))
+        {
+            logError("Error when loading model " + modelName + ".\nBinary image data of texture " + tex.name + " is truncated.");
+            return false;
+        }
+        if(computeSectionChecksum(tex.pMappedData, tex.fileDataSize) != tex.mappedChecksum)
+        {
+            logError("Error when loading model " + modelName + ".\nChecksum mismatch in the data of texture " + tex.name);
+            return false;
+        }
+        return true;
+    }
+
+    static Texture::SharedPtr getOrCreateTexture(const TextureData& tex, ResourceFormat format, TextureMap& textures, size_t& uploadedTextureBytes, const std::string& modelName)
+    {
+        TexSignature texSig;
+        texSig.format = format;
+        texSig.pData = tex.pMappedData ? tex.pMappedData : tex.data.data();
+
+        // Check if we already created a matching texture
+        auto existingTex = textures.find(texSig);
+        if(existingTex != textures.end())
+        {
+            return existingTex->second;
+        }
+
+        // The same data can be used with an sRGB and a linear format. Only validate it the first time.
+        if(tex.pMappedData)
+        {
+            auto sameData = textures.lower_bound({ tex.pMappedData, ResourceFormat::Unknown });
+            bool validated = (sameData != textures.end()) && (sameData->first.pData == tex.pMappedData);
+            if(validated == false && validateMappedTexture(tex, modelName) == false)
+            {
+                return nullptr;
+            }
+        }
+
+        // Flush the upload heap once in a while, so we don't accumulate a ton of memory usage when loading a model with a lot of textures
+        if(uploadedTextureBytes >= kTextureUploadBudget)
+        {
+            gpDevice->flushAndSync();
+            uploadedTextureBytes = 0;
+        }
+        auto pTexture = Texture::create2D(tex.width, tex.height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
+        pTexture->setSourceFilename(tex.name);
+        uploadedTextureBytes += tex.pMappedData ? tex.fileDataSize : tex.data.size();
+        textures[texSig] = pTexture;
+        return pTexture;
+    }
+
+    static bool readSubmeshMaterial(BinaryFileStream& stream, uint32_t version, int numTextureSlots, const std::vector<TextureData>& texData, bool loadTexAsSrgb, TextureMap& textures, size_t& uploadedTextureBytes, const std::string& modelName, Material::SharedPtr& pMaterial)
+    {
+        // create the material
+        pMaterial = Material::create("");
+
+        glm::vec3 ambient;
+        glm::vec4 diffuse;
+        glm::vec3 specular;
+        float glossiness;
+
+        stream >> ambient >> diffuse >> specular >> glossiness;
+        diffuse.w = 1 - diffuse.w;
+        pMaterial->setBaseColor(diffuse);
+        pMaterial->setSpecularParams(vec4(specular, glossiness));
+
+        if(version >= 3)
+        {
+            float displacementCoeff;
+            float displacementBias;
+            stream >> displacementCoeff >> displacementBias;
+            pMaterial->setHeightScaleOffset(displacementCoeff, displacementBias);
+        }
+
+        const int32_t numTextures = (int32_t)texData.size();
+        for(int i = 0; i < numTextureSlots; i++)
+        {
+            int32_t texID;
+            stream >> texID;
+            if(texID < -1 || texID >= numTextures)
+            {
+                std::string msg = "Error when loading model " + modelName + ".\nCorrupt binary mesh data!";
+                logError(msg);
+                return false;
+            }
+            else if(texID != -1)
+            {
+                // Load the texture
+                ResourceFormat format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, TextureType(i));
+                auto pTexture = getOrCreateTexture(texData[texID], format, textures, uploadedTextureBytes, modelName);
+                if(pTexture == nullptr)
+                {
+                    return false;
+                }
+                setTexture(pMaterial.get(), pTexture, TextureType(i), modelName);
+            }
+        }
+        return true;
+    }
+
+    // The flags which keep the geometry on the CPU. Meshlets are built from the kept geometry after the load.
+    static const Model::LoadFlags kKeepCpuGeometryFlags = Model::LoadFlags::KeepCpuGeometry | Model::LoadFlags::GenerateMeshlets;
+
+    // The flags which need a CPU copy of the positions
+    static const Model::LoadFlags kCpuPositionFlags = kKeepCpuGeometryFlags | Model::LoadFlags::OptimizeMeshes | Model::LoadFlags::GenerateLods;
+
+    static Mesh::CpuPositions readCpuPositions(const uint8_t* pData, ResourceFormat format, uint32_t stride, uint32_t vertexCount)
+    {
+        if(pData == nullptr || (format != ResourceFormat::RGB32Float && format != ResourceFormat::RGBA32Float))
+        {
+            return nullptr;
+        }
+
+        auto pPositions = std::make_shared<std::vector<glm::vec3>>(vertexCount);
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            const float* pPosition = (const float*)(pData + stride * i);
+            (*pPositions)[i] = glm::vec3(pPosition[0], pPosition[1], pPosition[2]);
+        }
+        return pPositions;
+    }
+
+    // Normals are used in place when they are tightly packed float3s. Padded float4 normals are copied, other formats can't be used for tangent generation.
+    static const glm::vec3* getNormals(const uint8_t* pData, ResourceFormat format, uint32_t stride, uint32_t vertexCount, std::vector<glm::vec3>& copy)
+    {
+        if(format == ResourceFormat::RGB32Float && stride == sizeof(glm::vec3))
+        {
+            return (const glm::vec3*)pData;
+        }
+        if(format != ResourceFormat::RGBA32Float)
+        {
+            return nullptr;
+        }
+
+        copy.resize(vertexCount);
+        for(uint32_t i = 0; i < vertexCount; i++)
+        {
+            const float* pNormal = (const float*)(pData + stride * i);
+            copy[i] = glm::vec3(pNormal[0], pNormal[1], pNormal[2]);
+        }
+        return copy.data();
+    }
+
+    static void readInstances(BinaryFileStream& stream, int32_t numInstances, const std::vector<std::vector<uint32_t>>& meshToSubmeshesID, const std::vector<Mesh::SharedPtr>& falcorMeshCache, Model& model)
+    {
+        for(int32_t instanceID = 0; instanceID < numInstances; instanceID++)
+        {
+            int32_t meshIdx = 0;
+            int32_t enabled = 1;
+            glm::mat4 transformation;
+
+            stream >> meshIdx >> enabled >> transformation;
+            //m_Stream >> inst.name >> inst.metadata;
+            readString(stream);   // Name
+            readString(stream);   // Meta-data
+
+            if(enabled)
+            {
+                for(uint32_t i : meshToSubmeshesID[meshIdx])
+                {
+                    model.addMeshInstance(falcorMeshCache[i], transformation);
+                }
+            }
+        }
+    }
+
+    // The vertices are shared by all the submeshes of a mesh, so only the triangle order can be optimized
+    static void optimizeSubmeshIndices(uint32_t* pIndices, uint32_t indexCount, const std::vector<glm::vec3>& positions, VertexCacheReport& report)
+    {
+        const uint32_t vertexCount = (uint32_t)positions.size();
+        VertexCacheStats before = analyzeVertexCache(pIndices, indexCount, vertexCount);
+        optimizeVertexCache(pIndices, indexCount, vertexCount);
+        optimizeOverdraw(pIndices, indexCount, positions.data(), vertexCount);
+        report.add(before, analyzeVertexCache(pIndices, indexCount, vertexCount), indexCount / 3);
+    }
+
     bool BinaryModelImporter::importModel(Model& model, Model::LoadFlags flags)
     {
         // Format ID and version.
@@ -572,6 +698,11 @@ namespace Falcor
             return false;
         }
 
+        if(version >= 9)
+        {
+            return importModelV9(model, flags, version);
+        }
+
         int numTextureSlots;
         int numAttributesType = AttribType_AORadius + 1;
 
@@ -637,21 +768,11 @@ namespace Falcor
 
         // This importer loads mesh/submesh data before instance data, so the meshes are cached here.
         std::vector<Mesh::SharedPtr> falcorMeshCache;
-        
-        struct TexSignature
-        {
-            const uint8_t* pData;
-            ResourceFormat format;
-            bool operator<(const TexSignature& other) const 
-            { 
-                if(pData < other.pData) return true;
-                if(pData == other.pData) return format < other.format;
-                return false;
-            }
-            bool operator==(const TexSignature& other) const { return pData == other.pData || format == other.format; }
-        };
-        std::map<TexSignature, Texture::SharedPtr> textures;
+
+        TextureMap textures;
         bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
+        size_t uploadedTextureBytes = 0;
+        VertexCacheReport cacheReport;
 
         // Load the meshes
         for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
@@ -814,61 +935,22 @@ namespace Falcor
                 textures.clear();
             }
 
+            // The submeshes share the vertex data, so they share the CPU copy of the positions
+            Mesh::CpuPositions pCpuPositions;
+            if(positionBufferIndex != kInvalidBufferIndex && is_set(flags, kCpuPositionFlags))
+            {
+                const VertexBufferLayout* pPositionLayout = pLayout->getBufferLayout(positionBufferIndex).get();
+                pCpuPositions = readCpuPositions(buffers[positionBufferIndex].vec.data(), pPositionLayout->getElementFormat(0), pPositionLayout->getStride(), numVertices);
+            }
+
             // Array of Submesh.
             // Falcor doesn't have a concept of submeshes, just create a new mesh for each submesh
             for(int submesh = 0; submesh < numSubmeshes; submesh++)
             {
-                // create the material
-                Material::SharedPtr pMaterial = Material::create("");
-
-                glm::vec3 ambient;
-                glm::vec4 diffuse;
-                glm::vec3 specular;
-                float glossiness;
-
-                mStream >> ambient >> diffuse >> specular >> glossiness;
-                diffuse.w = 1 - diffuse.w;
-                pMaterial->setBaseColor(diffuse);
-                pMaterial->setSpecularParams(vec4(specular, glossiness));
-
-                if(version >= 3)
+                Material::SharedPtr pMaterial;
+                if(readSubmeshMaterial(mStream, version, numTextureSlots, texData, loadTexAsSrgb, textures, uploadedTextureBytes, mModelName, pMaterial) == false)
                 {
-                    float displacementCoeff;
-                    float displacementBias;
-                    mStream >> displacementCoeff >> displacementBias;
-                    pMaterial->setHeightScaleOffset(displacementCoeff, displacementBias);
-                }
-
-                for(int i = 0; i < numTextureSlots; i++)
-                {
-                    int32_t texID;
-                    mStream >> texID;
-                    if(texID < -1 || texID >= numTextures)
-                    {
-                        std::string msg = "Error when loading model " + mModelName + ".\nCorrupt binary mesh data!";
-                        logError(msg);
-                        return false;
-                    }
-                    else if(texID != -1)
-                    {
-                        // Load the texture
-                        TexSignature texSig;
-                        texSig.format = getFormatFromMapType(loadTexAsSrgb, texData[texID].format, TextureType(i));
-                        texSig.pData = texData[texID].data.data();
-                        // Check if we already created a matching texture
-                        auto existingTex = textures.find(texSig);
-                        if(existingTex != textures.end())
-                        {
-                            setTexture(pMaterial.get(), existingTex->second, TextureType(i), mModelName);
-                        }
-                        else
-                        {
-                            auto pTexture = Texture::create2D(texData[texID].width, texData[texID].height, texSig.format, 1, Texture::kMaxPossible, texSig.pData);
-                            pTexture->setSourceFilename(texData[texID].name);
-                            textures[texSig] = pTexture;
-                            setTexture(pMaterial.get(), pTexture, TextureType(i), mModelName);
-                        }
-                    }
+                    return false;
                 }
 
                 // Create material and check if it already exists
@@ -889,13 +971,20 @@ namespace Falcor
                 uint32_t ibSize = 3 * numTriangles * sizeof(uint32_t);
                 mStream.read(&indices[0], ibSize);
 
+                if(pCpuPositions && is_set(flags, Model::LoadFlags::OptimizeMeshes))
+                {
+                    optimizeSubmeshIndices(indices.data(), numIndices, *pCpuPositions, cacheReport);
+                }
 
-                Buffer::BindFlags ibBindFlags = Buffer::BindFlags::Index;
-                if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+                std::vector<Mesh::Lod> lods;
+                if(pCpuPositions && is_set(flags, Model::LoadFlags::GenerateLods))
                 {
-                    ibBindFlags |= Buffer::BindFlags::ShaderResource;
+                    lods = generateLods(indices, pCpuPositions->data(), (uint32_t)pCpuPositions->size(), Model::getLodSettings());
+                    ibSize = (uint32_t)(indices.size() * sizeof(uint32_t));
                 }
-                auto pIB = Buffer::create(ibSize, ibBindFlags, Buffer::CpuAccess::None, indices.data());
+
+                ResourceFormat indexFormat = getIndexFormat(numVertices, flags, pMaterial.get());
+                auto pIB = createIndexBuffer(indices.data(), (uint32_t)(ibSize / sizeof(uint32_t)), indexFormat, flags);
 
                 // Generate tangent space data if needed
                 if(genTangentForMesh)
@@ -912,11 +1001,11 @@ namespace Falcor
 
                     if (posFormat == ResourceFormat::RGB32Float)
                     {
-                        generateSubmeshTangentData<glm::vec3>(indices, numVertices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                        generateSubmeshTangentData<glm::vec3>(indices.data(), numIndices, numVertices, (glm::vec3*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
                     }
                     else if (posFormat == ResourceFormat::RGBA32Float)
                     {
-                        generateSubmeshTangentData<glm::vec4>(indices, numVertices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
+                        generateSubmeshTangentData<glm::vec4>(indices.data(), numIndices, numVertices, (glm::vec4*)buffers[positionBufferIndex].vec.data(), (glm::vec3*)buffers[normalBufferIndex].vec.data(), texCrd, texCrdCount, (glm::vec3*)buffers[bitangentBufferIndex].vec.data());
                     }
 
                     pVBs[bitangentBufferIndex] = Buffer::create(buffers[bitangentBufferIndex].vec.size(), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, buffers[bitangentBufferIndex].vec.data());
@@ -940,7 +1029,16 @@ namespace Falcor
                 BoundingBox box = BoundingBox::fromMinMax(min, max);
 
                 // create the mesh
-                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false);
+                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, box, false, indexFormat);
+                if(lods.empty() == false)
+                {
+                    pMesh->setLods(lods);
+                }
+                if(pCpuPositions && is_set(flags, kKeepCpuGeometryFlags))
+                {
+                    indices.resize(numIndices);
+                    pMesh->setCpuGeometry(pCpuPositions, indices);
+                }
 
                 if (version >= 6)
                 {
@@ -956,27 +1054,333 @@ namespace Falcor
 
         if(version >= 6)
         {
-            for(int32_t instanceID = 0; instanceID < numInstances; instanceID++)
+            readInstances(mStream, numInstances, meshToSubmeshesID, falcorMeshCache, model);
+        }
+
+        if(cacheReport.getMeshCount() > 0)
+        {
+            logInfo(mModelName + ": " + cacheReport.getMessage());
+        }
+        return true;
+    }
+
+    bool BinaryModelImporter::importModelV9(Model& model, Model::LoadFlags flags, uint32_t version)
+    {
+        int32_t numTextures = 0;
+        int32_t numMeshes = 0;
+        int32_t numInstances = 0;
+        int32_t numSections = 0;
+        uint64_t sectionTableOffset = 0;
+        mStream >> numTextures >> numMeshes >> numInstances >> numSections >> sectionTableOffset;
+
+        if(numTextures < 0 || numMeshes < 0 || numInstances < 0 || numSections < 0)
+        {
+            std::string msg = "Error when loading model " + mModelName + ".\nFile is corrupted.";
+            logError(msg);
+            return false;
+        }
+
+        // The bulk data is used straight from the mapping. The OS only pages in what we actually touch.
+        size_t fileSize = 0;
+        const uint8_t* pFileData = (const uint8_t*)mapFileForReading(mModelName, fileSize);
+        if(pFileData == nullptr)
+        {
+            return false;
+        }
+        std::shared_ptr<const uint8_t> pMapping(pFileData, [fileSize](const uint8_t* pData) { unmapFile(pData, fileSize); });
+
+        struct SectionDesc
+        {
+            uint64_t offset;
+            uint64_t size;
+            uint32_t checksum;
+            uint32_t reserved;
+        };
+        static_assert(sizeof(SectionDesc) == 24, "SectionDesc doesn't match the file layout");
+
+        if(sectionTableOffset > fileSize || (fileSize - sectionTableOffset) / sizeof(SectionDesc) < (uint64_t)numSections)
+        {
+            logError("Error when loading model " + mModelName + ".\nSection table is corrupted.");
+            return false;
+        }
+        std::vector<SectionDesc> sections(numSections);
+        std::memcpy(sections.data(), pFileData + sectionTableOffset, numSections * sizeof(SectionDesc));
+
+        // Returns a pointer to a section's data, or nullptr if the section is invalid. The checksum is only validated when a section is used,
+        // sections which are used later (textures) skip it here and validate it themselves.
+        auto getSection = [&](int32_t index, uint64_t expectedSize, bool verifyChecksum) -> const uint8_t*
+        {
+            if(index < 0 || index >= numSections)
             {
-                int32_t meshIdx = 0;
-                int32_t enabled = 1;
-                glm::mat4 transformation;
+                logError("Error when loading model " + mModelName + ".\nInvalid section index " + std::to_string(index));
+                return nullptr;
+            }
+            const SectionDesc& desc = sections[index];
+            if(desc.offset > fileSize || desc.size > fileSize - desc.offset || desc.size < expectedSize)
+            {
+                logError("Error when loading model " + mModelName + ".\nSection " + std::to_string(index) + " is out of bounds.");
+                return nullptr;
+            }
+            const uint8_t* pData = pFileData + desc.offset;
+            if(verifyChecksum && computeSectionChecksum(pData, (size_t)desc.size) != desc.checksum)
+            {
+                logError("Error when loading model " + mModelName + ".\nChecksum mismatch in section " + std::to_string(index));
+                return nullptr;
+            }
+            return pData;
+        };
+
+        // Textures. Only the descriptions are read here, texels are uploaded when a material references the texture
+        std::vector<TextureData> texData(numTextures);
+        for(auto& tex : texData)
+        {
+            int32_t formatId;
+            int32_t section;
+            tex.name = readString(mStream);
+            mStream >> tex.width >> tex.height >> formatId >> section;
+            if(formatId < 0 || formatId >= FW::ImageFormat::ID_Generic)
+            {
+                logError("Error when loading model " + mModelName + ".\nCorrupt binary image data (unsupported image format).");
+                return false;
+            }
+            tex.format = getTextureFormat(FW::ImageFormat::ID(formatId));
+            // Only check the bounds here. The size and checksum are validated when a material first uses the texture, see getOrCreateTexture()
+            tex.pMappedData = getSection(section, 0, false);
+            if(tex.pMappedData == nullptr)
+            {
+                return false;
+            }
+            tex.fileDataSize = (uint32_t)sections[section].size;
+            tex.mappedChecksum = sections[section].checksum;
+        }
+
+        bool shouldGenerateTangents = is_set(flags, Model::LoadFlags::DontGenerateTangentSpace) == false;
+        bool loadTexAsSrgb = !is_set(flags, Model::LoadFlags::AssumeLinearSpaceTextures);
+        size_t uploadedTextureBytes = 0;
+        TextureMap textures;
+
+        Buffer::BindFlags vbBindFlags = Buffer::BindFlags::Vertex;
+        if(is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+        {
+            vbBindFlags |= Buffer::BindFlags::ShaderResource;
+        }
 
-                mStream >> meshIdx >> enabled >> transformation;
-                //m_Stream >> inst.name >> inst.metadata;
-                readString(mStream);   // Name
-                readString(mStream);   // Meta-data
+        std::vector<std::vector<uint32_t>> meshToSubmeshesID(numMeshes);
+        std::vector<Mesh::SharedPtr> falcorMeshCache;
+        VertexCacheReport cacheReport;
+
+        for(int meshIdx = 0; meshIdx < numMeshes; meshIdx++)
+        {
+            int32_t numAttribs = 0;
+            int32_t numVertices = 0;
+            int32_t numSubmeshes = 0;
+            mStream >> numAttribs >> numVertices >> numSubmeshes;
+            if(numAttribs < 0 || numVertices < 0 || numSubmeshes < 0)
+            {
+                logError("Error when loading model " + mModelName + ".\nCorrupted data.!");
+                return false;
+            }
+
+            Vao::BufferVec pVBs(numAttribs);
+            VertexLayout::SharedPtr pLayout = VertexLayout::create();
+
+            // CPU-side pointers into the mapping, needed for tangent generation
+            const uint8_t* pPositions = nullptr;
+            const glm::vec3* pNormals = nullptr;
+            std::vector<glm::vec3> normalsCopy;
+            const glm::vec2* pTexCrd = nullptr;
+            ResourceFormat posFormat = ResourceFormat::Unknown;
+            uint32_t texCrdCount = 0;
+            bool hasBitangents = false;
 
-                if(enabled)
+            for(int32_t i = 0; i < numAttribs; i++)
+            {
+                int32_t type, format, length, section;
+                mStream >> type >> format >> length >> section;
+                if(type < 0 || type >= AttribType_Max || format < 0 || format >= AttribFormat::AttribFormat_Max || length < 1 || length > 4)
                 {
-                    for(uint32_t i : meshToSubmeshesID[meshIdx])
+                    logError("Error when loading model " + mModelName + ".\nCorrupted data.!");
+                    return false;
+                }
+
+                VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+                pLayout->addBufferLayout(i, pBufferLayout);
+                ResourceFormat falcorFormat = getFalcorFormat(AttribFormat(format), length);
+                uint32_t shaderLocation = getShaderLocation(AttribType(type));
+                if(shaderLocation == kUnusedShaderElement)
+                {
+                    continue;
+                }
+                pBufferLayout->addElement(getSemanticName(AttribType(type)), 0, falcorFormat, 1, shaderLocation);
+
+                uint32_t vbSize = pBufferLayout->getStride() * numVertices;
+                const uint8_t* pData = getSection(section, vbSize, true);
+                if(pData == nullptr)
+                {
+                    return false;
+                }
+                pVBs[i] = Buffer::create(vbSize, vbBindFlags, Buffer::CpuAccess::None, pData);
+
+                switch(shaderLocation)
+                {
+                case VERTEX_POSITION_LOC:
+                    pPositions = pData;
+                    posFormat = falcorFormat;
+                    break;
+                case VERTEX_NORMAL_LOC:
+                    pNormals = getNormals(pData, falcorFormat, pBufferLayout->getStride(), numVertices, normalsCopy);
+                    if(pNormals == nullptr)
+                    {
+                        logWarning("Mesh " + std::to_string(meshIdx) + " of model " + mModelName + " has normals in format " + to_string(falcorFormat) + ", they can't be used for tangent generation");
+                    }
+                    break;
+                case VERTEX_BITANGENT_LOC:
+                    hasBitangents = true;
+                    break;
+                case VERTEX_TEXCOORD_LOC:
+                    // Tangent generation reads the texture coordinates as pairs of floats
+                    if(falcorFormat == ResourceFormat::RG32Float || falcorFormat == ResourceFormat::RGBA32Float)
+                    {
+                        pTexCrd = (const glm::vec2*)pData;
+                        texCrdCount = pBufferLayout->getStride() / sizeof(glm::vec2);
+                    }
+                    break;
+                }
+            }
+
+            // Check if we need to generate tangents
+            std::vector<glm::vec3> bitangents;
+            uint32_t bitangentBufferIndex = (uint32_t)pVBs.size();
+            if(shouldGenerateTangents && hasBitangents == false)
+            {
+                if(pNormals == nullptr || pPositions == nullptr || (posFormat != ResourceFormat::RGB32Float && posFormat != ResourceFormat::RGBA32Float))
+                {
+                    logWarning("Can't generate tangent space for mesh " + std::to_string(meshIdx) + " when loading model " + mModelName + ".\nMesh doesn't contain normals coordinates\n");
+                }
+                else
+                {
+                    bitangents.resize(numVertices);
+                    pVBs.resize(bitangentBufferIndex + 1);
+                    auto pBitangentLayout = VertexBufferLayout::create();
+                    pLayout->addBufferLayout(bitangentBufferIndex, pBitangentLayout);
+                    pBitangentLayout->addElement(VERTEX_BITANGENT_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
+                }
+            }
+
+            Mesh::CpuPositions pCpuPositions;
+            if(is_set(flags, kCpuPositionFlags))
+            {
+                pCpuPositions = readCpuPositions(pPositions, posFormat, getFormatBytesPerBlock(posFormat), numVertices);
+            }
+
+            for(int submesh = 0; submesh < numSubmeshes; submesh++)
+            {
+                Material::SharedPtr pMaterial;
+                if(readSubmeshMaterial(mStream, 9, TextureType_Glossiness + 1, texData, loadTexAsSrgb, textures, uploadedTextureBytes, mModelName, pMaterial) == false)
+                {
+                    return false;
+                }
+                pMaterial = checkForExistingMaterial(pMaterial);
+
+                int32_t numTriangles;
+                glm::vec3 boxMin, boxMax;
+                int32_t indexSection;
+                mStream >> numTriangles >> boxMin >> boxMax >> indexSection;
+                if(numTriangles < 0)
+                {
+                    logError("Error when loading model " + mModelName + ".\nMesh has negative number of triangles!");
+                    return false;
+                }
+
+                uint32_t numIndices = numTriangles * 3;
+                std::vector<Mesh::Lod> lods(1);
+                lods[0].indexCount = numIndices;
+                if(version >= 10)
+                {
+                    int32_t numLods;
+                    mStream >> numLods;
+                    if(numLods < 0 || numLods >= (int32_t)Mesh::kMaxLodCount)
+                    {
+                        logError("Error when loading model " + mModelName + ".\nCorrupted data.!");
+                        return false;
+                    }
+
+                    for(int32_t lod = 0; lod < numLods; lod++)
+                    {
+                        int32_t lodTriangles;
+                        Mesh::Lod level;
+                        mStream >> lodTriangles >> level.error;
+                        if(lodTriangles < 0)
+                        {
+                            logError("Error when loading model " + mModelName + ".\nMesh has negative number of triangles!");
+                            return false;
+                        }
+                        level.firstIndex = lods.back().firstIndex + lods.back().indexCount;
+                        level.indexCount = lodTriangles * 3;
+                        lods.push_back(level);
+                    }
+                }
+
+                uint32_t ibSize = (lods.back().firstIndex + lods.back().indexCount) * sizeof(uint32_t);
+                const uint32_t* pIndices = (const uint32_t*)getSection(indexSection, ibSize, true);
+                if(pIndices == nullptr)
+                {
+                    return false;
+                }
+
+                // Only the full-detail level is optimized. Stored LODs were already optimized by generateLods() when they were created, and are kept so they are only generated once.
+                std::vector<uint32_t> processedIndices;
+                const bool shouldGenerateLods = pCpuPositions && is_set(flags, Model::LoadFlags::GenerateLods) && (lods.size() == 1);
+                if(pCpuPositions && (is_set(flags, Model::LoadFlags::OptimizeMeshes) || shouldGenerateLods))
+                {
+                    processedIndices.assign(pIndices, pIndices + ibSize / sizeof(uint32_t));
+                    if(is_set(flags, Model::LoadFlags::OptimizeMeshes))
+                    {
+                        optimizeSubmeshIndices(processedIndices.data(), lods[0].indexCount, *pCpuPositions, cacheReport);
+                    }
+                    if(shouldGenerateLods)
+                    {
+                        lods = generateLods(processedIndices, pCpuPositions->data(), (uint32_t)pCpuPositions->size(), Model::getLodSettings());
+                        ibSize = (uint32_t)(processedIndices.size() * sizeof(uint32_t));
+                    }
+                    pIndices = processedIndices.data();
+                }
+                ResourceFormat indexFormat = getIndexFormat(numVertices, flags, pMaterial.get());
+                auto pIB = createIndexBuffer(pIndices, (uint32_t)(ibSize / sizeof(uint32_t)), indexFormat, flags);
+
+                if(bitangents.empty() == false)
+                {
+                    if(posFormat == ResourceFormat::RGB32Float)
+                    {
+                        generateSubmeshTangentData<glm::vec3>(pIndices, numIndices, numVertices, (const glm::vec3*)pPositions, pNormals, pTexCrd, texCrdCount, bitangents.data());
+                    }
+                    else if(posFormat == ResourceFormat::RGBA32Float)
                     {
-                        model.addMeshInstance(falcorMeshCache[i], transformation);
+                        generateSubmeshTangentData<glm::vec4>(pIndices, numIndices, numVertices, (const glm::vec4*)pPositions, pNormals, pTexCrd, texCrdCount, bitangents.data());
                     }
+                    pVBs[bitangentBufferIndex] = Buffer::create(bitangents.size() * sizeof(glm::vec3), Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, bitangents.data());
+                }
+
+                auto pMesh = Mesh::create(pVBs, numVertices, pIB, numIndices, pLayout, Vao::Topology::TriangleList, pMaterial, BoundingBox::fromMinMax(boxMin, boxMax), false, indexFormat);
+                if(lods.size() > 1)
+                {
+                    pMesh->setLods(lods);
+                }
+                if(pCpuPositions && is_set(flags, kKeepCpuGeometryFlags))
+                {
+                    pMesh->setCpuGeometry(pCpuPositions, std::vector<uint32_t>(pIndices, pIndices + numIndices));
                 }
+                falcorMeshCache.push_back(pMesh);
+                meshToSubmeshesID[meshIdx].push_back((uint32_t)(falcorMeshCache.size() - 1));
             }
         }
-        
+
+        readInstances(mStream, numInstances, meshToSubmeshesID, falcorMeshCache, model);
+
+        if(cacheReport.getMeshCount() > 0)
+        {
+            logInfo(mModelName + ": " + cacheReport.getMessage());
+        }
         return true;
     }
 }
@@ -49,6 +49,7 @@ namespace Falcor
     private:
         BinaryModelImporter(const std::string& fullpath);
         bool importModel(Model& model, Model::LoadFlags flags);
+        bool importModelV9(Model& model, Model::LoadFlags flags, uint32_t version);
 
         std::string mModelName;
         BinaryFileStream mStream;
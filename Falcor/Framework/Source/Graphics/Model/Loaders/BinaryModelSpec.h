@@ -26,22 +26,42 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <cstdint>
+#include <cstring>
 
 //------------------------------------------------------------------------
 /*
 
-Binary scene file format v8
----------------------------
+Binary scene file format v10
+----------------------------
 
 - The basic units of data are 32-bit little-endian ints and floats.
 - In addition to the latest version, the below specification also describes previous versions of the file format.
 - Each individual field is marked with the version number where it was introduced.
 - Legacy structs are postfixed with the highest version number for which they are still valid.
 - Each line describes: <ofs_dwords> <size_dwords> <Type> <version> <name> (<comments>)
+- Starting with v9, bulk data (texels, vertex attributes and indices) is stored in sections. Each section starts at a
+  64-byte aligned offset and is already in the layout used by the GPU resource, so the file can be memory-mapped and
+  uploaded without parsing. The rest of the file is a small sequential stream describing the objects.
 
 File
+0       2       string8 v9  formatID            ("BinScene")
+2       1       int     v9  formatVersion       (9 .. 10)
+3       1       int     v9  numTextures
+4       1       int     v9  numMeshes
+5       1       int     v9  numInstances
+6       1       int     v9  numSections
+7       2       int64   v9  sectionTableOffset  (offset of the SectionDesc array from the start of the file)
+9       n*?     array   v9  Texture             (numTextures)
+?       n*?     array   v9  Mesh                (numMeshes)
+?       n*?     array   v6  Instance            (numInstances)
+?       ?       bytes   v9  section data
+?       n*6     array   v9  SectionDesc         (numSections, at sectionTableOffset)
+?
+
+File_v8
 0       2       string8 v6  formatID            ("BinScene")
-2       1       int     v6  formatVersion       (6)
+2       1       int     v6  formatVersion       (6 .. 8)
 3       1       int     v6  numTextures
 4       1       int     v6  numMeshes
 5       1       int     v6  numInstances
@@ -63,13 +83,37 @@ File_v5
 ?       n*?     array   v1  Submesh             (numSubmeshes)
 ?
 
+SectionDesc
+0       2       int64   v9  offset              (from the start of the file, 64-byte aligned)
+2       2       int64   v9  size                (in bytes)
+4       1       int     v9  checksum            (see computeSectionChecksum())
+5       1       int     v9  reserved
+6
+
 Texture
+0       1       int     v9  idLength
+1       ?       string  v9  idString
+?       1       int     v9  width
+?       1       int     v9  height
+?       1       int     v9  formatID            (see FW::ImageFormat::ID. 3-channel 8-bit formats are stored with 4 channels)
+?       1       int     v9  dataSection         (index of the SectionDesc holding the texels of the first mip-level)
+?
+
+Texture_v8
 0       1       int     v2  idLength
 1       ?       string  v2  idString
 ?       ?       struct  v2  BinaryImage         (see ImageBinaryIO.hpp)
 ?
 
 Mesh
+0       1       int     v9  numAttribs
+1       1       int     v9  numVertices
+2       1       int     v9  numSubmeshes
+3       n*4     array   v9  AttribSpec          (numAttribs)
+?       n*?     array   v9  Submesh             (numSubmeshes)
+?
+
+Mesh_v8
 0       1       int     v6  numAttribs
 1       1       int     v6  numVertices
 2       1       int     v6  numSubmeshes
@@ -82,7 +126,8 @@ AttribSpec
 0       1       int     v1  Type                (see MeshBase::AttribType)
 1       1       int     v1  format              (see MeshBase::AttribFormat)
 2       1       int     v1  length
-3
+3       1       int     v9  dataSection         (index of the SectionDesc holding numVertices tightly packed elements)
+4
 
 Vertex
 0       ?       bytes   v1  vertex data         (dictated by the AttribSpecs)
@@ -101,8 +146,24 @@ Submesh
 16      1       int     v4  normalTexture       (-1 if none)
 17      1       int     v4  environmentTexture  (-1 if none)
 18      1       int     v5  specularTexture     (-1 if none)
-19      1       int     v1  numTriangles
-20      n*3     int     v1  indices             (numTriangles * 3)
+19      1       int     v7  glossinessTexture   (-1 if none)
+20      1       int     v1  numTriangles
+21      3       float   v9  boundingBoxMin
+24      3       float   v9  boundingBoxMax
+27      1       int     v9  indexSection        (index of the SectionDesc holding the indices of all the levels of detail, back to back, starting with the numTriangles * 3 32-bit indices of the full-detail submesh)
+28      1       int     v10 numLods             (number of simplified levels, not counting the full-detail submesh)
+29      n*2     array   v10 Lod                 (numLods, in index section order)
+?
+
+Lod
+0       1       int     v10 numTriangles
+1       1       float   v10 error               (geometric error, relative to the length of the bounding-box half-diagonal)
+2
+
+Submesh_v8
+0       ?       struct  v1  Submesh             (fields up to and including the texture slots)
+?       1       int     v1  numTriangles
+?       n*3     int     v1  indices             (numTriangles * 3)
 ?
 
 Instance
@@ -154,3 +215,29 @@ enum TextureType
     TextureType_Glossiness,     // Glossiness map.
     TextureType_Max
 };
+
+static const uint32_t kBinarySectionAlignment = 64;
+
+/** Checksum of a v9 section. Processes the data as 32-bit words (the tail is zero-padded) using 64-bit Fletcher-style sums, which is fast enough to keep up with disk bandwidth.
+*/
+inline uint32_t computeSectionChecksum(const void* pData, size_t size)
+{
+    const uint8_t* pBytes = (const uint8_t*)pData;
+    uint64_t a = 0;
+    uint64_t b = 0;
+    size_t wordCount = size / 4;
+    for(size_t i = 0; i < wordCount; i++)
+    {
+        uint32_t word;
+        std::memcpy(&word, pBytes + i * 4, 4);
+        a += word;
+        b += a;
+    }
+
+    uint32_t tail = 0;
+    std::memcpy(&tail, pBytes + wordCount * 4, size - wordCount * 4);
+    a += tail;
+    b += a;
+
+    return (uint32_t)(a ^ (a >> 32) ^ b ^ (b >> 32));
+}
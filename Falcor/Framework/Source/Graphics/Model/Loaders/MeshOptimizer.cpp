@@ -0,0 +1,459 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshOptimizer.h"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Forsyth's scoring parameters. The LRU cache size is larger than the hardware caches on purpose, see the original article.
+        const uint32_t kForsythCacheSize = 32;
+        const float kCacheDecayPower = 1.5f;
+        const float kLastTriScore = 0.75f;
+        const float kValenceBoostScale = 2.0f;
+        const float kValenceBoostPower = 0.5f;
+        const uint32_t kValenceTableSize = 32;
+
+        // FIFO cache size used to find the cluster boundaries for the overdraw optimization
+        const uint32_t kOverdrawCacheSize = 16;
+
+        struct ForsythScores
+        {
+            float cache[kForsythCacheSize];
+            float valence[kValenceTableSize];
+
+            ForsythScores()
+            {
+                for (uint32_t i = 0; i < kForsythCacheSize; i++)
+                {
+                    // The vertices of the last triangle get a fixed score, so the same triangle doesn't get picked twice in a row
+                    cache[i] = (i < 3) ? kLastTriScore : powf(1.0f - (float)(i - 3) / (float)(kForsythCacheSize - 3), kCacheDecayPower);
+                }
+                for (uint32_t i = 0; i < kValenceTableSize; i++)
+                {
+                    valence[i] = (i == 0) ? 0.0f : kValenceBoostScale * powf((float)i, -kValenceBoostPower);
+                }
+            }
+
+            float get(int32_t cachePosition, uint32_t remainingValence) const
+            {
+                if (remainingValence == 0)
+                {
+                    return -1.0f;
+                }
+                float score = (cachePosition >= 0) ? cache[cachePosition] : 0.0f;
+                score += (remainingValence < kValenceTableSize) ? valence[remainingValence] : kValenceBoostScale * powf((float)remainingValence, -kValenceBoostPower);
+                return score;
+            }
+        };
+
+        /** FIFO cache simulation. A vertex is cached if it was inserted less than cacheSize misses ago.
+        */
+        class FifoCache
+        {
+        public:
+            FifoCache(uint32_t vertexCount, uint32_t cacheSize) : mTimestamps(vertexCount, 0), mCacheSize(cacheSize), mTime(cacheSize + 1) {}
+
+            /** Process a triangle and return its number of misses
+            */
+            uint32_t addTriangle(const uint32_t* pTriangle)
+            {
+                uint32_t misses = 0;
+                for (uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t v = pTriangle[i];
+                    if (mTime - mTimestamps[v] > mCacheSize)
+                    {
+                        mTimestamps[v] = mTime++;
+                        misses++;
+                    }
+                }
+                return misses;
+            }
+
+            /** Evict everything
+            */
+            void flush() { mTime += mCacheSize + 1; }
+
+        private:
+            std::vector<uint32_t> mTimestamps;
+            uint32_t mCacheSize;
+            uint32_t mTime;
+        };
+    }
+
+    void VertexCacheReport::add(const VertexCacheStats& before, const VertexCacheStats& after, uint32_t triangleCount)
+    {
+        // Running weighted averages
+        const double total = mTriangleCount + triangleCount;
+        if (total == 0)
+        {
+            return;
+        }
+        const float w = (float)(triangleCount / total);
+        mBefore.acmr += (before.acmr - mBefore.acmr) * w;
+        mBefore.atvr += (before.atvr - mBefore.atvr) * w;
+        mAfter.acmr += (after.acmr - mAfter.acmr) * w;
+        mAfter.atvr += (after.atvr - mAfter.atvr) * w;
+        mTriangleCount = total;
+        mMeshCount++;
+    }
+
+    std::string VertexCacheReport::getMessage() const
+    {
+        return "Optimized " + std::to_string(mMeshCount) + " meshes. ACMR " + std::to_string(mBefore.acmr) + " -> " + std::to_string(mAfter.acmr) +
+            ", ATVR " + std::to_string(mBefore.atvr) + " -> " + std::to_string(mAfter.atvr);
+    }
+
+    VertexCacheStats analyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        VertexCacheStats stats;
+        const uint32_t triangleCount = indexCount / 3;
+        if (triangleCount == 0)
+        {
+            return stats;
+        }
+
+        FifoCache cache(vertexCount, cacheSize);
+        uint32_t misses = 0;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            misses += cache.addTriangle(indices + t * 3);
+        }
+
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t referencedCount = 0;
+        for (uint32_t i = 0; i < triangleCount * 3; i++)
+        {
+            if (referenced[indices[i]] == false)
+            {
+                referenced[indices[i]] = true;
+                referencedCount++;
+            }
+        }
+
+        stats.acmr = (float)misses / (float)triangleCount;
+        stats.atvr = (float)misses / (float)referencedCount;
+        return stats;
+    }
+
+    void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+    {
+        static const ForsythScores sScores;
+
+        const uint32_t triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+        {
+            return;
+        }
+
+        // Vertex -> triangles adjacency. The triangles which are still to be emitted are kept at the front of every vertex's list.
+        std::vector<uint32_t> remainingValence(vertexCount, 0);
+        for (uint32_t i = 0; i < triangleCount * 3; i++)
+        {
+            remainingValence[indices[i]]++;
+        }
+
+        std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            adjacencyOffset[v + 1] = adjacencyOffset[v] + remainingValence[v];
+        }
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+            for (uint32_t i = 0; i < triangleCount * 3; i++)
+            {
+                adjacency[fill[indices[i]]++] = i / 3;
+            }
+        }
+
+        std::vector<int32_t> cachePosition(vertexCount, -1);
+        std::vector<float> vertexScore(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            vertexScore[v] = sScores.get(-1, remainingValence[v]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        int32_t bestTriangle = 0;
+        for (uint32_t t = 0; t < triangleCount; t++)
+        {
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+            if (triangleScore[t] > triangleScore[bestTriangle])
+            {
+                bestTriangle = (int32_t)t;
+            }
+        }
+
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> newCache;
+        cache.reserve(kForsythCacheSize + 3);
+        newCache.reserve(kForsythCacheSize + 3);
+        uint32_t nextUnemitted = 0;
+
+        for (uint32_t i = 0; i < triangleCount; i++)
+        {
+            // Nothing in the cache has remaining triangles, so start over from the next triangle in the original order
+            if (bestTriangle < 0)
+            {
+                while (emitted[nextUnemitted])
+                {
+                    nextUnemitted++;
+                }
+                bestTriangle = (int32_t)nextUnemitted;
+            }
+
+            const uint32_t* pTriangle = indices + bestTriangle * 3;
+            emitted[bestTriangle] = true;
+            newCache.clear();
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                const uint32_t v = pTriangle[k];
+                output.push_back(v);
+
+                // Remove the triangle from the vertex's remaining list
+                uint32_t* pList = adjacency.data() + adjacencyOffset[v];
+                uint32_t* pLast = pList + remainingValence[v] - 1;
+                *std::find(pList, pLast + 1, (uint32_t)bestTriangle) = *pLast;
+                remainingValence[v]--;
+
+                if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+                {
+                    newCache.push_back(v);
+                }
+            }
+
+            // The triangle's vertices move to the front of the LRU cache
+            for (uint32_t v : cache)
+            {
+                if (v != pTriangle[0] && v != pTriangle[1] && v != pTriangle[2])
+                {
+                    newCache.push_back(v);
+                }
+            }
+
+            // Update the scores of the vertices which moved in the cache or were evicted, and of their remaining triangles
+            for (uint32_t slot = 0; slot < (uint32_t)newCache.size(); slot++)
+            {
+                const uint32_t v = newCache[slot];
+                cachePosition[v] = (slot < kForsythCacheSize) ? (int32_t)slot : -1;
+                const float score = sScores.get(cachePosition[v], remainingValence[v]);
+                const float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+
+                const uint32_t* pList = adjacency.data() + adjacencyOffset[v];
+                for (uint32_t j = 0; j < remainingValence[v]; j++)
+                {
+                    triangleScore[pList[j]] += delta;
+                }
+            }
+            newCache.resize(std::min((uint32_t)newCache.size(), kForsythCacheSize));
+            cache.swap(newCache);
+
+            // Only the triangles touching the cache can have a better score than before
+            bestTriangle = -1;
+            float bestScore = -1.0f;
+            for (uint32_t v : cache)
+            {
+                const uint32_t* pList = adjacency.data() + adjacencyOffset[v];
+                for (uint32_t j = 0; j < remainingValence[v]; j++)
+                {
+                    if (triangleScore[pList[j]] > bestScore)
+                    {
+                        bestScore = triangleScore[pList[j]];
+                        bestTriangle = (int32_t)pList[j];
+                    }
+                }
+            }
+        }
+
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    void optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, float threshold)
+    {
+        const uint32_t triangleCount = indexCount / 3;
+        if (triangleCount < 2)
+        {
+            return;
+        }
+
+        // Hard boundaries: triangles which miss the cache on all of their vertices restart the cache anyway
+        std::vector<uint32_t> hardClusters;
+        {
+            FifoCache cache(vertexCount, kOverdrawCacheSize);
+            for (uint32_t t = 0; t < triangleCount; t++)
+            {
+                if (cache.addTriangle(indices + t * 3) == 3)
+                {
+                    hardClusters.push_back(t);
+                }
+            }
+            // The first triangle always misses all of its vertices, unless it is degenerate
+            if (hardClusters.empty() || hardClusters[0] != 0)
+            {
+                hardClusters.insert(hardClusters.begin(), 0);
+            }
+        }
+        hardClusters.push_back(triangleCount);
+
+        // Soft boundaries: split a hard cluster as soon as the part before the split has a miss ratio within the threshold
+        std::vector<uint32_t> clusters;
+        {
+            FifoCache cache(vertexCount, kOverdrawCacheSize);
+            for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+            {
+                const uint32_t start = hardClusters[c];
+                const uint32_t end = hardClusters[c + 1];
+
+                cache.flush();
+                uint32_t clusterMisses = 0;
+                for (uint32_t t = start; t < end; t++)
+                {
+                    clusterMisses += cache.addTriangle(indices + t * 3);
+                }
+                const float targetAcmr = threshold * (float)clusterMisses / (float)(end - start);
+
+                cache.flush();
+                uint32_t softStart = start;
+                uint32_t softMisses = 0;
+                clusters.push_back(start);
+                for (uint32_t t = start; t < end; t++)
+                {
+                    softMisses += cache.addTriangle(indices + t * 3);
+                    if (t + 1 < end && (float)softMisses <= targetAcmr * (float)(t + 1 - softStart))
+                    {
+                        clusters.push_back(t + 1);
+                        softStart = t + 1;
+                        softMisses = 0;
+                        cache.flush();
+                    }
+                }
+            }
+        }
+        const uint32_t clusterCount = (uint32_t)clusters.size();
+        clusters.push_back(triangleCount);
+
+        // Area-weighted centroid and normal of every cluster
+        std::vector<glm::vec3> centroids(clusterCount);
+        std::vector<glm::vec3> normals(clusterCount);
+        glm::vec3 meshCentroid(0.0f);
+        float meshArea = 0;
+        for (uint32_t c = 0; c < clusterCount; c++)
+        {
+            glm::vec3 centroid(0.0f);
+            glm::vec3 normal(0.0f);
+            float area = 0;
+            for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+            {
+                const glm::vec3& p0 = positions[indices[t * 3]];
+                const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+                const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+                const glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+                const float triangleArea = glm::length(n);
+                centroid += (p0 + p1 + p2) * (triangleArea / 3.0f);
+                normal += n;
+                area += triangleArea;
+            }
+
+            meshCentroid += centroid;
+            meshArea += area;
+            centroids[c] = (area > 0) ? centroid / area : centroid;
+            float normalLength = glm::length(normal);
+            normals[c] = (normalLength > 0) ? normal / normalLength : normal;
+        }
+        if (meshArea > 0)
+        {
+            meshCentroid /= meshArea;
+        }
+
+        // Clusters facing away from the center first
+        std::vector<float> sortKeys(clusterCount);
+        std::vector<uint32_t> order(clusterCount);
+        for (uint32_t c = 0; c < clusterCount; c++)
+        {
+            sortKeys[c] = glm::dot(centroids[c] - meshCentroid, normals[c]);
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<uint32_t> output;
+        output.reserve(triangleCount * 3);
+        for (uint32_t c : order)
+        {
+            output.insert(output.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+        }
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount)
+    {
+        static const uint32_t kUnused = uint32_t(-1);
+        std::vector<uint32_t> remap(vertexCount, kUnused);
+
+        uint32_t nextVertex = 0;
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            uint32_t& newIndex = remap[indices[i]];
+            if (newIndex == kUnused)
+            {
+                newIndex = nextVertex++;
+            }
+            indices[i] = newIndex;
+        }
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            if (remap[v] == kUnused)
+            {
+                remap[v] = nextVertex++;
+            }
+        }
+        return remap;
+    }
+
+    void remapVertexData(void* pData, uint32_t stride, const std::vector<uint32_t>& remap)
+    {
+        uint8_t* pBytes = (uint8_t*)pData;
+        std::vector<uint8_t> original(pBytes, pBytes + remap.size() * stride);
+        for (size_t v = 0; v < remap.size(); v++)
+        {
+            std::memcpy(pBytes + remap[v] * stride, original.data() + v * stride, stride);
+        }
+    }
+}
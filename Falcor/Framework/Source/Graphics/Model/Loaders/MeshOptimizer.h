@@ -0,0 +1,99 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <string>
+#include "glm/vec3.hpp"
+
+namespace Falcor
+{
+    /** Post-transform vertex cache efficiency of an index buffer, measured with a FIFO cache
+    */
+    struct VertexCacheStats
+    {
+        float acmr = 0;     ///< Average cache miss ratio, the number of vertex shader invocations per triangle. Ranges from ~0.5 for regular grids to 3.
+        float atvr = 0;     ///< Average transformed vertex ratio, the number of vertex shader invocations per referenced vertex. 1 is optimal.
+    };
+
+    /** Accumulates the vertex cache statistics of several meshes for logging. The averages are weighted by the triangle counts.
+    */
+    class VertexCacheReport
+    {
+    public:
+        void add(const VertexCacheStats& before, const VertexCacheStats& after, uint32_t triangleCount);
+        uint32_t getMeshCount() const { return mMeshCount; }
+        std::string getMessage() const;
+
+    private:
+        uint32_t mMeshCount = 0;
+        double mTriangleCount = 0;
+        VertexCacheStats mBefore;
+        VertexCacheStats mAfter;
+    };
+
+    /** Simulate a FIFO post-transform vertex cache over a triangle list
+        \param[in] indices Index buffer. Every 3 indices form a triangle
+        \param[in] indexCount Number of indices
+        \param[in] vertexCount Number of vertices
+        \param[in] cacheSize Number of entries in the simulated cache
+    */
+    VertexCacheStats analyzeVertexCache(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, uint32_t cacheSize = 16);
+
+    /** Reorder the triangles of a triangle list to improve post-transform vertex cache hits, using Tom Forsyth's linear-speed algorithm
+        \param[in,out] indices Index buffer. Every 3 indices form a triangle
+        \param[in] indexCount Number of indices
+        \param[in] vertexCount Number of vertices
+    */
+    void optimizeVertexCache(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+    /** Reorder clusters of a cache-optimized triangle list to reduce overdraw, following Sander et al. "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw".
+        The list is split into clusters where the vertex cache restarts, and where the cluster's miss ratio is already within the threshold. Clusters facing away from the mesh center are drawn first, since they are the most likely to occlude the others.
+        \param[in,out] indices Index buffer, already processed by optimizeVertexCache()
+        \param[in] indexCount Number of indices
+        \param[in] positions Vertex positions
+        \param[in] vertexCount Number of vertices
+        \param[in] threshold How much the ACMR is allowed to degrade in exchange for finer clusters. 1.05 allows a 5% degradation
+    */
+    void optimizeOverdraw(uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, float threshold = 1.05f);
+
+    /** Renumber the vertices in the order the index buffer first references them, which makes vertex fetches mostly sequential. The indices are rewritten.
+        Vertices which are not referenced are moved after the referenced ones, so the vertex count doesn't change.
+        \param[in,out] indices Index buffer
+        \param[in] indexCount Number of indices
+        \param[in] vertexCount Number of vertices
+        \return For every original vertex, its new index. Pass it to remapVertexData() for every vertex stream.
+    */
+    std::vector<uint32_t> optimizeVertexFetch(uint32_t* indices, uint32_t indexCount, uint32_t vertexCount);
+
+    /** Move the vertices of a vertex stream to their new location
+        \param[in,out] pData The vertex data
+        \param[in] stride Size of a vertex in bytes
+        \param[in] remap The remap table returned by optimizeVertexFetch()
+    */
+    void remapVertexData(void* pData, uint32_t stride, const std::vector<uint32_t>& remap);
+}
@@ -0,0 +1,426 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Falcor
+{
+    namespace
+    {
+        // Border edges add a plane perpendicular to their triangle, weighted so that the silhouette of open meshes is preserved
+        const float kBorderWeight = 10.0f;
+
+        // A collapse is rejected if it rotates a triangle by more than ~75 degrees, which also catches flipped triangles
+        const float kMinNormalCos = 0.25f;
+
+        // A level of detail is only kept if it has at most this ratio of the previous level's triangles
+        const float kMinLodReduction = 0.85f;
+
+        enum class VertexKind : uint8_t
+        {
+            Manifold,   // Can collapse onto any neighbor
+            Border,     // Can only collapse along a border edge, onto a border or locked vertex
+            Locked,     // Attribute seams and non-manifold vertices. Never moves.
+        };
+
+        /** Symmetric 4x4 quadric with its accumulated weight. Evaluates to the weighted average of the squared distances to the accumulated planes.
+        */
+        struct Quadric
+        {
+            float a00 = 0, a11 = 0, a22 = 0, a01 = 0, a02 = 0, a12 = 0;
+            float b0 = 0, b1 = 0, b2 = 0;
+            float c = 0;
+            float w = 0;
+
+            static Quadric fromPlane(const glm::vec3& n, float d, float weight)
+            {
+                Quadric q;
+                q.a00 = n.x * n.x * weight;
+                q.a11 = n.y * n.y * weight;
+                q.a22 = n.z * n.z * weight;
+                q.a01 = n.x * n.y * weight;
+                q.a02 = n.x * n.z * weight;
+                q.a12 = n.y * n.z * weight;
+                q.b0 = n.x * d * weight;
+                q.b1 = n.y * d * weight;
+                q.b2 = n.z * d * weight;
+                q.c = d * d * weight;
+                q.w = weight;
+                return q;
+            }
+
+            void add(const Quadric& other)
+            {
+                a00 += other.a00; a11 += other.a11; a22 += other.a22;
+                a01 += other.a01; a02 += other.a02; a12 += other.a12;
+                b0 += other.b0; b1 += other.b1; b2 += other.b2;
+                c += other.c;
+                w += other.w;
+            }
+
+            float evaluate(const glm::vec3& p) const
+            {
+                float r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z;
+                r += 2 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z);
+                r += 2 * (b0 * p.x + b1 * p.y + b2 * p.z);
+                r += c;
+                return (w == 0) ? 0 : fabsf(r) / w;
+            }
+        };
+
+        struct Collapse
+        {
+            uint32_t source;
+            uint32_t target;
+            float cost;
+        };
+
+        uint64_t edgeKey(uint32_t a, uint32_t b)
+        {
+            return ((uint64_t)a << 32) | b;
+        }
+
+        /** Find the first vertex with the same position for every vertex
+        */
+        std::vector<uint32_t> weldVertices(const glm::vec3* positions, uint32_t vertexCount)
+        {
+            std::vector<uint32_t> order(vertexCount);
+            std::iota(order.begin(), order.end(), 0);
+            auto less = [positions](uint32_t a, uint32_t b)
+            {
+                const glm::vec3& pa = positions[a];
+                const glm::vec3& pb = positions[b];
+                if (pa.x != pb.x) return pa.x < pb.x;
+                if (pa.y != pb.y) return pa.y < pb.y;
+                if (pa.z != pb.z) return pa.z < pb.z;
+                return a < b;
+            };
+            std::sort(order.begin(), order.end(), less);
+
+            std::vector<uint32_t> weld(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; i++)
+            {
+                uint32_t v = order[i];
+                bool samePosition = (i > 0) && (positions[v] == positions[order[i - 1]]);
+                weld[v] = samePosition ? weld[order[i - 1]] : v;
+            }
+            return weld;
+        }
+    }
+
+    std::vector<uint32_t> simplifyMesh(const uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, uint32_t targetIndexCount, float targetError, float& resultError)
+    {
+        std::vector<uint32_t> result(indices, indices + indexCount);
+        resultError = 0;
+        if (indexCount <= targetIndexCount)
+        {
+            return result;
+        }
+
+        // Work in a normalized space, where the error is relative to the bounding-box half-diagonal
+        glm::vec3 boxMin(FLT_MAX);
+        glm::vec3 boxMax(-FLT_MAX);
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            boxMin = glm::min(boxMin, positions[indices[i]]);
+            boxMax = glm::max(boxMax, positions[indices[i]]);
+        }
+        const glm::vec3 center = (boxMin + boxMax) * 0.5f;
+        const float radius = glm::length(boxMax - center);
+        if (radius == 0)
+        {
+            return result;
+        }
+
+        std::vector<glm::vec3> points(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            points[v] = (positions[v] - center) / radius;
+        }
+
+        // Topology is defined on the welded vertices, so that attribute seams don't look like borders
+        std::vector<uint32_t> weld = weldVertices(positions, vertexCount);
+        std::vector<uint32_t> siblingCount(vertexCount, 0);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            siblingCount[weld[v]]++;
+        }
+
+        std::unordered_map<uint64_t, uint32_t> halfEdges;
+        halfEdges.reserve(indexCount);
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                halfEdges[edgeKey(weld[indices[i + k]], weld[indices[i + (k + 1) % 3]])]++;
+            }
+        }
+
+        std::vector<Quadric> quadrics(vertexCount);
+        std::vector<uint32_t> borderEdgeCount(vertexCount, 0);
+        std::vector<bool> nonManifold(vertexCount, false);
+        std::unordered_set<uint64_t> borderEdges;
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            const uint32_t w[3] = { weld[indices[i]], weld[indices[i + 1]], weld[indices[i + 2]] };
+            glm::vec3 normal = glm::cross(points[w[1]] - points[w[0]], points[w[2]] - points[w[0]]);
+            float length = glm::length(normal);
+            if (length == 0)
+            {
+                continue;
+            }
+            normal /= length;
+
+            // Weighted by area, so that the error doesn't depend on the tessellation
+            Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, points[w[0]]), length * 0.5f);
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                quadrics[w[k]].add(plane);
+            }
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t a = w[k];
+                uint32_t b = w[(k + 1) % 3];
+                if (halfEdges[edgeKey(a, b)] > 1)
+                {
+                    nonManifold[a] = nonManifold[b] = true;
+                }
+                else if (halfEdges.count(edgeKey(b, a)) == 0)
+                {
+                    borderEdgeCount[a]++;
+                    borderEdgeCount[b]++;
+                    borderEdges.insert(edgeKey(std::min(a, b), std::max(a, b)));
+
+                    glm::vec3 borderNormal = glm::cross(points[b] - points[a], normal);
+                    float borderLength = glm::length(borderNormal);
+                    if (borderLength > 0)
+                    {
+                        borderNormal /= borderLength;
+                        Quadric borderPlane = Quadric::fromPlane(borderNormal, -glm::dot(borderNormal, points[a]), borderLength * borderLength * kBorderWeight);
+                        quadrics[a].add(borderPlane);
+                        quadrics[b].add(borderPlane);
+                    }
+                }
+            }
+        }
+
+        std::vector<VertexKind> kinds(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            uint32_t w = weld[v];
+            if (siblingCount[w] > 1 || nonManifold[w] || (borderEdgeCount[w] != 0 && borderEdgeCount[w] != 2))
+            {
+                kinds[v] = VertexKind::Locked;
+            }
+            else
+            {
+                kinds[v] = (borderEdgeCount[w] == 0) ? VertexKind::Manifold : VertexKind::Border;
+            }
+        }
+
+        std::vector<uint32_t> remap(vertexCount);
+        std::vector<bool> touched(vertexCount);
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        const float maxCost = targetError * targetError;
+        float resultCost = 0;
+
+        // Every pass collapses a set of independent edges in order of increasing cost, then rebuilds the index buffer
+        while (result.size() > targetIndexCount)
+        {
+            const uint32_t triangleCount = (uint32_t)result.size() / 3;
+
+            std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+            for (uint32_t index : result)
+            {
+                adjacencyOffsets[index + 1]++;
+            }
+            std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+            adjacency.resize(result.size());
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t i = 0; i < (uint32_t)result.size(); i++)
+            {
+                adjacency[fill[result[i]]++] = i / 3;
+            }
+
+            collapses.clear();
+            for (uint32_t i = 0; i < (uint32_t)result.size(); i++)
+            {
+                uint32_t a = result[i];
+                uint32_t b = result[i - i % 3 + (i + 1) % 3];
+                for (uint32_t k = 0; k < 2; k++)
+                {
+                    uint32_t source = k ? b : a;
+                    uint32_t target = k ? a : b;
+                    bool valid = (kinds[source] == VertexKind::Manifold);
+                    if (kinds[source] == VertexKind::Border && kinds[target] != VertexKind::Manifold)
+                    {
+                        valid = borderEdges.count(edgeKey(std::min(weld[a], weld[b]), std::max(weld[a], weld[b]))) != 0;
+                    }
+                    if (valid)
+                    {
+                        Quadric q = quadrics[weld[source]];
+                        q.add(quadrics[weld[target]]);
+                        collapses.push_back({ source, target, q.evaluate(points[target]) });
+                    }
+                }
+            }
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+            std::iota(remap.begin(), remap.end(), 0);
+            std::fill(touched.begin(), touched.end(), false);
+            uint32_t remainingTriangles = triangleCount;
+            uint32_t collapsed = 0;
+            for (const Collapse& c : collapses)
+            {
+                if (c.cost > maxCost || remainingTriangles * 3 <= targetIndexCount)
+                {
+                    break;
+                }
+                if (touched[c.source] || touched[c.target])
+                {
+                    continue;
+                }
+
+                // Reject collapses which fold triangles over, or whose neighborhood already changed in this pass
+                bool valid = true;
+                uint32_t removedTriangles = 0;
+                for (uint32_t j = adjacencyOffsets[c.source]; valid && j < adjacencyOffsets[c.source + 1]; j++)
+                {
+                    const uint32_t* pTri = &result[adjacency[j] * 3];
+                    if (remap[pTri[0]] != pTri[0] || remap[pTri[1]] != pTri[1] || remap[pTri[2]] != pTri[2])
+                    {
+                        valid = false;
+                        break;
+                    }
+
+                    uint32_t k = (pTri[0] == c.source) ? 0 : ((pTri[1] == c.source) ? 1 : 2);
+                    uint32_t v1 = pTri[(k + 1) % 3];
+                    uint32_t v2 = pTri[(k + 2) % 3];
+                    if (weld[v1] == weld[c.target] || weld[v2] == weld[c.target])
+                    {
+                        removedTriangles++;
+                        continue;
+                    }
+
+                    glm::vec3 e1 = points[v1] - points[c.source];
+                    glm::vec3 e2 = points[v2] - points[c.source];
+                    glm::vec3 n0 = glm::cross(e1, e2);
+                    glm::vec3 n1 = glm::cross(points[v1] - points[c.target], points[v2] - points[c.target]);
+                    valid = glm::dot(n0, n1) >= kMinNormalCos * glm::length(n0) * glm::length(n1);
+                }
+                if (valid == false)
+                {
+                    continue;
+                }
+
+                remap[c.source] = c.target;
+                quadrics[weld[c.target]].add(quadrics[weld[c.source]]);
+                for (uint32_t j = adjacencyOffsets[c.source]; j < adjacencyOffsets[c.source + 1]; j++)
+                {
+                    const uint32_t* pTri = &result[adjacency[j] * 3];
+                    touched[pTri[0]] = touched[pTri[1]] = touched[pTri[2]] = true;
+                }
+                remainingTriangles -= std::min(removedTriangles, remainingTriangles);
+                resultCost = std::max(resultCost, c.cost);
+                collapsed++;
+            }
+
+            if (collapsed == 0)
+            {
+                break;
+            }
+
+            uint32_t writeIndex = 0;
+            for (uint32_t i = 0; i < (uint32_t)result.size(); i += 3)
+            {
+                uint32_t a = remap[result[i]];
+                uint32_t b = remap[result[i + 1]];
+                uint32_t c = remap[result[i + 2]];
+                if (weld[a] != weld[b] && weld[b] != weld[c] && weld[a] != weld[c])
+                {
+                    result[writeIndex++] = a;
+                    result[writeIndex++] = b;
+                    result[writeIndex++] = c;
+                }
+            }
+            result.resize(writeIndex);
+        }
+
+        resultError = sqrtf(resultCost);
+        return result;
+    }
+
+    std::vector<Mesh::Lod> generateLods(std::vector<uint32_t>& indices, const glm::vec3* positions, uint32_t vertexCount, const Model::LodSettings& settings)
+    {
+        std::vector<Mesh::Lod> lods(1);
+        lods[0].indexCount = (uint32_t)indices.size();
+
+        const uint32_t maxLodCount = (settings.maxLodCount < Mesh::kMaxLodCount) ? settings.maxLodCount : Mesh::kMaxLodCount;
+        std::vector<uint32_t> current = indices;
+        float error = 0;
+        while (lods.size() < maxLodCount)
+        {
+            uint32_t targetIndexCount = (uint32_t)((float)(current.size() / 3) * settings.triangleRatio) * 3;
+            if (targetIndexCount / 3 < settings.minTriangleCount)
+            {
+                break;
+            }
+
+            // The errors of consecutive levels add up, so the remaining budget shrinks along the chain. Every level is measured against its own bounds,
+            // which are contained in the full-detail bounds, so the accumulated error is conservative.
+            float lodError = 0;
+            std::vector<uint32_t> simplified = simplifyMesh(current.data(), (uint32_t)current.size(), positions, vertexCount, targetIndexCount, settings.maxError - error, lodError);
+            if (simplified.empty() || (float)simplified.size() > (float)current.size() * kMinLodReduction)
+            {
+                break;
+            }
+            optimizeVertexCache(simplified.data(), (uint32_t)simplified.size(), vertexCount);
+
+            error += lodError;
+            Mesh::Lod lod;
+            lod.firstIndex = (uint32_t)indices.size();
+            lod.indexCount = (uint32_t)simplified.size();
+            lod.error = error;
+            lods.push_back(lod);
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+            current.swap(simplified);
+        }
+        return lods;
+    }
+}
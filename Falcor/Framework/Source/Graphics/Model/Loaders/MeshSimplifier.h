@@ -0,0 +1,57 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/vec3.hpp"
+#include "Graphics/Model/Model.h"
+
+namespace Falcor
+{
+    /** Simplify a triangle list with quadric error metric edge collapses (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+        The vertices are left untouched, a collapse moves one endpoint of an edge onto the other, so the result can be drawn with the original vertex buffers.
+        Vertices are welded by position to find the topology. Vertices on an attribute seam (several vertices sharing a position) and non-manifold vertices are locked, border vertices only collapse along the border.
+        \param[in] indices Index buffer. Every 3 indices form a triangle
+        \param[in] indexCount Number of indices
+        \param[in] positions Vertex positions
+        \param[in] vertexCount Number of vertices
+        \param[in] targetIndexCount Stop once the simplified mesh has at most this number of indices
+        \param[in] targetError Stop before exceeding this error, relative to the length of the half-diagonal of the mesh's bounding-box
+        \param[out] resultError The error of the simplified mesh, with the same scale as targetError
+        \return The simplified index buffer. It has more than targetIndexCount indices if the target error was reached first.
+    */
+    std::vector<uint32_t> simplifyMesh(const uint32_t* indices, uint32_t indexCount, const glm::vec3* positions, uint32_t vertexCount, uint32_t targetIndexCount, float targetError, float& resultError);
+
+    /** Generate a chain of levels of detail for a triangle list. Every level is simplified from the previous one and optimized for the vertex cache.
+        \param[in,out] indices Index buffer of the full-detail mesh. The levels are appended to it.
+        \param[in] positions Vertex positions
+        \param[in] vertexCount Number of vertices
+        \param[in] settings Generation settings
+        \return The levels of detail, starting with the full-detail mesh. The chain stops early when the error limit or the triangle count limit is reached.
+    */
+    std::vector<Mesh::Lod> generateLods(std::vector<uint32_t>& indices, const glm::vec3* positions, uint32_t vertexCount, const Model::LodSettings& settings);
+}
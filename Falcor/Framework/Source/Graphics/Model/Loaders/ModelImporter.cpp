@@ -46,4 +46,42 @@ namespace Falcor
         mLoadedMaterials.push_back(pMaterial);
         return pMaterial;
     }
+
+    static bool isReadByShaders(Model::LoadFlags flags, const Material* pMaterial)
+    {
+        if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+        {
+            return true;
+        }
+        return pMaterial && (EXTRACT_EMISSIVE_TYPE(pMaterial->getFlags()) != ChannelTypeUnused);
+    }
+
+    ResourceFormat ModelImporter::getIndexFormat(uint32_t vertexCount, Model::LoadFlags flags, const Material* pMaterial)
+    {
+        const bool fitsIn16Bits = vertexCount <= (uint32_t)UINT16_MAX + 1;
+        return (fitsIn16Bits && !isReadByShaders(flags, pMaterial)) ? ResourceFormat::R16Uint : ResourceFormat::R32Uint;
+    }
+
+    bool ModelImporter::canQuantizeVertices(Model::LoadFlags flags, const Material* pMaterial, bool hasBones)
+    {
+        return is_set(flags, Model::LoadFlags::QuantizeVertices) && !hasBones && !isReadByShaders(flags, pMaterial);
+    }
+
+    Buffer::SharedPtr ModelImporter::createIndexBuffer(const uint32_t* pIndices, uint32_t indexCount, ResourceFormat format, Model::LoadFlags flags)
+    {
+        Buffer::BindFlags bindFlags = Buffer::BindFlags::Index;
+        if (is_set(flags, Model::LoadFlags::BuffersAsShaderResource))
+        {
+            bindFlags |= Buffer::BindFlags::ShaderResource;
+        }
+
+        if (format == ResourceFormat::R16Uint)
+        {
+            std::vector<uint16_t> indices(pIndices, pIndices + indexCount);
+            return Buffer::create(indexCount * sizeof(uint16_t), bindFlags, Buffer::CpuAccess::None, indices.data());
+        }
+
+        assert(format == ResourceFormat::R32Uint);
+        return Buffer::create(indexCount * sizeof(uint32_t), bindFlags, Buffer::CpuAccess::None, pIndices);
+    }
 }
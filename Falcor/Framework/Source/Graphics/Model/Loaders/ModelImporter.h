@@ -30,6 +30,8 @@
 
 #include <vector>
 #include "Graphics/Material/Material.h"
+#include "Graphics/Model/Model.h"
+#include "API/Buffer.h"
 
 namespace Falcor
 {
@@ -47,6 +49,28 @@ namespace Falcor
         */
         Material::SharedPtr checkForExistingMaterial(const Material::SharedPtr& pMaterial);
 
+        /** Pick the format of a mesh's index buffer. 16-bit indices are used when they can address all the vertices, unless shaders read the index buffer as 32-bit indices.
+            That's the case for the ray-tracing shaders, which require Model::LoadFlags::BuffersAsShaderResource, and for area lights, which are created from meshes with emissive materials.
+            \param[in] vertexCount Number of vertices the indices point into
+            \param[in] flags Flags the model is loaded with
+            \param[in] pMaterial The mesh's material
+            \return ResourceFormat::R16Uint or ResourceFormat::R32Uint
+        */
+        static ResourceFormat getIndexFormat(uint32_t vertexCount, Model::LoadFlags flags, const Material* pMaterial);
+
+        /** Check if the vertices of a mesh can be quantized when loading with Model::LoadFlags::QuantizeVertices. The same shader readers as in getIndexFormat() expect full-precision vertices, and so does the skinning cache.
+        */
+        static bool canQuantizeVertices(Model::LoadFlags flags, const Material* pMaterial, bool hasBones);
+
+        /** Create an index buffer from 32-bit indices
+            \param[in] pIndices The indices
+            \param[in] indexCount Number of indices
+            \param[in] format The format of the buffer, see getIndexFormat(). The indices are narrowed for ResourceFormat::R16Uint.
+            \param[in] flags Flags the model is loaded with
+            \return A new buffer
+        */
+        static Buffer::SharedPtr createIndexBuffer(const uint32_t* pIndices, uint32_t indexCount, ResourceFormat format, Model::LoadFlags flags);
+
         std::vector<Material::SharedPtr> mLoadedMaterials; // vector because we make use of operator==, and it's only for the importers
     };
 }
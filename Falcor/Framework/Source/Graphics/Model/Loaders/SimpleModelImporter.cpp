@@ -43,7 +43,7 @@ namespace Falcor
 
     Model::SharedPtr SimpleModelImporter::create( VertexFormat vertLayout, uint32_t vboSz, const void *vboData,
                                                   uint32_t idxBufSz, const uint32_t *idxBufData, Texture::SharedPtr diffuseTexture,
-                                                  Vao::Topology geomTopology )
+                                                  Vao::Topology geomTopology, Model::LoadFlags flags )
     {
         // Since SimpleModelImporter is all static, create an instance here to help track materials
         SimpleModelImporter modelImporter;
@@ -86,9 +86,6 @@ namespace Falcor
         pLayout->addBufferLayout(0, pVertexLayout);
         Buffer::SharedPtr pBuffer = Buffer::create( vboSz, Buffer::BindFlags::Vertex, Buffer::CpuAccess::None, vboData );
 
-        // Create index buffer and add to the model
-        Buffer::SharedPtr pIB = Buffer::create( idxBufSz, Buffer::BindFlags::Index, Buffer::CpuAccess::None, idxBufData );
-
         // Compute more explicit / traditional counts needed internally
         uint32_t numVertices = vboSz / vertexStride;
         uint32_t numIndicies = idxBufSz / (sizeof( uint32_t ));
@@ -102,6 +99,10 @@ namespace Falcor
         pMaterial->setBaseColor(vec4(1));
         pMaterial = modelImporter.checkForExistingMaterial(pMaterial);
 
+        // Create index buffer and add to the model
+        ResourceFormat indexFormat = getIndexFormat( numVertices, Model::LoadFlags::None, pMaterial.get() );
+        Buffer::SharedPtr pIB = createIndexBuffer( idxBufData, numIndicies, indexFormat, Model::LoadFlags::None );
+
         // Calculate a bounding-box for this model
         glm::vec3 posMax, posMin;
         for ( uint32_t i = 0; i < numIndicies; i++ )
@@ -118,7 +119,17 @@ namespace Falcor
         BoundingBox box = BoundingBox::fromMinMax( posMin, posMax );
 
         // create a mesh containing this index & vertex data.
-        Mesh::SharedPtr pMesh = Mesh::create({ pBuffer }, numVertices, pIB, numIndicies, pLayout, geomTopology, pMaterial, box, false);
+        Mesh::SharedPtr pMesh = Mesh::create({ pBuffer }, numVertices, pIB, numIndicies, pLayout, geomTopology, pMaterial, box, false, indexFormat);
+        if ( geomTopology == Vao::Topology::TriangleList && is_set( flags, Model::LoadFlags::KeepCpuGeometry ) )
+        {
+            auto pPositions = std::make_shared<std::vector<glm::vec3>>( numVertices );
+            for ( uint32_t i = 0; i < numVertices; i++ )
+            {
+                float* pPosition = (float*) (((uint8_t *) vboData) + ( vertexStride * i ) + positionOffset);
+                (*pPositions)[i] = glm::vec3( pPosition[0], pPosition[1], pPosition[2] );
+            }
+            pMesh->setCpuGeometry( pPositions, std::vector<uint32_t>( idxBufData, idxBufData + numIndicies ) );
+        }
         pModel->addMeshInstance(pMesh, glm::mat4()); // Add this mesh to the model
 
         // Do internal computations on model properties
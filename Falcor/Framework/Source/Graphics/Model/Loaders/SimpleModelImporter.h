@@ -82,10 +82,12 @@ namespace Falcor
         };
 
         // Create a model made up of a number of triangles, layed out (in the index buffer) as GL_TRIANGLES
+        // Only Model::LoadFlags::KeepCpuGeometry is used from the flags
         static Model::SharedPtr create( VertexFormat vertLayout, uint32_t vboSz, const void *vboData, 
                                         uint32_t idxBufSz, const uint32_t *idxData, 
                                         Texture::SharedPtr diffuseTexture = nullptr,
-                                        Vao::Topology geomTopology = Vao::Topology::TriangleList );
+                                        Vao::Topology geomTopology = Vao::Topology::TriangleList,
+                                        Model::LoadFlags flags = Model::LoadFlags::None );
 
     private:
         static ResourceFormat    getResourceFormat( AttribFormat format, uint32_t components );
@@ -0,0 +1,446 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TangentSpaceHelper.h"
+#include "Utils/WorkerPool.h"
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace Falcor
+{
+    // The math below evaluates every expression in the same order GLM does (normalize(v) = v * (1 / sqrt(dot(v, v))), dot(a, b) = (a.x * b.x + a.y * b.y) + a.z * b.z, etc.).
+    // SSE sqrt/div are correctly rounded just like their scalar counterparts, so the SIMD path, the scalar path and the original per-triangle loop produce bit-identical results.
+    namespace
+    {
+        const uint32_t kTrianglesPerJob = 16 * 1024;
+        const uint32_t kVerticesPerJob = 16 * 1024;
+
+        struct Float3
+        {
+            float x, y, z;
+        };
+
+        struct Float3x4
+        {
+            __m128 x, y, z;
+        };
+
+        struct MeshData
+        {
+            const uint32_t* pIndices;
+            const float* pPos;
+            uint32_t posStride;
+            const float* pNormals;
+            const float* pTexCrd;
+            uint32_t texCrdStride;
+        };
+
+        bool isSpecialFloat(float f)
+        {
+            uint32_t d;
+            std::memcpy(&d, &f, sizeof(d));
+            // Check the exponent
+            d = (d >> 23) & 0xff;
+            return d == 0xff;
+        }
+
+        bool isInvalidVec(const Float3& v)
+        {
+            return isSpecialFloat(v.x) || isSpecialFloat(v.y) || isSpecialFloat(v.z);
+        }
+
+        float dot(const Float3& a, const Float3& b)
+        {
+            return a.x * b.x + a.y * b.y + a.z * b.z;
+        }
+
+        Float3 mul(const Float3& a, float s)
+        {
+            return { a.x * s, a.y * s, a.z * s };
+        }
+
+        Float3 sub(const Float3& a, const Float3& b)
+        {
+            return { a.x - b.x, a.y - b.y, a.z - b.z };
+        }
+
+        Float3 normalize(const Float3& v)
+        {
+            return mul(v, 1.0f / std::sqrt(dot(v, v)));
+        }
+
+        Float3 cross(const Float3& a, const Float3& b)
+        {
+            return { a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y };
+        }
+
+        Float3 projectNormalToBitangent(const Float3& normal)
+        {
+            Float3 bitangent;
+            if(std::abs(normal.x) > std::abs(normal.y))
+            {
+                float length = std::sqrt(normal.x * normal.x + normal.z * normal.z);
+                bitangent = { normal.z / length, 0.f / length, -normal.x / length };
+            }
+            else
+            {
+                float length = std::sqrt(normal.y * normal.y + normal.z * normal.z);
+                bitangent = { 0.f / length, normal.z / length, -normal.y / length };
+            }
+            return normalize(bitangent);
+        }
+
+        Float3 loadFloat3(const float* pData, uint32_t index, uint32_t stride)
+        {
+            const float* p = pData + (size_t)index * stride;
+            return { p[0], p[1], p[2] };
+        }
+
+        // Projects the triangle's tangent frame into the plane of a vertex normal and returns the bitangent contribution for that vertex
+        Float3 calcCornerBitangent(const Float3& tangent, const Float3& bitangent, const Float3& normal)
+        {
+            Float3 localTangent = normalize(sub(tangent, mul(normal, dot(tangent, normal))));
+            Float3 localBitangent = normalize(sub(bitangent, mul(normal, dot(bitangent, normal))));
+            localBitangent = normalize(sub(localBitangent, mul(localTangent, dot(localBitangent, localTangent))));
+            return normalize(localBitangent);
+        }
+
+        bool processTriangle(const MeshData& mesh, uint32_t primID, float* pCorners)
+        {
+            Float3 pos[3];
+            Float3 normal[3];
+            float u[3];
+            float v[3];
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                uint32_t index = mesh.pIndices[primID * 3 + i];
+                pos[i] = loadFloat3(mesh.pPos, index, mesh.posStride);
+                normal[i] = loadFloat3(mesh.pNormals, index, 3);
+                u[i] = mesh.pTexCrd ? mesh.pTexCrd[(size_t)index * mesh.texCrdStride] : 0;
+                v[i] = mesh.pTexCrd ? mesh.pTexCrd[(size_t)index * mesh.texCrdStride + 1] : 0;
+            }
+
+            Float3 posDelta0 = sub(pos[1], pos[0]);
+            Float3 posDelta1 = sub(pos[2], pos[0]);
+            float sx = u[1] - u[0];
+            float sy = v[1] - v[0];
+            float tx = u[2] - u[0];
+            float ty = v[2] - v[0];
+
+            Float3 tangent;
+            Float3 bitangent;
+
+            // when t1, t2, t3 in same position in UV space, just use default UV direction.
+            if((sx == 0 && sy == 0) || (tx == 0 && ty == 0))
+            {
+                bitangent = projectNormalToBitangent(normal[0]);
+                tangent = cross(bitangent, normal[0]);
+            }
+            else
+            {
+                float dirCorrection = 1.0f / (sx * ty - sy * tx);
+                tangent = mul(sub(mul(posDelta0, ty), mul(posDelta1, tx)), dirCorrection);
+                bitangent = mul(sub(mul(posDelta1, sx), mul(posDelta0, sy)), dirCorrection);
+            }
+
+            if(isInvalidVec(bitangent))
+            {
+                return false;
+            }
+
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                Float3 b = calcCornerBitangent(tangent, bitangent, normal[i]);
+                pCorners[i * 3 + 0] = b.x;
+                pCorners[i * 3 + 1] = b.y;
+                pCorners[i * 3 + 2] = b.z;
+            }
+            return true;
+        }
+
+        __m128 select(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }
+
+        Float3x4 select(__m128 mask, const Float3x4& a, const Float3x4& b)
+        {
+            return { select(mask, a.x, b.x), select(mask, a.y, b.y), select(mask, a.z, b.z) };
+        }
+
+        __m128 dot(const Float3x4& a, const Float3x4& b)
+        {
+            return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+        }
+
+        Float3x4 mul(const Float3x4& a, __m128 s)
+        {
+            return { _mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s) };
+        }
+
+        Float3x4 sub(const Float3x4& a, const Float3x4& b)
+        {
+            return { _mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z) };
+        }
+
+        Float3x4 normalize(const Float3x4& v)
+        {
+            return mul(v, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(dot(v, v))));
+        }
+
+        Float3x4 cross(const Float3x4& a, const Float3x4& b)
+        {
+            return {
+                _mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(b.y, a.z)),
+                _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(b.z, a.x)),
+                _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(b.x, a.y)) };
+        }
+
+        // Returns a mask with all bits set in lanes where the value is Inf or NaN
+        __m128 isSpecialFloat(__m128 f)
+        {
+            const __m128i kExponentMask = _mm_set1_epi32(0x7f800000);
+            __m128i exponent = _mm_and_si128(_mm_castps_si128(f), kExponentMask);
+            return _mm_castsi128_ps(_mm_cmpeq_epi32(exponent, kExponentMask));
+        }
+
+        Float3x4 projectNormalToBitangent(const Float3x4& normal)
+        {
+            const __m128 kSignMask = _mm_set1_ps(-0.0f);
+            const __m128 kZero = _mm_setzero_ps();
+            __m128 useXZ = _mm_cmpgt_ps(_mm_andnot_ps(kSignMask, normal.x), _mm_andnot_ps(kSignMask, normal.y));
+
+            __m128 lengthXZ = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(normal.x, normal.x), _mm_mul_ps(normal.z, normal.z)));
+            Float3x4 bitangentXZ = { _mm_div_ps(normal.z, lengthXZ), _mm_div_ps(kZero, lengthXZ), _mm_div_ps(_mm_xor_ps(normal.x, kSignMask), lengthXZ) };
+
+            __m128 lengthYZ = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(normal.y, normal.y), _mm_mul_ps(normal.z, normal.z)));
+            Float3x4 bitangentYZ = { _mm_div_ps(kZero, lengthYZ), _mm_div_ps(normal.z, lengthYZ), _mm_div_ps(_mm_xor_ps(normal.y, kSignMask), lengthYZ) };
+
+            return normalize(select(useXZ, bitangentXZ, bitangentYZ));
+        }
+
+        Float3x4 calcCornerBitangent(const Float3x4& tangent, const Float3x4& bitangent, const Float3x4& normal)
+        {
+            Float3x4 localTangent = normalize(sub(tangent, mul(normal, dot(tangent, normal))));
+            Float3x4 localBitangent = normalize(sub(bitangent, mul(normal, dot(bitangent, normal))));
+            localBitangent = normalize(sub(localBitangent, mul(localTangent, dot(localBitangent, localTangent))));
+            return normalize(localBitangent);
+        }
+
+        // Processes 4 consecutive triangles, one per SIMD lane. Returns a 4-bit mask of the triangles with a valid bitangent
+        uint32_t processTriangles4(const MeshData& mesh, uint32_t firstPrim, float* pCorners)
+        {
+            alignas(16) float pos[3][3][4];
+            alignas(16) float normal[3][3][4];
+            alignas(16) float uv[3][2][4];
+            for(uint32_t lane = 0; lane < 4; lane++)
+            {
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    uint32_t index = mesh.pIndices[(firstPrim + lane) * 3 + i];
+                    const float* pPos = mesh.pPos + (size_t)index * mesh.posStride;
+                    const float* pNormal = mesh.pNormals + (size_t)index * 3;
+                    for(uint32_t c = 0; c < 3; c++)
+                    {
+                        pos[i][c][lane] = pPos[c];
+                        normal[i][c][lane] = pNormal[c];
+                    }
+                    uv[i][0][lane] = mesh.pTexCrd ? mesh.pTexCrd[(size_t)index * mesh.texCrdStride] : 0;
+                    uv[i][1][lane] = mesh.pTexCrd ? mesh.pTexCrd[(size_t)index * mesh.texCrdStride + 1] : 0;
+                }
+            }
+
+            Float3x4 P[3];
+            Float3x4 N[3];
+            __m128 U[3];
+            __m128 V[3];
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                P[i] = { _mm_load_ps(pos[i][0]), _mm_load_ps(pos[i][1]), _mm_load_ps(pos[i][2]) };
+                N[i] = { _mm_load_ps(normal[i][0]), _mm_load_ps(normal[i][1]), _mm_load_ps(normal[i][2]) };
+                U[i] = _mm_load_ps(uv[i][0]);
+                V[i] = _mm_load_ps(uv[i][1]);
+            }
+
+            Float3x4 posDelta0 = sub(P[1], P[0]);
+            Float3x4 posDelta1 = sub(P[2], P[0]);
+            __m128 sx = _mm_sub_ps(U[1], U[0]);
+            __m128 sy = _mm_sub_ps(V[1], V[0]);
+            __m128 tx = _mm_sub_ps(U[2], U[0]);
+            __m128 ty = _mm_sub_ps(V[2], V[0]);
+
+            // Evaluate both branches and pick per lane. The unused branch may produce Inf/NaN, which is harmless
+            const __m128 kZero = _mm_setzero_ps();
+            __m128 sIsZero = _mm_and_ps(_mm_cmpeq_ps(sx, kZero), _mm_cmpeq_ps(sy, kZero));
+            __m128 tIsZero = _mm_and_ps(_mm_cmpeq_ps(tx, kZero), _mm_cmpeq_ps(ty, kZero));
+            __m128 useNormal = _mm_or_ps(sIsZero, tIsZero);
+
+            Float3x4 bitangentN = projectNormalToBitangent(N[0]);
+            Float3x4 tangentN = cross(bitangentN, N[0]);
+
+            __m128 dirCorrection = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sub_ps(_mm_mul_ps(sx, ty), _mm_mul_ps(sy, tx)));
+            Float3x4 tangentUV = mul(sub(mul(posDelta0, ty), mul(posDelta1, tx)), dirCorrection);
+            Float3x4 bitangentUV = mul(sub(mul(posDelta1, sx), mul(posDelta0, sy)), dirCorrection);
+
+            Float3x4 tangent = select(useNormal, tangentN, tangentUV);
+            Float3x4 bitangent = select(useNormal, bitangentN, bitangentUV);
+
+            __m128 invalid = _mm_or_ps(_mm_or_ps(isSpecialFloat(bitangent.x), isSpecialFloat(bitangent.y)), isSpecialFloat(bitangent.z));
+            uint32_t validMask = (~(uint32_t)_mm_movemask_ps(invalid)) & 0xf;
+
+            alignas(16) float corner[3][4];
+            for(uint32_t i = 0; i < 3; i++)
+            {
+                Float3x4 b = calcCornerBitangent(tangent, bitangent, N[i]);
+                _mm_store_ps(corner[0], b.x);
+                _mm_store_ps(corner[1], b.y);
+                _mm_store_ps(corner[2], b.z);
+                for(uint32_t lane = 0; lane < 4; lane++)
+                {
+                    float* pDst = pCorners + lane * 9 + i * 3;
+                    pDst[0] = corner[0][lane];
+                    pDst[1] = corner[1][lane];
+                    pDst[2] = corner[2][lane];
+                }
+            }
+            return validMask;
+        }
+
+        void generateBitangents(const MeshData& mesh, uint32_t indexCount, uint32_t vertexCount, float* pBitangents)
+        {
+            const uint32_t primCount = indexCount / 3;
+            WorkerPool& pool = WorkerPool::getGlobal();
+
+            // Pass 1 - per-triangle work. Every triangle writes the contributions of its 3 corners into its own slots, so there's no sharing between threads
+            std::vector<float> corners((size_t)primCount * 9);
+            std::vector<uint8_t> validPrims(primCount);
+            const uint32_t primJobCount = (primCount + kTrianglesPerJob - 1) / kTrianglesPerJob;
+            pool.parallelFor(0, primJobCount, [&](uint32_t job)
+            {
+                uint32_t first = job * kTrianglesPerJob;
+                uint32_t last = std::min(primCount, first + kTrianglesPerJob);
+                uint32_t prim = first;
+                for(; prim + 4 <= last; prim += 4)
+                {
+                    uint32_t validMask = processTriangles4(mesh, prim, &corners[(size_t)prim * 9]);
+                    for(uint32_t lane = 0; lane < 4; lane++)
+                    {
+                        validPrims[prim + lane] = (validMask >> lane) & 1;
+                    }
+                }
+                for(; prim < last; prim++)
+                {
+                    validPrims[prim] = processTriangle(mesh, prim, &corners[(size_t)prim * 9]) ? 1 : 0;
+                }
+            });
+
+            // Pass 2 - bucket the corners by vertex. Filling the buckets in triangle order preserves the summation order of the sequential algorithm
+            std::vector<uint32_t> offsets(vertexCount + 1, 0);
+            for(uint32_t prim = 0; prim < primCount; prim++)
+            {
+                if(validPrims[prim] == 0) continue;
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    offsets[mesh.pIndices[prim * 3 + i] + 1]++;
+                }
+            }
+            for(uint32_t v = 0; v < vertexCount; v++)
+            {
+                offsets[v + 1] += offsets[v];
+            }
+
+            std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+            std::vector<uint32_t> cornerRefs(offsets[vertexCount]);
+            for(uint32_t prim = 0; prim < primCount; prim++)
+            {
+                if(validPrims[prim] == 0) continue;
+                for(uint32_t i = 0; i < 3; i++)
+                {
+                    cornerRefs[cursor[mesh.pIndices[prim * 3 + i]]++] = prim * 3 + i;
+                }
+            }
+
+            // Pass 3 - gather and normalize per vertex
+            const uint32_t vertexJobCount = (vertexCount + kVerticesPerJob - 1) / kVerticesPerJob;
+            pool.parallelFor(0, vertexJobCount, [&](uint32_t job)
+            {
+                uint32_t first = job * kVerticesPerJob;
+                uint32_t last = std::min(vertexCount, first + kVerticesPerJob);
+                for(uint32_t v = first; v < last; v++)
+                {
+                    Float3 sum = { 0, 0, 0 };
+                    for(uint32_t r = offsets[v]; r < offsets[v + 1]; r++)
+                    {
+                        const float* pCorner = &corners[(size_t)cornerRefs[r] * 3];
+                        sum.x += pCorner[0];
+                        sum.y += pCorner[1];
+                        sum.z += pCorner[2];
+                    }
+
+                    Float3 bitangent = normalize(sum);
+                    if(isInvalidVec(bitangent))
+                    {
+                        bitangent = projectNormalToBitangent(loadFloat3(mesh.pNormals, v, 3));
+                    }
+                    pBitangents[(size_t)v * 3 + 0] = bitangent.x;
+                    pBitangents[(size_t)v * 3 + 1] = bitangent.y;
+                    pBitangents[(size_t)v * 3 + 2] = bitangent.z;
+                }
+            });
+        }
+    }
+
+    template<typename posType>
+    void generateSubmeshTangentData(
+        const uint32_t* indices,
+        uint32_t indexCount,
+        uint32_t vertexCount,
+        const posType* vertexPosData,
+        const glm::vec3* vertexNormalData,
+        const glm::vec2* texCrdData,
+        uint32_t texCrdCount,
+        glm::vec3* bitangentData)
+    {
+        static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "generateBitangents() expects tightly packed vectors");
+
+        MeshData mesh;
+        mesh.pIndices = indices;
+        mesh.pPos = (const float*)vertexPosData;
+        mesh.posStride = sizeof(posType) / sizeof(float);
+        mesh.pNormals = (const float*)vertexNormalData;
+        mesh.pTexCrd = (const float*)texCrdData;
+        mesh.texCrdStride = texCrdCount * 2;
+        generateBitangents(mesh, indexCount, vertexCount, (float*)bitangentData);
+    }
+
+    template void generateSubmeshTangentData<glm::vec3>(const uint32_t*, uint32_t, uint32_t, const glm::vec3*, const glm::vec3*, const glm::vec2*, uint32_t, glm::vec3*);
+    template void generateSubmeshTangentData<glm::vec4>(const uint32_t*, uint32_t, uint32_t, const glm::vec4*, const glm::vec3*, const glm::vec2*, uint32_t, glm::vec3*);
+}
@@ -0,0 +1,58 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "glm/vec2.hpp"
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+
+namespace Falcor
+{
+    /** Generate per-vertex bitangents for an indexed triangle list.
+        Each triangle contributes its UV-space bitangent, projected into the plane of the vertex normal, to its 3 vertices. The sums are then normalized.
+        Vertices without a valid bitangent fall back to a direction derived from the normal alone.
+        The work is split across the global WorkerPool. The result is bit-identical to a sequential evaluation, since every vertex sums its contributions in triangle order.
+        \param[in] indices Index buffer. Every 3 indices form a triangle
+        \param[in] indexCount Number of indices
+        \param[in] vertexCount Number of vertices
+        \param[in] vertexPosData Vertex positions. Only xyz are used
+        \param[in] vertexNormalData Vertex normals
+        \param[in] texCrdData Texture coordinates. Can be nullptr
+        \param[in] texCrdCount Number of vec2 elements per vertex in texCrdData. The first one is used
+        \param[out] bitangentData Receives vertexCount bitangents
+    */
+    template<typename posType>
+    void generateSubmeshTangentData(
+        const uint32_t* indices,
+        uint32_t indexCount,
+        uint32_t vertexCount,
+        const posType* vertexPosData,
+        const glm::vec3* vertexNormalData,
+        const glm::vec2* texCrdData,
+        uint32_t texCrdCount,
+        glm::vec3* bitangentData);
+}
@@ -0,0 +1,204 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VertexQuantizer.h"
+#include "Data/VertexAttrib.h"
+#include "glm/common.hpp"
+#include "glm/packing.hpp"
+#include <cmath>
+#include <cfloat>
+
+namespace Falcor
+{
+    static uint16_t toUnorm16(float v)
+    {
+        return (uint16_t)std::round(glm::clamp(v, 0.f, 1.f) * 65535.f);
+    }
+
+    static int16_t toSnorm16(float v)
+    {
+        return (int16_t)std::round(glm::clamp(v, -1.f, 1.f) * 32767.f);
+    }
+
+    // Project the vector onto the octahedron |x| + |y| + |z| = 1 and unfold the lower half over the corners. Zero vectors decode to +Z.
+    static glm::vec2 encodeOctahedral(const glm::vec3& v)
+    {
+        float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1 == 0)
+        {
+            return glm::vec2(0);
+        }
+
+        glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+        if (v.z < 0)
+        {
+            p = glm::vec2((1 - std::abs(p.y)) * (p.x >= 0 ? 1.f : -1.f), (1 - std::abs(p.x)) * (p.y >= 0 ? 1.f : -1.f));
+        }
+        return p;
+    }
+
+    static glm::vec3 readElement(const std::vector<uint8_t>& data, uint32_t stride, uint32_t channels, uint32_t vertexID)
+    {
+        const float* pSrc = (const float*)(data.data() + stride * vertexID);
+        glm::vec3 v(0);
+        for (uint32_t c = 0; c < channels && c < 3; c++)
+        {
+            v[c] = pSrc[c];
+        }
+        return v;
+    }
+
+    static std::vector<uint8_t> quantizePositions(const std::vector<uint8_t>& data, uint32_t stride, uint32_t channels, uint32_t vertexCount, glm::vec3& scale, glm::vec3& offset)
+    {
+        glm::vec3 boxMin(FLT_MAX);
+        glm::vec3 boxMax(-FLT_MAX);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 p = readElement(data, stride, channels, v);
+            boxMin = glm::min(boxMin, p);
+            boxMax = glm::max(boxMax, p);
+        }
+
+        scale = boxMax - boxMin;
+        offset = boxMin;
+        glm::vec3 invScale;
+        for (uint32_t c = 0; c < 3; c++)
+        {
+            invScale[c] = scale[c] > 0 ? 1 / scale[c] : 0;
+        }
+
+        std::vector<uint8_t> quantized(vertexCount * 4 * sizeof(uint16_t));
+        uint16_t* pDst = (uint16_t*)quantized.data();
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 p = (readElement(data, stride, channels, v) - offset) * invScale;
+            pDst[v * 4 + 0] = toUnorm16(p.x);
+            pDst[v * 4 + 1] = toUnorm16(p.y);
+            pDst[v * 4 + 2] = toUnorm16(p.z);
+            pDst[v * 4 + 3] = 0;
+        }
+        return quantized;
+    }
+
+    static std::vector<uint8_t> quantizeDirections(const std::vector<uint8_t>& data, uint32_t stride, uint32_t channels, uint32_t vertexCount)
+    {
+        std::vector<uint8_t> quantized(vertexCount * 2 * sizeof(int16_t));
+        int16_t* pDst = (int16_t*)quantized.data();
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            glm::vec2 e = encodeOctahedral(readElement(data, stride, channels, v));
+            pDst[v * 2 + 0] = toSnorm16(e.x);
+            pDst[v * 2 + 1] = toSnorm16(e.y);
+        }
+        return quantized;
+    }
+
+    static std::vector<uint8_t> quantizeTexCoords(const std::vector<uint8_t>& data, uint32_t stride, uint32_t vertexCount, ResourceFormat& format)
+    {
+        bool normalized = true;
+        for (uint32_t v = 0; v < vertexCount && normalized; v++)
+        {
+            glm::vec3 uv = readElement(data, stride, 2, v);
+            normalized = (uv.x >= 0 && uv.x <= 1 && uv.y >= 0 && uv.y <= 1);
+        }
+
+        format = normalized ? ResourceFormat::RG16Unorm : ResourceFormat::RG16Float;
+        std::vector<uint8_t> quantized(vertexCount * sizeof(uint32_t));
+        uint32_t* pDst = (uint32_t*)quantized.data();
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 uv = readElement(data, stride, 2, v);
+            pDst[v] = normalized ? glm::packUnorm2x16(glm::vec2(uv)) : glm::packHalf2x16(glm::vec2(uv));
+        }
+        return quantized;
+    }
+
+    VertexLayout::SharedPtr quantizeVertices(const VertexLayout* pLayout, std::vector<std::vector<uint8_t>>& vertexData, uint32_t vertexCount, glm::vec3& positionScale, glm::vec3& positionOffset)
+    {
+        positionScale = glm::vec3(1);
+        positionOffset = glm::vec3(0);
+
+        VertexLayout::SharedPtr pQuantizedLayout = VertexLayout::create();
+        for (uint32_t i = 0; i < (uint32_t)pLayout->getBufferCount(); i++)
+        {
+            const VertexBufferLayout::SharedConstPtr& pBufferLayout = pLayout->getBufferLayout(i);
+            pQuantizedLayout->addBufferLayout(i, pBufferLayout);
+            if (pBufferLayout == nullptr || pBufferLayout->getElementCount() != 1)
+            {
+                continue;
+            }
+
+            // Only full-precision float elements are quantized
+            const ResourceFormat format = pBufferLayout->getElementFormat(0);
+            const uint32_t channels = getFormatChannelCount(format);
+            if (getFormatType(format) != FormatType::Float || getFormatBytesPerBlock(format) != channels * sizeof(float))
+            {
+                continue;
+            }
+
+            const uint32_t stride = pBufferLayout->getStride();
+            const uint32_t location = pBufferLayout->getElementShaderLocation(0);
+            ResourceFormat quantizedFormat = ResourceFormat::Unknown;
+            std::vector<uint8_t> quantized;
+            switch (location)
+            {
+            case VERTEX_POSITION_LOC:
+                if (channels >= 3)
+                {
+                    quantized = quantizePositions(vertexData[i], stride, channels, vertexCount, positionScale, positionOffset);
+                    quantizedFormat = ResourceFormat::RGBA16Unorm;
+                }
+                break;
+            case VERTEX_NORMAL_LOC:
+            case VERTEX_BITANGENT_LOC:
+                if (channels >= 3)
+                {
+                    quantized = quantizeDirections(vertexData[i], stride, channels, vertexCount);
+                    quantizedFormat = ResourceFormat::RG16Snorm;
+                }
+                break;
+            case VERTEX_TEXCOORD_LOC:
+            case VERTEX_LIGHTMAP_UV_LOC:
+                if (channels >= 2)
+                {
+                    quantized = quantizeTexCoords(vertexData[i], stride, vertexCount, quantizedFormat);
+                }
+                break;
+            }
+
+            if (quantizedFormat != ResourceFormat::Unknown)
+            {
+                VertexBufferLayout::SharedPtr pQuantizedBufferLayout = VertexBufferLayout::create();
+                pQuantizedBufferLayout->addElement(pBufferLayout->getElementName(0), 0, quantizedFormat, 1, location);
+                pQuantizedLayout->addBufferLayout(i, pQuantizedBufferLayout);
+                vertexData[i] = std::move(quantized);
+            }
+        }
+        return pQuantizedLayout;
+    }
+}
@@ -0,0 +1,46 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "glm/vec3.hpp"
+#include "API/VertexLayout.h"
+
+namespace Falcor
+{
+    /** Quantize the vertex buffers of a mesh, see Model::LoadFlags::QuantizeVertices.
+        Positions are stored in RGBA16Unorm relative to the bounding-box of the vertices. Normals and bitangents are octahedral-encoded in RG16Snorm.
+        Texture coordinates are stored in RG16Unorm if they are all inside [0, 1], and in RG16Float otherwise. The other elements are kept as they are.
+        \param[in] pLayout The layout of the buffers. Every buffer must hold a single element, as the importers lay them out.
+        \param[in,out] vertexData The data of every buffer in the layout
+        \param[in] vertexCount Number of vertices
+        \param[out] positionScale The scale which dequantizes the positions, see Mesh::getPositionScale()
+        \param[out] positionOffset The offset which dequantizes the positions
+        \return The layout of the quantized buffers
+    */
+    VertexLayout::SharedPtr quantizeVertices(const VertexLayout* pLayout, std::vector<std::vector<uint8_t>>& vertexData, uint32_t vertexCount, glm::vec3& positionScale, glm::vec3& positionOffset);
+}
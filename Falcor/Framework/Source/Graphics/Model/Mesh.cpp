@@ -36,6 +36,7 @@
 #include "API/VertexLayout.h"
 #include "Graphics/Camera/Camera.h"
 #include "Data/VertexAttrib.h"
+#include <cfloat>
 
 namespace Falcor
 { 
@@ -50,9 +51,10 @@ namespace Falcor
         Vao::Topology topology,
         const Material::SharedPtr& pMaterial,
         const BoundingBox& boundingBox,
-        bool hasBones)
+        bool hasBones,
+        ResourceFormat indexFormat)
     {
-        return SharedPtr(new Mesh(vertexBuffers, vertexCount, pIndexBuffer, indexCount, pLayout, topology, pMaterial, boundingBox, hasBones));
+        return SharedPtr(new Mesh(vertexBuffers, vertexCount, pIndexBuffer, indexCount, pLayout, topology, pMaterial, boundingBox, hasBones, indexFormat));
     }
 
     Mesh::Mesh(const Vao::BufferVec& vertexBuffers,
@@ -63,7 +65,8 @@ namespace Falcor
         Vao::Topology topology,
         const Material::SharedPtr& pMaterial,
         const BoundingBox& boundingBox,
-        bool hasBones) 
+        bool hasBones,
+        ResourceFormat indexFormat)
         : mId(sMeshCounter++)
         , mIndexCount(indexCount)
         , mVertexCount(vertexCount)
@@ -88,8 +91,282 @@ namespace Falcor
         }
 
         mPrimitiveCount = mIndexCount / VertsPerPrim;
+        mLods.push_back({ 0, mIndexCount, 0.0f });
 
-        mpVao = Vao::create(topology, pLayout, vertexBuffers, pIndexBuffer, ResourceFormat::R32Uint);
+        assert(indexFormat == ResourceFormat::R32Uint || indexFormat == ResourceFormat::R16Uint);
+        mpVao = Vao::create(topology, pLayout, vertexBuffers, pIndexBuffer, indexFormat);
+    }
+
+    void Mesh::setCpuGeometry(const CpuPositions& pPositions, std::vector<uint32_t> indices)
+    {
+        assert(mpVao->getPrimitiveTopology() == Vao::Topology::TriangleList);
+        mpCpuPositions = pPositions;
+        mCpuIndices = std::move(indices);
+    }
+
+    void Mesh::setLods(std::vector<Lod> lods)
+    {
+        assert(lods.size() > 0 && lods.size() <= kMaxLodCount);
+        assert(lods[0].firstIndex == 0 && lods[0].indexCount == mIndexCount);
+        mLods = std::move(lods);
+    }
+
+    void Mesh::setPositionQuantization(const glm::vec3& scale, const glm::vec3& offset)
+    {
+        mQuantizedPositions = true;
+        mPositionScale = scale;
+        mPositionOffset = offset;
+    }
+
+    const BoundingVolumeHierarchy* Mesh::getTriangleBvh() const
+    {
+        if (hasCpuGeometry() == false) return nullptr;
+
+        std::call_once(mTriangleBvhFlag, [this]()
+        {
+            const auto& positions = *mpCpuPositions;
+            const uint32_t triangleCount = (uint32_t)mCpuIndices.size() / 3;
+            std::vector<BoundingBox> boxes(triangleCount);
+            for (uint32_t i = 0; i < triangleCount; i++)
+            {
+                const glm::vec3& p0 = positions[mCpuIndices[i * 3 + 0]];
+                const glm::vec3& p1 = positions[mCpuIndices[i * 3 + 1]];
+                const glm::vec3& p2 = positions[mCpuIndices[i * 3 + 2]];
+                boxes[i] = BoundingBox::fromMinMax(glm::min(p0, glm::min(p1, p2)), glm::max(p0, glm::max(p1, p2)));
+            }
+            mpTriangleBvh = BoundingVolumeHierarchy::create();
+            mpTriangleBvh->build(boxes);
+        });
+        return mpTriangleBvh.get();
+    }
+
+    bool Mesh::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& t, uint32_t& triangleID, glm::vec2& barycentrics) const
+    {
+        const BoundingVolumeHierarchy* pBvh = getTriangleBvh();
+        if (pBvh == nullptr) return false;
+
+        const auto& positions = *mpCpuPositions;
+        bool found = false;
+        auto intersectTriangle = [&](uint32_t triangle, float tMax)
+        {
+            // Moller-Trumbore
+            const glm::vec3& p0 = positions[mCpuIndices[triangle * 3 + 0]];
+            const glm::vec3 e1 = positions[mCpuIndices[triangle * 3 + 1]] - p0;
+            const glm::vec3 e2 = positions[mCpuIndices[triangle * 3 + 2]] - p0;
+            glm::vec3 p = glm::cross(direction, e2);
+            float det = glm::dot(e1, p);
+            if (det == 0) return tMax;
+
+            float invDet = 1.0f / det;
+            glm::vec3 s = origin - p0;
+            float u = glm::dot(s, p) * invDet;
+            if (u < 0 || u > 1) return tMax;
+
+            glm::vec3 q = glm::cross(s, e1);
+            float v = glm::dot(direction, q) * invDet;
+            if (v < 0 || u + v > 1) return tMax;
+
+            float hitT = glm::dot(e2, q) * invDet;
+            if (hitT < 0 || hitT >= tMax) return tMax;
+
+            found = true;
+            triangleID = triangle;
+            barycentrics = glm::vec2(u, v);
+            return hitT;
+        };
+
+        t = pBvh->intersectRay(origin, direction, t, intersectTriangle);
+        return found;
+    }
+
+    /** Compute the bounding sphere and the normal cone of a meshlet, following the cone construction of meshoptimizer
+    */
+    static void computeMeshletBounds(Mesh::Meshlet& meshlet, const uint32_t* pIndices, const std::vector<glm::vec3>& positions)
+    {
+        const uint32_t indexCount = meshlet.triangleCount * 3;
+
+        glm::vec3 boxMin(FLT_MAX);
+        glm::vec3 boxMax(-FLT_MAX);
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            boxMin = glm::min(boxMin, positions[pIndices[i]]);
+            boxMax = glm::max(boxMax, positions[pIndices[i]]);
+        }
+        meshlet.center = (boxMin + boxMax) * 0.5f;
+        meshlet.radius = 0;
+        for (uint32_t i = 0; i < indexCount; i++)
+        {
+            meshlet.radius = glm::max(meshlet.radius, glm::length(positions[pIndices[i]] - meshlet.center));
+        }
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(meshlet.triangleCount);
+        glm::vec3 normalSum(0);
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            const glm::vec3& p0 = positions[pIndices[i]];
+            glm::vec3 n = glm::cross(positions[pIndices[i + 1]] - p0, positions[pIndices[i + 2]] - p0);
+            float length = glm::length(n);
+            if (length > 0)
+            {
+                normals.push_back(n / length);
+                normalSum += normals.back();
+            }
+        }
+
+        meshlet.coneApex = meshlet.center;
+        meshlet.coneAxis = glm::vec3(0, 0, 1);
+        meshlet.coneCutoff = 1;
+        float sumLength = glm::length(normalSum);
+        if (sumLength == 0)
+        {
+            return;
+        }
+
+        glm::vec3 axis = normalSum / sumLength;
+        float minDot = 1;
+        for (const glm::vec3& n : normals)
+        {
+            minDot = glm::min(minDot, glm::dot(n, axis));
+        }
+
+        // Cones wider than a hemisphere can't be culled
+        if (minDot <= 0.1f)
+        {
+            return;
+        }
+
+        // Move the apex back along the axis until every triangle plane is in front of it
+        float maxT = 0;
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            const glm::vec3& p0 = positions[pIndices[i]];
+            glm::vec3 n = glm::cross(positions[pIndices[i + 1]] - p0, positions[pIndices[i + 2]] - p0);
+            float length = glm::length(n);
+            if (length > 0)
+            {
+                n /= length;
+                maxT = glm::max(maxT, glm::dot(meshlet.center - p0, n) / glm::dot(axis, n));
+            }
+        }
+
+        meshlet.coneApex = meshlet.center - axis * maxT;
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = sqrtf(1 - minDot * minDot);
+    }
+
+    void Mesh::buildMeshlets(uint32_t maxVertices, uint32_t maxTriangles)
+    {
+        assert(maxVertices >= 3 && maxVertices <= 256 && maxTriangles >= 1);
+        mMeshlets.clear();
+        mMeshletVertices.clear();
+        mMeshletTriangles.clear();
+        if (hasCpuGeometry() == false)
+        {
+            return;
+        }
+
+        // Local index of every vertex in the current meshlet
+        const uint32_t kNotInMeshlet = ~0u;
+        std::vector<uint32_t> localIndex(mpCpuPositions->size(), kNotInMeshlet);
+
+        Meshlet meshlet;
+        auto finishMeshlet = [&]()
+        {
+            for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+            {
+                localIndex[mMeshletVertices[meshlet.vertexOffset + v]] = kNotInMeshlet;
+            }
+            computeMeshletBounds(meshlet, mCpuIndices.data() + meshlet.firstIndex, *mpCpuPositions);
+            mMeshlets.push_back(meshlet);
+        };
+
+        const uint32_t indexCount = (uint32_t)mCpuIndices.size();
+        for (uint32_t i = 0; i < indexCount; i += 3)
+        {
+            const uint32_t* pTriangle = &mCpuIndices[i];
+            uint32_t newVertices = 0;
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                bool repeated = (k > 0 && pTriangle[k] == pTriangle[0]) || (k > 1 && pTriangle[k] == pTriangle[1]);
+                newVertices += (localIndex[pTriangle[k]] == kNotInMeshlet && repeated == false) ? 1 : 0;
+            }
+
+            if (meshlet.triangleCount > 0 && (meshlet.vertexCount + newVertices > maxVertices || meshlet.triangleCount == maxTriangles))
+            {
+                finishMeshlet();
+                meshlet = Meshlet();
+            }
+
+            if (meshlet.triangleCount == 0)
+            {
+                meshlet.firstIndex = i;
+                meshlet.vertexOffset = (uint32_t)mMeshletVertices.size();
+                meshlet.triangleOffset = (uint32_t)(mMeshletTriangles.size() / 3);
+            }
+
+            for (uint32_t k = 0; k < 3; k++)
+            {
+                uint32_t& local = localIndex[pTriangle[k]];
+                if (local == kNotInMeshlet)
+                {
+                    local = meshlet.vertexCount++;
+                    mMeshletVertices.push_back(pTriangle[k]);
+                }
+                mMeshletTriangles.push_back((uint8_t)local);
+            }
+            meshlet.triangleCount++;
+        }
+
+        if (meshlet.triangleCount > 0)
+        {
+            finishMeshlet();
+        }
+    }
+
+    void Mesh::cullMeshlets(const Camera* pCamera, const glm::mat4& worldMat, bool cullBackfaces, std::vector<uint32_t>& visibleMeshlets) const
+    {
+        visibleMeshlets.clear();
+
+        glm::vec4 planes[6];
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            planes[p] = pCamera->getFrustumPlane(p);
+            planes[p] /= glm::length(glm::vec3(planes[p]));
+        }
+
+        // The spheres are scaled by the largest axis scale, which keeps the frustum test conservative for non-uniform scaling
+        const glm::mat3 linear(worldMat);
+        const float scale = sqrtf(glm::max(glm::dot(linear[0], linear[0]), glm::max(glm::dot(linear[1], linear[1]), glm::dot(linear[2], linear[2]))));
+
+        // The cones are tested in object space. Affine transforms don't change which side of a triangle the camera is on, unless they mirror the mesh.
+        cullBackfaces = cullBackfaces && (glm::determinant(linear) > 0);
+        const glm::vec3 cameraPos = glm::vec3(glm::inverse(worldMat) * glm::vec4(pCamera->getPosition(), 1));
+
+        for (uint32_t i = 0; i < (uint32_t)mMeshlets.size(); i++)
+        {
+            const Meshlet& meshlet = mMeshlets[i];
+            const glm::vec3 center = glm::vec3(worldMat * glm::vec4(meshlet.center, 1));
+            const float radius = meshlet.radius * scale;
+
+            bool visible = true;
+            for (uint32_t p = 0; visible && p < 6; p++)
+            {
+                visible = glm::dot(glm::vec3(planes[p]), center) + planes[p].w > -radius;
+            }
+
+            if (visible && cullBackfaces)
+            {
+                glm::vec3 view = meshlet.coneApex - cameraPos;
+                float viewLength = glm::length(view);
+                visible = (viewLength == 0) || (glm::dot(view, meshlet.coneAxis) <= meshlet.coneCutoff * viewLength);
+            }
+
+            if (visible)
+            {
+                visibleMeshlets.push_back(i);
+            }
+        }
     }
 
     void Mesh::resetGlobalIdCounter()
@@ -28,11 +28,13 @@
 #pragma once
 #include <map>
 #include <vector>
+#include <mutex>
 #include "glm/vec3.hpp"
 #include "glm/mat4x4.hpp"
 #include "API/VAO.h"
 #include "API/RenderContext.h"
 #include "Utils/AABB.h"
+#include "Utils/Math/BoundingVolumeHierarchy.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Paths/MovableObject.h"
 
@@ -65,6 +67,7 @@ namespace Falcor
             \param[in] pMaterial The material of the mesh
             \param[in] BoundingBox The mesh's axis-aligned bounding-box
             \param[in] bHasBones Indicates the the mesh uses bones for animation
+            \param[in] indexFormat The format of the index buffer, ResourceFormat::R32Uint or ResourceFormat::R16Uint
         */
         static SharedPtr create(const Vao::BufferVec& vertexBuffers,
             uint32_t vertexCount,
@@ -74,7 +77,8 @@ namespace Falcor
             Vao::Topology topology,
             const Material::SharedPtr& pMaterial,
             const BoundingBox& boundingBox,
-            bool hasBones);
+            bool hasBones,
+            ResourceFormat indexFormat = ResourceFormat::R32Uint);
 
         /** Destructor
         */
@@ -92,10 +96,93 @@ namespace Falcor
         */
         uint32_t getPrimitiveCount() const { return mPrimitiveCount; }
 
-        /** Get the number of indices in the index buffer. Use this value when drawing the mesh.
+        /** Get the number of indices of the full-detail mesh. Use this value when drawing the mesh without LODs.
         */
         uint32_t getIndexCount() const { return mIndexCount; }
 
+        static const uint32_t kMaxLodCount = 16; ///> Max supported levels of detail per mesh, including the full-detail mesh
+
+        /** A level of detail. All the levels of a mesh share its vertices and are stored back to back in its index buffer.
+        */
+        struct Lod
+        {
+            uint32_t firstIndex = 0;    ///< Offset of the level in the index buffer
+            uint32_t indexCount = 0;    ///< Number of indices of the level
+            float error = 0;            ///< Geometric error of the level, relative to the length of the bounding-box half-diagonal
+        };
+
+        /** Get the number of levels of detail. Level 0 is the full-detail mesh, and the error grows with the level.
+        */
+        uint32_t getLodCount() const { return (uint32_t)mLods.size(); }
+
+        /** Get a level of detail
+        */
+        const Lod& getLod(uint32_t lod) const { return mLods[lod]; }
+
+        static const uint32_t kMeshletMaxVertices = 64;     ///> Default max number of vertices per meshlet
+        static const uint32_t kMeshletMaxTriangles = 124;   ///> Default max number of triangles per meshlet
+
+        /** A cluster of triangles of the full-detail mesh. The triangles of a meshlet are contiguous in the index buffer, so a set of meshlets can be drawn as index ranges.
+            The meshlet is also described with its own vertex list and 8-bit local indices, which is the layout mesh shaders consume.
+        */
+        struct Meshlet
+        {
+            uint32_t firstIndex = 0;        ///< Offset of the meshlet's triangles in the index buffer
+            uint32_t vertexOffset = 0;      ///< Offset of the meshlet's vertices in getMeshletVertices()
+            uint32_t triangleOffset = 0;    ///< Offset of the meshlet's triangles in getMeshletTriangles(), in triangles. Every triangle is 3 local vertex indices.
+            uint32_t vertexCount = 0;       ///< Number of vertices
+            uint32_t triangleCount = 0;     ///< Number of triangles
+            glm::vec3 center;               ///< Center of the bounding sphere, in object space
+            float radius = 0;               ///< Radius of the bounding sphere
+            glm::vec3 coneApex;             ///< Apex of the normal cone, in object space
+            glm::vec3 coneAxis;             ///< Axis of the normal cone
+            float coneCutoff = 1;           ///< The meshlet faces away from a camera at position p if dot(normalize(coneApex - p), coneAxis) > coneCutoff. 1 if the normals are too spread out to ever cull it.
+        };
+
+        /** Split the full-detail mesh into meshlets and compute their bounds. The triangles are grouped greedily in index buffer order, so the meshlets are tighter if the mesh was optimized for the vertex cache.
+            Does nothing if the mesh has no CPU geometry.
+            \param[in] maxVertices Max number of vertices per meshlet, at most 256
+            \param[in] maxTriangles Max number of triangles per meshlet
+        */
+        void buildMeshlets(uint32_t maxVertices = kMeshletMaxVertices, uint32_t maxTriangles = kMeshletMaxTriangles);
+
+        /** Get the number of meshlets. 0 if buildMeshlets() wasn't called.
+        */
+        uint32_t getMeshletCount() const { return (uint32_t)mMeshlets.size(); }
+
+        /** Get a meshlet
+        */
+        const Meshlet& getMeshlet(uint32_t meshletID) const { return mMeshlets[meshletID]; }
+
+        /** Get the vertex lists of all the meshlets
+        */
+        const std::vector<uint32_t>& getMeshletVertices() const { return mMeshletVertices; }
+
+        /** Get the local triangles of all the meshlets. Every triangle is 3 indices into the meshlet's vertex list.
+        */
+        const std::vector<uint8_t>& getMeshletTriangles() const { return mMeshletTriangles; }
+
+        /** Cull the meshlets of an instance of the mesh against a camera. This is the CPU reference for cluster culling.
+            The bounding spheres are tested against the frustum. If requested, meshlets facing away from the camera are culled with their normal cones, assuming counter-clockwise front faces.
+            \param[in] pCamera The camera
+            \param[in] worldMat The instance's world matrix
+            \param[in] cullBackfaces Whether to cull the meshlets facing away from the camera. Ignored for mirroring transforms.
+            \param[out] visibleMeshlets The IDs of the visible meshlets, in increasing order
+        */
+        void cullMeshlets(const Camera* pCamera, const glm::mat4& worldMat, bool cullBackfaces, std::vector<uint32_t>& visibleMeshlets) const;
+
+        /** Check if the positions in the vertex buffer are quantized, see Model::LoadFlags::QuantizeVertices
+        */
+        bool hasQuantizedPositions() const { return mQuantizedPositions; }
+
+        /** Get the scale which dequantizes the positions. The vertex shader computes the object-space position as the stored position * scale + offset.
+        */
+        const glm::vec3& getPositionScale() const { return mPositionScale; }
+
+        /** Get the offset which dequantizes the positions
+        */
+        const glm::vec3& getPositionOffset() const { return mPositionOffset; }
+
         /** Get a pointer to the mesh's material
         */
         const Material::SharedPtr& getMaterial() const { return mpMaterial; }
@@ -122,6 +209,35 @@ namespace Falcor
 
         static const uint32_t kMaxBonesPerVertex = 4; ///> Max supported bones per vertex
 
+        using CpuPositions = std::shared_ptr<const std::vector<glm::vec3>>;
+
+        /** Check if the geometry was kept on the CPU for ray queries. The importers keep it for triangle lists when the model is loaded with Model::LoadFlags::KeepCpuGeometry or Model::LoadFlags::GenerateMeshlets.
+        */
+        bool hasCpuGeometry() const { return mpCpuPositions != nullptr; }
+
+        /** Get the vertex positions kept on the CPU. Meshes which share a vertex buffer share the positions. Only valid if hasCpuGeometry() returns true.
+        */
+        const std::vector<glm::vec3>& getCpuPositions() const { return *mpCpuPositions; }
+
+        /** Get the indices kept on the CPU. Only valid if hasCpuGeometry() returns true.
+        */
+        const std::vector<uint32_t>& getCpuIndices() const { return mCpuIndices; }
+
+        /** Get the BVH over the mesh's triangles, in object space. Box i of the BVH is triangle i. The BVH is built on first use, and this function can be called concurrently.
+            \return The BVH, or nullptr if the mesh has no CPU geometry
+        */
+        const BoundingVolumeHierarchy* getTriangleBvh() const;
+
+        /** Find the closest intersection of a ray with the mesh's triangles, in object space. Both sides of the triangles are hit. Skinned meshes are intersected in their bind pose.
+            \param[in] origin Ray origin
+            \param[in] direction Ray direction. Distances are in multiples of its length.
+            \param[in,out] t On input, the max distance along the ray. On output, the distance to the hit if one was found.
+            \param[out] triangleID The triangle which was hit
+            \param[out] barycentrics The barycentrics of the hit, relative to the second and third vertices of the triangle
+            \return Whether a hit closer than the input t was found
+        */
+        bool intersectRay(const glm::vec3& origin, const glm::vec3& direction, float& t, uint32_t& triangleID, glm::vec2& barycentrics) const;
+
         // TODO: Get mesh ID in file mesh was loaded from (temporary, fix better solution later)
         const uint32_t getLoadId() const { return mLoadId; }
 
@@ -130,6 +246,20 @@ namespace Falcor
         friend BinaryModelImporter;
         friend SimpleModelImporter;
 
+        /** Keep the geometry of a triangle list on the CPU for ray queries
+            \param[in] pPositions The vertex positions, which can be shared with other meshes using the same vertex buffer
+            \param[in] indices The indices of the full-detail mesh
+        */
+        void setCpuGeometry(const CpuPositions& pPositions, std::vector<uint32_t> indices);
+
+        /** Set the levels of detail stored in the index buffer. The first level must be the full-detail mesh.
+        */
+        void setLods(std::vector<Lod> lods);
+
+        /** Set the dequantization of positions stored in normalized integers
+        */
+        void setPositionQuantization(const glm::vec3& scale, const glm::vec3& offset);
+
     private:
         Mesh(const Vao::BufferVec& vertexBuffers,
             uint32_t vertexCount,
@@ -139,7 +269,8 @@ namespace Falcor
             Vao::Topology topology,
             const Material::SharedPtr& pMaterial,
             const BoundingBox& boundingBox,
-            bool hasBones);
+            bool hasBones,
+            ResourceFormat indexFormat);
 
         static uint32_t sMeshCounter;
 
@@ -149,8 +280,21 @@ namespace Falcor
         uint32_t mVertexCount = 0;
         uint32_t mPrimitiveCount = 0;
         bool mHasBones = false;
+        bool mQuantizedPositions = false;
+        glm::vec3 mPositionScale = glm::vec3(1);
+        glm::vec3 mPositionOffset = glm::vec3(0);
         Material::SharedPtr mpMaterial;
         BoundingBox mBoundingBox;
         Vao::SharedPtr mpVao;
+        std::vector<Lod> mLods;
+
+        std::vector<Meshlet> mMeshlets;
+        std::vector<uint32_t> mMeshletVertices;
+        std::vector<uint8_t> mMeshletTriangles;
+
+        CpuPositions mpCpuPositions;
+        std::vector<uint32_t> mCpuIndices;
+        mutable std::once_flag mTriangleBvhFlag;
+        mutable BoundingVolumeHierarchy::UniquePtr mpTriangleBvh;
     };
 }
\ No newline at end of file
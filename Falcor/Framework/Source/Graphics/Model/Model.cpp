@@ -41,12 +41,14 @@
 #include "Utils/StringUtils.h"
 #include "Graphics/Camera/Camera.h"
 #include "API/VAO.h"
+#include "Utils/WorkerPool.h"
 #include <set>
 
 namespace Falcor
 {
 
     uint32_t Model::sModelCounter = 0;
+    Model::LodSettings Model::sLodSettings;
     const char* Model::kSupportedFileFormatsStr = "Supported Formats\0*.obj;*.bin;*.dae;*.x;*.md5mesh;*.ply;*.fbx;*.3ds;*.blend;*.ase;*.ifc;*.xgl;*.zgl;*.dxf;*.lwo;*.lws;*.lxo;*.stl;*.x;*.ac;*.ms3d;*.cob;*.scn;*.3d;*.mdl;*.mdl2;*.pk3;*.smd;*.vta;*.raw;*.ter\0\0";
 
     // Method to sort meshes
@@ -69,6 +71,7 @@ namespace Falcor
         mVertexCount = other.mVertexCount;
         mIndexCount = other.mIndexCount;
         mPrimitiveCount = other.mPrimitiveCount;
+        mMeshletCount = other.mMeshletCount;
         mMeshInstanceCount = other.mMeshInstanceCount;
         mBufferCount = other.mBufferCount;
         mMaterialCount = other.mMaterialCount;
@@ -87,6 +90,28 @@ namespace Falcor
 
     Model::~Model() = default;
 
+    void Model::finishLoad(SharedPtr& pModel, bool success, const std::string& filename, LoadFlags flags)
+    {
+        if(success)
+        {
+            if(is_set(flags, LoadFlags::GenerateMeshlets))
+            {
+                pModel->buildMeshlets();
+            }
+            pModel->calculateModelProperties();
+            pModel->setFilename(filename);
+
+            std::string name = getFilenameFromPath(filename);
+            size_t extPos = name.find_last_of('.');
+            name = (extPos == std::string::npos) ? name : name.substr(0, extPos);
+            pModel->setName(name);
+        }
+        else
+        {
+            pModel = nullptr;
+        }
+    }
+
     Model::SharedPtr Model::createFromFile(const char* filename, LoadFlags flags)
     {
         SharedPtr pModel = SharedPtr(new Model());
@@ -100,22 +125,44 @@ namespace Falcor
             res = AssimpModelImporter::import(*pModel, filename, flags);
         }
 
-        if(res)
-        {
-            pModel->calculateModelProperties();
-            pModel->setFilename(filename);
+        finishLoad(pModel, res, filename, flags);
+        return pModel;
+    }
 
-            std::string name = getFilenameFromPath(filename);
-            size_t extPos = name.find_last_of('.');
-            name = (extPos == std::string::npos) ? name : name.substr(0, extPos);
-            pModel->setName(name);
-        }
-        else
+    std::vector<Model::SharedPtr> Model::createFromFiles(const std::vector<std::string>& filenames, LoadFlags flags)
+    {
+        // Parsing is the expensive part of ASSIMP imports and doesn't touch the device, so run it for all the files concurrently.
+        // Binary files are mostly texture decoding, which is already parallel, so they are loaded in order below.
+        std::vector<std::future<AssimpModelImporter::ParsedFile::SharedPtr>> parsedFiles(filenames.size());
+        for(size_t i = 0; i < filenames.size(); i++)
         {
-            pModel = nullptr;
+            if(hasSuffix(filenames[i], ".bin", false) == false)
+            {
+                std::string filename = filenames[i];
+                parsedFiles[i] = WorkerPool::getGlobal().submit([filename, flags]() { return AssimpModelImporter::parseFile(filename, flags); });
+            }
         }
 
-        return pModel;
+        // Create the models in order, so that the result doesn't depend on which file finished parsing first
+        std::vector<SharedPtr> models(filenames.size());
+        for(size_t i = 0; i < filenames.size(); i++)
+        {
+            SharedPtr pModel = SharedPtr(new Model());
+            bool res;
+            if(parsedFiles[i].valid())
+            {
+                AssimpModelImporter::ParsedFile::SharedPtr pFile = parsedFiles[i].get();
+                res = pFile ? AssimpModelImporter::import(*pModel, pFile, flags) : false;
+            }
+            else
+            {
+                res = BinaryModelImporter::import(*pModel, filenames[i], flags);
+            }
+
+            finishLoad(pModel, res, filenames[i], flags);
+            models[i] = pModel;
+        }
+        return models;
     }
 
     Model::SharedPtr Model::create()
@@ -133,11 +180,26 @@ namespace Falcor
         BinaryModelExporter::exportToFile(filename, this);
     }
 
+    void Model::buildMeshlets()
+    {
+        WorkerPool::getGlobal().parallelFor(0, getMeshCount(), [this](uint32_t meshID)
+        {
+            getMesh(meshID)->buildMeshlets();
+        });
+
+        mMeshletCount = 0;
+        for(uint32_t meshID = 0; meshID < getMeshCount(); meshID++)
+        {
+            mMeshletCount += getMesh(meshID)->getMeshletCount() * getMeshInstanceCount(meshID);
+        }
+    }
+
     void Model::calculateModelProperties()
     {
         mVertexCount = 0;
         mIndexCount = 0;
         mPrimitiveCount = 0;
+        mMeshletCount = 0;
         mMeshInstanceCount = 0;
         mBufferCount = 0;
         mMaterialCount = 0;
@@ -163,6 +225,7 @@ namespace Falcor
             mVertexCount += pMesh->getVertexCount() * instanceCount;
             mIndexCount += pMesh->getIndexCount() * instanceCount;
             mPrimitiveCount += pMesh->getPrimitiveCount() * instanceCount;
+            mMeshletCount += pMesh->getMeshletCount() * instanceCount;
             mMeshInstanceCount += instanceCount;
 
             const Material* pMaterial = pMesh->getMaterial().get();
@@ -236,6 +299,28 @@ namespace Falcor
         return changed;
     }
 
+    bool Model::animate(const std::vector<Model*>& models, double currentTime)
+    {
+        std::vector<AnimationController*> controllers;
+        for (Model* pModel : models)
+        {
+            if (pModel->mpAnimationController) controllers.push_back(pModel->mpAnimationController.get());
+        }
+        AnimationController::animate(controllers, currentTime);
+
+        // Skinning issues GPU work, so it stays on this thread
+        bool changed = false;
+        for (Model* pModel : models)
+        {
+            if (pModel->mpAnimationController)
+            {
+                pModel->update();
+                changed = true;
+            }
+        }
+        return changed;
+    }
+
     bool Model::hasAnimations() const
     {
         return (getAnimationsCount() != 0);
@@ -364,6 +449,7 @@ namespace Falcor
         }
 
         mMeshes[meshID].push_back(MeshInstance::create(pMesh, baseTransform));
+        mMeshInstanceVersion++;
     }
 
     void Model::sortMeshes()
@@ -375,6 +461,7 @@ namespace Falcor
         };
         
         std::sort(mMeshes.begin(), mMeshes.end(), matSortPred);
+        mMeshInstanceVersion++;
     }
 
     template<typename T>
@@ -387,12 +474,21 @@ namespace Falcor
 
     void Model::deleteCulledMeshInstances(MeshInstanceList& meshInstances, const Camera *pCamera)
     {
-        for (auto& instance : meshInstances)
+        BoundingBoxArray bounds;
+        bounds.resize((uint32_t)meshInstances.size());
+        for (uint32_t i = 0; i < bounds.size(); i++)
+        {
+            bounds.set(i, meshInstances[i]->getBoundingBox());
+        }
+
+        std::vector<uint32_t> visibilityMask;
+        pCamera->cullObjects(bounds, visibilityMask);
+        for (uint32_t i = 0; i < bounds.size(); i++)
         {
-            if (pCamera->isObjectCulled(instance->getBoundingBox()))
+            if (Camera::isVisible(visibilityMask, i) == false)
             {
                 // Remove mesh ptr reference
-                instance->mpObject = nullptr;
+                meshInstances[i]->mpObject = nullptr;
             }
         }
 
@@ -400,6 +496,7 @@ namespace Falcor
         auto instPred = [](MeshInstance::SharedPtr& instance) { return instance->getObject() == nullptr; };
         auto instEnd = std::remove_if(meshInstances.begin(), meshInstances.end(), instPred);
         meshInstances.erase(instEnd, meshInstances.end());
+        mMeshInstanceVersion++;
     }
 
     void Model::deleteCulledMeshes(const Camera* pCamera)
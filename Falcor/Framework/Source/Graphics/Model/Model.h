@@ -66,12 +66,41 @@ namespace Falcor
             DontMergeMeshes             = 0x8,    ///< Preserve the original list of meshes in the scene, don't merge meshes with the same material
             BuffersAsShaderResource     = 0x10,   ///< Generate the VBs and IB with the shader-resource-view bind flag
             RemoveInstancing            = 0x20,   ///< Flatten mesh instances
+            UseImportCache              = 0x40,   ///< Store the post-processed ASSIMP scene in a snapshot next to the executable and reuse it while the model file and its materials are unchanged
+            OptimizeMeshes              = 0x80,   ///< Reorder the triangles of every triangle list for the post-transform vertex cache and overdraw, and its vertices for fetch locality. The ACMR/ATVR before and after are logged.
+            GenerateLods                = 0x100,  ///< Generate levels of detail for every triangle list by quadric edge collapse, see setLodSettings(). Binary models store their LODs, so they are only generated when missing.
+            GenerateMeshlets            = 0x200,  ///< Split every triangle list into meshlets with bounding spheres and normal cones, see Mesh::buildMeshlets(). Meshlets are built from the CPU geometry, so this implies KeepCpuGeometry.
+            QuantizeVertices            = 0x400,  ///< Store positions in 16 bits relative to the mesh's bounding-box, octahedral-encoded normals and bitangents and 16-bit texture coordinates. ASSIMP models only. Meshes with bones or emissive materials, and models loaded with BuffersAsShaderResource, keep full-precision vertices.
+            KeepCpuGeometry             = 0x800,  ///< Keep the vertex positions and indices of triangle lists on the CPU, for ray queries such as Picking. Without it, meshes are only picked by their bounding-box. Implied by GenerateMeshlets.
         };
 
+        /** Settings for the LODs generated with LoadFlags::GenerateLods
+        */
+        struct LodSettings
+        {
+            uint32_t maxLodCount = 6;       ///< Max number of levels, including the full-detail mesh. Clamped to Mesh::kMaxLodCount.
+            float triangleRatio = 0.5f;     ///< Target triangle count of a level, relative to the previous level
+            float maxError = 0.1f;          ///< Max geometric error of the coarsest level, relative to the length of the mesh's bounding-box half-diagonal
+            uint32_t minTriangleCount = 32; ///< Levels with fewer triangles are not generated
+        };
+
+        /** Set the LOD generation settings used by the following loads
+        */
+        static void setLodSettings(const LodSettings& settings) { sLodSettings = settings; }
+
+        /** Get the LOD generation settings
+        */
+        static const LodSettings& getLodSettings() { return sLodSettings; }
+
         /** Create a new model from file
         */
         static SharedPtr createFromFile(const char* filename, LoadFlags flags = LoadFlags::None);
 
+        /** Create multiple models from files. The files are parsed concurrently, the API objects are created on the calling thread.
+            \return The models, in the same order as the filenames. Models which failed to load are nullptr
+        */
+        static std::vector<SharedPtr> createFromFiles(const std::vector<std::string>& filenames, LoadFlags flags = LoadFlags::None);
+
         static SharedPtr create();
 
         static const char* kSupportedFileFormatsStr;
@@ -106,6 +135,14 @@ namespace Falcor
         */
         uint32_t getPrimitiveCount() const { return mPrimitiveCount; }
 
+        /** Get the number of meshlets in the model, over all the mesh instances.
+        */
+        uint32_t getMeshletCount() const { return mMeshletCount; }
+
+        /** Split the meshes into meshlets, see Mesh::buildMeshlets(). The meshes are processed concurrently.
+        */
+        void buildMeshlets();
+
         /** Get the number of meshes in the model.
         */
         uint32_t getMeshCount() const { return uint32_t(mMeshes.size()); }
@@ -151,6 +188,10 @@ namespace Falcor
         */
         void addMeshInstance(const Mesh::SharedPtr& pMesh, const glm::mat4& baseTransform);
 
+        /** Get a counter which is incremented every time mesh instances are added, removed or reordered
+        */
+        uint32_t getMeshInstanceVersion() const { return mMeshInstanceVersion; }
+
         /** Check if the model contains animations.
         */
         bool hasAnimations() const;
@@ -165,6 +206,13 @@ namespace Falcor
         */
         bool animate(double currentTime);
 
+        /** Animate multiple models. The bone hierarchies are evaluated concurrently, the skinning updates run on the calling thread in order.
+            \param[in] models The models to animate. Each model should appear once
+            \param[in] currentTime The current global time
+            \return true if any of the models has changed
+        */
+        static bool animate(const std::vector<Model*>& models, double currentTime);
+
         /** Get the animation name from animation ID.
         */
         const std::string& getAnimationName(uint32_t animationID) const;
@@ -267,7 +315,9 @@ namespace Falcor
         uint32_t mVertexCount;
         uint32_t mIndexCount;
         uint32_t mPrimitiveCount;
+        uint32_t mMeshletCount = 0;
         uint32_t mMeshInstanceCount;
+        uint32_t mMeshInstanceVersion = 0;
         uint32_t mBufferCount;
         uint32_t mMaterialCount;
         uint32_t mTextureCount;
@@ -283,8 +333,10 @@ namespace Falcor
         std::string mFilename;
 
         static uint32_t sModelCounter;
+        static LodSettings sLodSettings;
 
         void calculateModelProperties();
+        static void finishLoad(SharedPtr& pModel, bool success, const std::string& filename, LoadFlags flags);
     };
 
     enum_class_operators(Model::LoadFlags);
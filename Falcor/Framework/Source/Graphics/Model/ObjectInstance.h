@@ -34,6 +34,7 @@
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/euler_angles.hpp"
 #include "Utils/Math/FalcorMath.h"
+#include "Graphics/Model/TransformStore.h"
 
 namespace Falcor
 {
@@ -42,6 +43,7 @@ namespace Falcor
 
     /** Handles transformations for Mesh and Model instances. Primary transform is stored in the "Base" transform. An additional "Movable"
         transform is applied after the Base transform can be set through the IMovableObject interface. This is currently used by paths.
+        The transforms live in a slot of the global TransformStore, which is updated in a batch once per frame. Getters update the slot themselves if it is still dirty.
     */
     template<typename ObjectType>
     class ObjectInstance : public IMovableObject, public inherit_shared_from_this<IMovableObject, ObjectInstance<ObjectType>>
@@ -120,30 +122,36 @@ namespace Falcor
         */
         void setTranslation(const glm::vec3& translation, bool updateLookAt)
         {
+            TransformStore::LookAt base = getBase();
             if (updateLookAt)
             {
-                glm::vec3 toLookAt = mBase.target - mBase.translation;
-                mBase.target = translation + toLookAt;
+                glm::vec3 toLookAt = base.target - base.translation;
+                base.target = translation + toLookAt;
             }
 
-            mBase.translation = translation;
-            mBase.matrixDirty = true;
+            base.translation = translation;
+            setBase(base);
         };
 
         /** Gets the position/translation of the instance
             \return Translation of the instance
         */
-        const glm::vec3& getTranslation() const { return mBase.translation; };
+        glm::vec3 getTranslation() const { return getBase().translation; };
 
         /** Sets scale of the instance
             \param[in] scaling Instance scale
         */
-        void setScaling(const glm::vec3& scaling) { mBase.scale = scaling; mBase.matrixDirty = true; }
+        void setScaling(const glm::vec3& scaling)
+        {
+            TransformStore::LookAt base = getBase();
+            base.scale = scaling;
+            setBase(base);
+        }
 
         /** Gets scale of the instance
             \return Scale of the instance
         */
-        const glm::vec3& getScaling() const { return mBase.scale; }
+        glm::vec3 getScaling() const { return getBase().scale; }
 
         /** Sets orientation of the instance
             \param[in] yawPitchRoll Yaw-Pitch-Roll rotation in radians
@@ -154,10 +162,10 @@ namespace Falcor
             const glm::mat3 rotMtx(glm::yawPitchRoll(yawPitchRoll[0], yawPitchRoll[1], yawPitchRoll[2]));
 
             // Get look-at info
-            mBase.up = rotMtx[1];
-            mBase.target = mBase.translation + rotMtx[2]; // position + forward
-
-            mBase.matrixDirty = true;
+            TransformStore::LookAt base = getBase();
+            base.up = rotMtx[1];
+            base.target = base.translation + rotMtx[2]; // position + forward
+            setBase(base);
         }
 
         /** Gets rotation for the instance
@@ -167,7 +175,8 @@ namespace Falcor
         {
             glm::vec3 result;
 
-            glm::mat4 rotationMtx = createMatrixFromLookAt(mBase.translation, mBase.target, mBase.up);
+            const TransformStore::LookAt base = getBase();
+            glm::mat4 rotationMtx = createMatrixFromLookAt(base.translation, base.target, base.up);
             glm::extractEulerAngleXYZ(rotationMtx, result[1], result[0], result[2]); // YawPitchRoll is YXZ
 
             return result;
@@ -175,21 +184,31 @@ namespace Falcor
 
         /** Sets the up vector orientation
         */
-        void setUpVector(const glm::vec3& up) { mBase.up = glm::normalize(up); mBase.matrixDirty = true; }
+        void setUpVector(const glm::vec3& up)
+        {
+            TransformStore::LookAt base = getBase();
+            base.up = glm::normalize(up);
+            setBase(base);
+        }
 
         /** Sets the look-at target
         */
-        void setTarget(const glm::vec3& target) { mBase.target = target; mBase.matrixDirty = true; }
+        void setTarget(const glm::vec3& target)
+        {
+            TransformStore::LookAt base = getBase();
+            base.target = target;
+            setBase(base);
+        }
 
         /** Gets the up vector of the instance
             \return Up vector
         */
-        const glm::vec3& getUpVector() const { return mBase.up; }
+        glm::vec3 getUpVector() const { return getBase().up; }
 
         /** Gets look-at target of the instance's orientation
             \return Look-at target position
         */
-        const glm::vec3& getTarget() const { return mBase.target; }
+        glm::vec3 getTarget() const { return getBase().target; }
 
         /** Gets the transform matrix
             \return Transform matrix
@@ -197,13 +216,21 @@ namespace Falcor
         const glm::mat4& getTransformMatrix() const
         {
             updateInstanceProperties();
-            return mFinalTransformMatrix;
+            return TransformStore::getGlobal().getMatrix(mTransformID);
         }
 
         const glm::mat4& getPrevTransformMatrix() const
         {
             updateInstanceProperties();
-            return mPrevFinalTransformMatrix;
+            return TransformStore::getGlobal().getPrevMatrix(mTransformID);
+        }
+
+        /** Get a counter which is incremented every time the transform matrix changes. Used to detect moving instances without comparing matrices.
+        */
+        uint32_t getTransformVersion() const
+        {
+            updateInstanceProperties();
+            return TransformStore::getGlobal().getVersion(mTransformID);
         }
 
         /** Gets the bounding box
@@ -212,20 +239,35 @@ namespace Falcor
         const BoundingBox& getBoundingBox() const
         {
             updateInstanceProperties();
-            return mBoundingBox;
+            return TransformStore::getGlobal().getBounds(mTransformID);
         }
 
+        /** Get the index of the instance's slot in the global TransformStore
+        */
+        uint32_t getTransformID() const { return mTransformID; }
+
         /** IMovableObject interface
         */
         virtual void move(const glm::vec3& position, const glm::vec3& target, const glm::vec3& up) override
         {
-            mMovable.translation = position;
-            mMovable.target = target;
-            mMovable.up = up;
-            mMovable.scale = glm::vec3(1.0f);
-            mMovable.matrixDirty = true;
+            TransformStore::LookAt movable;
+            movable.translation = position;
+            movable.target = target;
+            movable.up = up;
+
+            TransformStore& store = TransformStore::getGlobal();
+            store.setMovable(mTransformID, movable);
+            store.setLocalBounds(mTransformID, mpObject->getBoundingBox());
         }
 
+        ~ObjectInstance()
+        {
+            TransformStore::getGlobal().release(mTransformID);
+        }
+
+        ObjectInstance(const ObjectInstance&) = delete;
+        ObjectInstance& operator=(const ObjectInstance&) = delete;
+
         SharedPtr shared_from_this()
         {
             return inherit_shared_from_this < IMovableObject, ObjectInstance>::shared_from_this();
@@ -239,73 +281,55 @@ namespace Falcor
 
         void updateInstanceProperties() const
         {
-            if (mBase.matrixDirty || mMovable.matrixDirty)
-            {
-                if (mBase.matrixDirty)
-                {
-                    mBase.matrix = calculateTransformMatrix(mBase.translation, mBase.target, mBase.up, mBase.scale);
-                    mBase.matrixDirty = false;
-                }
-
-                if (mMovable.matrixDirty)
-                {
-                    mPrevMovable = mMovable;
-                    mMovable.matrix = calculateTransformMatrix(mMovable.translation, mMovable.target, mMovable.up, mMovable.scale);
-                    mMovable.matrixDirty = false;
-                }
-
-                mFinalTransformMatrix = mMovable.matrix * mBase.matrix;
-                mPrevFinalTransformMatrix = mPrevMovable.matrix * mBase.matrix;
-
-                mBoundingBox = mpObject->getBoundingBox().transform(mFinalTransformMatrix);
-            }
+            TransformStore::getGlobal().update(mTransformID);
         }
 
-        static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale)
+        TransformStore::LookAt getBase() const
         {
-            glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
-            glm::mat4 rotationMtx = createMatrixFromLookAt(translation, target, up);
-            glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
-
-            return translationMtx * rotationMtx * scalingMtx;
+            return TransformStore::getGlobal().getBase(mTransformID);
         }
 
-        static glm::mat4 calculateTransformMatrix(const glm::vec3& translation, const glm::vec3& yawPitchRoll, const glm::vec3& scale)
+        void setBase(const TransformStore::LookAt& base)
         {
-            glm::mat4 translationMtx = glm::translate(glm::mat4(), translation);
-            glm::mat4 rotationMtx = glm::yawPitchRoll(yawPitchRoll[0], yawPitchRoll[1], yawPitchRoll[2]);
-            glm::mat4 scalingMtx = glm::scale(glm::mat4(), scale);
-
-            return translationMtx * rotationMtx * scalingMtx;
+            TransformStore& store = TransformStore::getGlobal();
+            store.setBase(mTransformID, base);
+            store.setLocalBounds(mTransformID, mpObject->getBoundingBox());
         }
 
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const std::string& name)
-            : mpObject(pObject), mName(name) { }
+            : mpObject(pObject), mName(name)
+        {
+            mTransformID = TransformStore::getGlobal().allocate();
+            TransformStore::getGlobal().setLocalBounds(mTransformID, pObject->getBoundingBox());
+        }
 
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::mat4& baseTransform, const std::string& name)
             : ObjectInstance(pObject, name)
         {
             // #TODO Decompose matrix
 
-            mBase.matrix = baseTransform;
-            mBase.matrixDirty = false;
+            TransformStore::getGlobal().setBaseMatrix(mTransformID, baseTransform);
         }
 
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& target, const glm::vec3& up, const glm::vec3& scale, const std::string& name = "")
             : ObjectInstance(pObject, name)
         {
-            mBase.translation = translation;
-            mBase.target = target;
-            mBase.up = up;
-            mBase.scale = scale;
+            TransformStore::LookAt base;
+            base.translation = translation;
+            base.target = target;
+            base.up = up;
+            base.scale = scale;
+            setBase(base);
         }
 
         ObjectInstance(const typename ObjectType::SharedPtr& pObject, const glm::vec3& translation, const glm::vec3& yawPitchRoll, const glm::vec3& scale, const std::string& name = "")
             : ObjectInstance(pObject, name)
         {
-            mBase.translation = translation;
+            TransformStore::LookAt base;
+            base.translation = translation;
+            base.scale = scale;
+            setBase(base);
             setRotation(yawPitchRoll);
-            mBase.scale = scale;
         }
 
         friend class Model;
@@ -315,24 +339,6 @@ namespace Falcor
 
         typename ObjectType::SharedPtr mpObject;
 
-        struct Transform
-        {
-            glm::vec3 translation;
-            glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-            glm::vec3 target = glm::vec3(0.0f, 0.0f, 1.0f);
-            glm::vec3 scale = glm::vec3(1.0f);
-
-            // Matrix containing the above transforms
-            glm::mat4 matrix;
-            bool matrixDirty = true;
-        };
-
-        mutable Transform mBase;
-        mutable Transform mMovable;
-        mutable Transform mPrevMovable;
-
-        mutable glm::mat4 mFinalTransformMatrix;
-        mutable glm::mat4 mPrevFinalTransformMatrix;
-        mutable BoundingBox mBoundingBox;
+        uint32_t mTransformID;
     };
 }
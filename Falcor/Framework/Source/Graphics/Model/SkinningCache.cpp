@@ -30,6 +30,7 @@
 #include "API/Device.h"
 #include "Data/VertexAttrib.h"
 #include "Graphics/Model/Model.h"
+#include <cstring>
 
 namespace Falcor
 {
@@ -39,14 +40,19 @@ namespace Falcor
 
     static const uint32_t kGroupSize = 256;     // threads per group
 
-    SkinningCache::SharedPtr SkinningCache::create()
+    SkinningCache::SharedPtr SkinningCache::create(Backend backend)
     {
-        SharedPtr ptr = SharedPtr(new SkinningCache());
+        SharedPtr ptr = SharedPtr(new SkinningCache(backend));
         return ptr->init() ? ptr : nullptr;
     }
 
     bool SkinningCache::update(const Model* pModel)
     {
+        if (mBackend == Backend::Cpu)
+        {
+            return updateCpu(pModel);
+        }
+
         bool changed = false;
         if (pModel->hasBones())
         {
@@ -92,8 +98,154 @@ namespace Falcor
         return nullptr;
     }
 
+    const SkinningCache::CpuVertices* SkinningCache::getCpuVertices(const Mesh* pMesh) const
+    {
+        auto it = mSkinnedBuffers.find(pMesh);
+        if (it != mSkinnedBuffers.end() && it->second.valid && mBackend == Backend::Cpu)
+        {
+            return &it->second.skinned;
+        }
+        return nullptr;
+    }
+
+    // Read a vertex stream back from the GPU. Returns false if the VAO doesn't have the stream.
+    template<typename T>
+    static bool readVertexStream(uint32_t vertexLoc, const Vao* pVao, uint32_t vertexCount, std::vector<T>& data)
+    {
+        const auto& elemDesc = pVao->getElementIndexByLocation(vertexLoc);
+        if (elemDesc.elementIndex == Vao::ElementDesc::kInvalidIndex)
+        {
+            return false;
+        }
+
+        const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex).get();
+        const uint32_t stride = pLayout->getStride();
+        const uint32_t offset = pLayout->getElementOffset(elemDesc.elementIndex);
+        assert(getFormatBytesPerBlock(pLayout->getElementFormat(elemDesc.elementIndex)) == sizeof(T));
+
+        const Buffer::SharedPtr& pBuffer = pVao->getVertexBuffer(elemDesc.vbIndex);
+        const uint8_t* pSrc = (const uint8_t*)pBuffer->map(Buffer::MapType::Read);
+        data.resize(vertexCount);
+        for (uint32_t i = 0; i < vertexCount; i++)
+        {
+            std::memcpy(&data[i], pSrc + i * stride + offset, sizeof(T));
+        }
+        pBuffer->unmap();
+        return true;
+    }
+
+    // Upload a skinned vertex stream. Like the skinning shader, this expects the stream's buffer to hold only this element, so the bytes between vertices can be overwritten.
+    static void writeVertexStream(uint32_t vertexLoc, const Vao* pVao, const std::vector<glm::vec3>& data)
+    {
+        const auto& elemDesc = pVao->getElementIndexByLocation(vertexLoc);
+        if (elemDesc.elementIndex == Vao::ElementDesc::kInvalidIndex || data.empty())
+        {
+            return;
+        }
+
+        const VertexBufferLayout* pLayout = pVao->getVertexLayout()->getBufferLayout(elemDesc.vbIndex).get();
+        const uint32_t stride = pLayout->getStride();
+        const uint32_t offset = pLayout->getElementOffset(elemDesc.elementIndex);
+        assert(pLayout->getElementCount() == 1);
+        assert(getFormatBytesPerBlock(pLayout->getElementFormat(elemDesc.elementIndex)) >= sizeof(glm::vec3));
+
+        const Buffer::SharedPtr& pBuffer = pVao->getVertexBuffer(elemDesc.vbIndex);
+        if (stride == sizeof(glm::vec3) && offset == 0)
+        {
+            pBuffer->updateData(data.data(), 0, data.size() * sizeof(glm::vec3));
+            return;
+        }
+
+        std::vector<uint8_t> vertices(pBuffer->getSize());
+        assert(offset + (data.size() - 1) * stride + sizeof(glm::vec3) <= vertices.size());
+        scatterVertexStream(data.data(), (uint32_t)data.size(), stride, offset, vertices.data());
+        pBuffer->updateData(vertices.data(), 0, vertices.size());
+    }
+
+    bool SkinningCache::updateCpu(const Model* pModel)
+    {
+        bool changed = false;
+        if (pModel->hasBones())
+        {
+            for (uint32_t meshId = 0; meshId < pModel->getMeshCount(); meshId++)
+            {
+                const Mesh* pMesh = pModel->getMesh(meshId).get();
+                if (pMesh->hasBones())
+                {
+                    createVertexBuffers(pMesh);
+                    skinMeshCpu(pModel, pMesh);
+                    changed = true;
+                }
+            }
+        }
+        return changed;
+    }
+
+    void SkinningCache::skinMeshCpu(const Model* pModel, const Mesh* pMesh)
+    {
+        VertexBuffers& buffers = mSkinnedBuffers[pMesh];
+        CpuSourceVertices& source = buffers.source;
+        CpuVertices& skinned = buffers.skinned;
+        const uint32_t vertexCount = pMesh->getVertexCount();
+
+        // The source vertices never change, read them back the first time the mesh is skinned
+        if (source.positions.empty())
+        {
+            const Vao* pVao = pMesh->getVao().get();
+            std::vector<uint32_t> boneIds;  // RGBA8Uint, 4 IDs per vertex
+            bool hasPos = readVertexStream(VERTEX_POSITION_LOC, pVao, vertexCount, source.positions);
+            bool hasBoneWeight = readVertexStream(VERTEX_BONE_WEIGHT_LOC, pVao, vertexCount, source.boneWeights);
+            bool hasBoneId = readVertexStream(VERTEX_BONE_ID_LOC, pVao, vertexCount, boneIds);
+            assert(hasPos && hasBoneWeight && hasBoneId);
+            readVertexStream(VERTEX_NORMAL_LOC, pVao, vertexCount, source.normals);
+            readVertexStream(VERTEX_BITANGENT_LOC, pVao, vertexCount, source.bitangents);
+            source.boneIds.assign((const uint8_t*)boneIds.data(), (const uint8_t*)boneIds.data() + boneIds.size() * 4);
+
+            skinned.positions.resize(vertexCount);
+            skinned.normals.resize(source.normals.size());
+            skinned.bitangents.resize(source.bitangents.size());
+        }
+
+        const Vao* pVaoOut = buffers.pVao.get();
+
+        // The positions from the last update become the previous positions
+        if (buffers.valid)
+        {
+            writeVertexStream(VERTEX_PREV_POSITION_LOC, pVaoOut, skinned.positions);
+        }
+
+        SkinningInput input;
+        input.pPositions = source.positions.data();
+        input.pNormals = source.normals.empty() ? nullptr : source.normals.data();
+        input.pBitangents = source.bitangents.empty() ? nullptr : source.bitangents.data();
+        input.pBoneWeights = source.boneWeights.data();
+        input.pBoneIds = source.boneIds.data();
+
+        SkinningOutput output;
+        output.pPositions = skinned.positions.data();
+        output.pNormals = skinned.normals.empty() ? nullptr : skinned.normals.data();
+        output.pBitangents = skinned.bitangents.empty() ? nullptr : skinned.bitangents.data();
+
+        skinVerticesParallel(input, pModel->getBoneMatrices(), pModel->getBoneInvTransposeMatrices(), output, vertexCount);
+
+        writeVertexStream(VERTEX_POSITION_LOC, pVaoOut, skinned.positions);
+        writeVertexStream(VERTEX_NORMAL_LOC, pVaoOut, skinned.normals);
+        writeVertexStream(VERTEX_BITANGENT_LOC, pVaoOut, skinned.bitangents);
+        if (buffers.valid == false)
+        {
+            writeVertexStream(VERTEX_PREV_POSITION_LOC, pVaoOut, skinned.positions);
+        }
+
+        buffers.valid = true;
+    }
+
     bool SkinningCache::init()
     {
+        if (mBackend == Backend::Cpu)
+        {
+            return true;
+        }
+
         // Create shaders
         mSkinningPass.pProgram = ComputeProgram::createFromFile(kShaderFilenameSkinning, "main");
         assert(mSkinningPass.pProgram);
@@ -104,30 +256,40 @@ namespace Falcor
         mSkinningPass.pState->setProgram(mSkinningPass.pProgram);
 
         const ParameterBlockReflection* pBlock = mSkinningPass.pProgram->getReflector()->getDefaultParameterBlock().get();
-        initVariableOffsets(pBlock);
+        initVariableHandles(pBlock);
         initMeshBufferLocations(pBlock);
 
         return true;
     }
 
-    void SkinningCache::initVariableOffsets(const ParameterBlockReflection* pBlock)
+    void SkinningCache::initVariableHandles(const ParameterBlockReflection* pBlock)
     {
-        if (mVariableOffsets.bonesOffset == ConstantBuffer::kInvalidOffset)
+        if (mVariables.bones.isValid() == false)
         {
             const ReflectionVar* pVar = pBlock->getResource(kPerModelCbName).get();
 
             if (pVar != nullptr)
             {
                 assert(pVar->getType()->asResourceType()->getType() == ReflectionResourceType::Type::ConstantBuffer);
-                const ReflectionType* pType = pVar->getType().get();
+                const ReflectionResourceType* pType = pVar->getType()->asResourceType();
 
                 assert(pType->findMember("gBoneMat[0]")->getType()->asBasicType()->isRowMajor() == false); // We copy into CBs as column-major
                 assert(pType->findMember("gInvTransposeBoneMat[0]")->getType()->asBasicType()->isRowMajor() == false);
                 assert(pType->findMember("gBoneMat")->getType()->getTotalArraySize() >= MAX_BONES);
                 assert(pType->findMember("gInvTransposeBoneMat")->getType()->getTotalArraySize() >= MAX_BONES);
 
-                mVariableOffsets.bonesOffset = pType->findMember("gBoneMat[0]")->getOffset();
-                mVariableOffsets.bonesInvTransposeOffset = pType->findMember("gInvTransposeBoneMat[0]")->getOffset();
+                mVariables.bones = ConstantBuffer::getVariableHandle<glm::mat4>(pType, "gBoneMat");
+                mVariables.bonesInvTranspose = ConstantBuffer::getVariableHandle<glm::mat4>(pType, "gInvTransposeBoneMat");
+            }
+        }
+
+        if (mVariables.numVertices.isValid() == false)
+        {
+            const ReflectionVar* pVar = pBlock->getResource(kPerMeshCbName).get();
+
+            if (pVar != nullptr)
+            {
+                mVariables.numVertices = ConstantBuffer::getVariableHandle<uint32_t>(pVar->getType()->asResourceType(), "gNumVertices");
             }
         }
     }
@@ -217,8 +379,8 @@ namespace Falcor
         if (pCB)
         {
             assert(pModel->getBoneCount() <= MAX_BONES);
-            pCB->setVariableArray(mVariableOffsets.bonesOffset, pModel->getBoneMatrices(), pModel->getBoneCount());
-            pCB->setVariableArray(mVariableOffsets.bonesInvTransposeOffset, pModel->getBoneInvTransposeMatrices(), pModel->getBoneCount());
+            pCB->setVariableArray(mVariables.bones, pModel->getBoneMatrices(), pModel->getBoneCount());
+            pCB->setVariableArray(mVariables.bonesInvTranspose, pModel->getBoneInvTransposeMatrices(), pModel->getBoneCount());
         }
     }
 
@@ -270,7 +432,7 @@ namespace Falcor
         ConstantBuffer::SharedPtr pCB = pVars->getConstantBuffer(kPerMeshCbName);
         if (pCB)
         {
-            pCB["gNumVertices"] = pMesh->getVertexCount();
+            pCB->setVariable(mVariables.numVertices, pMesh->getVertexCount());
         }
 
         // Bind input vertex buffers
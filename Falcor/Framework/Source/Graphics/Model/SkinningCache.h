@@ -27,7 +27,9 @@
 ***************************************************************************/
 #pragma once
 #include <map>
+#include <vector>
 #include "API/RenderContext.h"
+#include "CpuSkinning.h"
 
 namespace Falcor
 {
@@ -55,6 +57,8 @@ namespace Falcor
 
         4)  Provide metric on amount of change to guide choice of BVH rebuild/refit for ray tracing purposes.
 
+        The cache can also skin on the CPU, using SSE and the global worker pool, and upload the results into the same vertex buffers.
+        This is useful for validating the compute path without a GPU readback, and as a fallback when the compute queue is busy.
     */
     class SkinningCache : public std::enable_shared_from_this<SkinningCache>
     {
@@ -63,7 +67,19 @@ namespace Falcor
         using SharedConstPtr = std::shared_ptr<const SkinningCache>;
         virtual ~SkinningCache() = default;
 
-        static SharedPtr create();
+        /** Where the skinning is done
+        */
+        enum class Backend
+        {
+            Compute,    ///< Compute shader
+            Cpu,        ///< Worker threads. The source vertex buffers are read back once per mesh.
+        };
+
+        /** Create a skinning cache
+            \param[in] backend Where to do the skinning
+            \return A new object, or nullptr if the skinning program couldn't be created
+        */
+        static SharedPtr create(Backend backend = Backend::Compute);
 
         /** Create/update skinned vertex buffers for model.
         */
@@ -73,26 +89,59 @@ namespace Falcor
         */
         Vao::SharedPtr getVao(const Mesh* pMesh) const;
 
+        /** Skinned vertices of a mesh on the CPU. Only available with the CPU backend, after the mesh was skinned at least once.
+        */
+        struct CpuVertices
+        {
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec3> normals;     // Empty if the mesh has no normals
+            std::vector<glm::vec3> bitangents;  // Empty if the mesh has no bitangents
+        };
+
+        /** Returns the skinned vertices for pMesh if they exist, nullptr otherwise
+        */
+        const CpuVertices* getCpuVertices(const Mesh* pMesh) const;
+
+        /** Get the backend the cache was created with
+        */
+        Backend getBackend() const { return mBackend; }
+
     protected:
-        SkinningCache() = default;
+        SkinningCache(Backend backend) : mBackend(backend) {}
 
         bool init();
-        void initVariableOffsets(const ParameterBlockReflection* pBlock);
+        bool updateCpu(const Model* pModel);
+        void skinMeshCpu(const Model* pModel, const Mesh* pMesh);
+        void initVariableHandles(const ParameterBlockReflection* pBlock);
         void initMeshBufferLocations(const ParameterBlockReflection* pBlock);
         void createVertexBuffers(const Mesh* pMesh);
         void setPerModelData(const Model* pModel);
         void setPerMeshData(const Mesh* pMesh);
 
+        // Source vertex streams of a mesh, read back from the GPU for CPU skinning
+        struct CpuSourceVertices
+        {
+            std::vector<glm::vec3> positions;
+            std::vector<glm::vec3> normals;
+            std::vector<glm::vec3> bitangents;
+            std::vector<glm::vec4> boneWeights;
+            std::vector<uint8_t> boneIds;
+        };
+
         struct VertexBuffers
         {
             Vao::SharedPtr pVao;
             bool valid = false;
+            // CPU backend only
+            CpuSourceVertices source;
+            CpuVertices skinned;
         };
 
-        struct VariableOffsets
+        struct VariableHandles
         {
-            size_t bonesOffset = ConstantBuffer::kInvalidOffset;
-            size_t bonesInvTransposeOffset = ConstantBuffer::kInvalidOffset;
+            ConstantBuffer::VariableHandle<glm::mat4> bones;
+            ConstantBuffer::VariableHandle<glm::mat4> bonesInvTranspose;
+            ConstantBuffer::VariableHandle<uint32_t> numVertices;
         };
 
         struct MeshBufferLocations
@@ -110,10 +159,11 @@ namespace Falcor
             ParameterBlockReflection::BindLocation bitangentOut;
         };
 
-        VariableOffsets mVariableOffsets;
+        VariableHandles mVariables;
         MeshBufferLocations mMeshBufferLocations;
 
         std::map<const Mesh*, VertexBuffers> mSkinnedBuffers;
+        Backend mBackend;
 
         struct
         {
@@ -0,0 +1,336 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TransformStore.h"
+#include "Utils/WorkerPool.h"
+#include <xmmintrin.h>
+
+namespace Falcor
+{
+    namespace
+    {
+        void normalize(__m128& x, __m128& y, __m128& z)
+        {
+            __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+            __m128 invLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(lengthSq));
+            x = _mm_mul_ps(x, invLength);
+            y = _mm_mul_ps(y, invLength);
+            z = _mm_mul_ps(z, invLength);
+        }
+
+        uint32_t lowestBit(uint64_t mask)
+        {
+            const uint32_t low = (uint32_t)mask;
+            return low ? bitScanForward(low) : 32 + bitScanForward((uint32_t)(mask >> 32));
+        }
+    }
+
+    const uint32_t TransformStore::kBlockSize;
+
+    TransformStore& TransformStore::getGlobal()
+    {
+        static TransformStore sStore;
+        return sStore;
+    }
+
+    uint32_t TransformStore::allocate()
+    {
+        uint32_t id;
+        if (mFreeSlots.empty() == false)
+        {
+            id = mFreeSlots.back();
+            mFreeSlots.pop_back();
+        }
+        else
+        {
+            id = mSlotCount++;
+            if (id % kBlockSize == 0)
+            {
+                mBlocks.push_back(std::make_unique<Block>());
+                mDirtyBlocks.resize((mBlocks.size() + 63) / 64, 0);
+            }
+        }
+
+        Block& block = getBlock(id);
+        const uint32_t lane = id % kBlockSize;
+        writeLookAt(block.base, lane, LookAt());
+        writeLookAt(block.movable, lane, LookAt());
+        block.baseMatrix[lane] = glm::mat4();
+        block.movableMatrix[lane] = glm::mat4();
+        block.prevMovableMatrix[lane] = glm::mat4();
+        block.localBounds[lane] = BoundingBox();
+        block.version[lane] = 0;
+        block.baseDirty |= 1ull << lane;
+        block.movableDirty |= 1ull << lane;
+        markDirty(id);
+        return id;
+    }
+
+    void TransformStore::release(uint32_t id)
+    {
+        Block& block = getBlock(id);
+        const uint64_t laneBit = 1ull << (id % kBlockSize);
+        block.baseDirty &= ~laneBit;
+        block.movableDirty &= ~laneBit;
+        block.matrixDirty &= ~laneBit;
+        mFreeSlots.push_back(id);
+    }
+
+    void TransformStore::markDirty(uint32_t id)
+    {
+        getBlock(id).matrixDirty |= 1ull << (id % kBlockSize);
+        const uint32_t blockID = id / kBlockSize;
+        mDirtyBlocks[blockID / 64] |= 1ull << (blockID % 64);
+    }
+
+    void TransformStore::writeLookAt(LookAtSoA& soa, uint32_t lane, const LookAt& lookAt)
+    {
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            soa.translation[i][lane] = lookAt.translation[i];
+            soa.target[i][lane] = lookAt.target[i];
+            soa.up[i][lane] = lookAt.up[i];
+            soa.scale[i][lane] = lookAt.scale[i];
+        }
+    }
+
+    void TransformStore::setBase(uint32_t id, const LookAt& lookAt)
+    {
+        Block& block = getBlock(id);
+        writeLookAt(block.base, id % kBlockSize, lookAt);
+        block.baseDirty |= 1ull << (id % kBlockSize);
+        markDirty(id);
+    }
+
+    TransformStore::LookAt TransformStore::getBase(uint32_t id) const
+    {
+        const Block& block = getBlock(id);
+        const uint32_t lane = id % kBlockSize;
+        LookAt lookAt;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            lookAt.translation[i] = block.base.translation[i][lane];
+            lookAt.target[i] = block.base.target[i][lane];
+            lookAt.up[i] = block.base.up[i][lane];
+            lookAt.scale[i] = block.base.scale[i][lane];
+        }
+        return lookAt;
+    }
+
+    void TransformStore::setBaseMatrix(uint32_t id, const glm::mat4& matrix)
+    {
+        Block& block = getBlock(id);
+        block.baseMatrix[id % kBlockSize] = matrix;
+        block.baseDirty &= ~(1ull << (id % kBlockSize));
+        markDirty(id);
+    }
+
+    void TransformStore::setMovable(uint32_t id, const LookAt& lookAt)
+    {
+        Block& block = getBlock(id);
+        writeLookAt(block.movable, id % kBlockSize, lookAt);
+        block.movableDirty |= 1ull << (id % kBlockSize);
+        markDirty(id);
+    }
+
+    void TransformStore::setLocalBounds(uint32_t id, const BoundingBox& box)
+    {
+        getBlock(id).localBounds[id % kBlockSize] = box;
+        markDirty(id);
+    }
+
+    bool TransformStore::isDirty(uint32_t id) const
+    {
+        return (getBlock(id).matrixDirty & (1ull << (id % kBlockSize))) != 0;
+    }
+
+    void TransformStore::buildMatrices(const LookAtSoA& soa, uint64_t laneMask, glm::mat4* pMatrices)
+    {
+        // Same as translate(translation) * createMatrixFromLookAt(translation, target, up) * scale(scale), 4 slots at a time
+        for (uint32_t first = 0; first < kBlockSize; first += 4)
+        {
+            const uint32_t groupMask = (uint32_t)(laneMask >> first) & 0xF;
+            if (groupMask == 0)
+            {
+                continue;
+            }
+
+            __m128 tx = _mm_load_ps(&soa.translation[0][first]);
+            __m128 ty = _mm_load_ps(&soa.translation[1][first]);
+            __m128 tz = _mm_load_ps(&soa.translation[2][first]);
+            __m128 fx = _mm_sub_ps(_mm_load_ps(&soa.target[0][first]), tx);
+            __m128 fy = _mm_sub_ps(_mm_load_ps(&soa.target[1][first]), ty);
+            __m128 fz = _mm_sub_ps(_mm_load_ps(&soa.target[2][first]), tz);
+            __m128 ux = _mm_load_ps(&soa.up[0][first]);
+            __m128 uy = _mm_load_ps(&soa.up[1][first]);
+            __m128 uz = _mm_load_ps(&soa.up[2][first]);
+
+            // Side = cross(up, forward)
+            __m128 sx = _mm_sub_ps(_mm_mul_ps(uy, fz), _mm_mul_ps(uz, fy));
+            __m128 sy = _mm_sub_ps(_mm_mul_ps(uz, fx), _mm_mul_ps(ux, fz));
+            __m128 sz = _mm_sub_ps(_mm_mul_ps(ux, fy), _mm_mul_ps(uy, fx));
+            normalize(fx, fy, fz);
+            normalize(sx, sy, sz);
+
+            // Up = cross(forward, side)
+            __m128 vx = _mm_sub_ps(_mm_mul_ps(fy, sz), _mm_mul_ps(fz, sy));
+            __m128 vy = _mm_sub_ps(_mm_mul_ps(fz, sx), _mm_mul_ps(fx, sz));
+            __m128 vz = _mm_sub_ps(_mm_mul_ps(fx, sy), _mm_mul_ps(fy, sx));
+
+            __m128 scaleX = _mm_load_ps(&soa.scale[0][first]);
+            __m128 scaleY = _mm_load_ps(&soa.scale[1][first]);
+            __m128 scaleZ = _mm_load_ps(&soa.scale[2][first]);
+
+            alignas(16) float columns[12][4];
+            _mm_store_ps(columns[0], _mm_mul_ps(sx, scaleX));
+            _mm_store_ps(columns[1], _mm_mul_ps(sy, scaleX));
+            _mm_store_ps(columns[2], _mm_mul_ps(sz, scaleX));
+            _mm_store_ps(columns[3], _mm_mul_ps(vx, scaleY));
+            _mm_store_ps(columns[4], _mm_mul_ps(vy, scaleY));
+            _mm_store_ps(columns[5], _mm_mul_ps(vz, scaleY));
+            _mm_store_ps(columns[6], _mm_mul_ps(fx, scaleZ));
+            _mm_store_ps(columns[7], _mm_mul_ps(fy, scaleZ));
+            _mm_store_ps(columns[8], _mm_mul_ps(fz, scaleZ));
+            _mm_store_ps(columns[9], tx);
+            _mm_store_ps(columns[10], ty);
+            _mm_store_ps(columns[11], tz);
+
+            for (uint32_t lane = 0; lane < 4; lane++)
+            {
+                if (groupMask & (1 << lane))
+                {
+                    glm::mat4& m = pMatrices[first + lane];
+                    m[0] = glm::vec4(columns[0][lane], columns[1][lane], columns[2][lane], 0);
+                    m[1] = glm::vec4(columns[3][lane], columns[4][lane], columns[5][lane], 0);
+                    m[2] = glm::vec4(columns[6][lane], columns[7][lane], columns[8][lane], 0);
+                    m[3] = glm::vec4(columns[9][lane], columns[10][lane], columns[11][lane], 1);
+                }
+            }
+        }
+    }
+
+    void TransformStore::updateBlock(Block& block, uint64_t laneMask)
+    {
+        const uint64_t baseMask = block.baseDirty & laneMask;
+        const uint64_t movableMask = block.movableDirty & laneMask;
+        const uint64_t matrixMask = block.matrixDirty & laneMask;
+
+        buildMatrices(block.base, baseMask, block.baseMatrix);
+
+        for (uint64_t mask = movableMask; mask; mask &= mask - 1)
+        {
+            const uint32_t lane = lowestBit(mask);
+            block.prevMovableMatrix[lane] = block.movableMatrix[lane];
+        }
+        buildMatrices(block.movable, movableMask, block.movableMatrix);
+
+        for (uint64_t mask = matrixMask; mask; mask &= mask - 1)
+        {
+            const uint32_t lane = lowestBit(mask);
+            block.matrix[lane] = block.movableMatrix[lane] * block.baseMatrix[lane];
+            block.prevMatrix[lane] = block.prevMovableMatrix[lane] * block.baseMatrix[lane];
+            block.bounds[lane] = block.localBounds[lane].transform(block.matrix[lane]);
+            block.version[lane]++;
+        }
+
+        block.baseDirty &= ~laneMask;
+        block.movableDirty &= ~laneMask;
+        block.matrixDirty &= ~laneMask;
+    }
+
+    uint32_t TransformStore::addChangeCallback(const ChangeCallback& callback)
+    {
+        uint32_t handle = mNextCallbackHandle++;
+        mChangeCallbacks.push_back({ handle, callback });
+        return handle;
+    }
+
+    void TransformStore::removeChangeCallback(uint32_t handle)
+    {
+        for (auto it = mChangeCallbacks.begin(); it != mChangeCallbacks.end(); it++)
+        {
+            if (it->first == handle)
+            {
+                mChangeCallbacks.erase(it);
+                return;
+            }
+        }
+    }
+
+    void TransformStore::notifyChanged(const std::vector<uint32_t>& ids)
+    {
+        if (ids.empty()) return;
+        for (const auto& callback : mChangeCallbacks)
+        {
+            callback.second(ids);
+        }
+    }
+
+    void TransformStore::update(uint32_t id)
+    {
+        if (isDirty(id))
+        {
+            updateBlock(getBlock(id), 1ull << (id % kBlockSize));
+            if (mChangeCallbacks.size()) notifyChanged({ id });
+        }
+    }
+
+    void TransformStore::update()
+    {
+        std::vector<uint32_t> dirtyBlocks;
+        for (uint32_t word = 0; word < (uint32_t)mDirtyBlocks.size(); word++)
+        {
+            for (uint64_t mask = mDirtyBlocks[word]; mask; mask &= mask - 1)
+            {
+                dirtyBlocks.push_back(word * 64 + lowestBit(mask));
+            }
+            mDirtyBlocks[word] = 0;
+        }
+
+        // Remember which slots are rebuilt before the blocks clear their dirty masks
+        std::vector<uint32_t> changed;
+        if (mChangeCallbacks.size())
+        {
+            for (uint32_t blockID : dirtyBlocks)
+            {
+                for (uint64_t mask = mBlocks[blockID]->matrixDirty; mask; mask &= mask - 1)
+                {
+                    changed.push_back(blockID * kBlockSize + lowestBit(mask));
+                }
+            }
+        }
+
+        WorkerPool::getGlobal().parallelFor(0, (uint32_t)dirtyBlocks.size(), [&](uint32_t i)
+        {
+            Block& block = *mBlocks[dirtyBlocks[i]];
+            updateBlock(block, block.matrixDirty);
+        });
+
+        notifyChanged(changed);
+    }
+}
@@ -0,0 +1,178 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <memory>
+#include <functional>
+#include "glm/mat4x4.hpp"
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    /** Central storage for the transforms of mesh and model instances. Every instance owns a slot in the store and keeps its index.
+        The look-at inputs are kept in SoA blocks of kBlockSize slots with dirty bitsets. update() rebuilds the transform matrices, previous-frame
+        matrices and world-space bounds of all the dirty slots in a single batched pass, 4 slots at a time with SSE and in parallel across blocks.
+        Slots can also be updated one at a time, which is what the instance getters do when they find their slot dirty.
+        Registered change callbacks receive the IDs of the rebuilt slots, so users can react to the moved instances without polling all of them.
+        The store isn't thread-safe. Slots should be allocated, modified and updated on the main thread.
+    */
+    class TransformStore
+    {
+    public:
+        static const uint32_t kBlockSize = 64;
+
+        /** Look-at description of a transform
+        */
+        struct LookAt
+        {
+            glm::vec3 translation;
+            glm::vec3 target = glm::vec3(0.0f, 0.0f, 1.0f);
+            glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+            glm::vec3 scale = glm::vec3(1.0f);
+        };
+
+        /** Get the global store used by the object instances
+        */
+        static TransformStore& getGlobal();
+
+        /** Allocate a slot. Its base and movable transforms are the identity.
+            \return The slot index
+        */
+        uint32_t allocate();
+
+        /** Release a slot so it can be reused
+        */
+        void release(uint32_t id);
+
+        /** Set the base transform. The matrix is rebuilt on the next update.
+        */
+        void setBase(uint32_t id, const LookAt& lookAt);
+
+        /** Get the base transform's look-at inputs
+        */
+        LookAt getBase(uint32_t id) const;
+
+        /** Set the base transform matrix directly. The look-at inputs are left unchanged and will override the matrix the next time they are set.
+        */
+        void setBaseMatrix(uint32_t id, const glm::mat4& matrix);
+
+        /** Set the movable transform, which is applied after the base transform. The current movable matrix becomes the previous-frame one on the next update.
+        */
+        void setMovable(uint32_t id, const LookAt& lookAt);
+
+        /** Set the object-space bounds which are transformed into the world-space bounds
+        */
+        void setLocalBounds(uint32_t id, const BoundingBox& box);
+
+        /** Rebuild all the dirty slots
+        */
+        void update();
+
+        /** Rebuild a single slot if it is dirty
+        */
+        void update(uint32_t id);
+
+        /** Check if a slot has changes which were not applied yet
+        */
+        bool isDirty(uint32_t id) const;
+
+        /** Get the final transform matrix. Only valid if the slot is not dirty.
+        */
+        const glm::mat4& getMatrix(uint32_t id) const { return getBlock(id).matrix[id % kBlockSize]; }
+
+        /** Get the previous-frame transform matrix. Only valid if the slot is not dirty.
+        */
+        const glm::mat4& getPrevMatrix(uint32_t id) const { return getBlock(id).prevMatrix[id % kBlockSize]; }
+
+        /** Get the world-space bounds. Only valid if the slot is not dirty.
+        */
+        const BoundingBox& getBounds(uint32_t id) const { return getBlock(id).bounds[id % kBlockSize]; }
+
+        /** Get a counter which is incremented every time the slot is rebuilt
+        */
+        uint32_t getVersion(uint32_t id) const { return getBlock(id).version[id % kBlockSize]; }
+
+        /** Called after slots were rebuilt, with the IDs of those slots. The slots are valid when it is called.
+            The callback must not modify or update the store.
+        */
+        using ChangeCallback = std::function<void(const std::vector<uint32_t>& ids)>;
+
+        /** Register a change callback
+            \param[in] callback The function to call when slots are rebuilt
+            eturn A handle for removeChangeCallback()
+        */
+        uint32_t addChangeCallback(const ChangeCallback& callback);
+
+        /** Unregister a change callback
+            \param[in] handle The handle returned by addChangeCallback()
+        */
+        void removeChangeCallback(uint32_t handle);
+
+    private:
+        struct LookAtSoA
+        {
+            alignas(16) float translation[3][kBlockSize];
+            alignas(16) float target[3][kBlockSize];
+            alignas(16) float up[3][kBlockSize];
+            alignas(16) float scale[3][kBlockSize];
+        };
+
+        struct Block
+        {
+            LookAtSoA base;
+            LookAtSoA movable;
+            uint64_t baseDirty = 0;         // Base matrix needs to be rebuilt from the look-at inputs
+            uint64_t movableDirty = 0;      // Movable matrix needs to be rebuilt from the look-at inputs
+            uint64_t matrixDirty = 0;       // Final matrices and bounds need to be recomputed
+
+            glm::mat4 baseMatrix[kBlockSize];
+            glm::mat4 movableMatrix[kBlockSize];
+            glm::mat4 prevMovableMatrix[kBlockSize];
+            glm::mat4 matrix[kBlockSize];
+            glm::mat4 prevMatrix[kBlockSize];
+            BoundingBox localBounds[kBlockSize];
+            BoundingBox bounds[kBlockSize];
+            uint32_t version[kBlockSize];
+        };
+
+        Block& getBlock(uint32_t id) { return *mBlocks[id / kBlockSize]; }
+        const Block& getBlock(uint32_t id) const { return *mBlocks[id / kBlockSize]; }
+        void markDirty(uint32_t id);
+        static void writeLookAt(LookAtSoA& soa, uint32_t lane, const LookAt& lookAt);
+        static void buildMatrices(const LookAtSoA& soa, uint64_t laneMask, glm::mat4* pMatrices);
+        static void updateBlock(Block& block, uint64_t laneMask);
+        void notifyChanged(const std::vector<uint32_t>& ids);
+
+        std::vector<std::unique_ptr<Block>> mBlocks;
+        std::vector<uint64_t> mDirtyBlocks;     // One bit per block
+        std::vector<uint32_t> mFreeSlots;
+        uint32_t mSlotCount = 0;
+        std::vector<std::pair<uint32_t, ChangeCallback>> mChangeCallbacks;
+        uint32_t mNextCallbackHandle = 0;
+    };
+}
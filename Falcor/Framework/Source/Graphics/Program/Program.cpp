@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Program.h"
 #include <vector>
+#include <algorithm>
 #include "glm/glm.hpp"
 #include "glm/gtc/type_ptr.hpp"
 #include "Graphics/TextureHelper.h"
@@ -39,6 +40,12 @@
 #include "API/RenderContext.h"
 #include "Utils/StringUtils.h"
 #include "ShaderLibrary.h"
+#include "ShaderCache.h"
+#include "Utils/WorkerPool.h"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
 
 namespace Falcor
 {
@@ -109,9 +116,17 @@ namespace Falcor
 
     // Program
     std::vector<Program*> Program::sPrograms;
+    static std::atomic<bool> sAsyncCompilation(false);
+
+    // Background compilation jobs hold a reference to their program, so a program might be destroyed on a worker thread
+    static std::mutex sProgramsMutex;
+
+    // Reverse dependency index, from a file to the programs which have versions depending on it. Guarded by sProgramsMutex
+    static std::unordered_map<std::string, std::unordered_set<const Program*>> sDependentPrograms;
 
     Program::Program()
     {
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
         sPrograms.push_back(this);
     }
 
@@ -119,11 +134,15 @@ namespace Falcor
     {
         mDesc = desc;
         mDefineList = programDefines;
+        mDefineListHash = getDefineListHash(mDefineList);
     }
 
     Program::~Program()
     {
+        unregisterDependencies();
+
         // Remove the current program from the program vector
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
         for(auto it = sPrograms.begin() ; it != sPrograms.end() ; it++)
         {
             if(*it == this)
@@ -159,16 +178,23 @@ namespace Falcor
     bool Program::addDefine(const std::string& name, const std::string& value)
     {
         // Make sure that it doesn't exist already
-        if(mDefineList.find(name) != mDefineList.end())
+        auto it = mDefineList.find(name);
+        if(it != mDefineList.end())
         {
-            if(mDefineList[name] == value)
+            if(it->second == value)
             {
                 // Same define
                 return false;
             }
+            mDefineListHash -= getDefineHash(name, it->second);
+            it->second = value;
+        }
+        else
+        {
+            mDefineList.emplace(name, value);
         }
+        mDefineListHash += getDefineHash(name, value);
         mLinkRequired = true;
-        mDefineList[name] = value;
         return true;
     }
 
@@ -187,10 +213,12 @@ namespace Falcor
 
     bool Program::removeDefine(const std::string& name)
     {
-        if(mDefineList.find(name) != mDefineList.end())
+        auto it = mDefineList.find(name);
+        if(it != mDefineList.end())
         {
             mLinkRequired = true;
-            mDefineList.erase(name);
+            mDefineListHash -= getDefineHash(it->first, it->second);
+            mDefineList.erase(it);
             return true;
         }
         return false;
@@ -217,6 +245,7 @@ namespace Falcor
             if (pos < it->first.length() && it->first.compare(pos, len, str) == 0)
             {
                 mLinkRequired = true;
+                mDefineListHash -= getDefineHash(it->first, it->second);
                 it = mDefineList.erase(it);
                 dirty = true;
             }
@@ -234,6 +263,7 @@ namespace Falcor
         {
             mLinkRequired = true;
             mDefineList.clear();
+            mDefineListHash = 0;
             return true;
         }
         return false;
@@ -246,58 +276,244 @@ namespace Falcor
         {
             mLinkRequired = true;
             mDefineList = dl;
+            mDefineListHash = getDefineListHash(mDefineList);
             return true;
         }
         return false;
     }
 
-    bool Program::checkIfFilesChanged()
+    uint64_t Program::getDefineHash(const std::string& name, const std::string& value)
     {
-        if(mActiveProgram.pVersion == nullptr)
+        uint64_t h = ShaderCache::hash(value, ShaderCache::hash(name, 0xcbf29ce484222325ull));
+        // FNV has weak high bits, and the list hash is a plain sum. Finalize with the splitmix64 mixer
+        h ^= h >> 30;
+        h *= 0xbf58476d1ce4e5b9ull;
+        h ^= h >> 27;
+        h *= 0x94d049bb133111ebull;
+        h ^= h >> 31;
+        return h;
+    }
+
+    uint64_t Program::getDefineListHash(const DefineList& defines)
+    {
+        uint64_t h = 0;
+        for (const auto& d : defines)
         {
-            // We never linked, so nothing really changed
-            return false;
+            h += getDefineHash(d.first, d.second);
         }
+        return h;
+    }
 
-        // Have any of the files we depend on changed?
-        for(auto& entry : mFileTimeMap)
+    const Program::VersionData* Program::VersionTable::find(uint64_t hash, const DefineList& defines) const
+    {
+        if (mSlots.empty()) return nullptr;
+        size_t mask = mSlots.size() - 1;
+        for (size_t i = (size_t)hash & mask; mSlots[i].used; i = (i + 1) & mask)
         {
-            auto& path = entry.first;
-            auto& modifiedTime = entry.second;
+            if (mSlots[i].hash == hash && mSlots[i].defines == defines)
+            {
+                return &mSlots[i].data;
+            }
+        }
+        return nullptr;
+    }
 
-            if( modifiedTime != getFileModifiedTime(path) )
+    void Program::VersionTable::insert(uint64_t hash, const DefineList& defines, const VersionData& data)
+    {
+        // Keep the load factor below 1/2, so probe sequences stay short
+        if ((mCount + 1) * 2 > mSlots.size())
+        {
+            std::vector<Slot> oldSlots = std::move(mSlots);
+            mSlots = std::vector<Slot>(std::max<size_t>(16, oldSlots.size() * 2));
+            mCount = 0;
+            for (auto& slot : oldSlots)
             {
-                return true;
+                if (slot.used) insert(slot.hash, slot.defines, slot.data);
             }
         }
-        return false;
+
+        size_t mask = mSlots.size() - 1;
+        size_t i = (size_t)hash & mask;
+        while (mSlots[i].used && (mSlots[i].hash != hash || mSlots[i].defines != defines))
+        {
+            i = (i + 1) & mask;
+        }
+
+        if (mSlots[i].used == false) mCount++;
+        mSlots[i].used = true;
+        mSlots[i].hash = hash;
+        mSlots[i].defines = defines;
+        mSlots[i].data = data;
+    }
+
+    Program::VersionData Program::VersionTable::erase(uint64_t hash, const DefineList& defines)
+    {
+        if (mSlots.empty()) return VersionData();
+        size_t mask = mSlots.size() - 1;
+        size_t i = (size_t)hash & mask;
+        while (mSlots[i].used && (mSlots[i].hash != hash || mSlots[i].defines != defines))
+        {
+            i = (i + 1) & mask;
+        }
+        if (mSlots[i].used == false) return VersionData();
+
+        VersionData data = mSlots[i].data;
+        mSlots[i] = Slot();
+        mCount--;
+
+        // Re-insert the rest of the cluster, so that no probe sequence is broken by the hole
+        for (size_t j = (i + 1) & mask; mSlots[j].used; j = (j + 1) & mask)
+        {
+            Slot slot = std::move(mSlots[j]);
+            mSlots[j] = Slot();
+            mCount--;
+            insert(slot.hash, slot.defines, slot.data);
+        }
+        return data;
+    }
+
+    void Program::VersionTable::clear()
+    {
+        mSlots.clear();
+        mCount = 0;
     }
 
     ProgramVersion::SharedConstPtr Program::getActiveVersion() const
     {
         if(mLinkRequired)
         {
-            const auto& it = mProgramVersions.find(mDefineList);
-            if(it == mProgramVersions.end())
+            const VersionData* pVersionData = mProgramVersions.find(mDefineListHash, mDefineList);
+            if(pVersionData == nullptr)
             {
-                if(link() == false)
+                bool async = sAsyncCompilation && supportsAsyncCompilation();
+                if (async && mPendingVersions.find(mDefineList) == mPendingVersions.end())
                 {
-                    return nullptr;
+                    startAsyncCompilation(mDefineList);
                 }
-                else
+
+                // If the version is being compiled in the background, keep using the current version until it's done. We have to wait if there is no current version
+                bool hasFallback = async && (mActiveProgram.pVersion != nullptr);
+                if (finishAsyncCompilation(mDefineList, hasFallback == false) == false)
                 {
-                    mProgramVersions[mDefineList] = mActiveProgram;
+                    return mActiveProgram.pVersion;
+                }
+                pVersionData = mProgramVersions.find(mDefineListHash, mDefineList);
+            }
+
+            if(pVersionData == nullptr)
+            {
+                if(link() == false)
+                {
+                    return nullptr;
                 }
             }
             else
             {
-                mActiveProgram = mProgramVersions[mDefineList];
+                mActiveProgram = *pVersionData;
             }
+            mLinkRequired = false;
         }
 
         return mActiveProgram.pVersion;
     }
 
+    bool Program::isActiveVersionReady() const
+    {
+        getActiveVersion();
+        return mProgramVersions.find(mDefineListHash, mDefineList) != nullptr;
+    }
+
+    void Program::setAsyncCompilation(bool enable)
+    {
+        sAsyncCompilation = enable;
+    }
+
+    bool Program::isAsyncCompilationEnabled()
+    {
+        return sAsyncCompilation;
+    }
+
+    void Program::prewarm(const std::vector<DefineList>& defineLists) const
+    {
+        for (const auto& defines : defineLists)
+        {
+            if (mProgramVersions.find(getDefineListHash(defines), defines) || mPendingVersions.find(defines) != mPendingVersions.end()) continue;
+
+            if (supportsAsyncCompilation())
+            {
+                startAsyncCompilation(defines);
+            }
+            else
+            {
+                std::string log;
+                std::vector<std::string> dependencies;
+                VersionData versionData = preprocessAndCreateProgramVersion(defines, log, dependencies);
+                if (versionData.pVersion == nullptr)
+                {
+                    logError("Can't prewarm program version.\n\n" + getProgramDescString() + "\n" + log);
+                    continue;
+                }
+                addVersion(defines, versionData, dependencies);
+            }
+        }
+    }
+
+    void Program::startAsyncCompilation(const DefineList& defines) const
+    {
+        // Keep the program alive while the job is running
+        SharedConstPtr pThis = shared_from_this();
+        mPendingVersions[defines] = WorkerPool::getGlobal().submit([pThis, defines]()
+        {
+            CompileResult result;
+            result.versionData = pThis->preprocessAndCreateProgramVersion(defines, result.log, result.dependencies);
+            return result;
+        });
+    }
+
+    bool Program::finishAsyncCompilation(const DefineList& defines, bool wait) const
+    {
+        auto it = mPendingVersions.find(defines);
+        if (it == mPendingVersions.end()) return true;
+        if (wait == false && it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return false;
+
+        CompileResult result = it->second.get();
+        mPendingVersions.erase(it);
+
+        // On failure, nothing is added. The next request for this version will call link(), which reports the error and lets the user retry
+        if (result.versionData.pVersion)
+        {
+            addVersion(defines, result.versionData, result.dependencies);
+        }
+        return true;
+    }
+
+    std::vector<Program::SharedPtr> Program::getLivePrograms()
+    {
+        // Programs which are being destroyed can't be locked anymore and are skipped
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
+        std::vector<SharedPtr> programs;
+        programs.reserve(sPrograms.size());
+        for (auto& pProgram : sPrograms)
+        {
+            SharedPtr pShared = pProgram->weak_from_this().lock();
+            if (pShared) programs.push_back(pShared);
+        }
+        return programs;
+    }
+
+    void Program::finishAsyncCompilations()
+    {
+        for (auto& pProgram : getLivePrograms())
+        {
+            while (pProgram->mPendingVersions.size())
+            {
+                // Copy the key, the entry is erased by finishAsyncCompilation()
+                DefineList defines = pProgram->mPendingVersions.begin()->first;
+                pProgram->finishAsyncCompilation(defines, true);
+            }
+        }
+    }
+
     SlangSession* getSlangSession()
     {
         // TODO: figure out a strategy for finalizing the Slang session, if desired
@@ -347,9 +563,68 @@ namespace Falcor
 #endif
     }
 
-    Program::VersionData Program::preprocessAndCreateProgramVersion(std::string& log) const
+    uint64_t Program::getShaderCacheKey(const DefineList& defines) const
+    {
+        uint64_t key = ShaderCache::hash(std::string(getSlangProfileString()), ShaderCache::getCompilerHash());
+        key = ShaderCache::hash(&mDesc.shaderFlags, sizeof(mDesc.shaderFlags), key);
+
+        for (const auto& path : getDataDirectoriesList())
+        {
+            key = ShaderCache::hash(path, key);
+        }
+
+        for (const auto& pLibrary : mDesc.mShaderLibraries)
+        {
+            std::string fullpath;
+            findFileInDataDirectories(pLibrary->getFilename(), fullpath);
+            key = ShaderCache::hash(fullpath, key);
+        }
+
+        for (uint32_t i = 0; i < kShaderCount; i++)
+        {
+            const auto& entryPoint = mDesc.mEntryPoints[i];
+            if (entryPoint.isValid() == false) continue;
+            key = ShaderCache::hash(&i, sizeof(i), key);
+            key = ShaderCache::hash(&entryPoint.libraryIndex, sizeof(entryPoint.libraryIndex), key);
+            key = ShaderCache::hash(entryPoint.name, key);
+        }
+
+        for (const auto& shaderDefine : defines)
+        {
+            key = ShaderCache::hash(shaderDefine.first, key);
+            key = ShaderCache::hash(shaderDefine.second, key);
+        }
+        return key;
+    }
+
+    // Slang sessions can't be used from multiple threads at once. Everything else in the compilation can run in parallel
+    static std::mutex sSlangMutex;
+
+    Program::VersionData Program::preprocessAndCreateProgramVersion(const DefineList& defines, std::string& log, std::vector<std::string>& dependencies) const
     {
-        mFileTimeMap.clear();
+        dependencies.clear();
+
+        // Check the persistent cache first. On a hit we don't need to run Slang at all
+        bool dumpIR = is_set(mDesc.getCompilerFlags(), Shader::CompilerFlags::DumpIntermediates);
+        bool useCache = ShaderCache::isEnabled() && (dumpIR == false);
+        uint64_t cacheKey = useCache ? getShaderCacheKey(defines) : 0;
+        ShaderCache::Entry cacheEntry;
+        if (useCache && ShaderCache::load(cacheKey, cacheEntry))
+        {
+            VersionData programVersion;
+            programVersion.reflectors.pReflector = cacheEntry.pReflector;
+            programVersion.reflectors.pLocalReflector = cacheEntry.pLocalReflector;
+            programVersion.reflectors.pGlobalReflector = cacheEntry.pGlobalReflector;
+            programVersion.pVersion = createProgramVersion(log, cacheEntry.shaderBlob, programVersion.reflectors);
+            if (programVersion.pVersion)
+            {
+                dependencies = cacheEntry.dependencies;
+                return programVersion;
+            }
+
+            // The cached code failed to create the program. Fall back to a full compilation, which will also replace the entry
+            cacheEntry = ShaderCache::Entry();
+        }
 
         // Run all of the shaders through Slang, so that we can get final code,
         // reflection data, etc.
@@ -357,6 +632,7 @@ namespace Falcor
         // Note that we provide all the shaders at once, so that automatically
         // generated bindings can be made consistent across the stages.
 
+        std::unique_lock<std::mutex> slangLock(sSlangMutex);
         SlangSession* slangSession = getSlangSession();
 
         // Start building a request for compilation
@@ -372,12 +648,11 @@ namespace Falcor
         }
 
         // Enable/disable intermediates dump
-        bool dumpIR = is_set(mDesc.getCompilerFlags(), Shader::CompilerFlags::DumpIntermediates);
         spSetDumpIntermediates(slangRequest, dumpIR);
 
         // Pass any `#define` flags along to Slang, since we aren't doing our
         // own preprocessing any more.
-        for(auto shaderDefine : mDefineList)
+        for(auto shaderDefine : defines)
         {
             spAddPreprocessorDefine(slangRequest, shaderDefine.first.c_str(), shaderDefine.second.c_str());
         }
@@ -454,7 +729,7 @@ namespace Falcor
 
         // Extract the generated code for each stage
         int entryPointCounter = 0;
-        Shader::Blob shaderBlob[kShaderCount];
+        Shader::Blob* shaderBlob = cacheEntry.shaderBlob;
 
         for (uint32_t i = 0; i < kShaderCount; i++)
         {
@@ -489,16 +764,35 @@ namespace Falcor
         int depFileCount = spGetDependencyFileCount(slangRequest);
         for(int ii = 0; ii < depFileCount; ++ii)
         {
-            std::string depFilePath = spGetDependencyFilePath(slangRequest, ii);
-            mFileTimeMap[depFilePath] = getFileModifiedTime(depFilePath);
+            dependencies.push_back(spGetDependencyFilePath(slangRequest, ii));
+        }
+
+        // Snapshot the dependencies now, so a file saved while the program is being created doesn't get its hash attached to the old output
+        if (useCache)
+        {
+            cacheEntry.dependencyHashes.resize(dependencies.size());
+            for (size_t i = 0; i < dependencies.size() && useCache; i++)
+            {
+                useCache = ShaderCache::hashFile(dependencies[i], cacheEntry.dependencyHashes[i]);
+            }
         }
 
         spDestroyCompileRequest(slangRequest);
+        slangLock.unlock();
 
         // Now that we've preprocessed things, dispatch to the actual program creation logic,
         // which may vary in subclasses of `Program`
         programVersion.pVersion = createProgramVersion(log, shaderBlob, programVersion.reflectors);
 
+        if (useCache && programVersion.pVersion)
+        {
+            cacheEntry.dependencies = dependencies;
+            cacheEntry.pReflector = programVersion.reflectors.pReflector;
+            cacheEntry.pLocalReflector = programVersion.reflectors.pLocalReflector;
+            cacheEntry.pGlobalReflector = programVersion.reflectors.pGlobalReflector;
+            ShaderCache::store(cacheKey, cacheEntry);
+        }
+
         return programVersion;
     }
 
@@ -540,7 +834,8 @@ namespace Falcor
         {
             // create the program
             std::string log;
-            VersionData programVersion = preprocessAndCreateProgramVersion(log);
+            std::vector<std::string> dependencies;
+            VersionData programVersion = preprocessAndCreateProgramVersion(mDefineList, log, dependencies);
 
             if(programVersion.pVersion == nullptr)
             {
@@ -562,26 +857,126 @@ namespace Falcor
             else
             {
                 mActiveProgram = programVersion;
+                addVersion(mDefineList, programVersion, dependencies);
                 return true;
             }
         }
     }
 
-    void Program::reset()
+    void Program::addVersion(const DefineList& defines, const VersionData& data, const std::vector<std::string>& dependencies) const
+    {
+        uint64_t hash = getDefineListHash(defines);
+        mProgramVersions.insert(hash, defines, data);
+
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
+        for (const auto& dep : dependencies)
+        {
+            std::string file = canonicalizeFilename(dep);
+            if (file.empty()) continue;
+
+            auto& versions = mDependencyVersions[file];
+            if (versions.empty())
+            {
+                sDependentPrograms[file].insert(this);
+                watchFile(file);
+            }
+            if (std::find(versions.begin(), versions.end(), defines) == versions.end())
+            {
+                versions.push_back(defines);
+            }
+        }
+    }
+
+    void Program::invalidateDependency(const std::string& file) const
     {
-        mActiveProgram = VersionData();
-        mProgramVersions.clear();
-        mFileTimeMap.clear();
+        const auto& it = mDependencyVersions.find(file);
+        if (it == mDependencyVersions.end()) return;
+
+        std::vector<DefineList> invalidated = std::move(it->second);
+        mDependencyVersions.erase(it);
+        for (const DefineList& defines : invalidated)
+        {
+            VersionData data = mProgramVersions.erase(getDefineListHash(defines), defines);
+            if (data.pVersion && data.pVersion == mActiveProgram.pVersion)
+            {
+                mActiveProgram = VersionData();
+            }
+        }
+
+        // The removed versions are no longer used by their other dependencies. Files left without versions are unregistered like the changed one
+        std::vector<std::string> unusedFiles = { file };
+        for (auto depIt = mDependencyVersions.begin(); depIt != mDependencyVersions.end();)
+        {
+            auto& versions = depIt->second;
+            versions.erase(std::remove_if(versions.begin(), versions.end(), [&invalidated](const DefineList& defines)
+            {
+                return std::find(invalidated.begin(), invalidated.end(), defines) != invalidated.end();
+            }), versions.end());
+
+            if (versions.empty())
+            {
+                unusedFiles.push_back(depIt->first);
+                depIt = mDependencyVersions.erase(depIt);
+            }
+            else
+            {
+                ++depIt;
+            }
+        }
+
+        // Background compilations might have read the old file
+        mPendingVersions.clear();
         mLinkRequired = true;
+
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
+        for (const auto& unusedFile : unusedFiles)
+        {
+            const auto& depIt = sDependentPrograms.find(unusedFile);
+            if (depIt != sDependentPrograms.end())
+            {
+                depIt->second.erase(this);
+                if (depIt->second.empty()) sDependentPrograms.erase(depIt);
+            }
+        }
+    }
+
+    void Program::unregisterDependencies() const
+    {
+        std::lock_guard<std::mutex> lock(sProgramsMutex);
+        for (const auto& dep : mDependencyVersions)
+        {
+            const auto& it = sDependentPrograms.find(dep.first);
+            if (it == sDependentPrograms.end()) continue;
+            it->second.erase(this);
+            if (it->second.empty()) sDependentPrograms.erase(it);
+        }
+        mDependencyVersions.clear();
     }
 
     void Program::reloadAllPrograms()
     {
-        for(auto& pProgram : sPrograms)
+        // The OS reports which files changed, so only the programs depending on them are touched
+        std::vector<std::string> changedFiles;
+        getChangedFiles(changedFiles);
+
+        for (const auto& file : changedFiles)
         {
-            if(pProgram->checkIfFilesChanged())
+            std::vector<SharedConstPtr> programs;
+            {
+                std::lock_guard<std::mutex> lock(sProgramsMutex);
+                const auto& it = sDependentPrograms.find(file);
+                if (it == sDependentPrograms.end()) continue;
+                for (const Program* pProgram : it->second)
+                {
+                    // Programs which are being destroyed can't be locked anymore and are skipped
+                    SharedConstPtr pShared = pProgram->weak_from_this().lock();
+                    if (pShared) programs.push_back(pShared);
+                }
+            }
+
+            for (const auto& pProgram : programs)
             {
-                pProgram->reset();
+                pProgram->invalidateDependency(file);
             }
         }
     }
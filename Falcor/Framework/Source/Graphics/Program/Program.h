@@ -29,6 +29,7 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <future>
 #include "Graphics/Program//ProgramVersion.h"
 
 namespace Falcor
@@ -173,10 +174,35 @@ namespace Falcor
         */
         const DefineList& getActiveDefinesList() const { return mDefineList; }
 
-        /** Reload and relink all programs.
+        /** Reload the programs affected by modified shader files. Only the versions which depend on a modified file are discarded, and they are recompiled on their next use.
+            Modifications are reported by the OS file-watch service, so this doesn't access the files.
         */
         static void reloadAllPrograms();
 
+        /** Enable or disable asynchronous compilation for all programs. Disabled by default.
+            When enabled, a new combination of defines is compiled on the global WorkerPool. Until the compilation finishes, getActiveVersion() keeps returning the previously active version.
+            It only blocks when the program doesn't have any version yet.
+        */
+        static void setAsyncCompilation(bool enable);
+
+        /** Check if asynchronous compilation is enabled
+        */
+        static bool isAsyncCompilationEnabled();
+
+        /** Check if the version matching the current defines is ready. If it's not, getActiveVersion() returns the previously active version.
+            In async mode, this will start the compilation if it wasn't started yet.
+        */
+        bool isActiveVersionReady() const;
+
+        /** Compile versions for a list of define combinations in the background, so that they are ready when they are first used. This works regardless of the async compilation mode. The active version is not changed.
+            \param[in] defineLists The combinations of defines to compile. Each DefineList should contain all the defines of the version, not only the ones which differ from the current list.
+        */
+        void prewarm(const std::vector<DefineList>& defineLists) const;
+
+        /** Wait for all background compilations of all programs to finish
+        */
+        static void finishAsyncCompilations();
+
         const ProgramReflection::SharedConstPtr getReflector() const { getActiveVersion(); return mActiveProgram.reflectors.pReflector; }
         const ProgramReflection::SharedConstPtr getLocalReflector() const { getActiveVersion(); return mActiveProgram.reflectors.pLocalReflector; }
         const ProgramReflection::SharedConstPtr getGlobalReflector() const { getActiveVersion(); return mActiveProgram.reflectors.pGlobalReflector; }
@@ -200,27 +226,80 @@ namespace Falcor
             ProgramReflectors reflectors;
         };
 
+        // The result of a background compilation
+        struct CompileResult
+        {
+            VersionData versionData;
+            std::vector<std::string> dependencies;
+            std::string log;
+        };
+
+        // Open-addressing table of the compiled versions, keyed by the DefineList. The hash only selects the slot, entries are matched on the full DefineList so collisions are never aliased
+        class VersionTable
+        {
+        public:
+            const VersionData* find(uint64_t hash, const DefineList& defines) const;
+            void insert(uint64_t hash, const DefineList& defines, const VersionData& data);
+            VersionData erase(uint64_t hash, const DefineList& defines);
+            void clear();
+        private:
+            struct Slot
+            {
+                bool used = false;
+                uint64_t hash = 0;
+                DefineList defines;
+                VersionData data;
+            };
+            std::vector<Slot> mSlots;
+            size_t mCount = 0;
+        };
+
+        /** Hash a single define. A DefineList hash is the sum of its defines' hashes, so it can be updated when a single define changes
+        */
+        static uint64_t getDefineHash(const std::string& name, const std::string& value);
+
+        /** Hash a complete DefineList
+        */
+        static uint64_t getDefineListHash(const DefineList& defines);
+
         bool link() const;
-        VersionData preprocessAndCreateProgramVersion(std::string& log) const;
+        VersionData preprocessAndCreateProgramVersion(const DefineList& defines, std::string& log, std::vector<std::string>& dependencies) const;
+        uint64_t getShaderCacheKey(const DefineList& defines) const;
         virtual ProgramVersion::SharedPtr createProgramVersion(std::string& log, const Shader::Blob shaderBlob[kShaderCount], const ProgramReflectors& reflectors) const;
 
+        /** Check if createProgramVersion() can run on a worker thread. Programs which create API objects when creating a version should return false, those are always compiled on the calling thread
+        */
+        virtual bool supportsAsyncCompilation() const { return true; }
+        void startAsyncCompilation(const DefineList& defines) const;
+        bool finishAsyncCompilation(const DefineList& defines, bool wait) const;
+
+        /** Add a compiled version and register the files it depends on for hot-reload
+        */
+        void addVersion(const DefineList& defines, const VersionData& data, const std::vector<std::string>& dependencies) const;
+
+        /** Remove all the versions which depend on a file. The versions are also removed from the lists of their other dependencies
+        */
+        void invalidateDependency(const std::string& file) const;
+
         // The description used to create this program
         Desc mDesc;
 
         DefineList mDefineList;
+        uint64_t mDefineListHash = 0;
 
         // We are doing lazy compilation, so these are mutable
         mutable bool mLinkRequired = true;
-        mutable std::map<const DefineList, VersionData> mProgramVersions;
+        mutable VersionTable mProgramVersions;
         mutable VersionData mActiveProgram;
+        mutable std::map<const DefineList, std::future<CompileResult>> mPendingVersions;
 
         std::string getProgramDescString() const;
         static std::vector<Program*> sPrograms;
+        static std::vector<SharedPtr> getLivePrograms();
 
-        using string_time_map = std::unordered_map<std::string, time_t>;
-        mutable string_time_map mFileTimeMap;
+        // For each (canonicalized) file the program depends on, the defines of the versions using it. Every version appears once per file
+        mutable std::unordered_map<std::string, std::vector<DefineList>> mDependencyVersions;
 
-        bool checkIfFilesChanged();
-        void reset();
+        void unregisterDependencies() const;
     };
 }
\ No newline at end of file
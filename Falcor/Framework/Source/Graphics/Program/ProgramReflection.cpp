@@ -810,6 +810,239 @@ namespace Falcor
         if (pBlock->getName().size() == 0) mpDefaultBlock = pBlock;
     }
 
+    // Serialization. The stream holds the variables which were passed to ParameterBlockReflection::addResource(), everything else is re-created by replaying the same calls the Slang path uses
+    enum class SerializedType : uint32_t
+    {
+        Basic,
+        Struct,
+        Array,
+        Resource
+    };
+
+    static const uint32_t kMaxSerializedStringLength = 64 * 1024;
+    static const uint32_t kMaxSerializedTypeDepth = 64;
+
+    static void writeString(BinaryFileStream& stream, const std::string& str)
+    {
+        stream << (uint32_t)str.size();
+        stream.write(str.data(), str.size());
+    }
+
+    static bool readString(BinaryFileStream& stream, std::string& str)
+    {
+        uint32_t length = 0;
+        stream >> length;
+        if (stream.isGood() == false || length > kMaxSerializedStringLength) return false;
+        str.resize(length);
+        if (length) stream.read(&str[0], length);
+        return stream.isGood();
+    }
+
+    static void serializeVar(BinaryFileStream& stream, const ReflectionVar* pVar);
+
+    static void serializeType(BinaryFileStream& stream, const ReflectionType* pType)
+    {
+        if (const ReflectionBasicType* pBasicType = pType->asBasicType())
+        {
+            stream << SerializedType::Basic << (uint64_t)pBasicType->getOffset() << pBasicType->getType() << pBasicType->isRowMajor() << (uint64_t)pBasicType->getSize();
+        }
+        else if (const ReflectionStructType* pStructType = pType->asStructType())
+        {
+            stream << SerializedType::Struct << (uint64_t)pStructType->getOffset() << (uint64_t)pStructType->getSize();
+            writeString(stream, pStructType->getName());
+            stream << pStructType->getMemberCount();
+            for (const auto& pMember : *pStructType)
+            {
+                serializeVar(stream, pMember.get());
+            }
+        }
+        else if (const ReflectionArrayType* pArrayType = pType->asArrayType())
+        {
+            stream << SerializedType::Array << (uint64_t)pArrayType->getOffset() << pArrayType->getArraySize() << pArrayType->getArrayStride();
+            serializeType(stream, pArrayType->getType().get());
+        }
+        else
+        {
+            const ReflectionResourceType* pResourceType = pType->asResourceType();
+            assert(pResourceType);
+            bool hasStructType = (pResourceType->getStructType() != nullptr);
+            stream << SerializedType::Resource << pResourceType->getType() << pResourceType->getDimensions() << pResourceType->getStructuredBufferType() << pResourceType->getReturnType() << pResourceType->getShaderAccess() << hasStructType;
+            if (hasStructType) serializeType(stream, pResourceType->getStructType().get());
+        }
+    }
+
+    static void serializeVar(BinaryFileStream& stream, const ReflectionVar* pVar)
+    {
+        writeString(stream, pVar->getName());
+        stream << (uint64_t)pVar->getOffset() << pVar->getDescOffset() << pVar->getRegisterSpace() << pVar->getModifier();
+        serializeType(stream, pVar->getType().get());
+    }
+
+    static ReflectionVar::SharedPtr deserializeVar(BinaryFileStream& stream, uint32_t depth);
+
+    static ReflectionType::SharedPtr deserializeType(BinaryFileStream& stream, uint32_t depth)
+    {
+        SerializedType kind;
+        stream >> kind;
+        if (stream.isGood() == false || depth > kMaxSerializedTypeDepth) return nullptr;
+
+        switch (kind)
+        {
+        case SerializedType::Basic:
+        {
+            uint64_t offset, size;
+            ReflectionBasicType::Type type;
+            bool isRowMajor;
+            stream >> offset >> type >> isRowMajor >> size;
+            if (stream.isGood() == false) return nullptr;
+            return ReflectionBasicType::create((size_t)offset, type, isRowMajor, (size_t)size);
+        }
+        case SerializedType::Struct:
+        {
+            uint64_t offset, size;
+            std::string name;
+            uint32_t memberCount;
+            stream >> offset >> size;
+            if (readString(stream, name) == false) return nullptr;
+            stream >> memberCount;
+            if (stream.isGood() == false) return nullptr;
+            ReflectionStructType::SharedPtr pStructType = ReflectionStructType::create((size_t)offset, (size_t)size, name);
+            for (uint32_t m = 0; m < memberCount; m++)
+            {
+                ReflectionVar::SharedPtr pMember = deserializeVar(stream, depth + 1);
+                if (pMember == nullptr) return nullptr;
+                pStructType->addMember(pMember);
+            }
+            return pStructType;
+        }
+        case SerializedType::Array:
+        {
+            uint64_t offset;
+            uint32_t arraySize, arrayStride;
+            stream >> offset >> arraySize >> arrayStride;
+            if (stream.isGood() == false) return nullptr;
+            ReflectionType::SharedPtr pElementType = deserializeType(stream, depth + 1);
+            if (pElementType == nullptr) return nullptr;
+            return ReflectionArrayType::create((size_t)offset, arraySize, arrayStride, pElementType);
+        }
+        case SerializedType::Resource:
+        {
+            ReflectionResourceType::Type type;
+            ReflectionResourceType::Dimensions dims;
+            ReflectionResourceType::StructuredType structuredType;
+            ReflectionResourceType::ReturnType retType;
+            ReflectionResourceType::ShaderAccess shaderAccess;
+            bool hasStructType;
+            stream >> type >> dims >> structuredType >> retType >> shaderAccess >> hasStructType;
+            if (stream.isGood() == false) return nullptr;
+            ReflectionResourceType::SharedPtr pResourceType = ReflectionResourceType::create(type, dims, structuredType, retType, shaderAccess);
+            if (hasStructType)
+            {
+                ReflectionType::SharedPtr pStructType = deserializeType(stream, depth + 1);
+                if (pStructType == nullptr) return nullptr;
+                pResourceType->setStructType(pStructType);
+            }
+            return pResourceType;
+        }
+        default:
+            return nullptr;
+        }
+    }
+
+    static ReflectionVar::SharedPtr deserializeVar(BinaryFileStream& stream, uint32_t depth)
+    {
+        std::string name;
+        uint64_t offset;
+        uint32_t descOffset, regSpace;
+        ReflectionVar::Modifier modifier;
+        if (readString(stream, name) == false) return nullptr;
+        stream >> offset >> descOffset >> regSpace >> modifier;
+        if (stream.isGood() == false) return nullptr;
+        ReflectionType::SharedPtr pType = deserializeType(stream, depth);
+        if (pType == nullptr) return nullptr;
+        return ReflectionVar::create(name, pType, (size_t)offset, descOffset, regSpace, modifier);
+    }
+
+    static void serializeVariableMap(BinaryFileStream& stream, const ProgramReflection::VariableMap& varMap)
+    {
+        stream << (uint32_t)varMap.size();
+        for (const auto& v : varMap)
+        {
+            writeString(stream, v.first);
+            writeString(stream, v.second.semanticName);
+            stream << v.second.bindLocation << v.second.type;
+        }
+    }
+
+    static bool deserializeVariableMap(BinaryFileStream& stream, ProgramReflection::VariableMap& varMap)
+    {
+        uint32_t count = 0;
+        stream >> count;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            std::string name;
+            ProgramReflection::ShaderVariable var;
+            if (readString(stream, name) == false || readString(stream, var.semanticName) == false) return false;
+            stream >> var.bindLocation >> var.type;
+            varMap[name] = var;
+        }
+        return stream.isGood();
+    }
+
+    void ProgramReflection::serialize(BinaryFileStream& stream) const
+    {
+        stream << (uint32_t)mpParameterBlocks.size();
+        for (const auto& pBlock : mpParameterBlocks)
+        {
+            writeString(stream, pBlock->getName());
+            stream << (uint32_t)pBlock->mTopLevelVars.size();
+            for (const auto& pVar : pBlock->mTopLevelVars)
+            {
+                serializeVar(stream, pVar.get());
+            }
+        }
+
+        stream << mThreadGroupSize << mIsSampleFrequency;
+        serializeVariableMap(stream, mPsOut);
+        serializeVariableMap(stream, mVertAttr);
+        serializeVariableMap(stream, mVertAttrBySemantic);
+    }
+
+    ProgramReflection::SharedPtr ProgramReflection::createFromStream(BinaryFileStream& stream)
+    {
+        SharedPtr pReflector = SharedPtr(new ProgramReflection());
+
+        uint32_t blockCount = 0;
+        stream >> blockCount;
+        for (uint32_t b = 0; b < blockCount; b++)
+        {
+            std::string name;
+            uint32_t varCount = 0;
+            if (readString(stream, name) == false) return nullptr;
+            stream >> varCount;
+            if (stream.isGood() == false || pReflector->mParameterBlocksIndices.find(name) != pReflector->mParameterBlocksIndices.end()) return nullptr;
+
+            ParameterBlockReflection::SharedPtr pBlock = ParameterBlockReflection::create(name);
+            for (uint32_t v = 0; v < varCount; v++)
+            {
+                ReflectionVar::SharedPtr pVar = deserializeVar(stream, 0);
+                if (pVar == nullptr || pVar->getType()->unwrapArray()->asResourceType() == nullptr) return nullptr;
+                pBlock->addResource(pVar);
+            }
+            pBlock->finalize();
+            pReflector->addParameterBlock(pBlock);
+        }
+
+        if (pReflector->mpDefaultBlock == nullptr) return nullptr;
+        pReflector->updateDefaultBlockResourceBindings();
+
+        stream >> pReflector->mThreadGroupSize >> pReflector->mIsSampleFrequency;
+        if (deserializeVariableMap(stream, pReflector->mPsOut) == false) return nullptr;
+        if (deserializeVariableMap(stream, pReflector->mVertAttr) == false) return nullptr;
+        if (deserializeVariableMap(stream, pReflector->mVertAttrBySemantic) == false) return nullptr;
+        return pReflector;
+    }
+
     void ReflectionStructType::addMember(const std::shared_ptr<const ReflectionVar>& pVar)
     {
         if (mNameToIndex.find(pVar->getName()) != mNameToIndex.end())
@@ -973,6 +1206,7 @@ namespace Falcor
         uint32_t elementCount = max(1u, pVar->getType()->getTotalArraySize());
         mResources.push_back(getResourceDesc(pVar, elementCount, pVar->getName()));
         mpResourceVars->addMember(pVar);
+        mTopLevelVars.push_back(pVar);
 
         // If this is a constant-buffer, it might contain resources. Extract them.
         const ReflectionType* pType = pResourceType->getStructType().get();
@@ -1109,6 +1343,17 @@ namespace Falcor
         return nullptr;
     }
 
+    ReflectionVar::SharedConstPtr ReflectionResourceType::findMember(const std::string& name) const
+    {
+        std::lock_guard<std::mutex> lock(mMemberIndexMutex);
+        auto it = mMemberIndex.find(name);
+        if (it != mMemberIndex.end()) return it->second;
+
+        ReflectionVar::SharedConstPtr pVar = findMemberInternal(name, 0, 0, 0, 0, 0);
+        if (pVar) mMemberIndex[name] = pVar;
+        return pVar;
+    }
+
     ReflectionVar::SharedConstPtr ReflectionResourceType::findMemberInternal(const std::string& name, size_t strPos, size_t offset, uint32_t regIndex, uint32_t regSpace, uint32_t descOffset) const
     {
         if (mpStructType)
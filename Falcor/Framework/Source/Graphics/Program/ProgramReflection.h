@@ -29,8 +29,10 @@
 #include "Framework.h"
 #include <unordered_map>
 #include <unordered_set>
+#include <mutex>
 #include "Externals/Slang/slang.h"
 #include "API/DescriptorSet.h"
+#include "Utils/BinaryFileStream.h"
 
 namespace Falcor
 {
@@ -82,6 +84,10 @@ namespace Falcor
         */
         virtual size_t getSize() const = 0;
 
+        /** Get the offset of the object relative to the parent
+        */
+        size_t getOffset() const { return mOffset; }
+
         // Helper functions
         virtual std::shared_ptr<const ReflectionVar> findMemberInternal(const std::string& name, size_t strPos, size_t offset, uint32_t regIndex, uint32_t regSpace, uint32_t descOffset) const = 0;
 
@@ -392,6 +398,11 @@ namespace Falcor
         */
         const OffsetDesc& getOffsetDesc(size_t offset) const;
 
+        /** Get a variable by name. The name can contain array indices and struct members.
+            Successful lookups are memoized in a hashed index, so resolving the same name again doesn't re-parse it
+        */
+        virtual std::shared_ptr<const ReflectionVar> findMember(const std::string& name) const override;
+
         bool operator==(const ReflectionResourceType& other) const;
         bool operator==(const ReflectionType& other) const override;
     private:
@@ -403,6 +414,8 @@ namespace Falcor
         Type mType;
         ReflectionType::SharedConstPtr mpStructType;   // For constant- and structured-buffers
         OffsetDescMap mOffsetDescMap;
+        mutable std::unordered_map<std::string, std::shared_ptr<const ReflectionVar>> mMemberIndex; // Memoized findMember() results
+        mutable std::mutex mMemberIndexMutex;
 
         virtual std::shared_ptr<const ReflectionVar> findMemberInternal(const std::string& name, size_t strPos, size_t offset, uint32_t regIndex, uint32_t regSpace, uint32_t descOffset) const override;
     };
@@ -554,6 +567,7 @@ namespace Falcor
         ReflectionStructType::SharedPtr mpResourceVars;
         std::string mName;
         std::unordered_map<std::string, BindLocation> mResourceBindings;
+        std::vector<ReflectionVar::SharedConstPtr> mTopLevelVars;   // The variables passed to addResource(). Used for serialization
 
         SetLayoutVec mSetLayouts;
     };
@@ -590,6 +604,15 @@ namespace Falcor
         */
         static SharedPtr create(slang::ShaderReflection* pSlangReflector, ResourceScope scopeToReflect, std::string& log);
 
+        /** Create a new object from data written by serialize()
+            \return A new object, or nullptr if the stream doesn't contain valid reflection data
+        */
+        static SharedPtr createFromStream(BinaryFileStream& stream);
+
+        /** Write the reflection data into a binary stream. The object can be re-created using createFromStream()
+        */
+        void serialize(BinaryFileStream& stream) const;
+
         /** Get the index of a parameter block
         */
         uint32_t getParameterBlockIndex(const std::string& name) const;
@@ -650,6 +673,7 @@ namespace Falcor
 
         bool merge(const ProgramReflection* pOther);
     private:
+        ProgramReflection() = default;
         ProgramReflection(slang::ShaderReflection* pSlangReflector, ResourceScope scopeToReflect, std::string& log);
         void addParameterBlock(const ParameterBlockReflection::SharedConstPtr& pBlock);
         void updateDefaultBlockResourceBindings();
@@ -0,0 +1,259 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ShaderCache.h"
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include "Utils/Platform/OS.h"
+
+namespace Falcor
+{
+    // Bump this whenever the file layout or the serialized reflection changes
+    static const uint32_t kCacheFormatVersion = 1;
+    static const uint32_t kCacheMagic = 0x48435346; // 'FSCH'
+    static const uint64_t kHashOffsetBasis = 0xcbf29ce484222325ull;
+    static const uint64_t kHashPrime = 0x100000001b3ull;
+    static const uint32_t kMaxDependencyCount = 64 * 1024;
+    static const uint32_t kMaxPathLength = 32 * 1024;
+    static const uint64_t kMaxBlobSize = 256 * 1024 * 1024;
+
+    static std::mutex sMutex;
+    static bool sEnabled = true;
+    static std::string sDirectory;
+
+    void ShaderCache::setEnabled(bool enabled)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sEnabled = enabled;
+    }
+
+    bool ShaderCache::isEnabled()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        return sEnabled;
+    }
+
+    void ShaderCache::setDirectory(const std::string& directory)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sDirectory = directory;
+    }
+
+    std::string ShaderCache::getDirectory()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        if (sDirectory.empty())
+        {
+            sDirectory = getExecutableDirectory() + "/ShaderCache";
+        }
+        return sDirectory;
+    }
+
+    uint64_t ShaderCache::hash(const void* pData, size_t size, uint64_t seed)
+    {
+        // FNV-1a
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        uint64_t h = seed;
+        for (size_t i = 0; i < size; i++)
+        {
+            h ^= pBytes[i];
+            h *= kHashPrime;
+        }
+        return h;
+    }
+
+    uint64_t ShaderCache::hash(const std::string& str, uint64_t seed)
+    {
+        uint64_t length = str.size();
+        seed = hash(&length, sizeof(length), seed);
+        return hash(str.data(), str.size(), seed);
+    }
+
+    uint64_t ShaderCache::getCompilerHash()
+    {
+        static const uint64_t compilerHash = []()
+        {
+            uint64_t h = hash(&kCacheFormatVersion, sizeof(kCacheFormatVersion), kHashOffsetBasis);
+#ifdef FALCOR_VK
+            h = hash(std::string("FALCOR_VK"), h);
+#elif defined FALCOR_D3D12
+            h = hash(std::string("FALCOR_D3D12"), h);
+#endif
+            // Slang doesn't expose a version number. Use the path and timestamp of the library that was actually loaded, so updating Slang invalidates the cache
+            std::string slangPath = getModuleFilename((const void*)&spCreateSession);
+            uint64_t slangTime = 0;
+            if (slangPath.size() && doesFileExist(slangPath))
+            {
+                slangTime = (uint64_t)getFileModifiedTime(slangPath);
+            }
+            else
+            {
+                logWarning("ShaderCache: can't locate the Slang library, updating Slang won't invalidate the cache");
+            }
+            h = hash(slangPath, h);
+            return hash(&slangTime, sizeof(slangTime), h);
+        }();
+        return compilerHash;
+    }
+
+    static std::string getEntryFilename(const std::string& directory, uint64_t key)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+        return directory + "/" + name;
+    }
+
+    bool ShaderCache::hashFile(const std::string& filename, uint64_t& fileHash)
+    {
+        std::string content;
+        if (readFileToString(filename, content) == false) return false;
+        fileHash = hash(content, kHashOffsetBasis);
+        return true;
+    }
+
+    static void writeString(BinaryFileStream& stream, const std::string& str)
+    {
+        stream << (uint32_t)str.size();
+        stream.write(str.data(), str.size());
+    }
+
+    static bool readString(BinaryFileStream& stream, std::string& str)
+    {
+        uint32_t length = 0;
+        stream >> length;
+        if (stream.isGood() == false || length > kMaxPathLength) return false;
+        str.resize(length);
+        if (length) stream.read(&str[0], length);
+        return stream.isGood();
+    }
+
+    bool ShaderCache::load(uint64_t key, Entry& entry)
+    {
+        std::string filename = getEntryFilename(getDirectory(), key);
+        if (doesFileExist(filename) == false) return false;
+
+        BinaryFileStream stream(filename, BinaryFileStream::Mode::Read);
+        uint32_t magic = 0, version = 0;
+        uint64_t storedKey = 0;
+        stream >> magic >> version >> storedKey;
+        if (stream.isGood() == false || magic != kCacheMagic || version != kCacheFormatVersion || storedKey != key) return false;
+
+        // Make sure none of the dependencies changed since the entry was written
+        uint32_t depCount = 0;
+        stream >> depCount;
+        if (stream.isGood() == false || depCount > kMaxDependencyCount) return false;
+        entry.dependencies.resize(depCount);
+        entry.dependencyHashes.resize(depCount);
+        for (uint32_t i = 0; i < depCount; i++)
+        {
+            uint64_t currentHash;
+            if (readString(stream, entry.dependencies[i]) == false) return false;
+            stream >> entry.dependencyHashes[i];
+            if (stream.isGood() == false || hashFile(entry.dependencies[i], currentHash) == false || currentHash != entry.dependencyHashes[i]) return false;
+        }
+
+        for (uint32_t i = 0; i < kShaderCount; i++)
+        {
+            uint64_t size = 0;
+            stream >> entry.shaderBlob[i].type >> size;
+            if (stream.isGood() == false || size > kMaxBlobSize) return false;
+            entry.shaderBlob[i].data.resize((size_t)size);
+            if (size) stream.read(entry.shaderBlob[i].data.data(), (size_t)size);
+        }
+
+        entry.pReflector = ProgramReflection::createFromStream(stream);
+        entry.pLocalReflector = ProgramReflection::createFromStream(stream);
+        entry.pGlobalReflector = ProgramReflection::createFromStream(stream);
+        if (!entry.pReflector || !entry.pLocalReflector || !entry.pGlobalReflector) return false;
+
+        // The file ends with the magic number, which protects against truncated files
+        stream >> magic;
+        return stream.isGood() && (magic == kCacheMagic);
+    }
+
+    void ShaderCache::store(uint64_t key, const Entry& entry)
+    {
+        assert(entry.dependencyHashes.size() == entry.dependencies.size());
+        if (entry.dependencyHashes.size() != entry.dependencies.size()) return;
+
+        // A file saved while the program was compiling may not be what the compiler read. Don't store output which could be stale under the new file's hash
+        for (size_t i = 0; i < entry.dependencies.size(); i++)
+        {
+            uint64_t currentHash;
+            if (hashFile(entry.dependencies[i], currentHash) == false || currentHash != entry.dependencyHashes[i]) return;
+        }
+
+        std::string directory = getDirectory();
+        if (isDirectoryExists(directory) == false && createDirectory(directory) == false)
+        {
+            logWarning("ShaderCache: can't create the cache directory '" + directory + "'");
+            return;
+        }
+
+        // Write everything to a uniquely named file first. Renaming it into place is atomic, so other processes never see a partial entry
+        std::string filename = getEntryFilename(directory, key);
+        std::random_device rd;
+        std::string tempFilename = filename + "." + std::to_string(rd()) + std::to_string(rd()) + ".tmp";
+        {
+            BinaryFileStream stream(tempFilename, BinaryFileStream::Mode::Write);
+            stream << kCacheMagic << kCacheFormatVersion << key;
+
+            stream << (uint32_t)entry.dependencies.size();
+            for (size_t i = 0; i < entry.dependencies.size(); i++)
+            {
+                writeString(stream, entry.dependencies[i]);
+                stream << entry.dependencyHashes[i];
+            }
+
+            for (uint32_t i = 0; i < kShaderCount; i++)
+            {
+                stream << entry.shaderBlob[i].type << (uint64_t)entry.shaderBlob[i].data.size();
+                stream.write(entry.shaderBlob[i].data.data(), entry.shaderBlob[i].data.size());
+            }
+
+            entry.pReflector->serialize(stream);
+            entry.pLocalReflector->serialize(stream);
+            entry.pGlobalReflector->serialize(stream);
+            stream << kCacheMagic;
+
+            if (stream.isGood() == false)
+            {
+                logWarning("ShaderCache: failed writing '" + tempFilename + "'");
+                stream.remove();
+                return;
+            }
+        }
+
+        // Replace stale entries atomically. If that fails (e.g. another process has the entry open), keep the existing entry
+        if (replaceFile(tempFilename, filename) == false)
+        {
+            std::remove(tempFilename.c_str());
+        }
+    }
+}
@@ -0,0 +1,111 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include "API/Shader.h"
+#include "Graphics/Program/ProgramReflection.h"
+
+namespace Falcor
+{
+    /** Persistent on-disk cache of compiled programs.
+        Entries hold the Slang output for every stage together with the serialized reflection data, so warm starts don't need to invoke Slang at all.
+        An entry is keyed by everything that goes into the compile request (sources, entry points, defines, search paths, target profile, compiler version). It also records every file Slang reported as a dependency along with a hash of its content, and it's only used if all of them are unchanged.
+        Entries are written to a temporary file and renamed into place, so multiple processes can share the same cache directory.
+        All functions are thread-safe.
+    */
+    class ShaderCache
+    {
+    public:
+        static const uint32_t kShaderCount = (uint32_t)ShaderType::Count;
+
+        /** The data stored for a single program version
+        */
+        struct Entry
+        {
+            Shader::Blob shaderBlob[kShaderCount];          ///< The Slang output for each stage. Unused stages are empty
+            ProgramReflection::SharedPtr pReflector;        ///< Reflection for all resources
+            ProgramReflection::SharedPtr pLocalReflector;   ///< Reflection for local resources
+            ProgramReflection::SharedPtr pGlobalReflector;  ///< Reflection for global (shared) resources
+            std::vector<std::string> dependencies;          ///< Full paths of all the files the program depends on
+            std::vector<uint64_t> dependencyHashes;         ///< Content hash of every dependency, taken when the compiler reported it. See hashFile()
+        };
+
+        /** Enable or disable the cache. The cache is enabled by default
+        */
+        static void setEnabled(bool enabled);
+
+        /** Check if the cache is enabled
+        */
+        static bool isEnabled();
+
+        /** Set the directory holding the cache files. The default is 'ShaderCache' under the executable directory
+        */
+        static void setDirectory(const std::string& directory);
+
+        /** Get the directory holding the cache files
+        */
+        static std::string getDirectory();
+
+        /** Hash a block of data. Used to build cache keys
+            \param[in] pData The data to hash
+            \param[in] size Size of the data in bytes
+            \param[in] seed The hash to continue from
+        */
+        static uint64_t hash(const void* pData, size_t size, uint64_t seed);
+
+        /** Hash a string, including its length. Used to build cache keys
+        */
+        static uint64_t hash(const std::string& str, uint64_t seed);
+
+        /** Hash the content of a file. Used for the dependency hashes of an entry
+            \param[in] filename The full path of the file
+            \param[out] fileHash On success, the hash of the file's content
+            \return false if the file can't be read, otherwise true
+        */
+        static bool hashFile(const std::string& filename, uint64_t& fileHash);
+
+        /** Get a hash identifying the compiler and the cache format. This is the seed that all cache keys should start from
+        */
+        static uint64_t getCompilerHash();
+
+        /** Load an entry from the cache
+            \param[in] key The cache key
+            \param[out] entry On success, the cached data
+            \return true if a valid entry was found and all of its dependencies are unchanged, otherwise false
+        */
+        static bool load(uint64_t key, Entry& entry);
+
+        /** Store an entry in the cache. An existing entry with the same key is replaced. Failures are not fatal and only reported as warnings
+            If a dependency no longer matches its hash in the entry, the file changed during the compilation and the entry is not stored, since it may hold the output of the old file.
+            \param[in] key The cache key
+            \param[in] entry The data to store. Must have a hash for every dependency
+        */
+        static void store(uint64_t key, const Entry& entry);
+    };
+}
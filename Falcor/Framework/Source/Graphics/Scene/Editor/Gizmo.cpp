@@ -130,7 +130,7 @@ namespace Falcor
         : mGizmoType(Type::Invalid)
     {
         // Add model instances to scene
-        Model::SharedPtr pModel = Model::createFromFile(modelFilename);
+        Model::SharedPtr pModel = Model::createFromFile(modelFilename, Model::LoadFlags::KeepCpuGeometry);
         pScene->addModelInstance(pModel, "X", glm::vec3(), glm::radians(glm::vec3(0.0f, 0.0f, -90.0f)));
         pScene->addModelInstance(pModel, "Y");
         pScene->addModelInstance(pModel, "Z", glm::vec3(), glm::radians(glm::vec3(0.0f, 90.0f, 0.0f)));
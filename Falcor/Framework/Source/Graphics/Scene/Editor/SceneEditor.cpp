@@ -413,7 +413,7 @@ namespace Falcor
 
     SceneEditor::SceneEditor(const Scene::SharedPtr& pScene, Model::LoadFlags modelLoadFlags)
         : mpScene(pScene)
-        , mModelLoadFlags(modelLoadFlags)
+        , mModelLoadFlags(modelLoadFlags | Model::LoadFlags::KeepCpuGeometry)   // Picking needs the triangles
     {
         mpDebugDrawer = DebugDrawer::create();
 
@@ -485,7 +485,7 @@ namespace Falcor
         // Master Scene Picking
         //
 
-        mpScenePicker = Picking::create(mpScene, backBufferWidth, backBufferHeight);
+        mpScenePicker = Picking::create(mpScene);
 
         //
         // Editor Scene and Picking
@@ -495,7 +495,7 @@ namespace Falcor
         mpEditorScene->addCamera(Camera::create());
         mpEditorScene->getActiveCamera()->setAspectRatio((float)backBufferWidth/(float)backBufferHeight);
         mpEditorSceneRenderer = SceneEditorRenderer::create(mpEditorScene);
-        mpEditorPicker = Picking::create(mpEditorScene, backBufferWidth, backBufferHeight);
+        mpEditorPicker = Picking::create(mpEditorScene);
 
         //
         // Debug Draw Shaders
@@ -530,7 +530,7 @@ namespace Falcor
         // Cameras
         //
 
-        mpCameraModel = Model::createFromFile("Framework/Models/Camera.obj");
+        mpCameraModel = Model::createFromFile("Framework/Models/Camera.obj", Model::LoadFlags::KeepCpuGeometry);
 
         if (mpScene->getCameraCount() > 0)
         {
@@ -548,7 +548,7 @@ namespace Falcor
         // Lights
         //
 
-        mpLightModel = Model::createFromFile("Framework/Models/LightBulb.obj");
+        mpLightModel = Model::createFromFile("Framework/Models/LightBulb.obj", Model::LoadFlags::KeepCpuGeometry);
 
         uint32_t pointLightID = 0;
         for (uint32_t i = 0; i < mpScene->getLightCount(); i++)
@@ -597,7 +597,7 @@ namespace Falcor
             }
         }
 
-        mpKeyframeModel = Model::createFromFile("Framework/Models/Camera.obj");
+        mpKeyframeModel = Model::createFromFile("Framework/Models/Camera.obj", Model::LoadFlags::KeepCpuGeometry);
     }
 
     const glm::vec3& SceneEditor::getActiveInstanceRotationAngles()
@@ -832,7 +832,7 @@ namespace Falcor
             // Gizmo Selection
             if (mGizmoBeingDragged == false)
             {
-                if (mpEditorPicker->pick(pContext, mouseEvent.pos, mpEditorScene->getActiveCamera()))
+                if (mpEditorPicker->pick(mouseEvent.pos, mpEditorScene->getActiveCamera().get()))
                 {
                     const auto& pInstance = mpEditorPicker->getPickedModelInstance();
 
@@ -865,11 +865,11 @@ namespace Falcor
                 // Scene Object Selection
                 if (mMouseHoldTimer.getElapsedTime() < 0.2f)
                 {
-                    if (mpEditorPicker->pick(pContext, mouseEvent.pos, mpEditorScene->getActiveCamera()))
+                    if (mpEditorPicker->pick(mouseEvent.pos, mpEditorScene->getActiveCamera().get()))
                     {
                         select(mpEditorPicker->getPickedModelInstance());
                     }
-                    else if (mpScenePicker->pick(pContext, mouseEvent.pos, mpEditorScene->getActiveCamera()))
+                    else if (mpScenePicker->pick(mouseEvent.pos, mpEditorScene->getActiveCamera().get()))
                     {
                         select(mpScenePicker->getPickedModelInstance(), mpScenePicker->getPickedMeshInstance());
                     }
@@ -898,11 +898,7 @@ namespace Falcor
 
     void SceneEditor::onResizeSwapChain()
     {
-        if (mpScenePicker)
-        {
-            auto backBufferFBO = gpDevice->getSwapChainFbo();
-            mpScenePicker->resizeFBO(backBufferFBO->getWidth(), backBufferFBO->getHeight());
-        }
+        // Picking runs on the CPU, so nothing depends on the back buffer size
     }
 
     void SceneEditor::setActiveModelInstance(const Scene::ModelInstance::SharedPtr& pModelInstance)
@@ -51,6 +51,9 @@ namespace Falcor
     SceneEditorRenderer::SceneEditorRenderer(const Scene::SharedPtr& pScene)
         : SceneRenderer(pScene)
     {
+        // Gizmo state is bound per model instance, so draws can't be merged across model instances
+        toggleRenderQueue(false);
+
         mpGraphicsState = GraphicsState::create();
 
         // Solid Rasterizer state
@@ -73,6 +76,8 @@ namespace Falcor
         defines.add("SHADING");
         mpProgram = GraphicsProgram::createFromFile("Framework/Shaders/SceneEditor.slang", "editorVs", "editorPs", defines);
         mpProgramVars = GraphicsVars::create(mpProgram->getReflector());
+        mpColorCB = mpProgramVars->getConstantBuffer("ConstColorCB");
+        mColorVar = mpColorCB->getVariableHandle<glm::vec3>("gColor");
 
         defines.add("CULL_REAR_SECTION");
         mpRotGizmoProgram = GraphicsProgram::createFromFile("Framework/Shaders/SceneEditor.slang", "editorVs", "editorPs", defines);
@@ -99,7 +104,7 @@ namespace Falcor
             color[instanceID] = 1.0f;
 
             mpGraphicsState->setDepthStencilState(mpSetStencilDS);
-            mpProgramVars["ConstColorCB"]["gColor"] = color;
+            mpColorCB->setVariable(mColorVar, color);
 
             // For rotation gizmo, set shader to cut out away-facing parts
             if (gizmoType == Gizmo::Type::Rotate)
@@ -111,7 +116,7 @@ namespace Falcor
         else
         {
             mpGraphicsState->setDepthStencilState(mpExcludeStencilDS);
-            mpProgramVars["ConstColorCB"]["gColor"] = glm::vec3(0.6f);
+            mpColorCB->setVariable(mColorVar, glm::vec3(0.6f));
         }
 
         mpGraphicsState->setProgram(mpProgram);
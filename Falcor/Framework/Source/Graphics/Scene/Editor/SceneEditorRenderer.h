@@ -61,6 +61,9 @@ namespace Falcor
         GraphicsVars::SharedPtr mpProgramVars;
         GraphicsState::SharedPtr mpGraphicsState;
 
+        ConstantBuffer::SharedPtr mpColorCB;
+        ConstantBuffer::VariableHandle<glm::vec3> mColorVar;
+
         DepthStencilState::SharedPtr mpSetStencilDS;
         DepthStencilState::SharedPtr mpExcludeStencilDS;
     };
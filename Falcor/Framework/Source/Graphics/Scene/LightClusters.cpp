@@ -0,0 +1,286 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "LightClusters.h"
+#include "Scene.h"
+#include "Graphics/Camera/Camera.h"
+#include "Graphics/Program/ProgramVars.h"
+#include "Utils/WorkerPool.h"
+#include <xmmintrin.h>
+
+namespace Falcor
+{
+    static const char* kCbName = "InternalLightClustersCB";
+    static const char* kLightsName = "gClusterLights";
+    static const char* kClustersName = "gLightClusters";
+    static const char* kIndicesName = "gClusterLightIndices";
+
+    LightClusters::SharedPtr LightClusters::create(uint32_t tilesX, uint32_t tilesY, uint32_t depthSlices)
+    {
+        if (tilesX == 0 || tilesY == 0 || depthSlices == 0)
+        {
+            logError("LightClusters::create() - the cluster grid can't be empty");
+            return nullptr;
+        }
+        return SharedPtr(new LightClusters(tilesX, tilesY, depthSlices));
+    }
+
+    LightClusters::LightClusters(uint32_t tilesX, uint32_t tilesY, uint32_t depthSlices) : mDims(tilesX, tilesY, depthSlices)
+    {
+        mPaddedTilesX = (tilesX + 3) & ~3;
+        mSliceDepths.resize(depthSlices + 1);
+        mColumnEdges.resize(tilesX + 1);
+        mRowEdges.resize(tilesY + 1);
+        mClusterLights.resize(getClusterCount());
+        mClusterRanges.resize(getClusterCount(), glm::uvec2(0));
+    }
+
+    bool LightClusters::isUsedBy(const ProgramReflection* pReflector)
+    {
+        const ParameterBlockReflection* pBlock = pReflector->getDefaultParameterBlock().get();
+        return pBlock && pBlock->getResource(kIndicesName) != nullptr;
+    }
+
+    void LightClusters::initTileEdges(const glm::mat4& projMat)
+    {
+        // Solve the projection of a view-space point at depth d for X (or Y) on a tile edge in NDC. This is linear in d for both perspective and orthographic projections.
+        for (uint32_t i = 0; i <= mDims.x; i++)
+        {
+            const float ndc = -1.0f + 2.0f * i / mDims.x;
+            mColumnEdges[i].slope = (projMat[2][0] - ndc * projMat[2][3]) / projMat[0][0];
+            mColumnEdges[i].intercept = (ndc * projMat[3][3] - projMat[3][0]) / projMat[0][0];
+        }
+
+        for (uint32_t i = 0; i <= mDims.y; i++)
+        {
+            const float ndc = -1.0f + 2.0f * i / mDims.y;
+            mRowEdges[i].slope = (projMat[2][1] - ndc * projMat[2][3]) / projMat[1][1];
+            mRowEdges[i].intercept = (ndc * projMat[3][3] - projMat[3][1]) / projMat[1][1];
+        }
+    }
+
+    uint32_t LightClusters::getSlice(float depth) const
+    {
+        const float slice = std::floor(std::log(std::max(depth, 1e-4f)) * mDepthScale + mDepthBias);
+        return (uint32_t)glm::clamp(slice, 0.0f, float(mDims.z - 1));
+    }
+
+    void LightClusters::update(const Scene* pScene, const Camera* pCamera)
+    {
+        // Exponential depth slices, matching getLightCluster() in LightClusters.slang
+        const float nearZ = std::max(pCamera->getNearPlane(), 1e-4f);
+        const float farZ = std::max(pCamera->getFarPlane(), nearZ * 1.001f);
+        mDepthScale = mDims.z / std::log(farZ / nearZ);
+        mDepthBias = -std::log(nearZ) * mDepthScale;
+        for (uint32_t i = 0; i <= mDims.z; i++)
+        {
+            mSliceDepths[i] = nearZ * std::pow(farZ / nearZ, float(i) / mDims.z);
+        }
+        initTileEdges(pCamera->getProjMatrix());
+
+        // Collect the lights. Lights which aren't point or directional lights are kept to preserve the scene's indices, but never assigned.
+        const glm::mat4& viewMat = pCamera->getViewMatrix();
+        mLightData.clear();
+        mBoundedLights.clear();
+        mLightIndices.clear();
+        for (uint32_t i = 0; i < pScene->getLightCount(); i++)
+        {
+            const LightData& data = pScene->getLight(i)->getData();
+            mLightData.push_back(data);
+
+            if (data.type == LightPoint && data.range > 0)
+            {
+                const glm::vec4 posV = viewMat * glm::vec4(data.posW, 1);
+                BoundedLight light;
+                light.center = glm::vec3(posV.x, posV.y, -posV.z);
+                light.radius = data.range;
+                light.lightIndex = i;
+
+                // Skip the lights outside of the depth range
+                if (light.center.z + light.radius < nearZ || light.center.z - light.radius > farZ) continue;
+
+                light.firstSlice = getSlice(light.center.z - light.radius);
+                light.lastSlice = getSlice(light.center.z + light.radius);
+                mBoundedLights.push_back(light);
+            }
+            else if (data.type == LightPoint || data.type == LightDirectional)
+            {
+                mLightIndices.push_back(i);
+            }
+        }
+
+        // Bin the bounded lights. Every slice owns its clusters' lists, so the slices can be binned concurrently.
+        for (auto& lights : mClusterLights)
+        {
+            lights.clear();
+        }
+
+        if (mBoundedLights.empty() == false)
+        {
+            WorkerPool::getGlobal().parallelFor(0, mDims.z, [this](uint32_t slice) { binSlice(slice); });
+        }
+
+        // Compact the lists after the global lights, which are only stored once
+        mGlobalLightCount = (uint32_t)mLightIndices.size();
+        mMaxLightsPerCluster = 0;
+        for (uint32_t c = 0; c < getClusterCount(); c++)
+        {
+            const uint32_t offset = (uint32_t)mLightIndices.size();
+            const uint32_t count = (uint32_t)mClusterLights[c].size();
+            mLightIndices.insert(mLightIndices.end(), mClusterLights[c].begin(), mClusterLights[c].end());
+            mClusterRanges[c] = glm::uvec2(offset, count);
+            mMaxLightsPerCluster = std::max(mMaxLightsPerCluster, mGlobalLightCount + count);
+        }
+
+        mLightsBuffer.dirty = true;
+        mClustersBuffer.dirty = true;
+        mIndicesBuffer.dirty = true;
+    }
+
+    void LightClusters::binSlice(uint32_t slice)
+    {
+        const float d0 = mSliceDepths[slice];
+        const float d1 = mSliceDepths[slice + 1];
+
+        // The view-space bounds of the columns and rows of clusters in the slice. The padding columns never pass the distance test.
+        std::vector<float> minX(mPaddedTilesX, FLT_MAX);
+        std::vector<float> maxX(mPaddedTilesX, FLT_MAX);
+        for (uint32_t x = 0; x < mDims.x; x++)
+        {
+            const TileEdge& left = mColumnEdges[x];
+            const TileEdge& right = mColumnEdges[x + 1];
+            minX[x] = std::min(left.slope * d0, left.slope * d1) + left.intercept;
+            maxX[x] = std::max(right.slope * d0, right.slope * d1) + right.intercept;
+        }
+
+        std::vector<float> minY(mDims.y);
+        std::vector<float> maxY(mDims.y);
+        for (uint32_t y = 0; y < mDims.y; y++)
+        {
+            const TileEdge& bottom = mRowEdges[y];
+            const TileEdge& top = mRowEdges[y + 1];
+            minY[y] = std::min(bottom.slope * d0, bottom.slope * d1) + bottom.intercept;
+            maxY[y] = std::max(top.slope * d0, top.slope * d1) + top.intercept;
+        }
+
+        // Sphere vs. cluster AABB. The squared distance is separable, so it's accumulated per slice, row and 4 columns at a time.
+        const uint32_t sliceBase = slice * mDims.x * mDims.y;
+        for (const auto& light : mBoundedLights)
+        {
+            if (slice < light.firstSlice || slice > light.lastSlice) continue;
+
+            const float dz = std::max(0.0f, std::max(d0 - light.center.z, light.center.z - d1));
+            const float remainingZ = light.radius * light.radius - dz * dz;
+            if (remainingZ < 0) continue;
+
+            const __m128 centerX = _mm_set1_ps(light.center.x);
+            for (uint32_t y = 0; y < mDims.y; y++)
+            {
+                const float dy = std::max(0.0f, std::max(minY[y] - light.center.y, light.center.y - maxY[y]));
+                const float remainingY = remainingZ - dy * dy;
+                if (remainingY < 0) continue;
+
+                const __m128 remaining = _mm_set1_ps(remainingY);
+                std::vector<uint32_t>* pRow = &mClusterLights[sliceBase + y * mDims.x];
+                for (uint32_t x = 0; x < mDims.x; x += 4)
+                {
+                    __m128 dx = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[x]), centerX), _mm_sub_ps(centerX, _mm_loadu_ps(&maxX[x])));
+                    dx = _mm_max_ps(dx, _mm_setzero_ps());
+                    const int mask = _mm_movemask_ps(_mm_cmple_ps(_mm_mul_ps(dx, dx), remaining));
+                    for (uint32_t i = 0; i < 4; i++)
+                    {
+                        if (mask & (1 << i))
+                        {
+                            pRow[x + i].push_back(light.lightIndex);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void LightClusters::bindBuffer(ProgramVars* pVars, const ParameterBlockReflection* pBlock, const char* name, GpuBuffer& buffer, const void* pData, size_t elementCount, size_t elementSize)
+    {
+        const ReflectionVar* pVar = pBlock->getResource(name).get();
+        if (pVar == nullptr) return;
+
+        // Grow the buffer geometrically, the light count can change every frame
+        if (buffer.pBuffer == nullptr || buffer.pBuffer->getElementCount() < elementCount)
+        {
+            size_t capacity = std::max<size_t>(elementCount, 1);
+            if (buffer.pBuffer)
+            {
+                capacity = std::max(capacity, buffer.pBuffer->getElementCount() * 2);
+            }
+
+            ReflectionResourceType::SharedConstPtr pType = pVar->getType()->unwrapArray()->asResourceType()->inherit_shared_from_this::shared_from_this();
+            buffer.pBuffer = StructuredBuffer::create(name, pType, capacity, Resource::BindFlags::ShaderResource);
+            assert(buffer.pBuffer->getElementSize() == elementSize);
+            buffer.dirty = true;
+        }
+
+        if (buffer.dirty && elementCount > 0)
+        {
+            buffer.pBuffer->setBlob(pData, 0, elementCount * elementSize);
+        }
+        buffer.dirty = false;
+
+        pVars->setStructuredBuffer(name, buffer.pBuffer);
+    }
+
+    bool LightClusters::setIntoProgramVars(ProgramVars* pVars)
+    {
+        if (isUsedBy(pVars->getReflection().get()) == false)
+        {
+            return false;
+        }
+
+        const ParameterBlockReflection* pBlock = pVars->getReflection()->getDefaultParameterBlock().get();
+        bindBuffer(pVars, pBlock, kLightsName, mLightsBuffer, mLightData.data(), mLightData.size(), sizeof(LightData));
+        bindBuffer(pVars, pBlock, kClustersName, mClustersBuffer, mClusterRanges.data(), mClusterRanges.size(), sizeof(glm::uvec2));
+        bindBuffer(pVars, pBlock, kIndicesName, mIndicesBuffer, mLightIndices.data(), mLightIndices.size(), sizeof(uint32_t));
+
+        ConstantBuffer* pCB = pVars->getConstantBuffer(kCbName).get();
+        if (pCB)
+        {
+            if (mVariables.pReflector != pCB->getBufferReflector())
+            {
+                mVariables.pReflector = pCB->getBufferReflector();
+                mVariables.dims = pCB->getVariableHandle<glm::uvec3>("gClusterDims");
+                mVariables.depthScale = pCB->getVariableHandle<float>("gClusterDepthScale");
+                mVariables.depthBias = pCB->getVariableHandle<float>("gClusterDepthBias");
+                mVariables.globalLightCount = pCB->getVariableHandle<uint32_t>("gClusterGlobalLightCount");
+            }
+            pCB->setVariable(mVariables.dims, mDims);
+            pCB->setVariable(mVariables.depthScale, mDepthScale);
+            pCB->setVariable(mVariables.depthBias, mDepthBias);
+            pCB->setVariable(mVariables.globalLightCount, mGlobalLightCount);
+        }
+        return true;
+    }
+}
@@ -0,0 +1,180 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include <vector>
+#include "API/ConstantBuffer.h"
+#include "API/StructuredBuffer.h"
+#include "Data/HostDeviceData.h"
+
+namespace Falcor
+{
+    class Scene;
+    class Camera;
+    class ProgramVars;
+    class ProgramReflection;
+    class ParameterBlockReflection;
+
+    /** Bins the point and directional lights of a scene into clusters, which divide the view frustum into screen tiles and exponentially distributed depth slices.
+        The binning is done on the CPU, with the depth slices processed in parallel by the global worker pool.
+        The result is a compact list of light indices and the range of each cluster in it. Shaders import ShadingUtils/LightClusters.slang and only loop over the lights of the cluster containing the shading point,
+        so the shading cost depends on the number of lights reaching a pixel instead of the number of lights in the scene, and the scene isn't limited to MAX_LIGHT_SOURCES.
+
+        Point lights are assigned to the clusters intersecting the sphere of their range, see PointLight::setRange(). Spot lights use the same sphere.
+        Directional lights and point lights without a range reach every cluster. They are stored once, at the start of the index list, and shaders loop over them before the lights of the cluster.
+    */
+    class LightClusters
+    {
+    public:
+        using SharedPtr = std::shared_ptr<LightClusters>;
+        using SharedConstPtr = std::shared_ptr<const LightClusters>;
+
+        /** Create the light clusters
+            \param[in] tilesX Number of screen tiles along X
+            \param[in] tilesY Number of screen tiles along Y
+            \param[in] depthSlices Number of depth slices between the camera's near and far planes
+            \return A new object, or nullptr if a dimension is 0
+        */
+        static SharedPtr create(uint32_t tilesX = 16, uint32_t tilesY = 9, uint32_t depthSlices = 24);
+
+        /** Assign the lights of a scene to the clusters of a camera
+        */
+        void update(const Scene* pScene, const Camera* pCamera);
+
+        /** Check if a program declares the light clusters
+        */
+        static bool isUsedBy(const ProgramReflection* pReflector);
+
+        /** Bind the clusters built by the last update() call to a program. The buffers are created from the program's reflection, and only uploaded once per update().
+            \param[in] pVars The program vars
+            \return false if the program doesn't declare the light clusters, otherwise true
+        */
+        bool setIntoProgramVars(ProgramVars* pVars);
+
+        /** Get the number of tiles along X and Y and the number of depth slices
+        */
+        const glm::uvec3& getDimensions() const { return mDims; }
+
+        /** Get the total number of clusters
+        */
+        uint32_t getClusterCount() const { return mDims.x * mDims.y * mDims.z; }
+
+        /** Get the index of a cluster
+        */
+        uint32_t getClusterIndex(uint32_t tileX, uint32_t tileY, uint32_t slice) const { return (slice * mDims.y + tileY) * mDims.x + tileX; }
+
+        /** Get the number of lights reaching every cluster
+        */
+        uint32_t getGlobalLightCount() const { return mGlobalLightCount; }
+
+        /** Get the lights reaching every cluster, as indices into the scene's lights
+        */
+        const uint32_t* getGlobalLights() const { return mLightIndices.data(); }
+
+        /** Get the number of lights assigned to a cluster, not including the global lights
+        */
+        uint32_t getClusterLightCount(uint32_t cluster) const { return mClusterRanges[cluster].y; }
+
+        /** Get the lights assigned to a cluster, as indices into the scene's lights. The global lights are not included.
+        */
+        const uint32_t* getClusterLights(uint32_t cluster) const { return mLightIndices.data() + mClusterRanges[cluster].x; }
+
+        /** Get the size of the light index list, over all the clusters
+        */
+        uint32_t getLightIndexCount() const { return (uint32_t)mLightIndices.size(); }
+
+        /** Get the largest number of lights reaching a cluster, including the global lights
+        */
+        uint32_t getMaxLightsPerCluster() const { return mMaxLightsPerCluster; }
+
+    protected:
+        LightClusters(uint32_t tilesX, uint32_t tilesY, uint32_t depthSlices);
+
+        // A light with a bounded range, in view space
+        struct BoundedLight
+        {
+            glm::vec3 center;       // X and Y in view space, Z is the view-space depth
+            float radius;
+            uint32_t lightIndex;
+            uint32_t firstSlice;
+            uint32_t lastSlice;
+        };
+
+        // The view-space extent of a tile edge at depth d is d * slope + intercept
+        struct TileEdge
+        {
+            float slope;
+            float intercept;
+        };
+
+        // A structured buffer, uploaded when it's bound after an update()
+        struct GpuBuffer
+        {
+            StructuredBuffer::SharedPtr pBuffer;
+            bool dirty = true;
+        };
+
+        void initTileEdges(const glm::mat4& projMat);
+        uint32_t getSlice(float depth) const;
+        void binSlice(uint32_t slice);
+        void bindBuffer(ProgramVars* pVars, const ParameterBlockReflection* pBlock, const char* name, GpuBuffer& buffer, const void* pData, size_t elementCount, size_t elementSize);
+
+        // The InternalLightClustersCB variables, resolved once for the reflection they were created from
+        struct VariableHandles
+        {
+            ReflectionType::SharedConstPtr pReflector;
+            ConstantBuffer::VariableHandle<glm::uvec3> dims;
+            ConstantBuffer::VariableHandle<float> depthScale;
+            ConstantBuffer::VariableHandle<float> depthBias;
+            ConstantBuffer::VariableHandle<uint32_t> globalLightCount;
+        };
+        VariableHandles mVariables;
+
+        glm::uvec3 mDims;
+        uint32_t mPaddedTilesX;                             // Tiles along X, rounded up to a multiple of 4 for SSE
+
+        float mDepthScale = 0;                              // Slice = log(depth) * mDepthScale + mDepthBias
+        float mDepthBias = 0;
+        std::vector<float> mSliceDepths;                    // Depth of the slice boundaries
+        std::vector<TileEdge> mColumnEdges;                 // mDims.x + 1 edges
+        std::vector<TileEdge> mRowEdges;                    // mDims.y + 1 edges
+
+        std::vector<BoundedLight> mBoundedLights;
+        std::vector<std::vector<uint32_t>> mClusterLights;  // Per-cluster scratch lists, filled by binSlice()
+
+        std::vector<LightData> mLightData;
+        std::vector<glm::uvec2> mClusterRanges;             // Offset into mLightIndices and count
+        std::vector<uint32_t> mLightIndices;                // The global lights, followed by the lights of every cluster
+        uint32_t mGlobalLightCount = 0;
+        uint32_t mMaxLightsPerCluster = 0;
+
+        GpuBuffer mLightsBuffer;
+        GpuBuffer mClustersBuffer;
+        GpuBuffer mIndicesBuffer;
+    };
+}
@@ -58,9 +58,14 @@ namespace Falcor
     {
         // Reset all global id counters recursively
         Model::resetGlobalIdCounter();
+
+        mTransformCallback = TransformStore::getGlobal().addChangeCallback([this](const std::vector<uint32_t>& ids) { onTransformsChanged(ids); });
     }
 
-    Scene::~Scene() = default;
+    Scene::~Scene()
+    {
+        TransformStore::getGlobal().removeChangeCallback(mTransformCallback);
+    }
 
     void Scene::updateExtents()
     {
@@ -102,6 +107,123 @@ namespace Falcor
         }
     }
 
+    bool Scene::isBvhTopologyValid() const
+    {
+        // Model instances are only added and removed through the scene, which sets the dirty flag. Mesh instances are tracked by the models' version counters
+        if (mpBvh == nullptr || mBvhTopologyDirty || mBvhModels.size() != mModels.size()) return false;
+
+        for (uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            const Model* pModel = getModel(modelID).get();
+            const BvhModelData& modelData = mBvhModels[modelID];
+            if (modelData.pModel != pModel || modelData.meshInstanceVersion != pModel->getMeshInstanceVersion()) return false;
+        }
+        return true;
+    }
+
+    void Scene::buildBvh()
+    {
+        // Make sure all the transforms are current, so that no change reported later refers to the old tree
+        TransformStore::getGlobal().update();
+
+        std::vector<BoundingBox> boxes;
+        mBvhBoxRefs.clear();
+        mBvhSlots.clear();
+        mBvhDirtySlots.clear();
+        mBvhModels.resize(mModels.size());
+
+        for (uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            const Model* pModel = getModel(modelID).get();
+            BvhModelData& modelData = mBvhModels[modelID];
+            modelData.pModel = pModel;
+            modelData.meshInstanceVersion = pModel->getMeshInstanceVersion();
+            modelData.meshInstances.clear();
+            modelData.instances.resize(mModels[modelID].size());
+
+            for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+            {
+                for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                {
+                    const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID).get();
+                    mBvhSlots[pMeshInstance->getTransformID()] = { modelID, (uint32_t)modelData.meshInstances.size(), true };
+                    modelData.meshInstances.push_back(pMeshInstance);
+                }
+            }
+
+            for (uint32_t instanceID = 0; instanceID < mModels[modelID].size(); instanceID++)
+            {
+                const ModelInstance* pInstance = mModels[modelID][instanceID].get();
+                modelData.instances[instanceID] = { pInstance, (uint32_t)boxes.size() };
+                mBvhSlots[pInstance->getTransformID()] = { modelID, instanceID, false };
+
+                const glm::mat4& transform = pInstance->getTransformMatrix();
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < pModel->getMeshInstanceCount(meshID); meshInstanceID++)
+                    {
+                        boxes.push_back(pModel->getMeshInstance(meshID, meshInstanceID)->getBoundingBox().transform(transform));
+                        mBvhBoxRefs.push_back({ modelID, instanceID, meshID, meshInstanceID });
+                    }
+                }
+            }
+        }
+
+        mpBvh = BoundingVolumeHierarchy::create();
+        mpBvh->build(boxes);
+        mBvhTopologyDirty = false;
+    }
+
+    void Scene::onTransformsChanged(const std::vector<uint32_t>& ids)
+    {
+        if (mBvhSlots.empty()) return;
+        for (uint32_t id : ids)
+        {
+            const auto& it = mBvhSlots.find(id);
+            if (it != mBvhSlots.end()) mBvhDirtySlots.push_back(it->second);
+        }
+    }
+
+    const BoundingVolumeHierarchy* Scene::getBvh()
+    {
+        if (isBvhTopologyValid() == false)
+        {
+            buildBvh();
+            return mpBvh.get();
+        }
+
+        // Rebuild the pending transforms. The store reports the moved slots to onTransformsChanged()
+        TransformStore::getGlobal().update();
+
+        // Refit the boxes of the instances which moved
+        std::vector<BvhSlotRef> dirtySlots;
+        dirtySlots.swap(mBvhDirtySlots);
+        for (const BvhSlotRef& ref : dirtySlots)
+        {
+            const BvhModelData& modelData = mBvhModels[ref.modelID];
+            if (ref.isMeshInstance)
+            {
+                // A mesh instance moved inside its model. Its box in every instance of the model changes
+                const BoundingBox& box = modelData.meshInstances[ref.index]->getBoundingBox();
+                for (const auto& instanceData : modelData.instances)
+                {
+                    mpBvh->updateBox(instanceData.firstBox + ref.index, box.transform(instanceData.pInstance->getTransformMatrix()));
+                }
+            }
+            else
+            {
+                const BvhInstanceData& instanceData = modelData.instances[ref.index];
+                const glm::mat4& transform = instanceData.pInstance->getTransformMatrix();
+                for (uint32_t i = 0; i < (uint32_t)modelData.meshInstances.size(); i++)
+                {
+                    mpBvh->updateBox(instanceData.firstBox + i, modelData.meshInstances[i]->getBoundingBox().transform(transform));
+                }
+            }
+        }
+        mpBvh->refit();
+        return mpBvh.get();
+    }
+
     bool Scene::update(double currentTime, CameraController* cameraController)
     {
         bool changed = false;
@@ -113,16 +235,21 @@ namespace Falcor
             }
         }
 
+        std::vector<Model*> models(mModels.size());
         for (uint32_t i = 0; i < mModels.size(); i++)
         {
-            if (mModels[i][0]->getObject()->animate(currentTime))
-            {
-                changed = true;
-            }
+            models[i] = mModels[i][0]->getObject().get();
+        }
+        if (Model::animate(models, currentTime))
+        {
+            changed = true;
         }
 
         mExtentsDirty = mExtentsDirty || changed;
 
+        // Rebuild the instance transforms moved by the paths (and any other edits) in a single batch
+        TransformStore::getGlobal().update();
+
         if (getCameraCount() > 0)
         {
             getActiveCamera()->beginFrame();
@@ -144,12 +271,14 @@ namespace Falcor
         // Delete entire vector of instances
         mModels.erase(mModels.begin() + modelID);
         mExtentsDirty = true;
+        mBvhTopologyDirty = true;
     }
 
     void Scene::deleteAllModels()
     {
         mModels.clear();
         mExtentsDirty = true;
+        mBvhTopologyDirty = true;
     }
 
     uint32_t Scene::getModelInstanceCount(uint32_t modelID) const
@@ -166,6 +295,8 @@ namespace Falcor
 
     void Scene::addModelInstance(const ModelInstance::SharedPtr& pInstance)
     {
+        mBvhTopologyDirty = true;
+
         // Checking for existing instance list for model
         for (uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
         {
@@ -203,6 +334,7 @@ namespace Falcor
 
         //  Extents will be dirty in either case.
         mExtentsDirty = true;
+        mBvhTopologyDirty = true;
     }
 
     const Scene::UserVariable& Scene::getUserVariable(const std::string& name) const
@@ -320,6 +452,7 @@ namespace Falcor
 #undef merge
         mUserVars.insert(pFrom->mUserVars.begin(), pFrom->mUserVars.end());
         mExtentsDirty = true;
+        mBvhTopologyDirty = true;
     }
 
     void Scene::createAreaLights()
@@ -29,6 +29,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include "Graphics/Model/Model.h"
 #include "Graphics/Light.h"
 #include "Graphics/LightProbe.h"
@@ -37,6 +38,7 @@
 #include "Graphics/Paths/ObjectPath.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Model/SkinningCache.h"
+#include "Utils/Math/BoundingVolumeHierarchy.h"
 
 namespace Falcor
 {
@@ -212,6 +214,31 @@ namespace Falcor
         /** Attach skinning cache to all models in scene.
         */
         void attachSkinningCacheToModels(SkinningCache::SharedPtr pSkinningCache);
+
+        /** Identifies the mesh instance of a box in the scene's BVH
+        */
+        struct MeshInstanceRef
+        {
+            uint32_t modelID;
+            uint32_t instanceID;        ///< Model instance ID
+            uint32_t meshID;
+            uint32_t meshInstanceID;
+        };
+
+        /** Get a BVH over the world-space bounds of all the mesh instances, including the ones of hidden model instances.
+            The boxes of a model instance are consecutive, ordered by mesh and then by mesh instance.
+            The tree is rebuilt when model instances or mesh instances are added or removed. When model instances or mesh instances move,
+            the TransformStore reports their slots and only the affected boxes are refitted.
+        */
+        const BoundingVolumeHierarchy* getBvh();
+
+        /** Get the mesh instance of a box in the BVH. Only valid until the next call to getBvh().
+        */
+        const MeshInstanceRef& getBvhBoxRef(uint32_t boxID) const { return mBvhBoxRefs[boxID]; }
+
+        /** Get the first box of a model instance in the BVH. Only valid until the next call to getBvh().
+        */
+        uint32_t getBvhFirstBox(uint32_t modelID, uint32_t instanceID) const { return mBvhModels[modelID].instances[instanceID].firstBox; }
     protected:
 
         Scene();
@@ -242,6 +269,40 @@ namespace Falcor
 
         bool mExtentsDirty = true;
 
+        struct BvhInstanceData
+        {
+            const ModelInstance* pInstance;
+            uint32_t firstBox;
+        };
+
+        struct BvhModelData
+        {
+            const Model* pModel;
+            uint32_t meshInstanceVersion;
+            std::vector<const Model::MeshInstance*> meshInstances;     // In box order
+            std::vector<BvhInstanceData> instances;
+        };
+
+        // The BVH boxes which depend on a TransformStore slot
+        struct BvhSlotRef
+        {
+            uint32_t modelID;
+            uint32_t index;             // Model instance ID, or the index in BvhModelData::meshInstances for mesh instances
+            bool isMeshInstance;
+        };
+
+        BoundingVolumeHierarchy::UniquePtr mpBvh;
+        std::vector<BvhModelData> mBvhModels;
+        std::vector<MeshInstanceRef> mBvhBoxRefs;
+        std::unordered_map<uint32_t, BvhSlotRef> mBvhSlots;     // Keyed by the TransformStore slot
+        std::vector<BvhSlotRef> mBvhDirtySlots;
+        bool mBvhTopologyDirty = true;
+        uint32_t mTransformCallback;
+
+        bool isBvhTopologyValid() const;
+        void buildBvh();
+        void onTransformsChanged(const std::vector<uint32_t>& ids);
+
         using string_uservar_map = std::map<const std::string, UserVariable>;
         string_uservar_map mUserVars;
         static const UserVariable kInvalidVar;
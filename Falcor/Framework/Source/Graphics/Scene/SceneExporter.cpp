@@ -217,6 +217,10 @@ namespace Falcor
         addVector(jsonLight, allocator, SceneKeys::kLightDirection, pLight->getWorldDirection());
         addLiteral(jsonLight, allocator, SceneKeys::kLightOpeningAngle, glm::degrees(pLight->getOpeningAngle()));
         addLiteral(jsonLight, allocator, SceneKeys::kLightPenumbraAngle, glm::degrees(pLight->getPenumbraAngle()));
+        if (pLight->getRange() > 0)
+        {
+            addLiteral(jsonLight, allocator, SceneKeys::kLightRange, pLight->getRange());
+        }
     }
 
     void createDirectionalLightValue(const DirectionalLight* pLight, rapidjson::Document::AllocatorType& allocator, rapidjson::Value& jsonLight)
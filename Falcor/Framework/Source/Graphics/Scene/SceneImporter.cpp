@@ -177,6 +177,27 @@ namespace Falcor
         return true;
     }
 
+    static std::string getModelFilename(const std::string& directory, const std::string& filename)
+    {
+        std::string file = directory + '/' + filename;
+        if (doesFileExist(file) == false)
+        {
+            file = filename;
+        }
+        return file;
+    }
+
+    static bool findIncludeFile(const std::string& directory, const std::string& include, std::string& fullpath)
+    {
+        fullpath = directory + '/' + include;
+        if(doesFileExist(fullpath) == false)
+        {
+            // Look in the data directories
+            return findFileInDataDirectories(include, fullpath);
+        }
+        return true;
+    }
+
     bool SceneImporter::createModel(const rapidjson::Value& jsonModel)
     {
         // Model must have at least a filename
@@ -191,12 +212,18 @@ namespace Falcor
         }
 
         // Load the model
-        std::string file =  mDirectory + '/' + modelFile.GetString();
-        if (doesFileExist(file) == false)
+        std::string file = getModelFilename(mDirectory, modelFile.GetString());
+        Model::SharedPtr pModel;
+        auto preloaded = mpPreloadedModels->find(file);
+        if(preloaded != mpPreloadedModels->end() && preloaded->second.empty() == false)
+        {
+            pModel = preloaded->second.front();
+            preloaded->second.pop_front();
+        }
+        else
         {
-            file = modelFile.GetString();
+            pModel = Model::createFromFile(file.c_str(), mModelLoadFlags);
         }
-        auto pModel = Model::createFromFile(file.c_str(), mModelLoadFlags);
         if(pModel == nullptr)
         {
             return error("Could not load model: " + file);
@@ -379,6 +406,14 @@ namespace Falcor
                 angle = glm::radians(angle);
                 pPointLight->setPenumbraAngle(angle);
             }
+            else if(key == SceneKeys::kLightRange)
+            {
+                if(value.IsNumber() == false)
+                {
+                    return error("Point light range should be a number");
+                }
+                pPointLight->setRange((float)value.GetDouble());
+            }
             else if(key == SceneKeys::kLightIntensity)
             {
                 glm::vec3 intensity;
@@ -889,6 +924,12 @@ namespace Falcor
                 return error(std::string("JSON Parse error in line ") + std::to_string(line) + ". " + rapidjson::GetParseError_En(mJDoc.GetParseError()));
             }
 
+            // The top-level file loads the models of the scene and its includes up-front, so that they are parsed concurrently
+            if(mpPreloadedModels == nullptr)
+            {
+                preloadModels();
+            }
+
             if(topLevelLoop() == false)
             {
                 return false;
@@ -1070,18 +1111,16 @@ namespace Falcor
     bool SceneImporter::loadIncludeFile(const std::string& include)
     {
         // Find the file
-        std::string fullpath = mDirectory + '/' + include;
-        if(doesFileExist(fullpath) == false)
+        std::string fullpath;
+        if(findIncludeFile(mDirectory, include, fullpath) == false)
         {
-            // Look in the data directories
-            if(findFileInDataDirectories(include, fullpath) == false)
-            {
-                return error("Can't find include file " + include);
-            }
+            return error("Can't find include file " + include);
         }
 
         Scene::SharedPtr pScene = Scene::create();
-        SceneImporter::loadScene(*pScene, fullpath, mModelLoadFlags, mSceneLoadFlags);
+        SceneImporter importer(*pScene);
+        importer.mpPreloadedModels = mpPreloadedModels;
+        importer.load(fullpath, mModelLoadFlags, mSceneLoadFlags);
         if(pScene == nullptr)
         {
             return false;
@@ -1091,6 +1130,61 @@ namespace Falcor
         return true;
     }
 
+    void SceneImporter::collectModelFiles(const rapidjson::Value& jsonRoot, const std::string& directory, std::vector<std::string>& filenames) const
+    {
+        // Malformed entries are skipped here, they are reported when the scene is parsed
+        if(jsonRoot.IsObject() == false) return;
+
+        // Models are parsed before includes, so collect them in the same order
+        const auto& models = jsonRoot.FindMember(SceneKeys::kModels);
+        if(models != jsonRoot.MemberEnd() && models->value.IsArray())
+        {
+            for(uint32_t i = 0; i < models->value.Size(); i++)
+            {
+                const auto& jsonModel = models->value[i];
+                if(jsonModel.IsObject() && jsonModel.HasMember(SceneKeys::kFilename) && jsonModel[SceneKeys::kFilename].IsString())
+                {
+                    filenames.push_back(getModelFilename(directory, jsonModel[SceneKeys::kFilename].GetString()));
+                }
+            }
+        }
+
+        const auto& includes = jsonRoot.FindMember(SceneKeys::kInclude);
+        if(includes != jsonRoot.MemberEnd() && includes->value.IsArray())
+        {
+            for(uint32_t i = 0; i < includes->value.Size(); i++)
+            {
+                std::string fullpath;
+                if(includes->value[i].IsString() == false || findIncludeFile(directory, includes->value[i].GetString(), fullpath) == false) continue;
+
+                std::ifstream fileStream(fullpath);
+                std::stringstream strStream;
+                strStream << fileStream.rdbuf();
+                std::string jsonData = strStream.str();
+
+                rapidjson::Document jsonDoc;
+                jsonDoc.Parse(jsonData.c_str());
+                if(jsonDoc.HasParseError()) continue;
+
+                auto last = fullpath.find_last_of("/\\");
+                collectModelFiles(jsonDoc, fullpath.substr(0, last), filenames);
+            }
+        }
+    }
+
+    void SceneImporter::preloadModels()
+    {
+        std::vector<std::string> filenames;
+        collectModelFiles(mJDoc, mDirectory, filenames);
+        std::vector<Model::SharedPtr> models = Model::createFromFiles(filenames, mModelLoadFlags);
+
+        mpPreloadedModels = std::make_shared<ModelQueueMap>();
+        for(size_t i = 0; i < filenames.size(); i++)
+        {
+            (*mpPreloadedModels)[filenames[i]].push_back(models[i]);
+        }
+    }
+
     bool SceneImporter::parseIncludes(const rapidjson::Value& jsonVal)
     {
         if(jsonVal.IsArray() == false)
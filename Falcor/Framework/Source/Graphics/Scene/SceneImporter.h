@@ -26,6 +26,8 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include <deque>
+#include <memory>
 #include <string>
 #include "Externals/RapidJson/include/rapidjson/document.h"
 #include "Graphics/Material/Material.h"
@@ -64,6 +66,9 @@ namespace Falcor
 
         bool loadIncludeFile(const std::string& Include);
 
+        void preloadModels();
+        void collectModelFiles(const rapidjson::Value& jsonRoot, const std::string& directory, std::vector<std::string>& filenames) const;
+
         bool createModel(const rapidjson::Value& jsonModel);
         bool createModelInstances(const rapidjson::Value& jsonVal, const Model::SharedPtr& pModel);
         bool createPointLight(const rapidjson::Value& jsonLight);
@@ -92,6 +97,10 @@ namespace Falcor
         ObjectMap mCameraMap;
         ObjectMap mLightMap;
 
+        // Models loaded before parsing the scene, in the order they are referenced by the scene file and its includes. Shared with the include importers
+        using ModelQueueMap = std::map<std::string, std::deque<Model::SharedPtr>>;
+        std::shared_ptr<ModelQueueMap> mpPreloadedModels;
+
         struct FuncValue
         {
             const std::string token;
@@ -39,17 +39,18 @@
 
 namespace Falcor
 {
-    size_t SceneRenderer::sBonesOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sBonesInvTransposeOffset = ConstantBuffer::kInvalidOffset;
+    ConstantBuffer::VariableHandle<glm::mat4> SceneRenderer::sBonesVar;
+    ConstantBuffer::VariableHandle<glm::mat4> SceneRenderer::sBonesInvTransposeVar;
     size_t SceneRenderer::sCameraDataOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sWorldMatArraySize = 0;
-    size_t SceneRenderer::sWorldMatOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sPrevWorldMatOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sWorldInvTransposeMatOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sMeshIdOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sDrawIDOffset = ConstantBuffer::kInvalidOffset;
-    size_t SceneRenderer::sLightCountOffset = ConstantBuffer::kInvalidOffset;
+    ConstantBuffer::VariableHandle<uint32_t> SceneRenderer::sLightCountVar;
     size_t SceneRenderer::sLightArrayOffset = ConstantBuffer::kInvalidOffset;
+    ConstantBuffer::VariableHandle<glm::mat4> SceneRenderer::sWorldMatVar;
+    ConstantBuffer::VariableHandle<glm::mat4> SceneRenderer::sPrevWorldMatVar;
+    ConstantBuffer::VariableHandle<glm::mat3x4> SceneRenderer::sWorldInvTransposeMatVar;
+    ConstantBuffer::VariableHandle<uint32_t> SceneRenderer::sMeshIdVar;
+    ConstantBuffer::VariableHandle<uint32_t> SceneRenderer::sDrawIdVar;
+    ConstantBuffer::VariableHandle<glm::vec3> SceneRenderer::sPositionScaleVar;
+    ConstantBuffer::VariableHandle<glm::vec3> SceneRenderer::sPositionOffsetVar;
 
     const char* SceneRenderer::kPerMaterialCbName = "InternalPerMaterialCB";
     const char* SceneRenderer::kPerFrameCbName = "InternalPerFrameCB";
@@ -73,25 +74,29 @@ namespace Falcor
     void SceneRenderer::updateVariableOffsets(const ProgramReflection* pReflector)
     {
         const ParameterBlockReflection* pBlock = pReflector->getDefaultParameterBlock().get();
-        if (sWorldMatOffset == ConstantBuffer::kInvalidOffset)
+        if (sWorldMatVar.isValid() == false)
         {
             const ReflectionVar* pVar = pBlock->getResource(kPerMeshCbName).get();
             assert(pVar->getType()->asResourceType()->getType() == ReflectionResourceType::Type::ConstantBuffer);
 
             if (pVar != nullptr)
             {
-                const ReflectionType* pType = pVar->getType().get();
+                const ReflectionResourceType* pType = pVar->getType()->asResourceType();
 
                 assert(pType->findMember("gWorldMat[0]")->getType()->asBasicType()->isRowMajor() == false); // We copy into CBs as column-major
                 assert(pType->findMember("gWorldInvTransposeMat[0]")->getType()->asBasicType()->isRowMajor() == false);
                 assert(pType->findMember("gWorldMat")->getType()->getTotalArraySize() == pType->findMember("gWorldInvTransposeMat")->getType()->getTotalArraySize());
 
-                sWorldMatArraySize = pType->findMember("gWorldMat")->getType()->getTotalArraySize();
-                sWorldMatOffset = pType->findMember("gWorldMat[0]")->getOffset();
-                sWorldInvTransposeMatOffset = pType->findMember("gWorldInvTransposeMat[0]")->getOffset();
-                sMeshIdOffset = pType->findMember("gMeshId")->getOffset();
-                sDrawIDOffset = pType->findMember("gDrawId[0]")->getOffset();
-                sPrevWorldMatOffset = pType->findMember("gPrevWorldMat[0]")->getOffset();
+                sWorldMatVar = ConstantBuffer::getVariableHandle<glm::mat4>(pType, "gWorldMat");
+                sWorldInvTransposeMatVar = ConstantBuffer::getVariableHandle<glm::mat3x4>(pType, "gWorldInvTransposeMat"); // HLSL uses column-major and packing rules require 16B alignment, hence use glm:mat3x4
+                sPrevWorldMatVar = ConstantBuffer::getVariableHandle<glm::mat4>(pType, "gPrevWorldMat");
+                sMeshIdVar = ConstantBuffer::getVariableHandle<uint32_t>(pType, "gMeshId");
+                sDrawIdVar = ConstantBuffer::getVariableHandle<uint32_t>(pType, "gDrawId");
+                if (pType->findMember("gPositionScale"))
+                {
+                    sPositionScaleVar = ConstantBuffer::getVariableHandle<glm::vec3>(pType, "gPositionScale");
+                    sPositionOffsetVar = ConstantBuffer::getVariableHandle<glm::vec3>(pType, "gPositionOffset");
+                }
             }
         }
 
@@ -102,18 +107,33 @@ namespace Falcor
             if (pVar != nullptr)
             {
                 assert(pVar->getType()->asResourceType()->getType() == ReflectionResourceType::Type::ConstantBuffer);
-                const ReflectionType* pType = pVar->getType().get();
+                const ReflectionResourceType* pType = pVar->getType()->asResourceType();
                 sCameraDataOffset = pType->findMember("gCamera.viewMat")->getOffset();
-                const auto& pCountOffset = pType->findMember("gLightsCount");
-                sLightCountOffset = pCountOffset ? pCountOffset->getOffset() : ConstantBuffer::kInvalidOffset;
+                if (pType->findMember("gLightsCount"))
+                {
+                    sLightCountVar = ConstantBuffer::getVariableHandle<uint32_t>(pType, "gLightsCount");
+                }
                 const auto& pLightOffset = pType->findMember("gLights");
                 sLightArrayOffset = pLightOffset ? pLightOffset->getOffset() : ConstantBuffer::kInvalidOffset;
             }
         }
+
+        if (sBonesVar.isValid() == false)
+        {
+            const ReflectionVar* pVar = pBlock->getResource(kBoneCbName).get();
+
+            if (pVar != nullptr)
+            {
+                const ReflectionResourceType* pType = pVar->getType()->asResourceType();
+                sBonesVar = ConstantBuffer::getVariableHandle<glm::mat4>(pType, "gBoneMat");
+                sBonesInvTransposeVar = ConstantBuffer::getVariableHandle<glm::mat4>(pType, "gInvTransposeBoneMat");
+            }
+        }
     }
 
     void SceneRenderer::setPerFrameData(const CurrentWorkingData& currentData)
     {
+        const bool useLightClusters = mLightClustersEnabled && currentData.pCamera && LightClusters::isUsedBy(currentData.pVars->getReflection().get());
         ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kPerFrameCbName).get();
         if (pCB)
         {
@@ -123,18 +143,23 @@ namespace Falcor
                 currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
             }
 
-            // Set lights
+            // Set lights. The array only holds MAX_LIGHT_SOURCES lights, programs which need more should use the light clusters.
+            const uint32_t lightCount = std::min(mpScene->getLightCount(), (uint32_t)MAX_LIGHT_SOURCES);
             if (sLightArrayOffset != ConstantBuffer::kInvalidOffset)
             {
-                assert(mpScene->getLightCount() <= MAX_LIGHT_SOURCES);  // Max array size in the shader
-                for (uint_t i = 0; i < mpScene->getLightCount(); i++)
+                if (mpScene->getLightCount() > MAX_LIGHT_SOURCES && useLightClusters == false && mLightCountWarned == false)
+                {
+                    logWarning("SceneRenderer: the scene has " + std::to_string(mpScene->getLightCount()) + " lights, only the first " + std::to_string(MAX_LIGHT_SOURCES) + " are bound to gLights. Use ShadingUtils/LightClusters.slang to shade with all of them.");
+                    mLightCountWarned = true;
+                }
+                for (uint_t i = 0; i < lightCount; i++)
                 {
                     mpScene->getLight(i)->setIntoProgramVars(currentData.pVars, pCB, sLightArrayOffset + (i * Light::getShaderStructSize()));
                 }
             }
-            if (sLightCountOffset != ConstantBuffer::kInvalidOffset)
+            if (sLightCountVar.isValid())
             {
-                pCB->setVariable(sLightCountOffset, mpScene->getLightCount());
+                pCB->setVariable(sLightCountVar, lightCount);
             }
             if (mpScene->getLightProbeCount() > 0)
             {
@@ -144,6 +169,16 @@ namespace Falcor
             }
         }
 
+        if (useLightClusters)
+        {
+            if (mpLightClusters == nullptr)
+            {
+                mpLightClusters = LightClusters::create();
+            }
+            mpLightClusters->update(mpScene.get(), currentData.pCamera);
+            mpLightClusters->setIntoProgramVars(currentData.pVars);
+        }
+
         if (mpScene->getAreaLightCount() > 0)
         {
             const ParameterBlockReflection* pBlock = currentData.pVars->getReflection()->getDefaultParameterBlock().get();
@@ -175,15 +210,15 @@ namespace Falcor
             ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kBoneCbName).get();
             if (pCB != nullptr)
             {
-                if (sBonesOffset == ConstantBuffer::kInvalidOffset || sBonesInvTransposeOffset == ConstantBuffer::kInvalidOffset)
+                if (sBonesVar.isValid() == false || sBonesInvTransposeVar.isValid() == false)
                 {
-                    sBonesOffset = pCB->getVariableOffset("gBoneMat[0]");
-                    sBonesInvTransposeOffset = pCB->getVariableOffset("gInvTransposeBoneMat[0]");
+                    sBonesVar = pCB->getVariableHandle<glm::mat4>("gBoneMat");
+                    sBonesInvTransposeVar = pCB->getVariableHandle<glm::mat4>("gInvTransposeBoneMat");
                 }
 
                 assert(pModel->getBoneCount() <= MAX_BONES);
-                pCB->setVariableArray(sBonesOffset, pModel->getBoneMatrices(), pModel->getBoneCount());
-                pCB->setVariableArray(sBonesInvTransposeOffset, pModel->getBoneInvTransposeMatrices(), pModel->getBoneCount());
+                pCB->setVariableArray(sBonesVar, pModel->getBoneMatrices(), pModel->getBoneCount());
+                pCB->setVariableArray(sBonesInvTransposeVar, pModel->getBoneInvTransposeMatrices(), pModel->getBoneCount());
             }
         }
         return true;
@@ -217,31 +252,70 @@ namespace Falcor
 
             glm::mat3x4 worldInvTransposeMat = transpose(inverse(glm::mat3(worldMat)));
 
-            assert(drawInstanceID < sWorldMatArraySize);
-            pCB->setBlob(&worldMat, sWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
-            pCB->setBlob(&worldInvTransposeMat, sWorldInvTransposeMatOffset + drawInstanceID * sizeof(glm::mat3x4), sizeof(glm::mat3x4)); // HLSL uses column-major and packing rules require 16B alignment, hence use glm:mat3x4
-            pCB->setBlob(&prevWorldMat, sPrevWorldMatOffset + drawInstanceID * sizeof(glm::mat4), sizeof(glm::mat4));
+            assert(drawInstanceID < sWorldMatVar.arraySize);
+            pCB->setVariable(sWorldMatVar, drawInstanceID, worldMat);
+            pCB->setVariable(sWorldInvTransposeMatVar, drawInstanceID, worldInvTransposeMat);
+            pCB->setVariable(sPrevWorldMatVar, drawInstanceID, prevWorldMat);
 
             // Set mesh id
-            pCB->setVariable(sMeshIdOffset, pMesh->getId());
+            pCB->setVariable(sMeshIdVar, pMesh->getId());
         }
 
         return true;
     }
 
+    void SceneRenderer::setPositionQuantization(const CurrentWorkingData& currentData, const Mesh* pMesh)
+    {
+        // Programs which don't read quantized positions don't declare the constants
+        if (sPositionScaleVar.isValid() == false) return;
+
+        ConstantBuffer* pCB = currentData.pVars->getConstantBuffer(kPerMeshCbName).get();
+        if (pCB)
+        {
+            pCB->setVariable(sPositionScaleVar, pMesh->getPositionScale());
+            pCB->setVariable(sPositionOffsetVar, pMesh->getPositionOffset());
+        }
+    }
+
     bool SceneRenderer::setPerMaterialData(const CurrentWorkingData& currentData, const Material* pMaterial)
     {
         currentData.pVars->setParameterBlock("gMaterial", pMaterial->getParameterBlock());
         return true;
     }
 
-    void SceneRenderer::executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount)
+    void SceneRenderer::executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex)
     {
         // Draw
-        currentData.pContext->drawIndexedInstanced(indexCount, instanceCount, 0, 0, 0);
+        currentData.pContext->drawIndexedInstanced(indexCount, instanceCount, startIndex, 0, 0);
     }
 
-    void SceneRenderer::draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount)
+    uint32_t SceneRenderer::selectLod(const CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t boundsIndex)
+    {
+        if (mLodEnabled == false || pMesh->getLodCount() == 1 || currentData.pCamera == nullptr)
+        {
+            return 0;
+        }
+
+        // The LOD errors are relative to the mesh's half-diagonal. The half-diagonal of the instance's world-space box is at least as long, which keeps the estimate conservative.
+        const BoundingBox& box = mpScene->getBvh()->getBox(boundsIndex);
+        const float radius = glm::length(box.extent);
+        const float distance = glm::length(box.center - currentData.pCamera->getPosition()) - radius;
+        if (distance <= currentData.pCamera->getNearPlane())
+        {
+            return 0;
+        }
+
+        // Projected size of the half-diagonal, as a fraction of the viewport height
+        const float screenSize = radius * currentData.pCamera->getProjMatrix()[1][1] * 0.5f / distance;
+        uint32_t lod = 0;
+        while ((lod + 1 < pMesh->getLodCount()) && (pMesh->getLod(lod + 1).error * screenSize <= mLodErrorThreshold))
+        {
+            lod++;
+        }
+        return lod;
+    }
+
+    bool SceneRenderer::bindMaterial(CurrentWorkingData& currentData, const Mesh* pMesh)
     {
         currentData.pMaterial = pMesh->getMaterial().get();
         // Bind material
@@ -249,19 +323,90 @@ namespace Falcor
         {
             if (setPerMaterialData(currentData, currentData.pMaterial) == false)
             {
-                return;
+                return false;
             }
             mpLastMaterial = pMesh->getMaterial().get();
+            mStats.materialChanges++;
 
             if(mCompileMaterialWithProgram)
             {
-                currentData.pState->getProgram()->addDefine("_MS_STATIC_MATERIAL_FLAGS", std::to_string(mpLastMaterial->getFlags()));
+                mStats.programChanges += currentData.pState->getProgram()->addDefine("_MS_STATIC_MATERIAL_FLAGS", std::to_string(mpLastMaterial->getFlags())) ? 1 : 0;
             }
         }
+        return true;
+    }
 
-        executeDraw(currentData, pMesh->getIndexCount(), instanceCount);
+    void SceneRenderer::draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t lod, uint32_t instanceCount)
+    {
+        if (bindMaterial(currentData, pMesh) == false)
+        {
+            return;
+        }
+
+        const Mesh::Lod& level = pMesh->getLod(lod);
+        executeDraw(currentData, level.indexCount, instanceCount, level.firstIndex);
         postFlushDraw(currentData);
-        currentData.pState->getProgram()->removeDefine("_MS_STATIC_MATERIAL_FLAGS");
+        mStats.drawCalls++;
+        mStats.instances += instanceCount;
+        mStats.indices += level.indexCount * instanceCount;
+        mStats.programChanges += currentData.pState->getProgram()->removeDefine("_MS_STATIC_MATERIAL_FLAGS") ? 1 : 0;
+    }
+
+    SceneRenderer::ClusterVisibility SceneRenderer::cullClusters(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t lod)
+    {
+        // Skinned meshes move away from their bind-pose bounds, and the meshlets only cover the full-detail mesh
+        const Mesh* pMesh = pMeshInstance->getObject().get();
+        const uint32_t meshletCount = pMesh->getMeshletCount();
+        if (mClusterCullEnabled == false || meshletCount == 0 || lod != 0 || pMesh->hasBones() || currentData.pCamera == nullptr)
+        {
+            return ClusterVisibility::All;
+        }
+
+        // Back-facing meshlets can only be skipped if the rasterizer would cull their triangles anyway
+        const RasterizerState* pRastState = currentData.pState->getRasterizerState().get();
+        const bool cullBackfaces = (pMesh->getMaterial()->getDoubleSided() == false) && pRastState &&
+            (pRastState->getCullMode() == RasterizerState::CullMode::Back) && pRastState->isFrontCounterCW();
+
+        const glm::mat4 worldMat = pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
+        pMesh->cullMeshlets(currentData.pCamera, worldMat, cullBackfaces, mVisibleMeshlets);
+        mStats.clustersCulled += meshletCount - (uint32_t)mVisibleMeshlets.size();
+
+        if (mVisibleMeshlets.empty())
+        {
+            return ClusterVisibility::None;
+        }
+        if (mVisibleMeshlets.size() == meshletCount)
+        {
+            return ClusterVisibility::All;
+        }
+
+        // The meshlets are contiguous in the index buffer, so consecutive visible meshlets merge into a single range
+        mClusterRanges.clear();
+        for (uint32_t meshletID : mVisibleMeshlets)
+        {
+            const Mesh::Meshlet& meshlet = pMesh->getMeshlet(meshletID);
+            if (mClusterRanges.empty() == false && mClusterRanges.back().firstIndex + mClusterRanges.back().indexCount == meshlet.firstIndex)
+            {
+                mClusterRanges.back().indexCount += meshlet.triangleCount * 3;
+            }
+            else
+            {
+                mClusterRanges.push_back({ meshlet.firstIndex, meshlet.triangleCount * 3 });
+            }
+        }
+        return ClusterVisibility::Partial;
+    }
+
+    void SceneRenderer::drawClusters(CurrentWorkingData& currentData)
+    {
+        for (const IndexRange& range : mClusterRanges)
+        {
+            executeDraw(currentData, range.indexCount, 1, range.firstIndex);
+            postFlushDraw(currentData);
+            mStats.drawCalls++;
+            mStats.indices += range.indexCount;
+        }
+        mStats.instances++;
     }
 
     void SceneRenderer::postFlushDraw(const CurrentWorkingData& currentData)
@@ -269,16 +414,17 @@ namespace Falcor
 
     }
 
-    bool SceneRenderer::cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance)
+    void SceneRenderer::cullScene(const Camera* pCamera)
     {
-        BoundingBox box = pMeshInstance->getBoundingBox().transform(pModelInstance->getTransformMatrix());
-        return currentData.pCamera->isObjectCulled(box);
+        mpScene->getBvh()->cull(pCamera, mVisibilityMask);
     }
 
     void SceneRenderer::renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID)
     {
         const Model* pModel = currentData.pModel;
         const Mesh* pMesh = pModel->getMesh(meshID).get();
+        const uint32_t firstBoundsIndex = currentData.boundsIndex;
+        currentData.boundsIndex += pModel->getMeshInstanceCount(meshID);
 
         if (setPerMeshData(currentData, pMesh))
         {
@@ -287,12 +433,16 @@ namespace Falcor
             if (useVsSkinning)
             {
                 pProgram->addDefine("_VERTEX_BLENDING");
+                mStats.programChanges++;
             }
 
             // Bind VAO and set topology            
             currentData.pState->setVao(useVsSkinning ? pMesh->getVao() : pModel->getMeshVao(pMesh));
+            setPositionQuantization(currentData, pMesh);
+            mStats.vaoChanges++;
 
             uint32_t activeInstances = 0;
+            uint32_t activeLod = 0;
 
             const uint32_t instanceCount = pModel->getMeshInstanceCount(meshID);
             for (uint32_t instanceID = 0; instanceID < instanceCount; instanceID++)
@@ -301,8 +451,39 @@ namespace Falcor
 
                 if (pMeshInstance->isVisible())
                 {
-                    if ((mCullEnabled == false) || (cullMeshInstance(currentData, pModelInstance, pMeshInstance) == false))
+                    if ((mCullEnabled == false) || Camera::isVisible(mVisibilityMask, firstBoundsIndex + instanceID))
                     {
+                        // Instances are batched per level of detail
+                        uint32_t lod = selectLod(currentData, pMesh, firstBoundsIndex + instanceID);
+                        if (activeInstances != 0 && lod != activeLod)
+                        {
+                            draw(currentData, pMesh, activeLod, activeInstances);
+                            activeInstances = 0;
+                        }
+                        activeLod = lod;
+
+                        // Partially visible instances are drawn on their own, one draw per range of visible meshlets
+                        ClusterVisibility clusterVisibility = cullClusters(currentData, pModelInstance, pMeshInstance, lod);
+                        if (clusterVisibility == ClusterVisibility::None)
+                        {
+                            continue;
+                        }
+                        if (clusterVisibility == ClusterVisibility::Partial)
+                        {
+                            if (activeInstances != 0)
+                            {
+                                draw(currentData, pMesh, activeLod, activeInstances);
+                                activeInstances = 0;
+                            }
+                            if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, 0) && bindMaterial(currentData, pMesh))
+                            {
+                                currentData.drawID++;
+                                drawClusters(currentData);
+                                mStats.programChanges += pProgram->removeDefine("_MS_STATIC_MATERIAL_FLAGS") ? 1 : 0;
+                            }
+                            continue;
+                        }
+
                         if (setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, activeInstances))
                         {
                             currentData.drawID++;
@@ -312,7 +493,7 @@ namespace Falcor
                             {
                                 // DISABLED_FOR_D3D12
                                 //pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-                                draw(currentData, pMesh, activeInstances);
+                                draw(currentData, pMesh, activeLod, activeInstances);
                                 activeInstances = 0;
                             }
                         }
@@ -321,13 +502,14 @@ namespace Falcor
             }
             if(activeInstances != 0)
             {
-                draw(currentData, pMesh, activeInstances);
+                draw(currentData, pMesh, activeLod, activeInstances);
             }
 
             // Restore the program state
             if (useVsSkinning)
             {
                 pProgram->removeDefine("_VERTEX_BLENDING");
+                mStats.programChanges++;
             }
         }
     }
@@ -343,6 +525,279 @@ namespace Falcor
         }
     }
 
+    /** Sort the keys in ascending order using an LSD radix sort on 8-bit digits, reordering the values with them.
+        Passes where all the keys share the same digit are skipped, which is the common case for the unused key bits.
+    */
+    static void radixSort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, std::vector<uint64_t>& keysScratch, std::vector<uint32_t>& valuesScratch)
+    {
+        const size_t count = keys.size();
+        if (count < 2)
+        {
+            return;
+        }
+
+        keysScratch.resize(count);
+        valuesScratch.resize(count);
+
+        for (uint32_t shift = 0; shift < 64; shift += 8)
+        {
+            size_t histogram[256] = {};
+            for (size_t i = 0; i < count; i++)
+            {
+                histogram[(keys[i] >> shift) & 0xFF]++;
+            }
+
+            if (histogram[(keys[0] >> shift) & 0xFF] == count)
+            {
+                continue;
+            }
+
+            size_t offset = 0;
+            for (uint32_t digit = 0; digit < 256; digit++)
+            {
+                size_t digitCount = histogram[digit];
+                histogram[digit] = offset;
+                offset += digitCount;
+            }
+
+            for (size_t i = 0; i < count; i++)
+            {
+                size_t dst = histogram[(keys[i] >> shift) & 0xFF]++;
+                keysScratch[dst] = keys[i];
+                valuesScratch[dst] = values[i];
+            }
+
+            keys.swap(keysScratch);
+            values.swap(valuesScratch);
+        }
+    }
+
+    // Render queue sort key layout, from the most significant bit: program variant (1), material (15), VAO (20), LOD (4), depth bucket (16), unused (8)
+    static const uint32_t kKeyVariantShift = 63;
+    static const uint32_t kKeyMaterialShift = 48;
+    static const uint32_t kKeyVaoShift = 28;
+    static const uint32_t kKeyLodShift = 24;
+    static const uint32_t kKeyDepthShift = 8;
+    static const uint64_t kKeyMaterialMask = 0x7FFF;
+    static const uint64_t kKeyVaoMask = 0xFFFFF;
+    static const uint64_t kKeyLodMask = 0xF;
+    static const float kKeyDepthRange = 65535.0f;
+
+    void SceneRenderer::buildRenderQueue(const CurrentWorkingData& currentData)
+    {
+        mRenderQueue.clear();
+        mQueueKeys.clear();
+        mQueueOrder.clear();
+
+        const BoundingVolumeHierarchy* pBvh = mpScene->getBvh();
+        const glm::vec3 cameraPos = currentData.pCamera ? currentData.pCamera->getPosition() : glm::vec3(0);
+        const float depthScale = currentData.pCamera ? kKeyDepthRange / currentData.pCamera->getFarPlane() : 0.0f;
+
+        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = mpScene->getModel(modelID).get();
+
+            for (uint32_t instanceID = 0; instanceID < mpScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const Scene::ModelInstance* pInstance = mpScene->getModelInstance(modelID, instanceID).get();
+                if (pInstance->isVisible() == false)
+                {
+                    continue;
+                }
+
+                uint32_t boundsIndex = mpScene->getBvhFirstBox(modelID, instanceID);
+                for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    const Mesh* pMesh = pModel->getMesh(meshID).get();
+                    const uint32_t meshInstanceCount = pModel->getMeshInstanceCount(meshID);
+                    const bool useVsSkinning = pMesh->hasBones() && !pModel->getSkinningCache();
+
+                    // Meshes are owned by a single model, so the mesh ID also identifies the VAO
+                    const uint64_t meshKey = ((useVsSkinning ? 1ull : 0ull) << kKeyVariantShift) |
+                        (((uint64_t)pMesh->getMaterial()->getId() & kKeyMaterialMask) << kKeyMaterialShift) |
+                        (((uint64_t)pMesh->getId() & kKeyVaoMask) << kKeyVaoShift);
+
+                    for (uint32_t meshInstanceID = 0; meshInstanceID < meshInstanceCount; meshInstanceID++, boundsIndex++)
+                    {
+                        const Model::MeshInstance* pMeshInstance = pModel->getMeshInstance(meshID, meshInstanceID).get();
+                        if (pMeshInstance->isVisible() == false || (mCullEnabled && Camera::isVisible(mVisibilityMask, boundsIndex) == false))
+                        {
+                            continue;
+                        }
+
+                        // Front-to-back inside a batch
+                        float distance = glm::length(pBvh->getBox(boundsIndex).center - cameraPos);
+                        uint64_t depthBucket = (uint64_t)glm::clamp(distance * depthScale, 0.0f, kKeyDepthRange);
+
+                        uint32_t lod = selectLod(currentData, pMesh, boundsIndex);
+
+                        mQueueKeys.push_back(meshKey | (((uint64_t)lod & kKeyLodMask) << kKeyLodShift) | (depthBucket << kKeyDepthShift));
+                        mQueueOrder.push_back((uint32_t)mRenderQueue.size());
+                        mRenderQueue.push_back({ pModel, pInstance, pMeshInstance, instanceID, lod });
+                    }
+                }
+            }
+        }
+
+        radixSort(mQueueKeys, mQueueOrder, mQueueKeysScratch, mQueueOrderScratch);
+    }
+
+    void SceneRenderer::flushQueue(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t lod, uint32_t& instanceCount)
+    {
+        if (instanceCount == 0)
+        {
+            return;
+        }
+
+        const Mesh::Lod& level = pMesh->getLod(lod);
+        executeDraw(currentData, level.indexCount, instanceCount, level.firstIndex);
+        postFlushDraw(currentData);
+        mStats.drawCalls++;
+        mStats.instances += instanceCount;
+        mStats.indices += level.indexCount * instanceCount;
+        instanceCount = 0;
+    }
+
+    bool SceneRenderer::bindQueueMesh(CurrentWorkingData& currentData, const Mesh* pMesh)
+    {
+        if (setPerMeshData(currentData, pMesh) == false)
+        {
+            return false;
+        }
+
+        Program* pProgram = currentData.pState->getProgram().get();
+        const Model* pModel = currentData.pModel;
+        const bool useVsSkinning = pMesh->hasBones() && !pModel->getSkinningCache();
+        if (useVsSkinning != mQueueVertexBlending)
+        {
+            if (useVsSkinning)
+            {
+                pProgram->addDefine("_VERTEX_BLENDING");
+            }
+            else
+            {
+                pProgram->removeDefine("_VERTEX_BLENDING");
+            }
+            mQueueVertexBlending = useVsSkinning;
+            mStats.programChanges++;
+        }
+
+        const Vao::SharedPtr& pVao = useVsSkinning ? pMesh->getVao() : pModel->getMeshVao(pMesh);
+        if (pVao.get() != mpQueueVao)
+        {
+            currentData.pState->setVao(pVao);
+            mpQueueVao = pVao.get();
+            mStats.vaoChanges++;
+        }
+        setPositionQuantization(currentData, pMesh);
+
+        return bindMaterial(currentData, pMesh);
+    }
+
+    void SceneRenderer::renderQueue(CurrentWorkingData& currentData)
+    {
+        mpLastMaterial = nullptr;
+        mpQueueVao = nullptr;
+        mQueueVertexBlending = false;
+
+        const Scene::ModelInstance* pModelInstance = nullptr;
+        const Mesh* pMesh = nullptr;
+        bool modelValid = false;
+        bool instanceValid = false;
+        bool meshValid = false;
+        uint32_t lod = 0;
+        uint32_t activeInstances = 0;
+
+        for (uint32_t index : mQueueOrder)
+        {
+            const RenderQueueItem& item = mRenderQueue[index];
+            const Mesh* pItemMesh = item.pMeshInstance->getObject().get();
+            bool rebindMesh = (pItemMesh != pMesh);
+
+            if (item.pModel != currentData.pModel)
+            {
+                // Bones and skinned VAOs are per model, so skinned draws can't span models
+                if (pMesh && pMesh->hasBones())
+                {
+                    flushQueue(currentData, pMesh, lod, activeInstances);
+                    rebindMesh = true;
+                }
+                currentData.pModel = item.pModel;
+                modelValid = setPerModelData(currentData);
+                pModelInstance = nullptr;
+            }
+            if (modelValid == false)
+            {
+                continue;
+            }
+
+            if (item.pModelInstance != pModelInstance)
+            {
+                pModelInstance = item.pModelInstance;
+                instanceValid = setPerModelInstanceData(currentData, pModelInstance, item.instanceID);
+            }
+            if (instanceValid == false)
+            {
+                continue;
+            }
+
+            if (rebindMesh)
+            {
+                flushQueue(currentData, pMesh, lod, activeInstances);
+                pMesh = pItemMesh;
+                meshValid = bindQueueMesh(currentData, pMesh);
+            }
+            if (meshValid == false)
+            {
+                continue;
+            }
+
+            if (item.lod != lod)
+            {
+                flushQueue(currentData, pMesh, lod, activeInstances);
+                lod = item.lod;
+            }
+
+            // Partially visible instances are drawn on their own, one draw per range of visible meshlets
+            ClusterVisibility clusterVisibility = cullClusters(currentData, pModelInstance, item.pMeshInstance, lod);
+            if (clusterVisibility == ClusterVisibility::None)
+            {
+                continue;
+            }
+            if (clusterVisibility == ClusterVisibility::Partial)
+            {
+                flushQueue(currentData, pMesh, lod, activeInstances);
+                if (setPerMeshInstanceData(currentData, pModelInstance, item.pMeshInstance, 0))
+                {
+                    currentData.drawID++;
+                    drawClusters(currentData);
+                }
+                continue;
+            }
+
+            if (setPerMeshInstanceData(currentData, pModelInstance, item.pMeshInstance, activeInstances))
+            {
+                currentData.drawID++;
+                activeInstances++;
+
+                if (activeInstances == mMaxInstanceCount)
+                {
+                    flushQueue(currentData, pMesh, lod, activeInstances);
+                }
+            }
+        }
+        flushQueue(currentData, pMesh, lod, activeInstances);
+
+        // Restore the program state
+        Program* pProgram = currentData.pState->getProgram().get();
+        if (mQueueVertexBlending)
+        {
+            pProgram->removeDefine("_VERTEX_BLENDING");
+            mStats.programChanges++;
+        }
+        mStats.programChanges += pProgram->removeDefine("_MS_STATIC_MATERIAL_FLAGS") ? 1 : 0;
+    }
+
     bool SceneRenderer::update(double currentTime)
     {
         return mpScene->update(currentTime, mpCameraController.get());
@@ -355,8 +810,21 @@ namespace Falcor
 
     void SceneRenderer::renderScene(CurrentWorkingData& currentData)
     {
+        mStats = Stats();
         setPerFrameData(currentData);
 
+        if (mCullEnabled)
+        {
+            cullScene(currentData.pCamera);
+        }
+
+        if (mRenderQueueEnabled)
+        {
+            buildRenderQueue(currentData);
+            renderQueue(currentData);
+            return;
+        }
+
         for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
         {
             currentData.pModel = mpScene->getModel(modelID).get();
@@ -368,6 +836,7 @@ namespace Falcor
                     const auto pInstance = mpScene->getModelInstance(modelID, instanceID).get();
                     if (pInstance->isVisible())
                     {
+                        currentData.boundsIndex = mCullEnabled ? mpScene->getBvhFirstBox(modelID, instanceID) : 0;
                         if (setPerModelInstanceData(currentData, pInstance, instanceID))
                         {
                             renderModelInstance(currentData, pInstance);
@@ -33,6 +33,7 @@
 #include "Utils/CpuTimer.h"
 #include "API/ConstantBuffer.h"
 #include "Utils/DebugDrawer.h"
+#include "LightClusters.h"
 
 namespace Falcor
 {
@@ -100,6 +101,70 @@ namespace Falcor
 
         void toggleStaticMaterialCompilation(bool on) { mCompileMaterialWithProgram = on; }
 
+        /** Enable/disable the sorted render queue. When enabled, the visible mesh instances are sorted by program variant, material, VAO, level of detail and depth before drawing, and instances of the same mesh are merged into instanced draws across model instances.
+            Renderers which bind state in setPerModelInstanceData() should disable it, since a single draw can then span several model instances.
+        */
+        void toggleRenderQueue(bool enable) { mRenderQueueEnabled = enable; }
+
+        /** Check if the sorted render queue is enabled
+        */
+        bool isRenderQueueEnabled() const { return mRenderQueueEnabled; }
+
+        /** Enable/disable the selection of mesh levels of detail. When disabled, meshes are always drawn at full detail.
+        */
+        void toggleLods(bool enable) { mLodEnabled = enable; }
+
+        /** Check if the selection of mesh levels of detail is enabled
+        */
+        bool isLodEnabled() const { return mLodEnabled; }
+
+        /** Set the max geometric error of the selected levels of detail, as a fraction of the viewport height. The default of 0.001 is about a pixel at 1080p.
+        */
+        void setLodErrorThreshold(float threshold) { mLodErrorThreshold = threshold; }
+
+        /** Get the max geometric error of the selected levels of detail, as a fraction of the viewport height
+        */
+        float getLodErrorThreshold() const { return mLodErrorThreshold; }
+
+        /** Enable/disable cluster culling. When enabled, the meshlets of the meshes which have them (see Model::LoadFlags::GenerateMeshlets) are culled against the frustum and with their normal cones, and only the visible ones are drawn.
+            A partially visible mesh instance is drawn on its own, with one draw per range of consecutive visible meshlets. Skinned meshes and coarse levels of detail are not cluster culled.
+        */
+        void toggleClusterCulling(bool enable) { mClusterCullEnabled = enable; }
+
+        /** Check if cluster culling is enabled
+        */
+        bool isClusterCullingEnabled() const { return mClusterCullEnabled; }
+
+        /** Enable/disable clustered lighting. When enabled, the scene's lights are binned into LightClusters in every renderScene() call whose program imports ShadingUtils/LightClusters.slang.
+            Such programs aren't limited to MAX_LIGHT_SOURCES lights. Programs which don't import it are unaffected.
+        */
+        void toggleLightClusters(bool enable) { mLightClustersEnabled = enable; }
+
+        /** Check if clustered lighting is enabled
+        */
+        bool isLightClustersEnabled() const { return mLightClustersEnabled; }
+
+        /** Get the light clusters built by the last renderScene() call which used them. nullptr if no program used them yet.
+        */
+        const LightClusters::SharedPtr& getLightClusters() const { return mpLightClusters; }
+
+        /** Counters collected while rendering. Reset at the beginning of every renderScene() call.
+        */
+        struct Stats
+        {
+            uint32_t drawCalls = 0;         ///< Number of draw calls issued
+            uint32_t instances = 0;         ///< Number of mesh instances drawn
+            uint32_t indices = 0;           ///< Number of indices drawn, over all the instances
+            uint32_t clustersCulled = 0;    ///< Number of meshlets culled inside the visible mesh instances
+            uint32_t programChanges = 0;    ///< Number of program define changes (vertex blending and static material flags)
+            uint32_t vaoChanges = 0;        ///< Number of VAO binds
+            uint32_t materialChanges = 0;   ///< Number of material binds
+        };
+
+        /** Get the counters of the last renderScene() call
+        */
+        const Stats& getStats() const { return mStats; }
+
     protected:
 
         struct CurrentWorkingData
@@ -112,6 +177,7 @@ namespace Falcor
             const Material* pMaterial = nullptr;
 
             uint32_t drawID; // Zero-based mesh instance draw order/ID. Resets at the beginning of renderScene, and increments per mesh instance drawn.
+            uint32_t boundsIndex = 0; // Index of the current mesh instance in the scene's BVH
         };
 
         SceneRenderer(const Scene::SharedPtr& pScene);
@@ -125,17 +191,18 @@ namespace Falcor
         static const char* kProbeSharedVarName;
         static const char* kAreaLightCbName;
 
-        static size_t sBonesOffset;
-        static size_t sBonesInvTransposeOffset;
+        static ConstantBuffer::VariableHandle<glm::mat4> sBonesVar;
+        static ConstantBuffer::VariableHandle<glm::mat4> sBonesInvTransposeVar;
         static size_t sCameraDataOffset;
-        static size_t sLightCountOffset;
+        static ConstantBuffer::VariableHandle<uint32_t> sLightCountVar;
         static size_t sLightArrayOffset;
-        static size_t sWorldMatArraySize;
-        static size_t sWorldMatOffset;
-        static size_t sPrevWorldMatOffset;
-        static size_t sWorldInvTransposeMatOffset;
-        static size_t sMeshIdOffset;
-        static size_t sDrawIDOffset;
+        static ConstantBuffer::VariableHandle<glm::mat4> sWorldMatVar;
+        static ConstantBuffer::VariableHandle<glm::mat4> sPrevWorldMatVar;
+        static ConstantBuffer::VariableHandle<glm::mat3x4> sWorldInvTransposeMatVar;
+        static ConstantBuffer::VariableHandle<uint32_t> sMeshIdVar;
+        static ConstantBuffer::VariableHandle<uint32_t> sDrawIdVar;
+        static ConstantBuffer::VariableHandle<glm::vec3> sPositionScaleVar;
+        static ConstantBuffer::VariableHandle<glm::vec3> sPositionOffsetVar;
 
         static void updateVariableOffsets(const ProgramReflection* pReflector);
 
@@ -145,13 +212,64 @@ namespace Falcor
         virtual bool setPerMeshData(const CurrentWorkingData& currentData, const Mesh* pMesh);
         virtual bool setPerMeshInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t drawInstanceID);
         virtual bool setPerMaterialData(const CurrentWorkingData& currentData, const Material* pMaterial);
-        virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount);
+        virtual void executeDraw(const CurrentWorkingData& currentData, uint32_t indexCount, uint32_t instanceCount, uint32_t startIndex);
         virtual void postFlushDraw(const CurrentWorkingData& currentData);
-        virtual bool cullMeshInstance(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance);
+
+        /** Select the level of detail of a mesh instance. The default picks the coarsest level whose error, projected at the distance of the instance's bounding-box, is within the error threshold.
+            \param[in] currentData The current working data
+            \param[in] pMesh The mesh
+            \param[in] boundsIndex Index of the mesh instance in the scene's BVH
+            \return The level of detail to draw
+        */
+        virtual uint32_t selectLod(const CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t boundsIndex);
+
+        /** Cull all the mesh instances against the camera using the scene's BVH
+        */
+        void cullScene(const Camera* pCamera);
 
         void renderModelInstance(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance);
         void renderMeshInstances(CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, uint32_t meshID);
-        void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t instanceCount);
+        void draw(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t lod, uint32_t instanceCount);
+
+        /** Bind the material of a mesh if it changed. Returns false if the mesh should be skipped.
+        */
+        bool bindMaterial(CurrentWorkingData& currentData, const Mesh* pMesh);
+
+        /** Set the constants which dequantize the positions of the bound VAO. This is part of binding the VAO, so overrides of the setPer*Data() functions don't need to handle it.
+        */
+        void setPositionQuantization(const CurrentWorkingData& currentData, const Mesh* pMesh);
+
+        enum class ClusterVisibility
+        {
+            All,
+            Partial,
+            None
+        };
+
+        /** Cull the meshlets of a mesh instance, see Mesh::cullMeshlets(). If the instance is partially visible, the visible meshlets are merged into index ranges in mClusterRanges.
+            \return The visibility of the instance. All the meshlets are visible if cluster culling doesn't apply to the mesh.
+        */
+        ClusterVisibility cullClusters(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t lod);
+
+        /** Draw the index ranges in mClusterRanges for a single mesh instance. The mesh instance and material data must already be set.
+        */
+        void drawClusters(CurrentWorkingData& currentData);
+
+        /** Collect the visible mesh instances into the render queue and sort them
+        */
+        void buildRenderQueue(const CurrentWorkingData& currentData);
+
+        /** Draw the sorted render queue, changing state only when the sort key changes
+        */
+        void renderQueue(CurrentWorkingData& currentData);
+
+        /** Bind the VAO, program variant and material of a mesh for the render queue. Returns false if the mesh should be skipped.
+        */
+        bool bindQueueMesh(CurrentWorkingData& currentData, const Mesh* pMesh);
+
+        /** Issue an instanced draw for the queued mesh instances and reset the count
+        */
+        void flushQueue(CurrentWorkingData& currentData, const Mesh* pMesh, uint32_t lod, uint32_t& instanceCount);
 
         void renderScene(CurrentWorkingData& currentData);
 
@@ -161,6 +279,47 @@ namespace Falcor
         uint32_t mMaxInstanceCount = 64;
         const Material* mpLastMaterial = nullptr;
         bool mCullEnabled = true;
+
+        std::vector<uint32_t> mVisibilityMask;          // Visibility of the mesh instances, indexed by their box in the scene's BVH
         bool mCompileMaterialWithProgram = true;
+
+        bool mLodEnabled = true;
+        float mLodErrorThreshold = 0.001f;
+
+        struct IndexRange
+        {
+            uint32_t firstIndex;
+            uint32_t indexCount;
+        };
+
+        bool mClusterCullEnabled = true;
+        std::vector<uint32_t> mVisibleMeshlets;
+        std::vector<IndexRange> mClusterRanges;
+
+        struct RenderQueueItem
+        {
+            const Model* pModel;
+            const Scene::ModelInstance* pModelInstance;
+            const Model::MeshInstance* pMeshInstance;
+            uint32_t instanceID;
+            uint32_t lod;
+        };
+
+        bool mLightClustersEnabled = true;
+        LightClusters::SharedPtr mpLightClusters;
+        bool mLightCountWarned = false;                     // The warning about lights exceeding MAX_LIGHT_SOURCES is only logged once
+
+        bool mRenderQueueEnabled = true;
+        std::vector<RenderQueueItem> mRenderQueue;
+        std::vector<uint64_t> mQueueKeys;               // Sort keys, the values are indices into mRenderQueue
+        std::vector<uint32_t> mQueueOrder;
+        std::vector<uint64_t> mQueueKeysScratch;
+        std::vector<uint32_t> mQueueOrderScratch;
+
+        // Render queue state
+        bool mQueueVertexBlending = false;
+        const Vao* mpQueueVao = nullptr;
+
+        Stats mStats;
     };
 }
@@ -0,0 +1,276 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureCache.h"
+#include "Utils/Platform/OS.h"
+#include <algorithm>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+
+namespace Falcor
+{
+    namespace
+    {
+        struct CacheKey
+        {
+            std::string path;
+            Texture::BindFlags bindFlags;
+            bool generateMipLevels;
+            bool loadAsSrgb;
+
+            bool operator==(const CacheKey& other) const
+            {
+                return path == other.path && bindFlags == other.bindFlags && generateMipLevels == other.generateMipLevels && loadAsSrgb == other.loadAsSrgb;
+            }
+        };
+
+        struct CacheKeyHash
+        {
+            size_t operator()(const CacheKey& key) const
+            {
+                size_t flags = (size_t)key.bindFlags << 2 | (key.generateMipLevels ? 2 : 0) | (key.loadAsSrgb ? 1 : 0);
+                return std::hash<std::string>()(key.path) ^ (flags * 0x9e3779b97f4a7c15ull);
+            }
+        };
+
+        struct CacheEntry
+        {
+            std::weak_ptr<Texture> pTexture;
+            std::shared_future<Texture::SharedPtr> pending;     // Valid while a thread is loading the texture
+        };
+
+        // Released textures are pruned when the map grows past this size, after which it's set to twice the remaining size. The sweep is amortized over the insertions
+        static const size_t kMinPruneSize = 64;
+
+        struct CacheData
+        {
+            std::mutex mutex;
+            std::unordered_map<CacheKey, CacheEntry, CacheKeyHash> entries;
+            std::unordered_map<std::string, std::string> resolvedPaths;     // Maps the requested filename to the canonical path
+            size_t pruneSize = kMinPruneSize;
+            TextureCache::Stats stats;
+        };
+
+        // Expects the cache mutex to be locked
+        void pruneReleasedEntries(CacheData& cache)
+        {
+            for (auto it = cache.entries.begin(); it != cache.entries.end();)
+            {
+                bool released = it->second.pending.valid() == false && it->second.pTexture.expired();
+                it = released ? cache.entries.erase(it) : std::next(it);
+            }
+            cache.pruneSize = std::max(kMinPruneSize, cache.entries.size() * 2);
+        }
+
+        CacheData& getCacheData()
+        {
+            static CacheData data;
+            return data;
+        }
+
+        std::string resolvePath(CacheData& cache, const std::string& filename)
+        {
+            {
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                auto it = cache.resolvedPaths.find(filename);
+                if (it != cache.resolvedPaths.end()) return it->second;
+            }
+
+            // Files which can't be found are not remembered, they might be created later
+            std::string fullpath;
+            if (findFileInDataDirectories(filename, fullpath) == false) return filename;
+            fullpath = canonicalizeFilename(fullpath);
+
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            cache.resolvedPaths[filename] = fullpath;
+            return fullpath;
+        }
+
+        CacheKey createKey(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+        {
+            CacheKey key;
+            key.path = resolvePath(getCacheData(), filename);
+            key.bindFlags = bindFlags;
+            key.generateMipLevels = generateMipLevels;
+            key.loadAsSrgb = loadAsSrgb;
+            return key;
+        }
+    }
+
+    Texture::SharedPtr TextureCache::getOrLoad(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const std::function<Texture::SharedPtr()>& loadFunc)
+    {
+        CacheKey key = createKey(filename, generateMipLevels, loadAsSrgb, bindFlags);
+        CacheData& cache = getCacheData();
+        std::promise<Texture::SharedPtr> promise;
+        std::shared_future<Texture::SharedPtr> pending;
+        {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            CacheEntry& entry = cache.entries[key];
+            Texture::SharedPtr pTexture = entry.pTexture.lock();
+            if (pTexture)
+            {
+                cache.stats.hits++;
+                return pTexture;
+            }
+
+            if (entry.pending.valid())
+            {
+                // Another thread is loading this texture
+                cache.stats.hits++;
+                pending = entry.pending;
+            }
+            else
+            {
+                cache.stats.misses++;
+                entry.pending = promise.get_future().share();
+                if (cache.entries.size() >= cache.pruneSize)
+                {
+                    pruneReleasedEntries(cache);
+                }
+            }
+        }
+
+        if (pending.valid())
+        {
+            return pending.get();
+        }
+
+        Texture::SharedPtr pTexture;
+        try
+        {
+            pTexture = loadFunc();
+        }
+        catch (...)
+        {
+            // Release the waiting threads and don't leave a dangling pending entry behind
+            {
+                std::lock_guard<std::mutex> lock(cache.mutex);
+                cache.entries.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            if (pTexture)
+            {
+                CacheEntry& entry = cache.entries[key];
+                entry.pTexture = pTexture;
+                entry.pending = std::shared_future<Texture::SharedPtr>();
+            }
+            else
+            {
+                cache.entries.erase(key);
+            }
+        }
+        promise.set_value(pTexture);
+        return pTexture;
+    }
+
+    Texture::SharedPtr TextureCache::find(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+        CacheKey key = createKey(filename, generateMipLevels, loadAsSrgb, bindFlags);
+        CacheData& cache = getCacheData();
+        std::shared_future<Texture::SharedPtr> pending;
+        {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            auto it = cache.entries.find(key);
+            if (it == cache.entries.end())
+            {
+                cache.stats.misses++;
+                return nullptr;
+            }
+
+            Texture::SharedPtr pTexture = it->second.pTexture.lock();
+            if (pTexture)
+            {
+                cache.stats.hits++;
+                return pTexture;
+            }
+
+            if (it->second.pending.valid() == false)
+            {
+                // The texture was released
+                cache.entries.erase(it);
+                cache.stats.misses++;
+                return nullptr;
+            }
+            cache.stats.hits++;
+            pending = it->second.pending;
+        }
+        return pending.get();
+    }
+
+    void TextureCache::add(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const Texture::SharedPtr& pTexture)
+    {
+        if (pTexture == nullptr) return;
+
+        CacheKey key = createKey(filename, generateMipLevels, loadAsSrgb, bindFlags);
+        CacheData& cache = getCacheData();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        CacheEntry& entry = cache.entries[key];
+        if (entry.pending.valid() == false)
+        {
+            entry.pTexture = pTexture;
+        }
+        if (cache.entries.size() >= cache.pruneSize)
+        {
+            pruneReleasedEntries(cache);
+        }
+    }
+
+    TextureCache::Stats TextureCache::getStats()
+    {
+        CacheData& cache = getCacheData();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        return cache.stats;
+    }
+
+    void TextureCache::clear()
+    {
+        CacheData& cache = getCacheData();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        // Entries which are being loaded stay, the loading thread still needs them
+        for (auto it = cache.entries.begin(); it != cache.entries.end();)
+        {
+            it = it->second.pending.valid() ? std::next(it) : cache.entries.erase(it);
+        }
+        cache.resolvedPaths.clear();
+        cache.pruneSize = kMinPruneSize;
+        cache.stats = Stats();
+    }
+
+    void TextureCache::clearResolvedPaths()
+    {
+        CacheData& cache = getCacheData();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.resolvedPaths.clear();
+    }
+}
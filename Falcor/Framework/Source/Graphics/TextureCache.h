@@ -0,0 +1,78 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <functional>
+#include <string>
+#include "API/Texture.h"
+
+namespace Falcor
+{
+    /** Process-wide cache of textures loaded from files, shared by all models, scenes and reloads.
+        Entries are keyed by the canonical file path and the creation parameters. The cache only holds weak references, so it never keeps a texture alive. Entries of released textures are pruned as new textures are loaded.
+        All functions are thread-safe.
+    */
+    class TextureCache
+    {
+    public:
+        struct Stats
+        {
+            uint64_t hits = 0;      ///< Number of lookups that returned an existing texture
+            uint64_t misses = 0;    ///< Number of lookups that had to load the texture
+        };
+
+        /** Get a texture from the cache, or load it if it's not there.
+            Concurrent requests for the same texture are coalesced - only one thread calls the load function, the others wait for its result.
+            \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory
+            \param[in] generateMipLevels Whether the mip-chain should be generated
+            \param[in] loadAsSrgb Whether the texture is loaded using an sRGB format
+            \param[in] bindFlags The bind flags the texture is created with
+            \param[in] loadFunc Function creating the texture on a cache miss. Failed loads (nullptr) are not cached. If it throws, the exception is rethrown to the caller and to all waiting threads
+        */
+        static Texture::SharedPtr getOrLoad(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const std::function<Texture::SharedPtr()>& loadFunc);
+
+        /** Look for a texture in the cache. Returns nullptr if it's not there.
+        */
+        static Texture::SharedPtr find(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags);
+
+        /** Add a texture that was loaded outside of getOrLoad(). An existing entry with the same key is replaced, unless that texture is currently being loaded.
+        */
+        static void add(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags, const Texture::SharedPtr& pTexture);
+
+        /** Get the hit/miss statistics
+        */
+        static Stats getStats();
+
+        /** Remove all entries, forget the resolved file paths and reset the statistics. Textures which are still in use are not affected
+        */
+        static void clear();
+
+        /** Forget the resolved file paths. Called when the data directories change, since a filename may now resolve to a different file
+        */
+        static void clearResolvedPaths();
+    };
+}
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "TextureHelper.h"
+#include "TextureCache.h"
 #include "API/Texture.h"
 #include "Utils/Bitmap.h"
 #include "Utils/DDSHeader.h"
@@ -663,11 +664,8 @@ namespace Falcor
         return nullptr;
     }
 
-    Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    Texture::SharedPtr createTextureFromDdsData(DdsData& ddsData, const std::string& filename, bool generateMips, bool loadAsSrgb, Texture::BindFlags bindFlags)
     {
-        DdsData ddsData;
-        loadDDSDataFromFile(filename, ddsData);
-
         ResourceFormat format = getDdsResourceFormat(ddsData);
         assert(format != ResourceFormat::Unknown);
 
@@ -697,40 +695,69 @@ namespace Falcor
         return nullptr;
     }
 
-    Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    TextureFileData::UniquePtr loadTextureFile(const std::string& filename)
     {
-#define no_srgb()   \
-    if(loadAsSrgb)  \
-    {               \
-        logWarning("createTexture2DFromFile() warning. " + std::to_string(pBitmap->getBytesPerPixel()) + " channel images doesn't have a matching sRGB format. Loading in linear space.");  \
+        TextureFileData::UniquePtr pData = std::make_unique<TextureFileData>();
+        pData->filename = filename;
+        if (hasSuffix(filename, ".dds"))
+        {
+            pData->pDdsData = std::make_unique<DdsData>();
+            loadDDSDataFromFile(filename, *pData->pDdsData);
+        }
+        else
+        {
+            pData->pBitmap = Bitmap::createFromFile(filename, kTopDown);
+        }
+        return pData;
     }
 
+    Texture::SharedPtr createTextureFromFileData(TextureFileData& data, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
         Texture::SharedPtr pTex;
-        if (hasSuffix(filename, ".dds"))
+        if (data.pDdsData)
         {
-            pTex = createTextureFromDDSFile(filename, generateMipLevels, loadAsSrgb, bindFlags);
+            pTex = createTextureFromDdsData(*data.pDdsData, data.filename, generateMipLevels, loadAsSrgb, bindFlags);
         }
-        else
+        else if(data.pBitmap)
         {
-            Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
-            if(pBitmap)
+            const Bitmap* pBitmap = data.pBitmap.get();
+            ResourceFormat texFormat = pBitmap->getFormat();
+            if(loadAsSrgb)
             {
-                ResourceFormat texFormat = pBitmap->getFormat();
-                if(loadAsSrgb)
-                {
-                    texFormat = linearToSrgbFormat(texFormat);
-                }
-
-                pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
+                texFormat = linearToSrgbFormat(texFormat);
             }
+
+            pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kMaxPossible : 1, pBitmap->getData(), bindFlags);
         }
 
         if (pTex != nullptr)
         {
-            pTex->setSourceFilename(stripDataDirectories(filename));
+            pTex->setSourceFilename(stripDataDirectories(data.filename));
         }
 
         return pTex;
     }
+
+    Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags)
+    {
+#define no_srgb()   \
+    if(loadAsSrgb)  \
+    {               \
+        logWarning("createTexture2DFromFile() warning. " + std::to_string(pBitmap->getBytesPerPixel()) + " channel images doesn't have a matching sRGB format. Loading in linear space.");  \
+    }
+
+        auto loadFunc = [&]()
+        {
+            TextureFileData::UniquePtr pData = loadTextureFile(filename);
+            return createTextureFromFileData(*pData, generateMipLevels, loadAsSrgb, bindFlags);
+        };
+
+        // Textures which can be written by the GPU are not shared
+        if (is_set(bindFlags, Texture::BindFlags::UnorderedAccess | Texture::BindFlags::RenderTarget | Texture::BindFlags::DepthStencil))
+        {
+            return loadFunc();
+        }
+        return TextureCache::getOrLoad(filename, generateMipLevels, loadAsSrgb, bindFlags, loadFunc);
+    }
 #undef no_srgb
 }
@@ -27,7 +27,10 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <memory>
 #include "API/Texture.h"
+#include "Utils/Bitmap.h"
+#include "Utils/DDSHeader.h"
 namespace Falcor
 {
     /*!
@@ -36,6 +39,7 @@ namespace Falcor
     */
 
     /** Create a new texture object from a file.
+        Read-only textures are shared through the TextureCache, so loading the same file again with the same parameters returns the existing object.
         \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory
         \param[in] generateMipLevels Whether the mip-chain should be generated
         \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
@@ -43,5 +47,29 @@ namespace Falcor
     */
     Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
 
+    /** The contents of a texture file, decoded on the CPU
+    */
+    struct TextureFileData
+    {
+        using UniquePtr = std::unique_ptr<TextureFileData>;
+        std::string filename;
+        Bitmap::UniqueConstPtr pBitmap;                     // Set for images decoded through FreeImage
+        std::unique_ptr<DdsHelper::DdsData> pDdsData;       // Set for DDS files
+    };
+
+    /** Read and decode a texture file without creating any API object. Can be called from any thread.
+        \param[in] filename Filename of the image. Can also include a full path or relative path from a data directory
+        \return The decoded data. Use createTextureFromFileData() to turn it into a texture
+    */
+    TextureFileData::UniquePtr loadTextureFile(const std::string& filename);
+
+    /** Create a new texture object from data returned by loadTextureFile(). Has to be called from the thread that owns the device.
+        \param[in] data The decoded file. DDS data might be modified in-place
+        \param[in] generateMipLevels Whether the mip-chain should be generated
+        \param[in] loadAsSrgb Load the texture using sRGB format. Only valid for 3 or 4 component textures.
+        \param[in] bindFlags The bind flags to create the texture with
+    */
+    Texture::SharedPtr createTextureFromFileData(TextureFileData& data, bool generateMipLevels, bool loadAsSrgb, Texture::BindFlags bindFlags = Texture::BindFlags::ShaderResource);
+
     /*! @} */
 }
\ No newline at end of file
@@ -56,5 +56,6 @@ namespace Falcor
 
         static HitProgram::SharedPtr createCommon(const std::string& filename, const std::string& closestHitEntry, const std::string& anyHitEntry, const std::string& intersectionEntry, const DefineList& programDefines, bool fromFile, uint32_t maxPayloadSize, uint32_t maxAttributeSize);
         virtual ProgramVersion::SharedPtr createProgramVersion(std::string& log, const Shader::Blob shaderBlob[kShaderCount], const ProgramReflectors& reflectors) const override;
+        virtual bool supportsAsyncCompilation() const override { return false; } // Creating the version creates a local root-signature
     };
 }
\ No newline at end of file
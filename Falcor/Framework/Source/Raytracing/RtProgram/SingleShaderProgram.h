@@ -63,6 +63,8 @@ namespace Falcor
             return pProg;
         }
 
+        virtual bool supportsAsyncCompilation() const override { return false; } // Creating the version creates a local root-signature
+
         virtual ProgramVersion::SharedPtr createProgramVersion(std::string& log, const Shader::Blob shaderBlob[kShaderCount], const ProgramReflectors& reflectors) const override
         {
             RtShader::SharedPtr pShader;
@@ -29,6 +29,7 @@
 #include "glm/vec3.hpp"
 #include "glm/mat4x4.hpp"
 #include "glm/common.hpp"
+#include <vector>
 
 namespace Falcor
 {
@@ -124,4 +125,58 @@ namespace Falcor
             return BoundingBox::fromMinMax(min(bb0.getMinPos(), bb1.getMinPos()), max(bb0.getMaxPos(), bb1.getMaxPos()));
         }
     };
+    /** Bounding boxes in structure-of-arrays layout, for batched SIMD processing.
+        The arrays are padded to a multiple of kPadding elements with empty boxes.
+    */
+    struct BoundingBoxArray
+    {
+        static const uint32_t kPadding = 4;
+
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> extentX;
+        std::vector<float> extentY;
+        std::vector<float> extentZ;
+
+        /** Get the number of boxes, not including the padding
+        */
+        uint32_t size() const { return mCount; }
+
+        /** Set the number of boxes. New boxes are empty.
+        */
+        void resize(uint32_t count)
+        {
+            mCount = count;
+            size_t paddedCount = (count + kPadding - 1) / kPadding * kPadding;
+            for (auto pArray : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+            {
+                pArray->resize(paddedCount, 0.0f);
+            }
+        }
+
+        /** Set a box
+            \param[in] index Index of the box. Must be smaller than size()
+            \param[in] box The box
+        */
+        void set(uint32_t index, const BoundingBox& box)
+        {
+            assert(index < mCount);
+            centerX[index] = box.center.x;
+            centerY[index] = box.center.y;
+            centerZ[index] = box.center.z;
+            extentX[index] = box.extent.x;
+            extentY[index] = box.extent.y;
+            extentZ[index] = box.extent.z;
+        }
+
+        void push_back(const BoundingBox& box)
+        {
+            resize(mCount + 1);
+            set(mCount - 1, box);
+        }
+
+    private:
+        uint32_t mCount = 0;
+    };
 }
\ No newline at end of file
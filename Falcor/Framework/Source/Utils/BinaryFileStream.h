@@ -93,6 +93,16 @@ namespace Falcor
             mStream.ignore(count);
         }
 
+        /** Get the current read position in the stream
+            \return Offset in bytes from the beginning of the file
+        */
+        uint64_t getPosition() { return (uint64_t)mStream.tellg(); }
+
+        /** Move the read position to an absolute offset
+            \param[in] offset Offset in bytes from the beginning of the file
+        */
+        void seek(uint64_t offset) { mStream.seekg((std::streamoff)offset); }
+
         /** Deletes the managed file.
         */
         void remove()
@@ -0,0 +1,481 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BoundingVolumeHierarchy.h"
+#include "Graphics/Camera/Camera.h"
+#include <algorithm>
+#include <limits>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kBinCount = 16;
+        const uint32_t kStackReserve = 64;
+
+        float surfaceArea(const glm::vec3& min, const glm::vec3& max)
+        {
+            glm::vec3 d = glm::max(max - min, glm::vec3(0));
+            return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+        }
+
+        bool intersectBounds(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float& tEntry)
+        {
+            glm::vec3 t0 = (min - origin) * invDir;
+            glm::vec3 t1 = (max - origin) * invDir;
+            glm::vec3 tNear = glm::min(t0, t1);
+            glm::vec3 tFar = glm::max(t0, t1);
+            tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+            float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+            return tEntry <= tExit;
+        }
+    }
+
+    const uint32_t BoundingVolumeHierarchy::kInvalidIndex;
+    const uint32_t BoundingVolumeHierarchy::kMaxLeafSize;
+
+    BoundingVolumeHierarchy::UniquePtr BoundingVolumeHierarchy::create()
+    {
+        return UniquePtr(new BoundingVolumeHierarchy());
+    }
+
+    void BoundingVolumeHierarchy::build(const std::vector<BoundingBox>& boxes)
+    {
+        const uint32_t boxCount = (uint32_t)boxes.size();
+        mBoxes.resize(boxCount);
+        mBoxOrder.resize(boxCount);
+        mBoxLeaf.assign(boxCount, kInvalidIndex);
+        mNodes.clear();
+        mDirtyNodes.clear();
+        if (boxCount == 0) return;
+
+        std::vector<glm::vec3> centroids(boxCount);
+        for (uint32_t i = 0; i < boxCount; i++)
+        {
+            mBoxes[i].min = boxes[i].getMinPos();
+            mBoxes[i].max = boxes[i].getMaxPos();
+            centroids[i] = boxes[i].center;
+            mBoxOrder[i] = i;
+        }
+
+        // A binary tree with at least one box per leaf has less than 2 * boxCount nodes
+        mNodes.reserve(2 * boxCount);
+        mNodes.emplace_back();
+        mNodes[0].first = 0;
+        mNodes[0].count = boxCount;
+
+        // Children are always created after their parent. Processing the nodes in creation order builds the tree breadth-first without recursion
+        for (uint32_t nodeID = 0; nodeID < (uint32_t)mNodes.size(); nodeID++)
+        {
+            buildNode(nodeID, centroids);
+        }
+    }
+
+    void BoundingVolumeHierarchy::buildNode(uint32_t nodeID, std::vector<glm::vec3>& centroids)
+    {
+        const uint32_t first = mNodes[nodeID].first;
+        const uint32_t count = mNodes[nodeID].count;
+        uint32_t* pOrder = mBoxOrder.data() + first;
+
+        Bounds bounds = mBoxes[pOrder[0]];
+        glm::vec3 centroidMin = centroids[pOrder[0]];
+        glm::vec3 centroidMax = centroidMin;
+        for (uint32_t i = 1; i < count; i++)
+        {
+            bounds.min = glm::min(bounds.min, mBoxes[pOrder[i]].min);
+            bounds.max = glm::max(bounds.max, mBoxes[pOrder[i]].max);
+            centroidMin = glm::min(centroidMin, centroids[pOrder[i]]);
+            centroidMax = glm::max(centroidMax, centroids[pOrder[i]]);
+        }
+        mNodes[nodeID].bounds = bounds;
+
+        if (count <= kMaxLeafSize)
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                mBoxLeaf[pOrder[i]] = nodeID;
+            }
+            return;
+        }
+
+        // Find the best binned SAH split
+        uint32_t bestAxis = 0;
+        uint32_t bestSplit = 0;
+        float bestCost = std::numeric_limits<float>::max();
+        const glm::vec3 centroidExtent = centroidMax - centroidMin;
+
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            if (centroidExtent[axis] <= 0) continue;
+
+            struct Bin
+            {
+                Bounds bounds = { glm::vec3(std::numeric_limits<float>::max()), glm::vec3(-std::numeric_limits<float>::max()) };
+                uint32_t count = 0;
+            } bins[kBinCount];
+
+            const float binScale = kBinCount / centroidExtent[axis];
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint32_t b = std::min(kBinCount - 1, uint32_t((centroids[pOrder[i]][axis] - centroidMin[axis]) * binScale));
+                bins[b].bounds.min = glm::min(bins[b].bounds.min, mBoxes[pOrder[i]].min);
+                bins[b].bounds.max = glm::max(bins[b].bounds.max, mBoxes[pOrder[i]].max);
+                bins[b].count++;
+            }
+
+            // Sweep from the right to get the cost of the right side of every split, then from the left
+            float rightArea[kBinCount];
+            uint32_t rightCount[kBinCount];
+            Bin right;
+            for (uint32_t b = kBinCount - 1; b > 0; b--)
+            {
+                right.bounds.min = glm::min(right.bounds.min, bins[b].bounds.min);
+                right.bounds.max = glm::max(right.bounds.max, bins[b].bounds.max);
+                right.count += bins[b].count;
+                rightArea[b] = surfaceArea(right.bounds.min, right.bounds.max);
+                rightCount[b] = right.count;
+            }
+
+            Bin left;
+            for (uint32_t b = 0; b < kBinCount - 1; b++)
+            {
+                left.bounds.min = glm::min(left.bounds.min, bins[b].bounds.min);
+                left.bounds.max = glm::max(left.bounds.max, bins[b].bounds.max);
+                left.count += bins[b].count;
+                if (left.count == 0 || rightCount[b + 1] == 0) continue;
+
+                float cost = surfaceArea(left.bounds.min, left.bounds.max) * left.count + rightArea[b + 1] * rightCount[b + 1];
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = b + 1;
+                }
+            }
+        }
+
+        uint32_t leftCount;
+        if (bestCost < std::numeric_limits<float>::max())
+        {
+            const float binScale = kBinCount / centroidExtent[bestAxis];
+            auto isLeft = [&](uint32_t boxID) { return std::min(kBinCount - 1, uint32_t((centroids[boxID][bestAxis] - centroidMin[bestAxis]) * binScale)) < bestSplit; };
+            leftCount = uint32_t(std::partition(pOrder, pOrder + count, isLeft) - pOrder);
+        }
+        else
+        {
+            // All the centroids are in the same bin. Split in the middle of the largest axis
+            uint32_t axis = (centroidExtent.x >= centroidExtent.y && centroidExtent.x >= centroidExtent.z) ? 0 : (centroidExtent.y >= centroidExtent.z ? 1 : 2);
+            leftCount = count / 2;
+            std::nth_element(pOrder, pOrder + leftCount, pOrder + count, [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+        }
+
+        const uint32_t leftID = (uint32_t)mNodes.size();
+        mNodes[nodeID].left = leftID;
+        mNodes.resize(mNodes.size() + 2);
+        mNodes[leftID].parent = nodeID;
+        mNodes[leftID].first = first;
+        mNodes[leftID].count = leftCount;
+        mNodes[leftID + 1].parent = nodeID;
+        mNodes[leftID + 1].first = first + leftCount;
+        mNodes[leftID + 1].count = count - leftCount;
+    }
+
+    void BoundingVolumeHierarchy::updateBox(uint32_t boxID, const BoundingBox& box)
+    {
+        mBoxes[boxID].min = box.getMinPos();
+        mBoxes[boxID].max = box.getMaxPos();
+        mDirtyNodes.push_back(mBoxLeaf[boxID]);
+    }
+
+    void BoundingVolumeHierarchy::updateNodeBounds(uint32_t nodeID)
+    {
+        Node& node = mNodes[nodeID];
+        if (node.isLeaf())
+        {
+            node.bounds = mBoxes[mBoxOrder[node.first]];
+            for (uint32_t i = 1; i < node.count; i++)
+            {
+                const Bounds& box = mBoxes[mBoxOrder[node.first + i]];
+                node.bounds.min = glm::min(node.bounds.min, box.min);
+                node.bounds.max = glm::max(node.bounds.max, box.max);
+            }
+        }
+        else
+        {
+            const Bounds& left = mNodes[node.left].bounds;
+            const Bounds& right = mNodes[node.left + 1].bounds;
+            node.bounds.min = glm::min(left.min, right.min);
+            node.bounds.max = glm::max(left.max, right.max);
+        }
+    }
+
+    void BoundingVolumeHierarchy::refit()
+    {
+        if (mDirtyNodes.empty()) return;
+
+        // Add the ancestors of the changed leaves. Stop when reaching a node which is already in the list
+        std::vector<bool> isDirty(mNodes.size(), false);
+        size_t leafCount = mDirtyNodes.size();
+        for (size_t i = 0; i < leafCount; i++)
+        {
+            uint32_t nodeID = mDirtyNodes[i];
+            if (isDirty[nodeID]) continue;
+            isDirty[nodeID] = true;
+            for (uint32_t parent = mNodes[nodeID].parent; parent != kInvalidIndex && isDirty[parent] == false; parent = mNodes[parent].parent)
+            {
+                isDirty[parent] = true;
+                mDirtyNodes.push_back(parent);
+            }
+        }
+
+        // Children have larger indices than their parents, so updating in decreasing order updates the children first
+        std::sort(mDirtyNodes.begin(), mDirtyNodes.end(), std::greater<uint32_t>());
+        mDirtyNodes.erase(std::unique(mDirtyNodes.begin(), mDirtyNodes.end()), mDirtyNodes.end());
+        for (uint32_t nodeID : mDirtyNodes)
+        {
+            updateNodeBounds(nodeID);
+        }
+        mDirtyNodes.clear();
+    }
+
+    BoundingBox BoundingVolumeHierarchy::getBounds() const
+    {
+        if (mNodes.empty()) return BoundingBox::fromMinMax(glm::vec3(0), glm::vec3(0));
+        return BoundingBox::fromMinMax(mNodes[0].bounds.min, mNodes[0].bounds.max);
+    }
+
+    void BoundingVolumeHierarchy::cull(const Camera* pCamera, std::vector<uint32_t>& visibilityMask) const
+    {
+        visibilityMask.assign((mBoxes.size() + 31) / 32, 0);
+        if (mNodes.empty()) return;
+
+        glm::vec4 planes[6];
+        glm::vec3 absNormals[6];
+        for (uint32_t p = 0; p < 6; p++)
+        {
+            planes[p] = pCamera->getFrustumPlane(p);
+            absNormals[p] = glm::abs(glm::vec3(planes[p]));
+        }
+
+        // Test against the planes in the mask. Returns false if the box is outside, and clears the planes the box is completely inside of
+        auto testBounds = [&](const Bounds& b, uint32_t& planeMask)
+        {
+            glm::vec3 center = (b.min + b.max) * 0.5f;
+            glm::vec3 extent = (b.max - b.min) * 0.5f;
+            for (uint32_t p = 0; p < 6; p++)
+            {
+                if ((planeMask & (1 << p)) == 0) continue;
+                float d = glm::dot(center, glm::vec3(planes[p])) + planes[p].w;
+                float r = glm::dot(extent, absNormals[p]);
+                if (d + r <= 0) return false;
+                if (d - r > 0) planeMask &= ~(1 << p);
+            }
+            return true;
+        };
+
+        auto setVisible = [&](uint32_t boxID) { visibilityMask[boxID >> 5] |= 1u << (boxID & 31); };
+
+        struct Entry
+        {
+            uint32_t nodeID;
+            uint32_t planeMask;
+        };
+        std::vector<Entry> stack;
+        stack.reserve(kStackReserve);
+        stack.push_back({ 0, 0x3f });
+
+        while (stack.empty() == false)
+        {
+            Entry entry = stack.back();
+            stack.pop_back();
+            const Node& node = mNodes[entry.nodeID];
+            if (testBounds(node.bounds, entry.planeMask) == false) continue;
+
+            if (entry.planeMask == 0)
+            {
+                // Completely inside the frustum
+                for (uint32_t i = 0; i < node.count; i++)
+                {
+                    setVisible(mBoxOrder[node.first + i]);
+                }
+            }
+            else if (node.isLeaf())
+            {
+                for (uint32_t i = 0; i < node.count; i++)
+                {
+                    uint32_t boxID = mBoxOrder[node.first + i];
+                    uint32_t planeMask = entry.planeMask;
+                    if (testBounds(mBoxes[boxID], planeMask))
+                    {
+                        setVisible(boxID);
+                    }
+                }
+            }
+            else
+            {
+                stack.push_back({ node.left + 1, entry.planeMask });
+                stack.push_back({ node.left, entry.planeMask });
+            }
+        }
+    }
+
+    void BoundingVolumeHierarchy::queryOverlap(const BoundingBox& box, std::vector<uint32_t>& boxIDs) const
+    {
+        if (mNodes.empty()) return;
+
+        const glm::vec3 min = box.getMinPos();
+        const glm::vec3 max = box.getMaxPos();
+        auto overlaps = [&](const Bounds& b) { return glm::all(glm::lessThanEqual(b.min, max)) && glm::all(glm::lessThanEqual(min, b.max)); };
+
+        std::vector<uint32_t> stack;
+        stack.reserve(kStackReserve);
+        stack.push_back(0);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.back()];
+            stack.pop_back();
+            if (overlaps(node.bounds) == false) continue;
+
+            if (node.isLeaf())
+            {
+                for (uint32_t i = 0; i < node.count; i++)
+                {
+                    uint32_t boxID = mBoxOrder[node.first + i];
+                    if (overlaps(mBoxes[boxID])) boxIDs.push_back(boxID);
+                }
+            }
+            else
+            {
+                stack.push_back(node.left + 1);
+                stack.push_back(node.left);
+            }
+        }
+    }
+
+    void BoundingVolumeHierarchy::queryOverlap(const glm::vec3& center, float radius, std::vector<uint32_t>& boxIDs) const
+    {
+        if (mNodes.empty()) return;
+
+        const float radiusSq = radius * radius;
+        auto overlaps = [&](const Bounds& b)
+        {
+            glm::vec3 d = center - glm::clamp(center, b.min, b.max);
+            return glm::dot(d, d) <= radiusSq;
+        };
+
+        std::vector<uint32_t> stack;
+        stack.reserve(kStackReserve);
+        stack.push_back(0);
+        while (stack.empty() == false)
+        {
+            const Node& node = mNodes[stack.back()];
+            stack.pop_back();
+            if (overlaps(node.bounds) == false) continue;
+
+            if (node.isLeaf())
+            {
+                for (uint32_t i = 0; i < node.count; i++)
+                {
+                    uint32_t boxID = mBoxOrder[node.first + i];
+                    if (overlaps(mBoxes[boxID])) boxIDs.push_back(boxID);
+                }
+            }
+            else
+            {
+                stack.push_back(node.left + 1);
+                stack.push_back(node.left);
+            }
+        }
+    }
+
+    float BoundingVolumeHierarchy::intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax, const RayHitFunc& func) const
+    {
+        if (mNodes.empty()) return tMax;
+
+        const glm::vec3 invDir = 1.0f / direction;
+
+        struct Entry
+        {
+            uint32_t nodeID;
+            float tEntry;
+        };
+        std::vector<Entry> stack;
+        stack.reserve(kStackReserve);
+
+        float tEntry;
+        if (intersectBounds(mNodes[0].bounds.min, mNodes[0].bounds.max, origin, invDir, tMax, tEntry))
+        {
+            stack.push_back({ 0, tEntry });
+        }
+
+        while (stack.empty() == false)
+        {
+            Entry entry = stack.back();
+            stack.pop_back();
+            // The max distance might have shrunk since the node was pushed
+            if (entry.tEntry > tMax) continue;
+
+            const Node& node = mNodes[entry.nodeID];
+            if (node.isLeaf())
+            {
+                for (uint32_t i = 0; i < node.count; i++)
+                {
+                    uint32_t boxID = mBoxOrder[node.first + i];
+                    if (intersectBounds(mBoxes[boxID].min, mBoxes[boxID].max, origin, invDir, tMax, tEntry))
+                    {
+                        tMax = func(boxID, tMax);
+                    }
+                }
+            }
+            else
+            {
+                Entry children[2];
+                uint32_t hitCount = 0;
+                for (uint32_t c = 0; c < 2; c++)
+                {
+                    const Bounds& b = mNodes[node.left + c].bounds;
+                    if (intersectBounds(b.min, b.max, origin, invDir, tMax, tEntry))
+                    {
+                        children[hitCount++] = { node.left + c, tEntry };
+                    }
+                }
+
+                // Push the farther child first, so the closer one is visited first
+                if (hitCount == 2 && children[0].tEntry < children[1].tEntry)
+                {
+                    std::swap(children[0], children[1]);
+                }
+                for (uint32_t c = 0; c < hitCount; c++)
+                {
+                    stack.push_back(children[c]);
+                }
+            }
+        }
+        return tMax;
+    }
+}
@@ -0,0 +1,140 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <functional>
+#include <memory>
+#include "Utils/AABB.h"
+
+namespace Falcor
+{
+    class Camera;
+
+    /** CPU bounding volume hierarchy over a set of bounding boxes, for culling and spatial queries.
+        The tree is built top-down using the surface area heuristic. Moving boxes are handled by refitting the tree, which keeps the topology.
+        Rebuild the tree when boxes are added or removed, or when they moved far enough that the refitted tree became inefficient.
+    */
+    class BoundingVolumeHierarchy
+    {
+    public:
+        using UniquePtr = std::unique_ptr<BoundingVolumeHierarchy>;
+        using UniqueConstPtr = std::unique_ptr<const BoundingVolumeHierarchy>;
+
+        static const uint32_t kMaxLeafSize = 4;  ///< Max number of boxes in a leaf node
+
+        static UniquePtr create();
+
+        /** Build the tree
+            \param[in] boxes The boxes. Queries refer to a box by its index in this list.
+        */
+        void build(const std::vector<BoundingBox>& boxes);
+
+        /** Change a box. The tree isn't updated until refit() is called.
+        */
+        void updateBox(uint32_t boxID, const BoundingBox& box);
+
+        /** Update the bounds of the nodes containing boxes changed since the last refit. Only the changed paths in the tree are visited.
+        */
+        void refit();
+
+        /** Get the number of boxes in the tree
+        */
+        uint32_t getBoxCount() const { return (uint32_t)mBoxes.size(); }
+
+        /** Get a box
+        */
+        BoundingBox getBox(uint32_t boxID) const { return BoundingBox::fromMinMax(mBoxes[boxID].min, mBoxes[boxID].max); }
+
+        /** Get the bounds of the entire tree
+        */
+        BoundingBox getBounds() const;
+
+        /** Find the boxes that are inside the camera's frustum. Subtrees which are completely inside or outside the frustum are accepted or rejected without visiting their children.
+            \param[in] pCamera The camera
+            \param[out] visibilityMask One bit per box, set if the box is visible. Use Camera::isVisible() to read it.
+        */
+        void cull(const Camera* pCamera, std::vector<uint32_t>& visibilityMask) const;
+
+        /** Find the boxes overlapping a box
+            \param[in] box The box to test
+            \param[out] boxIDs The overlapping boxes. The result is appended to the vector.
+        */
+        void queryOverlap(const BoundingBox& box, std::vector<uint32_t>& boxIDs) const;
+
+        /** Find the boxes overlapping a sphere
+            \param[in] center The center of the sphere
+            \param[in] radius The radius of the sphere
+            \param[out] boxIDs The overlapping boxes. The result is appended to the vector.
+        */
+        void queryOverlap(const glm::vec3& center, float radius, std::vector<uint32_t>& boxIDs) const;
+
+        /** Callback for ray queries. Called for every box the ray hits, with the box ID and the current max distance along the ray.
+            Return the new max distance. Returning a smaller distance, for example when a closer hit was found, prunes the rest of the traversal.
+        */
+        using RayHitFunc = std::function<float(uint32_t boxID, float tMax)>;
+
+        /** Trace a ray through the tree. Closer nodes are visited first.
+            \param[in] origin Ray origin
+            \param[in] direction Ray direction. Doesn't need to be normalized, distances are in multiples of its length.
+            \param[in] tMax Max distance along the ray
+            \param[in] func Called for every box that the ray hits
+            \return The max distance returned by the last call to func, or tMax if no box was hit
+        */
+        float intersectRay(const glm::vec3& origin, const glm::vec3& direction, float tMax, const RayHitFunc& func) const;
+
+    private:
+        BoundingVolumeHierarchy() = default;
+
+        static const uint32_t kInvalidIndex = (uint32_t)-1;
+
+        struct Bounds
+        {
+            glm::vec3 min;
+            glm::vec3 max;
+        };
+
+        struct Node
+        {
+            Bounds bounds;
+            uint32_t parent = kInvalidIndex;
+            uint32_t left = kInvalidIndex;  ///< The right child is always left + 1. kInvalidIndex for leaf nodes
+            uint32_t first = 0;             ///< Index of the first box in mBoxOrder. Internal nodes also keep the range of their subtree, for accepting it as a whole
+            uint32_t count = 0;
+            bool isLeaf() const { return left == kInvalidIndex; }
+        };
+
+        std::vector<Bounds> mBoxes;
+        std::vector<Node> mNodes;
+        std::vector<uint32_t> mBoxOrder;        // Box IDs sorted by leaf
+        std::vector<uint32_t> mBoxLeaf;         // The leaf node of each box
+        std::vector<uint32_t> mDirtyNodes;
+
+        void buildNode(uint32_t nodeID, std::vector<glm::vec3>& centroids);
+        void updateNodeBounds(uint32_t nodeID);
+    };
+}
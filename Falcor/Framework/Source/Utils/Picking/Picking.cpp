@@ -28,179 +28,152 @@
 
 #include "Framework.h"
 #include "Utils/Picking/Picking.h"
-#include "Graphics/FboHelper.h"
+#include "Utils/WorkerPool.h"
+#include <algorithm>
 
 namespace Falcor
 {
-    Picking::UniquePtr Picking::create(const Scene::SharedPtr& pScene, uint32_t fboWidth, uint32_t fboHeight)
+    // Slab test. Returns true if the ray enters the box before t, and updates t to the entry distance (0 if the origin is inside)
+    static bool intersectBox(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& direction, float& t)
     {
-        return UniquePtr(new Picking(pScene, fboWidth, fboHeight));
-    }
-
-    bool Picking::pick(RenderContext* pContext, const glm::vec2& mousePos, const Camera::SharedPtr& pCamera)
-    {
-        calculateScissor(mousePos);
-        renderScene(pContext, pCamera.get());
-        readPickResults(pContext);
-        return mPickResult.pModelInstance != nullptr;
-    }
-
-    ObjectInstance<Mesh>::SharedPtr Picking::getPickedMeshInstance() const
-    {
-        return mPickResult.pMeshInstance;
-    }
-
-    ObjectInstance<Model>::SharedPtr Picking::getPickedModelInstance() const
-    {
-        return mPickResult.pModelInstance;
-    }
-
-    void Picking::resizeFBO(uint32_t width, uint32_t height)
-    {
-        Fbo::Desc fboDesc;
-        fboDesc.setColorTarget(0, Falcor::ResourceFormat::R16Int).setDepthStencilTarget(Falcor::ResourceFormat::D24UnormS8);
-
-        mpFBO = FboHelper::create2D(width, height, fboDesc);
+        glm::vec3 invDirection = 1.0f / direction;
+        glm::vec3 t0 = (box.getMinPos() - origin) * invDirection;
+        glm::vec3 t1 = (box.getMaxPos() - origin) * invDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float tExit = std::min(std::min(tFar.x, tFar.y), tFar.z);
+        if (tEnter > tExit || tEnter >= t) return false;
+        t = tEnter;
+        return true;
     }
 
-    void Picking::registerGizmos(const Gizmo::Gizmos& gizmos)
+    Picking::UniquePtr Picking::create(const Scene::SharedPtr& pScene)
     {
-        mSceneGizmos = gizmos;
+        return UniquePtr(new Picking(pScene));
     }
 
-    Picking::Picking(const Scene::SharedPtr& pScene, uint32_t fboWidth, uint32_t fboHeight)
-        : SceneRenderer(pScene)
+    Picking::Picking(const Scene::SharedPtr& pScene)
+        : mpScene(pScene)
     {
-        mpGraphicsState = GraphicsState::create();
-
-        // Create FBO
-        resizeFBO(fboWidth, fboHeight);
-        mpGraphicsState->setFbo(mpFBO);
-
-        // Compile shaders
-        Program::DefineList defines;
-        defines.add("PICKING");
-        mpProgram = GraphicsProgram::createFromFile("Framework/Shaders/SceneEditor.slang", "editorVs", "editorPs", defines);
-        mpProgramVars = GraphicsVars::create(mpProgram->getReflector());
-
-        defines.add("CULL_REAR_SECTION");
-        mpRotGizmoProgram = GraphicsProgram::createFromFile("Framework/Shaders/SceneEditor.slang", "editorVs", "editorPs", defines);
-
-        // Depth State
-        DepthStencilState::Desc dsDesc;
-        dsDesc.setDepthTest(false).setStencilTest(true).setStencilRef(1);
-        dsDesc.setStencilOp(DepthStencilState::Face::FrontAndBack, DepthStencilState::StencilOp::Keep, DepthStencilState::StencilOp::Keep, DepthStencilState::StencilOp::Replace);
-        mpSetStencilDS = DepthStencilState::create(dsDesc);
-
-        dsDesc.setDepthTest(true).setStencilTest(true).setStencilFunc(DepthStencilState::Face::FrontAndBack, DepthStencilState::Func::NotEqual);
-        dsDesc.setStencilOp(DepthStencilState::Face::FrontAndBack, DepthStencilState::StencilOp::Keep, DepthStencilState::StencilOp::Keep, DepthStencilState::StencilOp::Keep);
-        mpExcludeStencilDS = DepthStencilState::create(dsDesc);
-
-        // Rasterizer State
-        RasterizerState::Desc rsDesc;
-        rsDesc.setCullMode(RasterizerState::CullMode::None);
-        mpGraphicsState->setRasterizerState(RasterizerState::create(rsDesc));
     }
 
-    void Picking::renderScene(RenderContext* pContext, Camera* pCamera)
+    bool Picking::pick(const glm::vec2& mousePos, const Camera* pCamera)
     {
-        mDrawIDToInstance.clear();
-
-        const glm::vec4 clearColor(-1.0f);
-        pContext->clearFbo(mpFBO.get(), clearColor, 1.0f, 0, FboAttachmentType::All);
-
-        // Save state
-        auto pPrevGraphicsState = pContext->getGraphicsState();
-
-        mpGraphicsState->setScissors(0, mScissor);
-
-        // Render
-        pContext->setGraphicsState(mpGraphicsState);
-        pContext->setGraphicsVars(mpProgramVars);
-
-        SceneRenderer::renderScene(pContext, pCamera);
-
-        // Restore state
-        pContext->setGraphicsState(pPrevGraphicsState);
+        // Unproject the mouse position on the near and far planes
+        glm::vec2 ndc(mousePos.x * 2 - 1, 1 - mousePos.y * 2);
+        const glm::mat4& invViewProj = pCamera->getInvViewProjMatrix();
+        glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, 0, 1);
+        glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1, 1);
+        glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+        glm::vec3 end = glm::vec3(farPoint) / farPoint.w;
+
+        return pick(origin, end - origin, 1.0f);
     }
 
-    void Picking::readPickResults(RenderContext* pContext)
+    bool Picking::pick(const glm::vec3& origin, const glm::vec3& direction, float tMax)
     {
-        std::vector<uint8_t> textureData = pContext->readTextureSubresource(mpFBO->getColorTexture(0).get(), 0);
-        uint16_t* pData = (uint16_t*)textureData.data();
-
-        uint32_t i = mScissor.top * mpFBO->getWidth() + mScissor.left;
-
-        if (pData[i] >= 0)
+        // Gizmos take priority over the objects, even when they are behind them
+        Result result;
+        if (intersect(origin, direction, tMax, true, result) || intersect(origin, direction, tMax, false, result))
         {
-            mPickResult = mDrawIDToInstance[pData[i]];
+            mPickResult = result;
         }
         else
         {
-            // Nullptrs
-            mPickResult = Instance();
+            mPickResult = Result();
         }
+        return mPickResult.pModelInstance != nullptr;
     }
 
-    void Picking::setPerFrameData(const CurrentWorkingData& currentData)
+    bool Picking::intersect(const glm::vec3& origin, const glm::vec3& direction, float tMax, bool gizmos, Result& result) const
     {
-        if (currentData.pCamera)
+        const BoundingVolumeHierarchy* pBvh = mpScene->getBvh();
+
+        auto isCandidate = [&](const Scene::MeshInstanceRef& ref)
         {
-            // Set camera for regular shader
-            ConstantBuffer* pCB = mpProgramVars->getConstantBuffer(kPerFrameCbName).get();
-            currentData.pCamera->setIntoConstantBuffer(pCB, sCameraDataOffset);
-        }
-    }
+            const Model* pModel = mpScene->getModel(ref.modelID).get();
+            bool isGizmo = Gizmo::getGizmoType(mSceneGizmos, pModel) != Gizmo::Type::Invalid;
+            return (isGizmo == gizmos) && mpScene->getModelInstance(ref.modelID, ref.instanceID)->isVisible() && pModel->getMeshInstance(ref.meshID, ref.meshInstanceID)->isVisible();
+        };
+
+        // Build the triangle BVHs of the meshes along the ray in parallel, before tracing
+        std::vector<const Mesh*> meshes;
+        pBvh->intersectRay(origin, direction, tMax, [&](uint32_t boxID, float t)
+        {
+            const auto& ref = mpScene->getBvhBoxRef(boxID);
+            if (isCandidate(ref))
+            {
+                meshes.push_back(mpScene->getModel(ref.modelID)->getMeshInstance(ref.meshID, ref.meshInstanceID)->getObject().get());
+            }
+            return t;
+        });
+        if (meshes.empty()) return false;
 
-    bool Picking::setPerModelData(const CurrentWorkingData& currentData)
-    {
-        const Gizmo::Type gizmoType = Gizmo::getGizmoType(mSceneGizmos, currentData.pModel);
+        std::sort(meshes.begin(), meshes.end());
+        meshes.erase(std::unique(meshes.begin(), meshes.end()), meshes.end());
+        WorkerPool::getGlobal().parallelFor(0, (uint32_t)meshes.size(), [&](uint32_t i) { meshes[i]->getTriangleBvh(); });
 
-        // If rendering a gizmo
-        if (gizmoType != Gizmo::Type::Invalid)
+        bool found = false;
+        pBvh->intersectRay(origin, direction, tMax, [&](uint32_t boxID, float t)
         {
-            mpGraphicsState->setDepthStencilState(mpSetStencilDS);
-
-            // For rotation gizmo, set shader to cut out away-facing parts
-            if (gizmoType == Gizmo::Type::Rotate)
+            const auto& ref = mpScene->getBvhBoxRef(boxID);
+            if (isCandidate(ref) == false) return t;
+
+            const auto& pModelInstance = mpScene->getModelInstance(ref.modelID, ref.instanceID);
+            const auto& pMeshInstance = pModelInstance->getObject()->getMeshInstance(ref.meshID, ref.meshInstanceID);
+
+            // Intersect in object space. The direction isn't normalized, so distances are the same in both spaces
+            glm::mat4 world = pModelInstance->getTransformMatrix() * pMeshInstance->getTransformMatrix();
+            glm::mat4 invWorld = glm::inverse(world);
+            glm::vec3 objectOrigin = glm::vec3(invWorld * glm::vec4(origin, 1));
+            glm::vec3 objectDirection = glm::vec3(invWorld * glm::vec4(direction, 0));
+
+            float hitT = t;
+            uint32_t triangleID = kInvalidTriangle;
+            glm::vec2 barycentrics;
+            const Mesh* pMesh = pMeshInstance->getObject().get();
+            if (pMesh->hasCpuGeometry())
             {
-                mpGraphicsState->setProgram(gizmoType == Gizmo::Type::Rotate ? mpRotGizmoProgram : mpProgram);
-                return SceneRenderer::setPerModelData(currentData);
+                if (pMesh->intersectRay(objectOrigin, objectDirection, hitT, triangleID, barycentrics) == false) return t;
+            }
+            else if (intersectBox(pMesh->getBoundingBox(), objectOrigin, objectDirection, hitT) == false)
+            {
+                // The model wasn't loaded with Model::LoadFlags::KeepCpuGeometry, fall back to the mesh's bounding-box
+                return t;
             }
-        }
-        else
-        {
-            mpGraphicsState->setDepthStencilState(mpExcludeStencilDS);
-        }
 
-        mpGraphicsState->setProgram(mpProgram);
-        currentData.pContext->setGraphicsVars(mpProgramVars);
+            // The rotation gizmo doesn't draw the parts facing away from the camera. Same test as the editor shader
+            if (Gizmo::getGizmoType(mSceneGizmos, pModelInstance->getObject().get()) == Gizmo::Type::Rotate)
+            {
+                glm::vec3 hitPos = origin + direction * hitT;
+                glm::vec3 toVertex = glm::normalize(hitPos - glm::vec3(world[3]));
+                if (glm::dot(glm::normalize(-direction), toVertex) < -0.1f) return t;
+            }
 
-        return SceneRenderer::setPerModelData(currentData);
+            found = true;
+            result.pModelInstance = pModelInstance;
+            result.pMeshInstance = pMeshInstance;
+            result.triangleID = triangleID;
+            result.barycentrics = barycentrics;
+            result.distance = hitT;
+            return hitT;
+        });
+        return found;
     }
 
-    bool Picking::setPerMeshInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t drawInstanceID)
+    ObjectInstance<Mesh>::SharedPtr Picking::getPickedMeshInstance() const
     {
-        ConstantBuffer* pCB = currentData.pContext->getGraphicsVars()->getConstantBuffer(kPerMeshCbName).get();
-        pCB->setBlob(&currentData.drawID, sDrawIDOffset + drawInstanceID * sizeof(uint32_t), sizeof(uint32_t));
-
-        mDrawIDToInstance[currentData.drawID] = Instance(const_cast<Scene::ModelInstance*>(pModelInstance)->shared_from_this(), const_cast<Model::MeshInstance*>(pMeshInstance)->shared_from_this());
-
-        return SceneRenderer::setPerMeshInstanceData(currentData, pModelInstance, pMeshInstance, drawInstanceID);
+        return mPickResult.pMeshInstance;
     }
 
-    bool Picking::setPerMaterialData(const CurrentWorkingData& currentData, const Material* pMaterial)
+    ObjectInstance<Model>::SharedPtr Picking::getPickedModelInstance() const
     {
-        return true;
+        return mPickResult.pModelInstance;
     }
 
-    void Picking::calculateScissor(const glm::vec2& mousePos)
+    void Picking::registerGizmos(const Gizmo::Gizmos& gizmos)
     {
-        glm::vec2 mouseCoords = mousePos * glm::vec2(mpFBO->getWidth(), mpFBO->getHeight());;
-
-        mScissor.top = (int32_t)mouseCoords.y;
-        mScissor.left = (int32_t)mouseCoords.x;
-        mScissor.right = mScissor.left + 1;
-        mScissor.bottom = mScissor.top + 1;
+        mSceneGizmos = gizmos;
     }
 }
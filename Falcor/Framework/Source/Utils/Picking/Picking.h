@@ -27,36 +27,44 @@
 ***************************************************************************/
 #pragma once
 
-#include "Graphics/Scene/SceneRenderer.h"
+#include "Graphics/Scene/Scene.h"
 #include "Graphics/Model/ObjectInstance.h"
 #include "Graphics/Scene/Editor/Gizmo.h"
-#include <unordered_set>
 
 namespace Falcor
 {
-    /** SceneRenderer extended to add picking capabilities. Determines which object in the scene was clicked by the mouse.
+    /** Determines which object in the scene was clicked by the mouse.
+        Picking traces a ray on the CPU, through the scene's BVH and the meshes' triangle BVHs, so there is no GPU round trip.
+        Models need to be loaded with Model::LoadFlags::KeepCpuGeometry to be picked by their triangles, other meshes are picked by their bounding-boxes.
     */
-    class Picking : public SceneRenderer
+    class Picking
     {
     public:
         using UniquePtr = std::unique_ptr<Picking>;
         using UniqueConstPtr = std::unique_ptr<const Picking>;
 
+        static const uint32_t kInvalidTriangle = (uint32_t)-1;  ///< Picked triangle of meshes without CPU geometry, which are picked by their bounding-box
+
         /** Creates an instance of the scene picker.
             \param[in] pScene Scene to pick.
-            \param[in] fboWidth Size of internal FBO used for picking.
-            \param[in] fboHeight Size of internal FBO used for picking.
             \return New Picking instance for pScene.
         */
-        static UniquePtr create(const Scene::SharedPtr& pScene, uint32_t fboWidth, uint32_t fboHeight);
+        static UniquePtr create(const Scene::SharedPtr& pScene);
 
         /** Performs a picking operation on the scene and stores the result.
             \param[in] mousePos Mouse position in the range [0,1] with (0,0) being the top left corner. Same coordinate space as in MouseEvent.
-            \param[in] pContext Render context to render scene with.
             \param[in] pCamera Active camera to pick from.
             \return Whether an object was picked or not.
         */
-        bool pick(RenderContext* pContext, const glm::vec2& mousePos, const Camera::SharedPtr& pCamera);
+        bool pick(const glm::vec2& mousePos, const Camera* pCamera);
+
+        /** Find the closest object hit by a ray and store the result.
+            \param[in] origin Ray origin in world space.
+            \param[in] direction Ray direction in world space. Distances are in multiples of its length.
+            \param[in] tMax Max distance along the ray.
+            \return Whether an object was picked or not.
+        */
+        bool pick(const glm::vec3& origin, const glm::vec3& direction, float tMax);
 
         /** Gets the picked mesh instance.
             \return Pointer to the picked mesh instance, otherwise nullptr if nothing was picked.
@@ -68,57 +76,40 @@ namespace Falcor
         */
         Scene::ModelInstance::SharedPtr getPickedModelInstance() const;
 
-        /** Resize the internal FBO used for picking.
-            \param[in] width Width of the FBO.
-            \param[in] height Height of the FBO.
+        /** Get the index of the picked triangle in its mesh, or kInvalidTriangle if the mesh was picked by its bounding-box.
         */
-        void resizeFBO(uint32_t width, uint32_t height);
-
-        // #HACK For picking the editor scene, register gizmos to conditionally set states
-        void registerGizmos(const Gizmo::Gizmos& gizmos);
+        uint32_t getPickedTriangle() const { return mPickResult.triangleID; }
 
-    private:
+        /** Get the barycentrics of the picked point, relative to the second and third vertices of the triangle.
+        */
+        const glm::vec2& getPickedBarycentrics() const { return mPickResult.barycentrics; }
 
-        Picking(const Scene::SharedPtr& pScene, uint32_t fboWidth, uint32_t fboHeight);
+        /** Get the distance along the ray to the picked point.
+        */
+        float getPickedDistance() const { return mPickResult.distance; }
 
-        void renderScene(RenderContext* pContext, Camera* pCamera);
-        void readPickResults(RenderContext* pContext);
+        // #HACK For picking the editor scene, register gizmos so they take priority over the other objects
+        void registerGizmos(const Gizmo::Gizmos& gizmos);
 
-        virtual void setPerFrameData(const CurrentWorkingData& currentData) override;
-        virtual bool setPerModelData(const CurrentWorkingData& currentData) override;
-        virtual bool setPerMeshInstanceData(const CurrentWorkingData& currentData, const Scene::ModelInstance* pModelInstance, const Model::MeshInstance* pMeshInstance, uint32_t drawInstanceID) override;
-        virtual bool setPerMaterialData(const CurrentWorkingData& currentData, const Material* pMaterial) override;
+    private:
 
-        void calculateScissor(const glm::vec2& mousePos);
+        Picking(const Scene::SharedPtr& pScene);
 
-        struct Instance
+        struct Result
         {
             Scene::ModelInstance::SharedPtr pModelInstance;
             Model::MeshInstance::SharedPtr pMeshInstance;
-
-            Instance() {}
-
-            Instance(Scene::ModelInstance::SharedPtr pModelInstance, Model::MeshInstance::SharedPtr pMeshInstance)
-                : pModelInstance(pModelInstance), pMeshInstance(pMeshInstance) {}
+            uint32_t triangleID = kInvalidTriangle;
+            glm::vec2 barycentrics;
+            float distance = 0;
         };
 
-        Gizmo::Gizmos mSceneGizmos;
-
-        std::unordered_map<uint32_t, Instance> mDrawIDToInstance;
-        Instance mPickResult;
-
-        Fbo::SharedPtr mpFBO;
-        GraphicsState::SharedPtr mpGraphicsState;
-
-        GraphicsProgram::SharedPtr mpProgram;
-        GraphicsVars::SharedPtr mpProgramVars;
-
-        // Separate program for rotation gizmos because away-facing parts are discarded :(
-        GraphicsProgram::SharedPtr mpRotGizmoProgram;
-
-        DepthStencilState::SharedPtr mpSetStencilDS;
-        DepthStencilState::SharedPtr mpExcludeStencilDS;
+        /** Find the closest hit among the mesh instances which are (or are not) part of a gizmo
+        */
+        bool intersect(const glm::vec3& origin, const glm::vec3& direction, float tMax, bool gizmos, Result& result) const;
 
-        GraphicsState::Scissor mScissor;
+        Scene::SharedPtr mpScene;
+        Gizmo::Gizmos mSceneGizmos;
+        Result mPickResult;
     };
 }
@@ -33,13 +33,21 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 #include <sys/ptrace.h>
 #include <gtk/gtk.h>
 #include <fstream>
 #include <fcntl.h>
 #include <libgen.h>
 #include <errno.h>
+#include <dlfcn.h>
+#include <cstdio>
 #include <algorithm>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 #include <experimental/filesystem>
 namespace fs = std::experimental::filesystem;
 
@@ -408,6 +416,132 @@ namespace Falcor
         return s.st_mtime;
     }
 
+    std::string getModuleFilename(const void* pAddress)
+    {
+        Dl_info info;
+        if (dladdr(pAddress, &info) == 0 || info.dli_fname == nullptr)
+        {
+            return std::string();
+        }
+        return canonicalizeFilename(info.dli_fname);
+    }
+
+    bool replaceFile(const std::string& src, const std::string& dst)
+    {
+        return std::rename(src.c_str(), dst.c_str()) == 0;
+    }
+
+    const void* mapFileForReading(const std::string& fullpath, size_t& size)
+    {
+        int fd = open(fullpath.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+            logError("Can't open file '" + fullpath + "' for mapping");
+            return nullptr;
+        }
+
+        struct stat s;
+        void* pData = MAP_FAILED;
+        if (fstat(fd, &s) == 0 && s.st_size > 0)
+        {
+            size = (size_t)s.st_size;
+            pData = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        // The mapping keeps a reference to the file, we don't need the descriptor anymore
+        close(fd);
+
+        if (pData == MAP_FAILED)
+        {
+            logError("Can't map file '" + fullpath + "'");
+            return nullptr;
+        }
+        return pData;
+    }
+
+    void unmapFile(const void* pData, size_t size)
+    {
+        munmap(const_cast<void*>(pData), size);
+    }
+
+    // inotify watches directories. Editors often save by replacing the file, which would drop a per-file watch
+    static struct
+    {
+        std::mutex mutex;
+        int fd = -1;
+        std::unordered_map<int, std::string> directories;   // Watch descriptor -> directory
+        std::unordered_map<std::string, int> watches;       // Directory -> watch descriptor
+        std::unordered_set<std::string> files;              // Canonicalized watched files
+    } gFileWatch;
+
+    bool watchFile(const std::string& fullpath)
+    {
+        std::string file = canonicalizeFilename(fullpath);
+        if (file.empty()) return false;
+        std::string directory = getDirectoryFromFile(file);
+
+        std::lock_guard<std::mutex> lock(gFileWatch.mutex);
+        if (gFileWatch.fd == -1)
+        {
+            gFileWatch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (gFileWatch.fd == -1)
+            {
+                logWarning("watchFile() - inotify_init1() failed with error " + std::to_string(errno));
+                return false;
+            }
+        }
+
+        if (gFileWatch.watches.find(directory) == gFileWatch.watches.end())
+        {
+            int wd = inotify_add_watch(gFileWatch.fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+            if (wd == -1)
+            {
+                logWarning("watchFile() - can't watch '" + directory + "', error " + std::to_string(errno));
+                return false;
+            }
+            gFileWatch.watches[directory] = wd;
+            gFileWatch.directories[wd] = directory;
+        }
+        gFileWatch.files.insert(file);
+        return true;
+    }
+
+    void getChangedFiles(std::vector<std::string>& files)
+    {
+        files.clear();
+        std::lock_guard<std::mutex> lock(gFileWatch.mutex);
+        if (gFileWatch.fd == -1) return;
+
+        std::unordered_set<std::string> changed;
+        alignas(struct inotify_event) char buffer[16 * 1024];
+        while (true)
+        {
+            ssize_t length = read(gFileWatch.fd, buffer, sizeof(buffer));
+            if (length <= 0) break;
+
+            for (const char* pEvent = buffer; pEvent < buffer + length;)
+            {
+                const struct inotify_event* pInfo = (const struct inotify_event*)pEvent;
+                pEvent += sizeof(struct inotify_event) + pInfo->len;
+
+                if (pInfo->mask & IN_Q_OVERFLOW)
+                {
+                    // Events were lost, report everything
+                    changed.insert(gFileWatch.files.begin(), gFileWatch.files.end());
+                    continue;
+                }
+
+                const auto& dirIt = gFileWatch.directories.find(pInfo->wd);
+                if (pInfo->len == 0 || dirIt == gFileWatch.directories.end()) continue;
+                std::string file = canonicalizeFilename(dirIt->second + '/' + pInfo->name);
+                if (gFileWatch.files.find(file) != gFileWatch.files.end())
+                {
+                    changed.insert(file);
+                }
+            }
+        }
+        files.assign(changed.begin(), changed.end());
+    }
+
     uint32_t bitScanReverse(uint32_t a)
     {
         // __builtin_clz counts 0's from the MSB, convert to index from the LSB
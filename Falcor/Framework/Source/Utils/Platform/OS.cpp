@@ -28,7 +28,9 @@
 #include "Framework.h"
 #include "Utils/Platform/OS.h"
 #include "Utils/StringUtils.h"
+#include "Graphics/TextureCache.h"
 #include <fstream>
+#include <mutex>
 #include <experimental/filesystem>
 namespace fs = std::experimental::filesystem;
 
@@ -53,7 +55,9 @@ namespace Falcor
         return 1 << bitScanReverse(a);
     }
 
-    std::vector<std::string> gDataDirectories =
+    // The data directories are searched from worker threads, e.g. when models are loaded concurrently. All accesses lock this mutex
+    static std::mutex gDataDirectoriesMutex;
+    static std::vector<std::string> gDataDirectories =
     {
         // Ordering matters here, we want that while developing, resources will be loaded from the development media directory
         std::string(getWorkingDirectory()),
@@ -71,18 +75,50 @@ namespace Falcor
 #endif
     };
 
-    const std::vector<std::string>& getDataDirectoriesList()
+    // Expects gDataDirectoriesMutex to be locked
+    static void initDataDirectories()
     {
+        static bool bInit = false;
+        if (bInit == false)
+        {
+            std::string dataDirs;
+            if (getEnvironmentVariable("FALCOR_MEDIA_FOLDERS", dataDirs))
+            {
+                auto folders = splitString(dataDirs, ";");
+                gDataDirectories.insert(gDataDirectories.end(), folders.begin(), folders.end());
+            }
+            bInit = true;
+        }
+    }
+
+    std::vector<std::string> getDataDirectoriesList()
+    {
+        std::lock_guard<std::mutex> lock(gDataDirectoriesMutex);
+        initDataDirectories();
         return gDataDirectories;
     }
 
     void addDataDirectory(const std::string& dataDir)
     {
-        //Insert unique elements
-        if (std::find(gDataDirectories.begin(), gDataDirectories.end(), dataDir) == gDataDirectories.end())
         {
+            std::lock_guard<std::mutex> lock(gDataDirectoriesMutex);
+            initDataDirectories();
+            //Insert unique elements
+            if (std::find(gDataDirectories.begin(), gDataDirectories.end(), dataDir) != gDataDirectories.end()) return;
             gDataDirectories.push_back(dataDir);
         }
+        TextureCache::clearResolvedPaths();
+    }
+
+    void removeDataDirectory(const std::string& dataDir)
+    {
+        {
+            std::lock_guard<std::mutex> lock(gDataDirectoriesMutex);
+            auto it = std::find(gDataDirectories.begin(), gDataDirectories.end(), dataDir);
+            if (it == gDataDirectories.end()) return;
+            gDataDirectories.erase(it);
+        }
+        TextureCache::clearResolvedPaths();
     }
 
     std::string canonicalizeFilename(const std::string& filename)
@@ -93,18 +129,6 @@ namespace Falcor
 
     bool findFileInDataDirectories(const std::string& filename, std::string& fullpath)
     {
-        static bool bInit = false;
-        if (bInit == false)
-        {
-            std::string dataDirs;
-            if (getEnvironmentVariable("FALCOR_MEDIA_FOLDERS", dataDirs))
-            {
-                auto folders = splitString(dataDirs, ";");
-                gDataDirectories.insert(gDataDirectories.end(), folders.begin(), folders.end());
-            }
-            bInit = true;
-        }
-
         // Check if this is an absolute path
         if (doesFileExist(filename))
         {
@@ -112,7 +136,8 @@ namespace Falcor
             return true;
         }
 
-        for (const auto& Dir : gDataDirectories)
+        // Search a copy, so the file system isn't accessed while holding the lock
+        for (const auto& Dir : getDataDirectoriesList())
         {
             fullpath = canonicalizeFilename(Dir + '/' + filename);
             if (doesFileExist(fullpath))
@@ -145,7 +170,7 @@ namespace Falcor
     {
         std::string stripped = filename;
         std::string canonFile = canonicalizeFilename(filename);
-        for (const auto& dir : gDataDirectories)
+        for (const auto& dir : getDataDirectoriesList())
         {
             std::string canonDir = canonicalizeFilename(dir);
             if (canonDir.size() && hasPrefix(canonFile, canonDir, false))
@@ -143,9 +143,9 @@ namespace Falcor
     */
     bool getEnvironmentVariable(const std::string& varName, std::string& value);
 
-    /** Get a list of all recorded data directories.
+    /** Get a list of all recorded data directories. Returns a copy, since other threads may add or remove directories.
     */
-    const std::vector<std::string>& getDataDirectoriesList();
+    std::vector<std::string> getDataDirectoriesList();
 
     /** Read a file into a string. The function expects a full path to the file, and will not look in the common directories.
         \param[in] fullpath The path to the requested file
@@ -159,6 +159,11 @@ namespace Falcor
     */
     void addDataDirectory(const std::string& dir);
 
+    /** Removes a folder from the search directories
+        \param[in] dir The directory to remove. Must match the string it was added with.
+    */
+    void removeDataDirectory(const std::string& dir);
+
     /** Find a new filename based on the supplied parameters. This function doesn't actually create the file, just find an available file name.
         \param[in] prefix Requested file prefix.
         \param[in] directory The directory to create the file in.
@@ -226,6 +231,43 @@ namespace Falcor
     */
     time_t getFileModifiedTime(const std::string& filename);
 
+    /** Get the full path of the executable or shared library which contains an address
+        \param[in] pAddress The address of a function or a global variable in the module
+        \return The full path of the module, or an empty string if it can't be found
+    */
+    std::string getModuleFilename(const void* pAddress);
+
+    /** Move a file, replacing the destination if it already exists. Within a volume the destination is replaced atomically, so readers see either the old or the new file
+        \param[in] src The file to move
+        \param[in] dst The new name of the file
+        \return true if the file was moved, otherwise false
+    */
+    bool replaceFile(const std::string& src, const std::string& dst);
+
+    /** Map a file into the address space of the process for reading. The function expects a full path to the file.
+        \param[in] fullpath The file to map
+        \param[out] size The size of the file in bytes
+        \return A pointer to the file data, or nullptr if the file couldn't be mapped. Release it using unmapFile()
+    */
+    const void* mapFileForReading(const std::string& fullpath, size_t& size);
+
+    /** Release a file mapping created by mapFileForReading()
+        \param[in] pData The pointer returned by mapFileForReading()
+        \param[in] size The size returned by mapFileForReading()
+    */
+    void unmapFile(const void* pData, size_t size);
+
+    /** Start watching a file for modifications. Modifications are collected by the OS and reported by getChangedFiles(), the file itself is never polled.
+        \param[in] fullpath Full path of the file
+        \return true if the file is being watched, false if the OS can't watch it
+    */
+    bool watchFile(const std::string& fullpath);
+
+    /** Get the watched files which were modified since the last call. This only drains the OS change notifications, it doesn't access the files.
+        \param[out] files On return, the canonicalized full paths of the modified files
+    */
+    void getChangedFiles(std::vector<std::string>& files);
+
     enum class ThreadPriorityType : int32_t
     {
         BackgroundBegin     = -2,   //< Indicates I/O-intense thread
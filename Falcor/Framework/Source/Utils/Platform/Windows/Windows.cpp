@@ -36,6 +36,9 @@
 #include <sys/types.h>
 #include "API/Window.h"
 #include "psapi.h"
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 // Always run in Optimus mode on laptops
 extern "C"
@@ -310,6 +313,156 @@ namespace Falcor
         return s.st_mtime;
     }
 
+    std::string getModuleFilename(const void* pAddress)
+    {
+        HMODULE hModule = nullptr;
+        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT, (LPCSTR)pAddress, &hModule) == FALSE)
+        {
+            return std::string();
+        }
+
+        char filename[MAX_PATH];
+        DWORD length = GetModuleFileNameA(hModule, filename, ARRAYSIZE(filename));
+        if (length == 0 || length == ARRAYSIZE(filename)) return std::string();
+        return canonicalizeFilename(filename);
+    }
+
+    bool replaceFile(const std::string& src, const std::string& dst)
+    {
+        return MoveFileExA(src.c_str(), dst.c_str(), MOVEFILE_REPLACE_EXISTING) != FALSE;
+    }
+
+    const void* mapFileForReading(const std::string& fullpath, size_t& size)
+    {
+        HANDLE hFile = CreateFileA(fullpath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            logError("Can't open file '" + fullpath + "' for mapping");
+            return nullptr;
+        }
+
+        LARGE_INTEGER fileSize;
+        HANDLE hMapping = nullptr;
+        void* pData = nullptr;
+        if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0)
+        {
+            size = (size_t)fileSize.QuadPart;
+            hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        }
+        if (hMapping)
+        {
+            pData = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+            // The view keeps a reference to the mapping object, we don't need the handles anymore
+            CloseHandle(hMapping);
+        }
+        CloseHandle(hFile);
+
+        if (pData == nullptr)
+        {
+            logError("Can't map file '" + fullpath + "'");
+        }
+        return pData;
+    }
+
+    void unmapFile(const void* pData, size_t size)
+    {
+        UnmapViewOfFile(pData);
+    }
+
+    // ReadDirectoryChangesW watches directories. Each directory has an overlapped read pending at all times, getChangedFiles() collects the completed ones without blocking
+    struct DirectoryWatch
+    {
+        HANDLE hDirectory = INVALID_HANDLE_VALUE;
+        OVERLAPPED overlapped = {};
+        DWORD buffer[16 * 1024];
+        std::string path;
+    };
+
+    static struct
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<DirectoryWatch>> directories;
+        std::unordered_set<std::string> files;  // Canonicalized watched files
+    } gFileWatch;
+
+    static bool issueDirectoryRead(DirectoryWatch* pWatch)
+    {
+        const DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME;
+        return ReadDirectoryChangesW(pWatch->hDirectory, pWatch->buffer, sizeof(pWatch->buffer), FALSE, filter, nullptr, &pWatch->overlapped, nullptr) != 0;
+    }
+
+    bool watchFile(const std::string& fullpath)
+    {
+        std::string file = canonicalizeFilename(fullpath);
+        if (file.empty()) return false;
+        std::string directory = getDirectoryFromFile(file);
+
+        std::lock_guard<std::mutex> lock(gFileWatch.mutex);
+        if (gFileWatch.directories.find(directory) == gFileWatch.directories.end())
+        {
+            std::unique_ptr<DirectoryWatch> pWatch = std::make_unique<DirectoryWatch>();
+            pWatch->path = directory;
+            pWatch->hDirectory = CreateFileA(directory.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+            if (pWatch->hDirectory == INVALID_HANDLE_VALUE)
+            {
+                logWarning("watchFile() - can't open directory '" + directory + "'");
+                return false;
+            }
+            pWatch->overlapped.hEvent = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+            if (issueDirectoryRead(pWatch.get()) == false)
+            {
+                logWarning("watchFile() - can't watch directory '" + directory + "'");
+                CloseHandle(pWatch->overlapped.hEvent);
+                CloseHandle(pWatch->hDirectory);
+                return false;
+            }
+            gFileWatch.directories[directory] = std::move(pWatch);
+        }
+        gFileWatch.files.insert(file);
+        return true;
+    }
+
+    void getChangedFiles(std::vector<std::string>& files)
+    {
+        files.clear();
+        std::lock_guard<std::mutex> lock(gFileWatch.mutex);
+
+        std::unordered_set<std::string> changed;
+        for (auto& dir : gFileWatch.directories)
+        {
+            DirectoryWatch* pWatch = dir.second.get();
+            DWORD bytes = 0;
+            if (GetOverlappedResult(pWatch->hDirectory, &pWatch->overlapped, &bytes, FALSE) == FALSE) continue;
+
+            if (bytes == 0)
+            {
+                // The buffer overflowed and the events were lost. Report all the files in the directory
+                for (const auto& file : gFileWatch.files)
+                {
+                    if (getDirectoryFromFile(file) == pWatch->path) changed.insert(file);
+                }
+            }
+            else
+            {
+                const uint8_t* pEvent = (const uint8_t*)pWatch->buffer;
+                while (true)
+                {
+                    const FILE_NOTIFY_INFORMATION* pInfo = (const FILE_NOTIFY_INFORMATION*)pEvent;
+                    std::wstring name(pInfo->FileName, pInfo->FileNameLength / sizeof(WCHAR));
+                    std::string file = canonicalizeFilename(pWatch->path + '/' + wstring_2_string(name));
+                    if (gFileWatch.files.find(file) != gFileWatch.files.end())
+                    {
+                        changed.insert(file);
+                    }
+                    if (pInfo->NextEntryOffset == 0) break;
+                    pEvent += pInfo->NextEntryOffset;
+                }
+            }
+            issueDirectoryRead(pWatch);
+        }
+        files.assign(changed.begin(), changed.end());
+    }
+
     uint64_t getTotalVirtualMemory()
     {
         MEMORYSTATUSEX memInfo;
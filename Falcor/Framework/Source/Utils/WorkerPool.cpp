@@ -0,0 +1,154 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "WorkerPool.h"
+#include <atomic>
+#include <algorithm>
+
+namespace Falcor
+{
+    WorkerPool::SharedPtr WorkerPool::create(uint32_t threadCount)
+    {
+        if(threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return SharedPtr(new WorkerPool(threadCount));
+    }
+
+    WorkerPool& WorkerPool::getGlobal()
+    {
+        static SharedPtr spGlobal = create();
+        return *spGlobal;
+    }
+
+    WorkerPool::WorkerPool(uint32_t threadCount)
+    {
+        mThreads.reserve(threadCount);
+        for(uint32_t i = 0; i < threadCount; i++)
+        {
+            mThreads.emplace_back(&WorkerPool::workerFunc, this);
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+        }
+        mCondition.notify_all();
+        for(auto& t : mThreads)
+        {
+            t.join();
+        }
+    }
+
+    void WorkerPool::enqueue(Job job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mJobs.push_back(std::move(job));
+        }
+        mCondition.notify_one();
+    }
+
+    void WorkerPool::workerFunc()
+    {
+        while(true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mCondition.wait(lock, [this]() { return mTerminate || mJobs.empty() == false; });
+                if(mJobs.empty())
+                {
+                    return;
+                }
+                job = std::move(mJobs.front());
+                mJobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    void WorkerPool::parallelFor(uint32_t begin, uint32_t end, const std::function<void(uint32_t)>& func, uint32_t grainSize)
+    {
+        if(begin >= end) return;
+        grainSize = std::max(1u, grainSize);
+        const uint32_t chunkCount = (end - begin + grainSize - 1) / grainSize;
+
+        // Don't bother the workers if there's nothing to split
+        if(chunkCount == 1 || mThreads.empty())
+        {
+            for(uint32_t i = begin; i < end; i++) func(i);
+            return;
+        }
+
+        // The shared state outlives this call, since helper jobs which were queued behind other work might only start after we returned.
+        // Completion is tracked per-chunk, so we never wait on a helper which didn't start, which means nested calls can't deadlock.
+        struct State
+        {
+            std::atomic<uint32_t> nextChunk;
+            std::atomic<uint32_t> doneChunks;
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+        auto pState = std::make_shared<State>();
+        pState->nextChunk = 0;
+        pState->doneChunks = 0;
+
+        auto runChunks = [pState, begin, end, grainSize, chunkCount, &func]()
+        {
+            while(true)
+            {
+                uint32_t chunk = pState->nextChunk.fetch_add(1);
+                if(chunk >= chunkCount) return;
+                uint32_t first = begin + chunk * grainSize;
+                uint32_t last = std::min(end, first + grainSize);
+                for(uint32_t i = first; i < last; i++) func(i);
+
+                if(pState->doneChunks.fetch_add(1) + 1 == chunkCount)
+                {
+                    std::lock_guard<std::mutex> lock(pState->mutex);
+                    pState->condition.notify_all();
+                }
+            }
+        };
+
+        uint32_t helperCount = std::min(chunkCount - 1, getThreadCount());
+        for(uint32_t i = 0; i < helperCount; i++)
+        {
+            enqueue(runChunks);
+        }
+        runChunks();
+
+        std::unique_lock<std::mutex> lock(pState->mutex);
+        pState->condition.wait(lock, [&]() { return pState->doneChunks == chunkCount; });
+    }
+}
@@ -0,0 +1,95 @@
+/***************************************************************************
+# Copyright (c) 2018, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <deque>
+#include <vector>
+
+namespace Falcor
+{
+    /** A pool of worker threads for CPU-side jobs (asset decoding, mesh processing, etc.).
+        Jobs are executed in submission order. Most code should use the global pool instead of creating a new one.
+    */
+    class WorkerPool
+    {
+    public:
+        using SharedPtr = std::shared_ptr<WorkerPool>;
+        using Job = std::function<void()>;
+
+        /** Create a new pool
+            \param[in] threadCount Number of worker threads. 0 means one thread per hardware thread.
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+        ~WorkerPool();
+
+        /** Get the framework's global pool. It is created on first use.
+        */
+        static WorkerPool& getGlobal();
+
+        /** Submit a job to the pool.
+            \return A future which becomes ready once the job has executed
+        */
+        template<typename Func>
+        auto submit(Func&& func) -> std::future<decltype(func())>
+        {
+            using ResultType = decltype(func());
+            auto pTask = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+            std::future<ResultType> result = pTask->get_future();
+            enqueue([pTask]() { (*pTask)(); });
+            return result;
+        }
+
+        /** Call func(i) for every i in [begin, end), distributing the work across the pool. Blocks until all the calls returned.
+            The calling thread participates in the work, so it is safe to call this from inside a worker job.
+            \param[in] begin First index
+            \param[in] end One past the last index
+            \param[in] func The function to execute
+            \param[in] grainSize Number of consecutive indices a thread processes at once
+        */
+        void parallelFor(uint32_t begin, uint32_t end, const std::function<void(uint32_t)>& func, uint32_t grainSize = 1);
+
+        /** Get the number of worker threads
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mThreads.size(); }
+
+    private:
+        WorkerPool(uint32_t threadCount);
+        void enqueue(Job job);
+        void workerFunc();
+
+        std::vector<std::thread> mThreads;
+        std::deque<Job> mJobs;
+        std::mutex mMutex;
+        std::condition_variable mCondition;
+        bool mTerminate = false;
+    };
+}
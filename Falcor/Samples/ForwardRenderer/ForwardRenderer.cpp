@@ -58,7 +58,8 @@ void ForwardRenderer::initDepthPass()
 void ForwardRenderer::initLightingPass()
 {
     mLightingPass.pProgram = GraphicsProgram::createFromFile("ForwardRenderer.slang", "vs", "ps");
-    mLightingPass.pProgram->addDefine("_LIGHT_COUNT", std::to_string(mpSceneRenderer->getScene()->getLightCount()));
+    // Without light clusters, the lights come from the gLights array
+    mLightingPass.pProgram->addDefine("_LIGHT_COUNT", std::to_string(std::min(mpSceneRenderer->getScene()->getLightCount(), (uint32_t)MAX_LIGHT_SOURCES)));
     initControls();
     mLightingPass.pVars = GraphicsVars::create(mLightingPass.pProgram->getReflector());
     
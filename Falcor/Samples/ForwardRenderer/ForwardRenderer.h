@@ -184,6 +184,7 @@ private:
         EnableHashedAlpha,
         EnableTransparency,
         VisualizeCascades,
+        EnableLightClusters,
         Count
     };
 
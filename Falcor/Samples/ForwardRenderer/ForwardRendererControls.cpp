@@ -52,6 +52,7 @@ void ForwardRenderer::initControls()
     mControls[ControlID::EnableTransparency] = { false, false, "_ENABLE_TRANSPARENCY" };
     mControls[ControlID::EnableSSAO] = { true, false, "" };
     mControls[ControlID::VisualizeCascades] = { false, false, "_VISUALIZE_CASCADES" };
+    mControls[ControlID::EnableLightClusters] = { true, false, "_ENABLE_LIGHT_CLUSTERS" };
 
     for (uint32_t i = 0; i < ControlID::Count; i++)
     {
@@ -332,5 +333,11 @@ void ForwardRenderer::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
         {
             applyLightingProgramControl(ControlID::EnableHashedAlpha);
         }
+
+        if (pGui->addCheckBox("Clustered Lighting", mControls[ControlID::EnableLightClusters].enabled))
+        {
+            applyLightingProgramControl(ControlID::EnableLightClusters);
+            mpSceneRenderer->toggleLightClusters(mControls[ControlID::EnableLightClusters].enabled);
+        }
     }
 }
@@ -82,6 +82,10 @@ void ModelViewer::loadModelFromFile(const std::string& filename, ResourceFormat
     {
         flags |= Model::LoadFlags::DontGenerateTangentSpace;
     }
+    if (mOptimizeMeshes)
+    {
+        flags |= Model::LoadFlags::OptimizeMeshes;
+    }
 
     flags |= isSrgbFormat(fboFormat) ? Model::LoadFlags::None : Model::LoadFlags::AssumeLinearSpaceTextures;
     mpModel = Model::createFromFile(filename.c_str(), flags);
@@ -138,6 +142,7 @@ void ModelViewer::onGuiRender(SampleCallbacks* pSample, Gui* pGui)
     if (pGui->beginGroup("Load Options"))
     {
         pGui->addCheckBox("Generate Tangent Space", mGenerateTangentSpace);
+        pGui->addCheckBox("Optimize Meshes", mOptimizeMeshes);
         if (pGui->addButton("Export Model To Binary File"))
         {
             saveModel();
@@ -79,6 +79,7 @@ private:
     bool mDrawWireframe = false;
     bool mAnimate = false;
     bool mGenerateTangentSpace = true;
+    bool mOptimizeMeshes = false;
     glm::vec3 mAmbientIntensity = glm::vec3(0.1f, 0.1f, 0.1f);
 
     uint32_t mActiveAnimationID = kBindPoseAnimationID;
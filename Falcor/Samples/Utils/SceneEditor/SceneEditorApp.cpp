@@ -93,7 +93,7 @@ void SceneEditorApp::loadScene()
     {
         reset();
 
-        mpScene = Scene::loadFromFile(Filename, Model::LoadFlags::None, Scene::LoadFlags::None);
+        mpScene = Scene::loadFromFile(Filename, Model::LoadFlags::KeepCpuGeometry, Scene::LoadFlags::None);
         initNewScene();
     }
 }
@@ -0,0 +1,248 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "AnimationTest.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include <algorithm>
+
+const float AnimationTest::kDuration = 100.0f;
+
+void AnimationTest::addTests()
+{
+    addTestToList<TestUniformKeys>();
+    addTestToList<TestNonUniformKeys>();
+    addTestToList<TestConstantAndMissingChannels>();
+    addTestToList<TestStatelessSampling>();
+}
+
+Animation::AnimationSet AnimationTest::createAnimationSet(std::mt19937& rng, uint32_t boneID, uint32_t keyCount, bool uniform)
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+    std::uniform_real_distribution<float> time(1.0f, kDuration - 1.0f);
+
+    // Uniform keys end one step before the duration, so sampling also wraps from the last key to the first
+    std::vector<float> times(keyCount);
+    for (uint32_t k = 0; k < keyCount; k++)
+    {
+        times[k] = uniform ? kDuration * (float)k / (float)keyCount : time(rng);
+    }
+    std::sort(times.begin(), times.end());
+
+    // Rotations move by less than 90 degrees between keys, like a sampled motion
+    Animation::AnimationSet set;
+    set.boneID = boneID;
+    glm::vec3 translation(0);
+    glm::quat rotation(1, 0, 0, 0);
+    for (uint32_t k = 0; k < keyCount; k++)
+    {
+        translation = glm::clamp(translation + glm::vec3(unit(rng), unit(rng), unit(rng)) * 2.0f, glm::vec3(-10), glm::vec3(10));
+        rotation = glm::normalize(rotation * glm::angleAxis(unit(rng), glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0, 0, 2))));
+        set.translation.keys.push_back({ translation, times[k] });
+        set.scaling.keys.push_back({ glm::vec3(scale(rng), scale(rng), scale(rng)), times[k] });
+        set.rotation.keys.push_back({ rotation, times[k] });
+    }
+    return set;
+}
+
+AnimationController::UniquePtr AnimationTest::createController(const std::vector<Animation::AnimationSet>& sets)
+{
+    // Root bones with identity offsets, so the bone matrices are the sampled local transforms
+    std::vector<Bone> bones(sets.size());
+    for (uint32_t i = 0; i < (uint32_t)bones.size(); i++)
+    {
+        bones[i].parentID = AnimationController::kInvalidBoneID;
+        bones[i].boneID = i;
+        bones[i].name = "Bone" + std::to_string(i);
+        bones[i].offset = bones[i].localTransform = bones[i].originalLocalTransform = bones[i].globalTransform = glm::mat4(1);
+    }
+
+    AnimationController::UniquePtr pController = AnimationController::create(bones);
+    pController->addAnimation(Animation::create("Test", sets, kDuration, 1.0f));
+    pController->setActiveAnimation(0);
+    return pController;
+}
+
+namespace
+{
+    // Sample uncompressed keys. Between the last key and the first one, the value wraps around the end of the animation.
+    template<typename T, typename Func>
+    T sampleChannel(const Animation::AnimationChannel<T>& channel, float ticks, float duration, const T& defaultValue, Func interpolate)
+    {
+        const auto& keys = channel.keys;
+        if (keys.empty()) return defaultValue;
+        if (keys.size() == 1) return keys[0].value;
+
+        size_t next = 0;
+        while (next < keys.size() && keys[next].time <= ticks) next++;
+        if (next > 0 && next < keys.size())
+        {
+            const auto& k0 = keys[next - 1];
+            const auto& k1 = keys[next];
+            return interpolate(k0.value, k1.value, (ticks - k0.time) / (k1.time - k0.time));
+        }
+
+        const auto& k0 = keys.back();
+        const float t = (ticks < k0.time) ? ticks + duration : ticks;
+        return interpolate(k0.value, keys[0].value, (t - k0.time) / (keys[0].time + duration - k0.time));
+    }
+}
+
+glm::mat4 AnimationTest::sampleReference(const Animation::AnimationSet& set, float ticks)
+{
+    auto lerp = [](const glm::vec3& a, const glm::vec3& b, float t) { return glm::mix(a, b, t); };
+    auto slerp = [](const glm::quat& a, const glm::quat& b, float t) { return glm::slerp(a, b, t); };
+    glm::vec3 translation = sampleChannel(set.translation, ticks, kDuration, glm::vec3(0), lerp);
+    glm::vec3 scaling = sampleChannel(set.scaling, ticks, kDuration, glm::vec3(1), lerp);
+    glm::quat rotation = sampleChannel(set.rotation, ticks, kDuration, glm::quat(1, 0, 0, 0), slerp);
+    return glm::translate(glm::mat4(1), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1), scaling);
+}
+
+bool AnimationTest::compare(const glm::mat4& result, const glm::mat4& reference)
+{
+    // Translations use 16 bits over a range of 20. Rotations use 15 bits per component, and the error of the reconstructed component is amplified by the scaling.
+    const float tolerance = 2e-3f;
+    for (uint32_t c = 0; c < 4; c++)
+    {
+        glm::vec4 diff = glm::abs(result[c] - reference[c]);
+        if (diff.x > tolerance || diff.y > tolerance || diff.z > tolerance || diff.w > tolerance) return false;
+    }
+    return true;
+}
+
+bool AnimationTest::checkAnimation(const std::vector<Animation::AnimationSet>& sets, uint32_t seed)
+{
+    AnimationController::UniquePtr pController = createController(sets);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> time(0.0f, kDuration);
+
+    // Sample exactly on the keys, and at random times including before the first key and after the last one
+    std::vector<float> times;
+    for (const auto& set : sets)
+    {
+        for (const auto& key : set.translation.keys) times.push_back(key.time);
+    }
+    for (uint32_t i = 0; i < 500; i++) times.push_back(time(rng));
+
+    for (float t : times)
+    {
+        pController->animate(t);
+        const auto& matrices = pController->getBoneMatrices();
+        for (uint32_t b = 0; b < (uint32_t)sets.size(); b++)
+        {
+            if (compare(matrices[sets[b].boneID], sampleReference(sets[b], t)) == false) return false;
+        }
+    }
+    return true;
+}
+
+testing_func(AnimationTest, TestUniformKeys)
+{
+    std::mt19937 rng(1);
+    std::vector<Animation::AnimationSet> sets;
+    for (uint32_t b = 0; b < 8; b++)
+    {
+        sets.push_back(createAnimationSet(rng, b, 30, true));
+    }
+    if (checkAnimation(sets, 2) == false) return test_fail("Sampling uniformly spaced keys doesn't match the uncompressed keys");
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestNonUniformKeys)
+{
+    std::mt19937 rng(3);
+    std::vector<Animation::AnimationSet> sets;
+    for (uint32_t b = 0; b < 8; b++)
+    {
+        sets.push_back(createAnimationSet(rng, b, 2 + b * 5, false));
+    }
+    if (checkAnimation(sets, 4) == false) return test_fail("Sampling irregularly spaced keys doesn't match the uncompressed keys");
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestConstantAndMissingChannels)
+{
+    std::mt19937 rng(5);
+    std::vector<Animation::AnimationSet> sets;
+
+    // A single key per channel
+    sets.push_back(createAnimationSet(rng, 0, 1, false));
+
+    // Constant channels with several keys, and no scaling keys
+    Animation::AnimationSet constant = createAnimationSet(rng, 1, 10, true);
+    for (auto& key : constant.translation.keys) key.value = glm::vec3(1, -2, 3);
+    for (auto& key : constant.rotation.keys) key.value = constant.rotation.keys[0].value;
+    constant.scaling.keys.clear();
+    sets.push_back(constant);
+
+    // No keys at all, the bone stays at the identity
+    Animation::AnimationSet empty;
+    empty.boneID = 2;
+    sets.push_back(empty);
+
+    if (checkAnimation(sets, 6) == false) return test_fail("Constant or missing channels don't match the uncompressed keys");
+    return test_pass();
+}
+
+testing_func(AnimationTest, TestStatelessSampling)
+{
+    std::mt19937 rng(7);
+    std::vector<Animation::AnimationSet> sets;
+    for (uint32_t b = 0; b < 4; b++)
+    {
+        sets.push_back(createAnimationSet(rng, b, 20, b % 2 == 0));
+    }
+
+    // Controller copies share the animation. Sampling one must not affect the other, and the result must not depend on the previous sample time
+    AnimationController::UniquePtr pController = createController(sets);
+    AnimationController::UniquePtr pCopy = AnimationController::create(*pController);
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        const float forward = kDuration * (float)i / 100.0f;
+        const float backward = kDuration - forward - 0.5f;
+        pController->animate(forward);
+        pCopy->animate(backward);
+        for (uint32_t b = 0; b < (uint32_t)sets.size(); b++)
+        {
+            if (compare(pController->getBoneMatrices()[b], sampleReference(sets[b], forward)) == false) return test_fail("Sampling forward in time doesn't match the reference");
+            if (compare(pCopy->getBoneMatrices()[b], sampleReference(sets[b], backward)) == false) return test_fail("Sampling backward in time in a copy doesn't match the reference");
+        }
+    }
+
+    // Times past the duration loop
+    pController->animate(kDuration * 3 + 10.0f);
+    if (compare(pController->getBoneMatrices()[0], sampleReference(sets[0], 10.0f)) == false) return test_fail("The animation doesn't loop");
+    return test_pass();
+}
+
+int main()
+{
+    AnimationTest at;
+    at.init();
+    at.run();
+    return 0;
+}
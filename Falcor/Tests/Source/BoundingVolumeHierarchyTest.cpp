@@ -0,0 +1,293 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "BoundingVolumeHierarchyTest.h"
+#include "Graphics/Camera/Camera.h"
+#include <algorithm>
+#include <random>
+
+void BoundingVolumeHierarchyTest::addTests()
+{
+    addTestToList<TestBuild>();
+    addTestToList<TestQueryOverlap>();
+    addTestToList<TestIntersectRay>();
+    addTestToList<TestRefit>();
+    addTestToList<TestCull>();
+}
+
+std::vector<BoundingBox> BoundingVolumeHierarchyTest::createBoxes(uint32_t seed, uint32_t count)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> size(0.1f, 3.0f);
+
+    std::vector<BoundingBox> boxes(count);
+    for (auto& box : boxes)
+    {
+        box.center = glm::vec3(position(rng), position(rng), position(rng));
+        box.extent = glm::vec3(size(rng), size(rng), size(rng));
+    }
+    return boxes;
+}
+
+// The reference tests below use the same conventions as the tree: touching boxes overlap, and the ray starts at t = 0
+
+bool BoundingVolumeHierarchyTest::overlaps(const BoundingBox& a, const BoundingBox& b)
+{
+    return glm::all(glm::lessThanEqual(a.getMinPos(), b.getMaxPos())) && glm::all(glm::lessThanEqual(b.getMinPos(), a.getMaxPos()));
+}
+
+bool BoundingVolumeHierarchyTest::overlaps(const BoundingBox& box, const glm::vec3& center, float radius)
+{
+    glm::vec3 d = center - glm::clamp(center, box.getMinPos(), box.getMaxPos());
+    return glm::dot(d, d) <= radius * radius;
+}
+
+bool BoundingVolumeHierarchyTest::intersectRay(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& direction, float tMax, float& tEntry)
+{
+    const glm::vec3 invDir = 1.0f / direction;
+    glm::vec3 t0 = (box.getMinPos() - origin) * invDir;
+    glm::vec3 t1 = (box.getMaxPos() - origin) * invDir;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    tEntry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    return tEntry <= tExit;
+}
+
+bool BoundingVolumeHierarchyTest::checkBounds(const BoundingVolumeHierarchy* pBvh, const std::vector<BoundingBox>& boxes)
+{
+    // The tree stores min/max corners, so compare after the same conversions to avoid rounding differences
+    glm::vec3 min = boxes[0].getMinPos();
+    glm::vec3 max = boxes[0].getMaxPos();
+    for (const auto& box : boxes)
+    {
+        min = glm::min(min, box.getMinPos());
+        max = glm::max(max, box.getMaxPos());
+    }
+    const BoundingBox reference = BoundingBox::fromMinMax(min, max);
+    const BoundingBox bounds = pBvh->getBounds();
+    return bounds.getMinPos() == reference.getMinPos() && bounds.getMaxPos() == reference.getMaxPos();
+}
+
+bool BoundingVolumeHierarchyTest::checkOverlapQueries(const BoundingVolumeHierarchy* pBvh, const std::vector<BoundingBox>& boxes, uint32_t seed)
+{
+    std::vector<BoundingBox> queries = createBoxes(seed, 100);
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> radius(0.0f, 15.0f);
+
+    for (auto& query : queries)
+    {
+        query.extent *= 5.0f;
+        std::vector<uint32_t> boxResult;
+        std::vector<uint32_t> sphereResult;
+        const float r = radius(rng);
+        pBvh->queryOverlap(query, boxResult);
+        pBvh->queryOverlap(query.center, r, sphereResult);
+
+        std::vector<uint32_t> boxReference;
+        std::vector<uint32_t> sphereReference;
+        for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+        {
+            if (overlaps(boxes[i], query)) boxReference.push_back(i);
+            if (overlaps(boxes[i], query.center, r)) sphereReference.push_back(i);
+        }
+
+        std::sort(boxResult.begin(), boxResult.end());
+        std::sort(sphereResult.begin(), sphereResult.end());
+        if (boxResult != boxReference || sphereResult != sphereReference) return false;
+    }
+    return true;
+}
+
+testing_func(BoundingVolumeHierarchyTest, TestBuild)
+{
+    BoundingVolumeHierarchy::UniquePtr pBvh = BoundingVolumeHierarchy::create();
+    pBvh->build({});
+    std::vector<uint32_t> result;
+    pBvh->queryOverlap(BoundingBox::fromMinMax(glm::vec3(-1), glm::vec3(1)), result);
+    if (pBvh->getBoxCount() != 0 || result.empty() == false) return test_fail("An empty tree returned boxes");
+    if (pBvh->intersectRay(glm::vec3(0), glm::vec3(1), 10.0f, [](uint32_t, float tMax) { return tMax; }) != 10.0f) return test_fail("A ray query on an empty tree changed tMax");
+
+    std::vector<BoundingBox> boxes = createBoxes(1, 1000);
+    pBvh->build(boxes);
+    if (pBvh->getBoxCount() != boxes.size()) return test_fail("Wrong box count");
+
+    for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+    {
+        const BoundingBox reference = BoundingBox::fromMinMax(boxes[i].getMinPos(), boxes[i].getMaxPos());
+        if (pBvh->getBox(i).getMinPos() != reference.getMinPos() || pBvh->getBox(i).getMaxPos() != reference.getMaxPos()) return test_fail("A box changed when building the tree");
+    }
+    if (checkBounds(pBvh.get(), boxes) == false) return test_fail("The tree bounds aren't the union of the boxes");
+
+    // Boxes with the same centroid can't be split by the SAH, they must still all be found
+    std::vector<BoundingBox> stacked(3 * BoundingVolumeHierarchy::kMaxLeafSize, BoundingBox::fromMinMax(glm::vec3(-1), glm::vec3(1)));
+    pBvh->build(stacked);
+    pBvh->queryOverlap(glm::vec3(0), 0.5f, result);
+    if (result.size() != stacked.size()) return test_fail("Not all the boxes sharing a centroid were found");
+    return test_pass();
+}
+
+testing_func(BoundingVolumeHierarchyTest, TestQueryOverlap)
+{
+    std::vector<BoundingBox> boxes = createBoxes(2, 2000);
+    BoundingVolumeHierarchy::UniquePtr pBvh = BoundingVolumeHierarchy::create();
+    pBvh->build(boxes);
+    if (checkOverlapQueries(pBvh.get(), boxes, 3) == false) return test_fail("An overlap query doesn't match the brute-force result");
+
+    // Results are appended
+    std::vector<uint32_t> result = { 12345 };
+    pBvh->queryOverlap(boxes[7], result);
+    if (result[0] != 12345 || std::find(result.begin(), result.end(), 7) == result.end()) return test_fail("The query result wasn't appended");
+    return test_pass();
+}
+
+testing_func(BoundingVolumeHierarchyTest, TestIntersectRay)
+{
+    std::vector<BoundingBox> boxes = createBoxes(4, 2000);
+    BoundingVolumeHierarchy::UniquePtr pBvh = BoundingVolumeHierarchy::create();
+    pBvh->build(boxes);
+
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (uint32_t r = 0; r < 200; r++)
+    {
+        const glm::vec3 origin = glm::vec3(unit(rng), unit(rng), unit(rng)) * 60.0f;
+        const glm::vec3 direction = glm::vec3(unit(rng), unit(rng), unit(rng));
+        const float tMax = 100.0f;
+
+        // Collecting all the hits must find every box on the ray
+        std::vector<uint32_t> hits;
+        pBvh->intersectRay(origin, direction, tMax, [&hits](uint32_t boxID, float t) { hits.push_back(boxID); return t; });
+
+        std::vector<uint32_t> reference;
+        float closest = tMax;
+        uint32_t closestID = (uint32_t)-1;
+        for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+        {
+            float tEntry;
+            if (intersectRay(boxes[i], origin, direction, tMax, tEntry))
+            {
+                reference.push_back(i);
+                if (tEntry < closest)
+                {
+                    closest = tEntry;
+                    closestID = i;
+                }
+            }
+        }
+        std::sort(hits.begin(), hits.end());
+        if (hits != reference) return test_fail("The boxes hit by a ray don't match the brute-force result");
+
+        // Shrinking tMax to the hit distance finds the closest box, and prunes farther ones
+        uint32_t visited = 0;
+        uint32_t hitID = (uint32_t)-1;
+        float t = pBvh->intersectRay(origin, direction, tMax, [&](uint32_t boxID, float tCurrent)
+        {
+            visited++;
+            float tEntry;
+            if (intersectRay(boxes[boxID], origin, direction, tCurrent, tEntry) && tEntry < tCurrent)
+            {
+                hitID = boxID;
+                return tEntry;
+            }
+            return tCurrent;
+        });
+        // Several boxes can share the closest distance when the origin is inside them, so only the distance is compared
+        if (t != closest || (hitID == (uint32_t)-1) != (closestID == (uint32_t)-1)) return test_fail("The closest hit doesn't match the brute-force result");
+        if (visited > reference.size()) return test_fail("Boxes were visited more than once");
+    }
+    return test_pass();
+}
+
+testing_func(BoundingVolumeHierarchyTest, TestRefit)
+{
+    std::vector<BoundingBox> boxes = createBoxes(6, 1000);
+    BoundingVolumeHierarchy::UniquePtr pBvh = BoundingVolumeHierarchy::create();
+    pBvh->build(boxes);
+
+    // Move some of the boxes far away, including outside the original bounds
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> boxID(0, (uint32_t)boxes.size() - 1);
+    std::uniform_real_distribution<float> offset(-80.0f, 80.0f);
+    for (uint32_t i = 0; i < 100; i++)
+    {
+        uint32_t id = boxID(rng);
+        boxes[id].center += glm::vec3(offset(rng), offset(rng), offset(rng));
+        pBvh->updateBox(id, boxes[id]);
+    }
+    pBvh->refit();
+
+    if (checkBounds(pBvh.get(), boxes) == false) return test_fail("The refitted bounds aren't the union of the boxes");
+    if (checkOverlapQueries(pBvh.get(), boxes, 8) == false) return test_fail("An overlap query doesn't match the brute-force result after a refit");
+
+    // Refitting without changes does nothing
+    pBvh->refit();
+    if (checkOverlapQueries(pBvh.get(), boxes, 9) == false) return test_fail("A second refit broke the tree");
+    return test_pass();
+}
+
+testing_func(BoundingVolumeHierarchyTest, TestCull)
+{
+    std::vector<BoundingBox> boxes = createBoxes(10, 3000);
+    BoundingVolumeHierarchy::UniquePtr pBvh = BoundingVolumeHierarchy::create();
+    pBvh->build(boxes);
+
+    Camera::SharedPtr pCamera = Camera::create();
+    pCamera->setAspectRatio(1.5f);
+    pCamera->setDepthRange(0.1f, 60.0f);
+    pCamera->setUpVector(glm::vec3(0, 1, 0));
+
+    const glm::vec3 positions[] = { glm::vec3(0, 0, -70), glm::vec3(0), glm::vec3(30, 20, 10) };
+    for (const auto& position : positions)
+    {
+        pCamera->setPosition(position);
+        pCamera->setTarget(glm::vec3(5, 1, 0));
+
+        std::vector<uint32_t> mask;
+        pBvh->cull(pCamera.get(), mask);
+        if (mask.size() != (boxes.size() + 31) / 32) return test_fail("Wrong visibility mask size");
+
+        uint32_t visibleCount = 0;
+        for (uint32_t i = 0; i < (uint32_t)boxes.size(); i++)
+        {
+            const bool visible = Camera::isVisible(mask, i);
+            if (visible == pCamera->isObjectCulled(boxes[i])) return test_fail("The visibility of box " + std::to_string(i) + " doesn't match Camera::isObjectCulled()");
+            visibleCount += visible ? 1 : 0;
+        }
+        if (visibleCount == 0 || visibleCount == boxes.size()) return test_fail("The test camera should see some of the boxes, but not all of them");
+    }
+    return test_pass();
+}
+
+int main()
+{
+    BoundingVolumeHierarchyTest bvht;
+    bvht.init();
+    bvht.run();
+    return 0;
+}
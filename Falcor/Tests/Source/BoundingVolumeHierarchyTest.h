@@ -0,0 +1,49 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+#include "Utils/Math/BoundingVolumeHierarchy.h"
+
+class BoundingVolumeHierarchyTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override {};
+    register_testing_func(TestBuild);
+    register_testing_func(TestQueryOverlap);
+    register_testing_func(TestIntersectRay);
+    register_testing_func(TestRefit);
+    register_testing_func(TestCull);
+
+    static std::vector<BoundingBox> createBoxes(uint32_t seed, uint32_t count);
+    static bool overlaps(const BoundingBox& a, const BoundingBox& b);
+    static bool overlaps(const BoundingBox& box, const glm::vec3& center, float radius);
+    static bool intersectRay(const BoundingBox& box, const glm::vec3& origin, const glm::vec3& direction, float tMax, float& tEntry);
+    static bool checkBounds(const BoundingVolumeHierarchy* pBvh, const std::vector<BoundingBox>& boxes);
+    static bool checkOverlapQueries(const BoundingVolumeHierarchy* pBvh, const std::vector<BoundingBox>& boxes, uint32_t seed);
+};
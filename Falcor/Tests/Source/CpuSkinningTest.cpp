@@ -0,0 +1,227 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "CpuSkinningTest.h"
+#include <cstring>
+#include "glm/gtc/quaternion.hpp"
+
+void CpuSkinningTest::addTests()
+{
+    addTestToList<TestSkinVertices>();
+    addTestToList<TestSkinVerticesParallel>();
+    addTestToList<TestOptionalStreams>();
+    addTestToList<TestScatterVertexStream>();
+}
+
+SkinningInput CpuSkinningTest::TestMesh::getInput() const
+{
+    SkinningInput input;
+    input.pPositions = positions.data();
+    input.pNormals = normals.data();
+    input.pBitangents = bitangents.data();
+    input.pBoneWeights = boneWeights.data();
+    input.pBoneIds = boneIds.data();
+    return input;
+}
+
+CpuSkinningTest::TestMesh CpuSkinningTest::createTestMesh(uint32_t seed, uint32_t boneCount, uint32_t vertexCount)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 2.0f);
+    std::uniform_int_distribution<uint32_t> boneId(0, boneCount - 1);
+    auto randomVec3 = [&]() { return glm::vec3(unit(rng), unit(rng), unit(rng)); };
+
+    // Affine bones with non-uniform scale, so the inverse-transpose differs from the bone matrix
+    TestMesh mesh;
+    for (uint32_t b = 0; b < boneCount; b++)
+    {
+        glm::quat rotation = glm::normalize(glm::quat(unit(rng), unit(rng), unit(rng), unit(rng)));
+        glm::mat4 bone = glm::mat4_cast(rotation) * glm::mat4(glm::vec4(scale(rng), 0, 0, 0), glm::vec4(0, scale(rng), 0, 0), glm::vec4(0, 0, scale(rng), 0), glm::vec4(0, 0, 0, 1));
+        bone[3] = glm::vec4(randomVec3() * 10.0f, 1);
+        mesh.bones.push_back(bone);
+        mesh.bonesInvTranspose.push_back(glm::transpose(glm::inverse(bone)));
+    }
+
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        mesh.positions.push_back(randomVec3() * 5.0f);
+        mesh.normals.push_back(glm::normalize(randomVec3()));
+        mesh.bitangents.push_back(glm::normalize(randomVec3()));
+
+        glm::vec4 weights(std::abs(unit(rng)), std::abs(unit(rng)), std::abs(unit(rng)), std::abs(unit(rng)));
+        mesh.boneWeights.push_back(weights / (weights.x + weights.y + weights.z + weights.w + 1e-3f));
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            mesh.boneIds.push_back((uint8_t)boneId(rng));
+        }
+    }
+
+    // Scalar reference, blending the matrices one element at a time
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        glm::mat4 boneMat(0.0f);
+        glm::mat4 invTransposeMat(0.0f);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            const uint32_t id = mesh.boneIds[v * 4 + i];
+            const float w = mesh.boneWeights[v][i];
+            for (uint32_t c = 0; c < 4; c++)
+            {
+                for (uint32_t r = 0; r < 4; r++)
+                {
+                    boneMat[c][r] += mesh.bones[id][c][r] * w;
+                    invTransposeMat[c][r] += mesh.bonesInvTranspose[id][c][r] * w;
+                }
+            }
+        }
+        mesh.refPositions.push_back(glm::vec3(boneMat * glm::vec4(mesh.positions[v], 1)));
+        mesh.refNormals.push_back(glm::mat3(invTransposeMat) * mesh.normals[v]);
+        mesh.refBitangents.push_back(glm::mat3(boneMat) * mesh.bitangents[v]);
+    }
+    return mesh;
+}
+
+bool CpuSkinningTest::compare(const std::vector<glm::vec3>& result, const std::vector<glm::vec3>& reference, uint32_t first, uint32_t count)
+{
+    for (uint32_t v = first; v < first + count; v++)
+    {
+        // The SIMD code sums in a different order, allow for rounding relative to the magnitude
+        const float tolerance = 1e-5f * std::max(1.0f, glm::length(reference[v])) * 16;
+        const glm::vec3 diff = glm::abs(result[v] - reference[v]);
+        if (diff.x > tolerance || diff.y > tolerance || diff.z > tolerance)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+testing_func(CpuSkinningTest, TestSkinVertices)
+{
+    const uint32_t vertexCount = 257;
+    for (uint32_t seed = 0; seed < 8; seed++)
+    {
+        TestMesh mesh = createTestMesh(seed, 1 + seed * 9, vertexCount);
+        std::vector<glm::vec3> positions(vertexCount), normals(vertexCount), bitangents(vertexCount);
+        SkinningOutput output;
+        output.pPositions = positions.data();
+        output.pNormals = normals.data();
+        output.pBitangents = bitangents.data();
+
+        // Skin a range which doesn't start at the first vertex
+        const uint32_t first = 3;
+        const uint32_t count = vertexCount - first;
+        skinVertices(mesh.getInput(), mesh.bones.data(), mesh.bonesInvTranspose.data(), output, first, count);
+        if (compare(positions, mesh.refPositions, first, count) == false) return test_fail("Skinned positions don't match the reference");
+        if (compare(normals, mesh.refNormals, first, count) == false) return test_fail("Skinned normals don't match the reference");
+        if (compare(bitangents, mesh.refBitangents, first, count) == false) return test_fail("Skinned bitangents don't match the reference");
+    }
+    return test_pass();
+}
+
+testing_func(CpuSkinningTest, TestSkinVerticesParallel)
+{
+    // Not a multiple of the job size, so the last job has a partial range
+    const uint32_t vertexCount = 5000;
+    TestMesh mesh = createTestMesh(42, 64, vertexCount);
+    std::vector<glm::vec3> positions(vertexCount), normals(vertexCount), bitangents(vertexCount);
+    SkinningOutput output;
+    output.pPositions = positions.data();
+    output.pNormals = normals.data();
+    output.pBitangents = bitangents.data();
+
+    skinVerticesParallel(mesh.getInput(), mesh.bones.data(), mesh.bonesInvTranspose.data(), output, vertexCount);
+    if (compare(positions, mesh.refPositions, 0, vertexCount) == false) return test_fail("Skinned positions don't match the reference");
+    if (compare(normals, mesh.refNormals, 0, vertexCount) == false) return test_fail("Skinned normals don't match the reference");
+    if (compare(bitangents, mesh.refBitangents, 0, vertexCount) == false) return test_fail("Skinned bitangents don't match the reference");
+    return test_pass();
+}
+
+testing_func(CpuSkinningTest, TestOptionalStreams)
+{
+    const uint32_t vertexCount = 100;
+    TestMesh mesh = createTestMesh(7, 16, vertexCount);
+    const glm::vec3 sentinel(12345.0f);
+    std::vector<glm::vec3> positions(vertexCount), bitangents(vertexCount, sentinel);
+
+    // Meshes without bitangents, and outputs which aren't needed
+    SkinningInput input = mesh.getInput();
+    input.pBitangents = nullptr;
+    SkinningOutput output;
+    output.pPositions = positions.data();
+    output.pBitangents = bitangents.data();
+
+    skinVertices(input, mesh.bones.data(), mesh.bonesInvTranspose.data(), output, 0, vertexCount);
+    if (compare(positions, mesh.refPositions, 0, vertexCount) == false) return test_fail("Skinned positions don't match the reference");
+    for (const auto& b : bitangents)
+    {
+        if (b != sentinel) return test_fail("A stream without input was written");
+    }
+    return test_pass();
+}
+
+testing_func(CpuSkinningTest, TestScatterVertexStream)
+{
+    const uint32_t vertexCount = 33;
+    TestMesh mesh = createTestMesh(3, 4, vertexCount);
+
+    // Tightly packed float3s, padded float4s and an element after another one in the same vertex
+    const uint32_t layouts[][2] = { { 12, 0 }, { 16, 0 }, { 24, 12 } };
+    for (const auto& layout : layouts)
+    {
+        const uint32_t stride = layout[0];
+        const uint32_t offset = layout[1];
+        const uint8_t kFill = 0xcd;
+        std::vector<uint8_t> buffer(vertexCount * stride, kFill);
+        scatterVertexStream(mesh.refPositions.data(), vertexCount, stride, offset, buffer.data());
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            glm::vec3 p;
+            std::memcpy(&p, buffer.data() + v * stride + offset, sizeof(p));
+            if (p != mesh.refPositions[v]) return test_fail("Vertex " + std::to_string(v) + " wasn't written to its element with stride " + std::to_string(stride));
+
+            for (uint32_t b = 0; b < stride; b++)
+            {
+                if ((b < offset || b >= offset + sizeof(glm::vec3)) && buffer[v * stride + b] != kFill)
+                {
+                    return test_fail("Bytes outside of the element were overwritten with stride " + std::to_string(stride));
+                }
+            }
+        }
+    }
+    return test_pass();
+}
+
+int main()
+{
+    CpuSkinningTest cst;
+    cst.init();
+    cst.run();
+    return 0;
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+#include "Graphics/Model/CpuSkinning.h"
+#include <random>
+
+class CpuSkinningTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override {};
+    register_testing_func(TestSkinVertices);
+    register_testing_func(TestSkinVerticesParallel);
+    register_testing_func(TestOptionalStreams);
+    register_testing_func(TestScatterVertexStream);
+
+    // Random bones and vertices, with a scalar reference result
+    struct TestMesh
+    {
+        std::vector<glm::mat4> bones;
+        std::vector<glm::mat4> bonesInvTranspose;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;
+        std::vector<glm::vec3> bitangents;
+        std::vector<glm::vec4> boneWeights;
+        std::vector<uint8_t> boneIds;
+
+        std::vector<glm::vec3> refPositions;
+        std::vector<glm::vec3> refNormals;
+        std::vector<glm::vec3> refBitangents;
+
+        SkinningInput getInput() const;
+    };
+
+    static TestMesh createTestMesh(uint32_t seed, uint32_t boneCount, uint32_t vertexCount);
+    static bool compare(const std::vector<glm::vec3>& result, const std::vector<glm::vec3>& reference, uint32_t first, uint32_t count);
+};
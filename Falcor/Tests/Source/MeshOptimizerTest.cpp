@@ -0,0 +1,225 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshOptimizerTest.h"
+#include <algorithm>
+#include <random>
+
+void MeshOptimizerTest::addTests()
+{
+    addTestToList<TestAnalyzeVertexCache>();
+    addTestToList<TestOptimizeVertexCache>();
+    addTestToList<TestOptimizeOverdraw>();
+    addTestToList<TestOptimizeVertexFetch>();
+    addTestToList<TestVertexCacheReport>();
+}
+
+MeshOptimizerTest::TestMesh MeshOptimizerTest::createShuffledGrid(uint32_t size, uint32_t seed)
+{
+    // A regular grid with its triangles in random order, which defeats the vertex cache
+    TestMesh mesh;
+    for (uint32_t y = 0; y <= size; y++)
+    {
+        for (uint32_t x = 0; x <= size; x++)
+        {
+            mesh.positions.push_back(glm::vec3((float)x, (float)y, 0));
+        }
+    }
+
+    std::vector<glm::uvec3> triangles;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t v = y * (size + 1) + x;
+            triangles.push_back(glm::uvec3(v, v + 1, v + size + 2));
+            triangles.push_back(glm::uvec3(v, v + size + 2, v + size + 1));
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+    for (const auto& t : triangles)
+    {
+        mesh.indices.insert(mesh.indices.end(), { t.x, t.y, t.z });
+    }
+    return mesh;
+}
+
+std::vector<uint32_t> MeshOptimizerTest::getSortedTriangles(const std::vector<uint32_t>& indices)
+{
+    // Rotate every triangle so its smallest index is first, which keeps the winding, then sort the triangles
+    std::vector<glm::uvec3> triangles;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        glm::uvec3 t(indices[i], indices[i + 1], indices[i + 2]);
+        while (t.x > t.y || t.x > t.z)
+        {
+            t = glm::uvec3(t.y, t.z, t.x);
+        }
+        triangles.push_back(t);
+    }
+    std::sort(triangles.begin(), triangles.end(), [](const glm::uvec3& a, const glm::uvec3& b)
+    {
+        if (a.x != b.x) return a.x < b.x;
+        if (a.y != b.y) return a.y < b.y;
+        return a.z < b.z;
+    });
+
+    std::vector<uint32_t> result;
+    for (const auto& t : triangles)
+    {
+        result.insert(result.end(), { t.x, t.y, t.z });
+    }
+    return result;
+}
+
+testing_func(MeshOptimizerTest, TestAnalyzeVertexCache)
+{
+    const uint32_t triangle[] = { 0, 1, 2, 2, 1, 0 };
+    VertexCacheStats stats = analyzeVertexCache(triangle, 3, 3);
+    if (stats.acmr != 3 || stats.atvr != 1) return test_fail("A single triangle should miss every vertex once");
+    stats = analyzeVertexCache(triangle, 6, 3);
+    if (stats.acmr != 1.5f || stats.atvr != 1) return test_fail("A repeated triangle should hit the cache");
+
+    // With a cache of 3 entries, a strip of 3 triangles misses 5 vertices
+    const uint32_t strip[] = { 0, 1, 2, 2, 1, 3, 2, 3, 4 };
+    stats = analyzeVertexCache(strip, 9, 5, 3);
+    if (stats.acmr != 5.0f / 3.0f || stats.atvr != 1) return test_fail("Wrong statistics for a strip");
+
+    stats = analyzeVertexCache(strip, 0, 5);
+    if (stats.acmr != 0 || stats.atvr != 0) return test_fail("An empty index buffer should have no statistics");
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestOptimizeVertexCache)
+{
+    TestMesh grid = createShuffledGrid(32, 1);
+    const uint32_t indexCount = (uint32_t)grid.indices.size();
+    const uint32_t vertexCount = (uint32_t)grid.positions.size();
+    const std::vector<uint32_t> original = grid.indices;
+
+    VertexCacheStats before = analyzeVertexCache(grid.indices.data(), indexCount, vertexCount);
+    optimizeVertexCache(grid.indices.data(), indexCount, vertexCount);
+    VertexCacheStats after = analyzeVertexCache(grid.indices.data(), indexCount, vertexCount);
+
+    if (getSortedTriangles(grid.indices) != getSortedTriangles(original)) return test_fail("The optimized index buffer doesn't have the same triangles");
+    if (after.acmr >= before.acmr * 0.5f) return test_fail("The ACMR wasn't halved for a shuffled grid");
+    // A regular grid can reach ~0.6 with a 16 entries cache
+    if (after.acmr > 1.0f) return test_fail("The ACMR of an optimized grid is above 1, it is " + std::to_string(after.acmr));
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestOptimizeOverdraw)
+{
+    TestMesh grid = createShuffledGrid(32, 2);
+    const uint32_t indexCount = (uint32_t)grid.indices.size();
+    const uint32_t vertexCount = (uint32_t)grid.positions.size();
+    optimizeVertexCache(grid.indices.data(), indexCount, vertexCount);
+    const std::vector<uint32_t> original = grid.indices;
+    VertexCacheStats before = analyzeVertexCache(grid.indices.data(), indexCount, vertexCount);
+
+    const float threshold = 1.05f;
+    optimizeOverdraw(grid.indices.data(), indexCount, grid.positions.data(), vertexCount, threshold);
+    VertexCacheStats after = analyzeVertexCache(grid.indices.data(), indexCount, vertexCount);
+
+    if (getSortedTriangles(grid.indices) != getSortedTriangles(original)) return test_fail("The reordered index buffer doesn't have the same triangles");
+    // The threshold applies per cluster, the last cluster of a run can be worse. Allow some slack over the whole mesh.
+    if (after.acmr > before.acmr * threshold * 1.25f) return test_fail("Reordering the clusters degraded the ACMR from " + std::to_string(before.acmr) + " to " + std::to_string(after.acmr));
+
+    // Fewer than 2 triangles are left untouched
+    uint32_t single[] = { 2, 1, 0 };
+    optimizeOverdraw(single, 3, grid.positions.data(), vertexCount, threshold);
+    if (single[0] != 2 || single[1] != 1 || single[2] != 0) return test_fail("A single triangle was modified");
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestOptimizeVertexFetch)
+{
+    TestMesh grid = createShuffledGrid(8, 3);
+    // An extra vertex which isn't referenced
+    grid.positions.insert(grid.positions.begin(), glm::vec3(-1.0f));
+    for (uint32_t& index : grid.indices)
+    {
+        index++;
+    }
+
+    const std::vector<uint32_t> originalIndices = grid.indices;
+    const std::vector<glm::vec3> originalPositions = grid.positions;
+    const uint32_t vertexCount = (uint32_t)grid.positions.size();
+    std::vector<uint32_t> remap = optimizeVertexFetch(grid.indices.data(), (uint32_t)grid.indices.size(), vertexCount);
+    remapVertexData(grid.positions.data(), sizeof(glm::vec3), remap);
+
+    std::vector<uint32_t> sortedRemap = remap;
+    std::sort(sortedRemap.begin(), sortedRemap.end());
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        if (sortedRemap[v] != v) return test_fail("The remap table isn't a permutation");
+    }
+    if (remap[0] != vertexCount - 1) return test_fail("The unreferenced vertex wasn't moved after the referenced ones");
+
+    uint32_t nextVertex = 0;
+    for (size_t i = 0; i < grid.indices.size(); i++)
+    {
+        if (grid.indices[i] > nextVertex) return test_fail("The vertices aren't numbered in the order of their first use");
+        if (grid.indices[i] == nextVertex) nextVertex++;
+        if (grid.positions[grid.indices[i]] != originalPositions[originalIndices[i]]) return test_fail("A remapped index doesn't reference the original vertex data");
+    }
+    if (grid.positions[vertexCount - 1] != originalPositions[0]) return test_fail("The unreferenced vertex data wasn't moved");
+    return test_pass();
+}
+
+testing_func(MeshOptimizerTest, TestVertexCacheReport)
+{
+    VertexCacheReport report;
+    VertexCacheStats before;
+    VertexCacheStats after;
+
+    // Meshes without triangles are ignored while the report is empty
+    report.add(before, after, 0);
+    if (report.getMeshCount() != 0) return test_fail("An empty mesh was counted");
+
+    before.acmr = 2.0f;
+    after.acmr = 1.0f;
+    report.add(before, after, 100);
+    before.acmr = 1.0f;
+    after.acmr = 0.5f;
+    report.add(before, after, 300);
+    if (report.getMeshCount() != 2) return test_fail("Wrong mesh count");
+
+    const std::string message = report.getMessage();
+    if (message.find("ACMR " + std::to_string(1.25f) + " -> " + std::to_string(0.625f)) == std::string::npos) return test_fail("The averages aren't weighted by the triangle counts: " + message);
+    return test_pass();
+}
+
+int main()
+{
+    MeshOptimizerTest mot;
+    mot.init();
+    mot.run();
+    return 0;
+}
@@ -0,0 +1,225 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MeshSimplifierTest.h"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <map>
+
+void MeshSimplifierTest::addTests()
+{
+    addTestToList<TestPlaneSimplification>();
+    addTestToList<TestClosedMeshSimplification>();
+    addTestToList<TestErrorLimit>();
+    addTestToList<TestGenerateLods>();
+}
+
+MeshSimplifierTest::TestMesh MeshSimplifierTest::createGrid(uint32_t size)
+{
+    // A flat square in the XY plane, facing +Z
+    TestMesh mesh;
+    for (uint32_t y = 0; y <= size; y++)
+    {
+        for (uint32_t x = 0; x <= size; x++)
+        {
+            mesh.positions.push_back(glm::vec3((float)x, (float)y, 0));
+        }
+    }
+
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t v = y * (size + 1) + x;
+            mesh.indices.insert(mesh.indices.end(), { v, v + 1, v + size + 2 });
+            mesh.indices.insert(mesh.indices.end(), { v, v + size + 2, v + size + 1 });
+        }
+    }
+    return mesh;
+}
+
+MeshSimplifierTest::TestMesh MeshSimplifierTest::createSphere(uint32_t rings, uint32_t segments)
+{
+    // A closed unit sphere. The poles are single vertices and the segments wrap around, so no two vertices share a position.
+    TestMesh mesh;
+    const float pi = 3.14159265f;
+    mesh.positions.push_back(glm::vec3(0, 1, 0));
+    for (uint32_t r = 1; r < rings; r++)
+    {
+        float theta = pi * (float)r / (float)rings;
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            float phi = 2 * pi * (float)s / (float)segments;
+            mesh.positions.push_back(glm::vec3(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)));
+        }
+    }
+    const uint32_t southPole = (uint32_t)mesh.positions.size();
+    mesh.positions.push_back(glm::vec3(0, -1, 0));
+
+    auto ringVertex = [segments](uint32_t r, uint32_t s) { return 1 + (r - 1) * segments + (s % segments); };
+    for (uint32_t s = 0; s < segments; s++)
+    {
+        mesh.indices.insert(mesh.indices.end(), { 0, ringVertex(1, s + 1), ringVertex(1, s) });
+        mesh.indices.insert(mesh.indices.end(), { southPole, ringVertex(rings - 1, s), ringVertex(rings - 1, s + 1) });
+    }
+    for (uint32_t r = 1; r < rings - 1; r++)
+    {
+        for (uint32_t s = 0; s < segments; s++)
+        {
+            mesh.indices.insert(mesh.indices.end(), { ringVertex(r, s), ringVertex(r, s + 1), ringVertex(r + 1, s + 1) });
+            mesh.indices.insert(mesh.indices.end(), { ringVertex(r, s), ringVertex(r + 1, s + 1), ringVertex(r + 1, s) });
+        }
+    }
+    return mesh;
+}
+
+bool MeshSimplifierTest::isClosed(const std::vector<uint32_t>& indices)
+{
+    // Every edge must be used as many times in each direction
+    std::map<std::pair<uint32_t, uint32_t>, int32_t> edges;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            edges[std::make_pair(std::min(a, b), std::max(a, b))] += (a < b) ? 1 : -1;
+        }
+    }
+
+    for (const auto& e : edges)
+    {
+        if (e.second != 0) return false;
+    }
+    return true;
+}
+
+testing_func(MeshSimplifierTest, TestPlaneSimplification)
+{
+    // Interior vertices and the straight borders of a plane collapse without error, the corners must stay
+    TestMesh grid = createGrid(16);
+    float error = 0;
+    std::vector<uint32_t> result = simplifyMesh(grid.indices.data(), (uint32_t)grid.indices.size(), grid.positions.data(), (uint32_t)grid.positions.size(), 6, 1e-3f, error);
+
+    if (result.size() % 3 != 0) return test_fail("The result isn't a triangle list");
+    if (result.size() * 10 > grid.indices.size()) return test_fail("A plane wasn't simplified to less than 10% of its triangles");
+    if (error > 1e-3f) return test_fail("The result error is above the target error");
+
+    float area = 0;
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        if (result[i] >= grid.positions.size() || result[i + 1] >= grid.positions.size() || result[i + 2] >= grid.positions.size()) return test_fail("The result has an out-of-range index");
+        const glm::vec3& p0 = grid.positions[result[i]];
+        glm::vec3 normal = glm::cross(grid.positions[result[i + 1]] - p0, grid.positions[result[i + 2]] - p0);
+        if (normal.z < -1e-4f) return test_fail("A triangle was flipped");
+        area += normal.z * 0.5f;
+    }
+
+    if (fabsf(area - 16.0f * 16.0f) > 1e-2f) return test_fail("The simplified plane doesn't cover the original area");
+    return test_pass();
+}
+
+testing_func(MeshSimplifierTest, TestClosedMeshSimplification)
+{
+    TestMesh sphere = createSphere(32, 64);
+    const uint32_t targetIndexCount = (uint32_t)(sphere.indices.size() / 30) * 3;
+    float error = 0;
+    std::vector<uint32_t> result = simplifyMesh(sphere.indices.data(), (uint32_t)sphere.indices.size(), sphere.positions.data(), (uint32_t)sphere.positions.size(), targetIndexCount, 1.0f, error);
+
+    if (result.size() > targetIndexCount) return test_fail("The target index count wasn't reached with an unlimited error");
+    if (result.empty()) return test_fail("The sphere was simplified to nothing");
+    if (isClosed(result) == false) return test_fail("Simplifying a closed mesh opened holes in it");
+
+    // Vertices are never moved, so the result is always inscribed in the sphere
+    for (uint32_t index : result)
+    {
+        if (index >= sphere.positions.size()) return test_fail("The result has an out-of-range index");
+    }
+    return test_pass();
+}
+
+testing_func(MeshSimplifierTest, TestErrorLimit)
+{
+    TestMesh sphere = createSphere(32, 64);
+    const uint32_t indexCount = (uint32_t)sphere.indices.size();
+    const uint32_t vertexCount = (uint32_t)sphere.positions.size();
+
+    float fineError = 0;
+    float coarseError = 0;
+    std::vector<uint32_t> fine = simplifyMesh(sphere.indices.data(), indexCount, sphere.positions.data(), vertexCount, 0, 0.005f, fineError);
+    std::vector<uint32_t> coarse = simplifyMesh(sphere.indices.data(), indexCount, sphere.positions.data(), vertexCount, 0, 0.05f, coarseError);
+
+    if (fineError > 0.005f || coarseError > 0.05f) return test_fail("The result error is above the target error");
+    if (fine.size() >= indexCount) return test_fail("The sphere wasn't simplified within the error limit");
+    if (coarse.size() >= fine.size()) return test_fail("A larger error limit didn't simplify the sphere further");
+
+    // A mesh which is already below the target is returned unchanged
+    float error = 1;
+    std::vector<uint32_t> unchanged = simplifyMesh(sphere.indices.data(), indexCount, sphere.positions.data(), vertexCount, indexCount, 1.0f, error);
+    if (unchanged != sphere.indices || error != 0) return test_fail("A mesh below the target index count was modified");
+    return test_pass();
+}
+
+testing_func(MeshSimplifierTest, TestGenerateLods)
+{
+    TestMesh sphere = createSphere(32, 64);
+    const std::vector<uint32_t> original = sphere.indices;
+    Model::LodSettings settings;
+    std::vector<Mesh::Lod> lods = generateLods(sphere.indices, sphere.positions.data(), (uint32_t)sphere.positions.size(), settings);
+
+    if (lods.size() < 2) return test_fail("No levels of detail were generated for a sphere");
+    if (lods.size() > settings.maxLodCount) return test_fail("More levels than maxLodCount were generated");
+    if (lods[0].firstIndex != 0 || lods[0].indexCount != original.size() || lods[0].error != 0) return test_fail("Level 0 isn't the full-detail mesh");
+    if (std::equal(original.begin(), original.end(), sphere.indices.begin()) == false) return test_fail("The full-detail indices were modified");
+
+    for (size_t i = 1; i < lods.size(); i++)
+    {
+        const Mesh::Lod& prev = lods[i - 1];
+        const Mesh::Lod& lod = lods[i];
+        if (lod.firstIndex != prev.firstIndex + prev.indexCount) return test_fail("The levels aren't packed in order in the index buffer");
+        if (lod.indexCount >= prev.indexCount || lod.indexCount % 3 != 0) return test_fail("A level doesn't have fewer triangles than the previous one");
+        if (lod.error < prev.error) return test_fail("The error decreases along the chain");
+    }
+
+    const Mesh::Lod& last = lods.back();
+    if (last.firstIndex + last.indexCount != sphere.indices.size()) return test_fail("The index buffer has data past the last level");
+    if (last.error > settings.maxError * 1.001f) return test_fail("The coarsest level exceeds maxError");
+
+    // A single level leaves the mesh untouched
+    settings.maxLodCount = 1;
+    std::vector<uint32_t> indices = original;
+    if (generateLods(indices, sphere.positions.data(), (uint32_t)sphere.positions.size(), settings).size() != 1 || indices != original) return test_fail("maxLodCount of 1 generated levels");
+    return test_pass();
+}
+
+int main()
+{
+    MeshSimplifierTest mst;
+    mst.init();
+    mst.run();
+    return 0;
+}
@@ -0,0 +1,228 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ProgramVersionTableTest.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+
+void ProgramVersionTableTest::addTests()
+{
+    addTestToList<TestInsertFind>();
+    addTestToList<TestCollidingHashes>();
+    addTestToList<TestEraseInProbeSequence>();
+    addTestToList<TestDefineListHash>();
+    addTestToList<TestLookupBenchmark>();
+}
+
+ProgramVersionTableTest::VersionData ProgramVersionTableTest::createVersionData(uint32_t id)
+{
+    // The table never dereferences the version, so the pointer only serves as an ID. It doesn't own anything.
+    VersionData data;
+    data.pVersion = ProgramVersion::SharedConstPtr(std::shared_ptr<void>(), reinterpret_cast<const ProgramVersion*>((uintptr_t)id + 1));
+    return data;
+}
+
+uint32_t ProgramVersionTableTest::getVersionDataId(const VersionData* pData)
+{
+    return pData ? (uint32_t)(reinterpret_cast<uintptr_t>(pData->pVersion.get()) - 1) : (uint32_t)-1;
+}
+
+Program::DefineList ProgramVersionTableTest::createDefineList(uint32_t id)
+{
+    Program::DefineList defines;
+    defines.add("_VERSION", std::to_string(id));
+    defines.add("_ENABLE_FEATURE_" + std::to_string(id % 7));
+    return defines;
+}
+
+testing_func(ProgramVersionTableTest, TestInsertFind)
+{
+    VersionTable table;
+    if (table.find(0, createDefineList(0)) != nullptr) return test_fail("An empty table returned a version");
+
+    const uint32_t count = 300;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Program::DefineList defines = createDefineList(i);
+        table.insert(ProgramAccess::getDefineListHash(defines), defines, createVersionData(i));
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Program::DefineList defines = createDefineList(i);
+        if (getVersionDataId(table.find(ProgramAccess::getDefineListHash(defines), defines)) != i) return test_fail("Version " + std::to_string(i) + " wasn't found after growing the table");
+    }
+
+    // Inserting an existing DefineList replaces its version
+    Program::DefineList defines = createDefineList(5);
+    table.insert(ProgramAccess::getDefineListHash(defines), defines, createVersionData(1000));
+    if (getVersionDataId(table.find(ProgramAccess::getDefineListHash(defines), defines)) != 1000) return test_fail("Inserting an existing DefineList didn't replace its version");
+
+    Program::DefineList missing = createDefineList(count);
+    if (table.find(ProgramAccess::getDefineListHash(missing), missing) != nullptr) return test_fail("A missing DefineList returned a version");
+    return test_pass();
+}
+
+testing_func(ProgramVersionTableTest, TestCollidingHashes)
+{
+    // Different DefineLists with the same hash must never alias
+    VersionTable table;
+    const uint64_t hash = 0x1234;
+    const uint32_t count = 20;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        table.insert(hash, createDefineList(i), createVersionData(i));
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (getVersionDataId(table.find(hash, createDefineList(i))) != i) return test_fail("A colliding DefineList returned the wrong version");
+    }
+    if (table.find(hash, createDefineList(count)) != nullptr) return test_fail("A missing DefineList with a colliding hash returned a version");
+
+    // Erasing one of them only removes that version
+    VersionData erased = table.erase(hash, createDefineList(7));
+    if (getVersionDataId(&erased) != 7) return test_fail("erase() returned the wrong version");
+    if (table.find(hash, createDefineList(7)) != nullptr) return test_fail("An erased version was still found");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (i != 7 && getVersionDataId(table.find(hash, createDefineList(i))) != i) return test_fail("Erasing a colliding version removed another one");
+    }
+
+    if (table.erase(hash, createDefineList(7)).pVersion != nullptr) return test_fail("Erasing a missing version returned data");
+    return test_pass();
+}
+
+testing_func(ProgramVersionTableTest, TestEraseInProbeSequence)
+{
+    // Hashes which map to neighboring slots create long probe sequences. Erasing anywhere in them must keep the following entries reachable
+    VersionTable table;
+    const uint32_t count = 100;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        table.insert(i % 3, createDefineList(i), createVersionData(i));
+    }
+
+    for (uint32_t i = 0; i < count; i += 2)
+    {
+        table.erase(i % 3, createDefineList(i));
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const VersionData* pData = table.find(i % 3, createDefineList(i));
+        if ((i % 2) == 0 && pData != nullptr) return test_fail("An erased version was still found");
+        if ((i % 2) == 1 && getVersionDataId(pData) != i) return test_fail("Version " + std::to_string(i) + " became unreachable after erasing its neighbors");
+    }
+
+    table.clear();
+    if (table.find(1, createDefineList(1)) != nullptr) return test_fail("A cleared table returned a version");
+    return test_pass();
+}
+
+testing_func(ProgramVersionTableTest, TestDefineListHash)
+{
+    Program::DefineList a;
+    a.add("_A", "1");
+    a.add("_B", "2");
+    a.add("_C");
+    Program::DefineList b;
+    b.add("_C");
+    b.add("_B", "2");
+    b.add("_A", "1");
+    if (ProgramAccess::getDefineListHash(a) != ProgramAccess::getDefineListHash(b)) return test_fail("The DefineList hash depends on the order the defines were added in");
+
+    // Program updates the hash incrementally, which must match hashing the final list
+    uint64_t incremental = ProgramAccess::getDefineHash("_C", "") + ProgramAccess::getDefineHash("_A", "1") + ProgramAccess::getDefineHash("_B", "2");
+    if (incremental != ProgramAccess::getDefineListHash(a)) return test_fail("The sum of the define hashes doesn't match the DefineList hash");
+    incremental -= ProgramAccess::getDefineHash("_A", "1");
+    b.remove("_A");
+    if (incremental != ProgramAccess::getDefineListHash(b)) return test_fail("Removing a define's hash doesn't match the hash of the smaller list");
+
+    // Names and values are hashed separately
+    if (ProgramAccess::getDefineHash("_AB", "") == ProgramAccess::getDefineHash("_A", "B")) return test_fail("Moving characters from the name to the value doesn't change the hash");
+    if (ProgramAccess::getDefineHash("_A", "1") == ProgramAccess::getDefineHash("_A", "2")) return test_fail("The value doesn't change the hash");
+    return test_pass();
+}
+
+testing_func(ProgramVersionTableTest, TestLookupBenchmark)
+{
+    // Compare the hashed lookup with the std::map keyed by DefineList it replaced, for a program with a typical number of versions and defines
+    const uint32_t versionCount = 64;
+    const uint32_t lookupCount = 1000000;
+    std::vector<Program::DefineList> defineLists;
+    VersionTable table;
+    std::map<Program::DefineList, VersionData> map;
+    for (uint32_t i = 0; i < versionCount; i++)
+    {
+        Program::DefineList defines = createDefineList(i);
+        defines.add("_SHADING_MODEL", "Standard");
+        defines.add("_MAX_LIGHTS", "16");
+        defines.add("_ENABLE_SHADOWS");
+        defineLists.push_back(defines);
+        table.insert(ProgramAccess::getDefineListHash(defines), defines, createVersionData(i));
+        map[defines] = createVersionData(i);
+    }
+
+    // Program keeps the hash up to date as defines change, so the lookup itself only uses a stored hash
+    std::vector<uint64_t> hashes;
+    for (const auto& defines : defineLists) hashes.push_back(ProgramAccess::getDefineListHash(defines));
+
+    uint64_t tableSum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < lookupCount; i++)
+    {
+        const uint32_t v = i % versionCount;
+        tableSum += getVersionDataId(table.find(hashes[v], defineLists[v]));
+    }
+    auto tableTime = std::chrono::high_resolution_clock::now() - start;
+
+    uint64_t mapSum = 0;
+    start = std::chrono::high_resolution_clock::now();
+    for (uint32_t i = 0; i < lookupCount; i++)
+    {
+        const uint32_t v = i % versionCount;
+        mapSum += getVersionDataId(&map.find(defineLists[v])->second);
+    }
+    auto mapTime = std::chrono::high_resolution_clock::now() - start;
+
+    using ns = std::chrono::nanoseconds;
+    std::cout << "Version lookup: VersionTable " << std::chrono::duration_cast<ns>(tableTime).count() / lookupCount << "ns, std::map " << std::chrono::duration_cast<ns>(mapTime).count() / lookupCount << "ns\n";
+
+    // Timings aren't checked, they depend on the machine. The results must match
+    if (tableSum != mapSum) return test_fail("The VersionTable and the std::map returned different versions");
+    return test_pass();
+}
+
+int main()
+{
+    ProgramVersionTableTest pvtt;
+    pvtt.init();
+    pvtt.run();
+    return 0;
+}
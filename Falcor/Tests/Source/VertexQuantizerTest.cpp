@@ -0,0 +1,210 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "VertexQuantizerTest.h"
+#include "glm/packing.hpp"
+#include <algorithm>
+#include <random>
+
+void VertexQuantizerTest::addTests()
+{
+    addTestToList<TestPositions>();
+    addTestToList<TestDirections>();
+    addTestToList<TestTexCoords>();
+    addTestToList<TestUnquantizedElements>();
+}
+
+glm::vec3 VertexQuantizerTest::decodeOctahedral(const int16_t* pValues)
+{
+    // Same as decodeOctahedral() in DefaultVS.slang, after the RG16Snorm conversion
+    glm::vec2 e(std::max(pValues[0] / 32767.0f, -1.0f), std::max(pValues[1] / 32767.0f, -1.0f));
+    glm::vec3 v(e, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = glm::clamp(-v.z, 0.0f, 1.0f);
+    v.x += (v.x >= 0) ? -t : t;
+    v.y += (v.y >= 0) ? -t : t;
+    return glm::normalize(v);
+}
+
+bool VertexQuantizerTest::checkFormat(const VertexLayout* pLayout, uint32_t buffer, ResourceFormat format, uint32_t location)
+{
+    const auto& pBufferLayout = pLayout->getBufferLayout(buffer);
+    return pBufferLayout && pBufferLayout->getElementCount() == 1 && pBufferLayout->getElementFormat(0) == format &&
+        pBufferLayout->getElementShaderLocation(0) == location && pBufferLayout->getStride() == getFormatBytesPerBlock(format);
+}
+
+testing_func(VertexQuantizerTest, TestPositions)
+{
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> x(-100.0f, 300.0f);
+    std::uniform_real_distribution<float> y(5.0f, 6.0f);
+
+    // The Z axis is flat, it must decode exactly
+    const uint32_t vertexCount = 1000;
+    std::vector<glm::vec3> positions(vertexCount);
+    for (auto& p : positions) p = glm::vec3(x(rng), y(rng), 2.5f);
+
+    TestBuffers buffers;
+    buffers.addBuffer(VERTEX_POSITION_NAME, ResourceFormat::RGB32Float, VERTEX_POSITION_LOC, positions);
+    glm::vec3 scale, offset;
+    VertexLayout::SharedPtr pLayout = quantizeVertices(buffers.pLayout.get(), buffers.data, vertexCount, scale, offset);
+
+    if (checkFormat(pLayout.get(), 0, ResourceFormat::RGBA16Unorm, VERTEX_POSITION_LOC) == false) return test_fail("Positions weren't converted to RGBA16Unorm");
+    if (buffers.data[0].size() != vertexCount * 4 * sizeof(uint16_t)) return test_fail("Wrong quantized position buffer size");
+
+    const uint16_t* pQuantized = (const uint16_t*)buffers.data[0].data();
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        glm::vec3 p = glm::vec3(pQuantized[v * 4], pQuantized[v * 4 + 1], pQuantized[v * 4 + 2]) / 65535.0f * scale + offset;
+        // Half a quantization step, plus float rounding
+        glm::vec3 tolerance = scale / 65535.0f * 0.5f + glm::abs(positions[v]) * 1e-6f;
+        if (glm::any(glm::greaterThan(glm::abs(p - positions[v]), tolerance))) return test_fail("A dequantized position is off by more than half a step");
+    }
+    if (scale.z != 0 || offset.z != 2.5f) return test_fail("A flat axis should have a zero scale");
+    return test_pass();
+}
+
+testing_func(VertexQuantizerTest, TestDirections)
+{
+    std::mt19937 rng(2);
+    std::normal_distribution<float> gaussian;
+
+    // Random directions, plus the axes and the octahedron's edges where the lower half is folded
+    std::vector<glm::vec3> normals = { glm::vec3(0, 0, 1), glm::vec3(0, 0, -1), glm::vec3(1, 0, 0), glm::vec3(0, -1, 0), glm::normalize(glm::vec3(1, -1, 0)), glm::normalize(glm::vec3(-1, 1, -1e-3f)) };
+    while (normals.size() < 2000)
+    {
+        glm::vec3 n(gaussian(rng), gaussian(rng), gaussian(rng));
+        if (glm::length(n) > 1e-3f) normals.push_back(glm::normalize(n));
+    }
+
+    // Bitangents are stored in RGBA32Float by some importers, the 4th channel is dropped
+    std::vector<glm::vec4> bitangents;
+    for (const auto& n : normals) bitangents.push_back(glm::vec4(-n, 1));
+
+    const uint32_t vertexCount = (uint32_t)normals.size();
+    TestBuffers buffers;
+    buffers.addBuffer(VERTEX_NORMAL_NAME, ResourceFormat::RGB32Float, VERTEX_NORMAL_LOC, normals);
+    buffers.addBuffer(VERTEX_BITANGENT_NAME, ResourceFormat::RGBA32Float, VERTEX_BITANGENT_LOC, bitangents);
+    glm::vec3 scale, offset;
+    VertexLayout::SharedPtr pLayout = quantizeVertices(buffers.pLayout.get(), buffers.data, vertexCount, scale, offset);
+
+    if (checkFormat(pLayout.get(), 0, ResourceFormat::RG16Snorm, VERTEX_NORMAL_LOC) == false) return test_fail("Normals weren't converted to RG16Snorm");
+    if (checkFormat(pLayout.get(), 1, ResourceFormat::RG16Snorm, VERTEX_BITANGENT_LOC) == false) return test_fail("Bitangents weren't converted to RG16Snorm");
+    if (scale != glm::vec3(1) || offset != glm::vec3(0)) return test_fail("The position scale and offset should be the identity without positions");
+
+    const int16_t* pNormals = (const int16_t*)buffers.data[0].data();
+    const int16_t* pBitangents = (const int16_t*)buffers.data[1].data();
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        // 16-bit octahedral encoding has an error below 1e-4
+        if (glm::length(decodeOctahedral(pNormals + v * 2) - normals[v]) > 2e-4f) return test_fail("A decoded normal is off by more than 2e-4");
+        if (glm::length(decodeOctahedral(pBitangents + v * 2) + normals[v]) > 2e-4f) return test_fail("A decoded bitangent is off by more than 2e-4");
+    }
+
+    // Zero vectors decode to +Z instead of NaNs
+    TestBuffers zero;
+    zero.addBuffer(VERTEX_NORMAL_NAME, ResourceFormat::RGB32Float, VERTEX_NORMAL_LOC, std::vector<glm::vec3>(1, glm::vec3(0)));
+    quantizeVertices(zero.pLayout.get(), zero.data, 1, scale, offset);
+    if (decodeOctahedral((const int16_t*)zero.data[0].data()) != glm::vec3(0, 0, 1)) return test_fail("A zero normal doesn't decode to +Z");
+    return test_pass();
+}
+
+testing_func(VertexQuantizerTest, TestTexCoords)
+{
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const uint32_t vertexCount = 1000;
+
+    std::vector<glm::vec2> normalized(vertexCount);
+    for (auto& uv : normalized) uv = glm::vec2(unit(rng), unit(rng));
+    normalized[0] = glm::vec2(0, 1);
+
+    // A single coordinate outside [0, 1] switches the whole buffer to half floats
+    std::vector<glm::vec3> tiled(vertexCount);
+    for (auto& uv : tiled) uv = glm::vec3(unit(rng), unit(rng), 0);
+    tiled[vertexCount / 2] = glm::vec3(-3.5f, 12.25f, 0);
+
+    TestBuffers buffers;
+    buffers.addBuffer(VERTEX_TEXCOORD_NAME, ResourceFormat::RG32Float, VERTEX_TEXCOORD_LOC, normalized);
+    buffers.addBuffer(VERTEX_LIGHTMAP_UV_NAME, ResourceFormat::RGB32Float, VERTEX_LIGHTMAP_UV_LOC, tiled);
+    glm::vec3 scale, offset;
+    VertexLayout::SharedPtr pLayout = quantizeVertices(buffers.pLayout.get(), buffers.data, vertexCount, scale, offset);
+
+    if (checkFormat(pLayout.get(), 0, ResourceFormat::RG16Unorm, VERTEX_TEXCOORD_LOC) == false) return test_fail("Texture coordinates in [0, 1] weren't converted to RG16Unorm");
+    if (checkFormat(pLayout.get(), 1, ResourceFormat::RG16Float, VERTEX_LIGHTMAP_UV_LOC) == false) return test_fail("Texture coordinates outside [0, 1] weren't converted to RG16Float");
+
+    const uint32_t* pNormalized = (const uint32_t*)buffers.data[0].data();
+    const uint32_t* pTiled = (const uint32_t*)buffers.data[1].data();
+    for (uint32_t v = 0; v < vertexCount; v++)
+    {
+        if (glm::any(glm::greaterThan(glm::abs(glm::unpackUnorm2x16(pNormalized[v]) - normalized[v]), glm::vec2(0.5f / 65535.0f + 1e-7f)))) return test_fail("A dequantized texture coordinate is off by more than half a step");
+        // Half floats have 11 bits of mantissa
+        glm::vec2 uv(tiled[v]);
+        if (glm::any(glm::greaterThan(glm::abs(glm::unpackHalf2x16(pTiled[v]) - uv), glm::abs(uv) * (1.0f / 2048.0f) + 1e-7f))) return test_fail("A half-float texture coordinate is off by more than the half-float precision");
+    }
+    return test_pass();
+}
+
+testing_func(VertexQuantizerTest, TestUnquantizedElements)
+{
+    const uint32_t vertexCount = 16;
+    TestBuffers buffers;
+    // Not a quantized attribute
+    buffers.addBuffer(VERTEX_BONE_WEIGHT_NAME, ResourceFormat::RGBA32Float, VERTEX_BONE_WEIGHT_LOC, std::vector<glm::vec4>(vertexCount, glm::vec4(0.25f)));
+    // Already compact
+    buffers.addBuffer(VERTEX_TEXCOORD_NAME, ResourceFormat::RG16Float, VERTEX_TEXCOORD_LOC, std::vector<uint32_t>(vertexCount, 0x3c003c00));
+    // Too few channels for a position
+    buffers.addBuffer(VERTEX_POSITION_NAME, ResourceFormat::RG32Float, VERTEX_POSITION_LOC, std::vector<glm::vec2>(vertexCount, glm::vec2(1, 2)));
+
+    // Several elements in a buffer
+    VertexBufferLayout::SharedPtr pInterleaved = VertexBufferLayout::create();
+    pInterleaved->addElement(VERTEX_NORMAL_NAME, 0, ResourceFormat::RGB32Float, 1, VERTEX_NORMAL_LOC);
+    pInterleaved->addElement(VERTEX_BITANGENT_NAME, 12, ResourceFormat::RGB32Float, 1, VERTEX_BITANGENT_LOC);
+    buffers.pLayout->addBufferLayout(4, pInterleaved);
+    buffers.data.push_back({});
+    buffers.data.push_back(std::vector<uint8_t>(vertexCount * 24, 0));
+
+    const std::vector<std::vector<uint8_t>> original = buffers.data;
+    glm::vec3 scale, offset;
+    VertexLayout::SharedPtr pLayout = quantizeVertices(buffers.pLayout.get(), buffers.data, vertexCount, scale, offset);
+
+    if (pLayout->getBufferCount() != buffers.pLayout->getBufferCount()) return test_fail("The quantized layout has a different number of buffers");
+    for (uint32_t i = 0; i < (uint32_t)pLayout->getBufferCount(); i++)
+    {
+        if (pLayout->getBufferLayout(i) != buffers.pLayout->getBufferLayout(i)) return test_fail("The layout of buffer " + std::to_string(i) + " shouldn't change");
+    }
+    if (buffers.data != original) return test_fail("Unquantized buffers were modified");
+    if (scale != glm::vec3(1) || offset != glm::vec3(0)) return test_fail("The position scale and offset should be the identity when positions aren't quantized");
+    return test_pass();
+}
+
+int main()
+{
+    VertexQuantizerTest vqt;
+    vqt.init();
+    vqt.run();
+    return 0;
+}
@@ -0,0 +1,62 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "TestBase.h"
+#include "Graphics/Model/Loaders/VertexQuantizer.h"
+#include "Data/VertexAttrib.h"
+
+class VertexQuantizerTest : public TestBase
+{
+private:
+    void addTests() override;
+    void onInit() override {};
+    register_testing_func(TestPositions);
+    register_testing_func(TestDirections);
+    register_testing_func(TestTexCoords);
+    register_testing_func(TestUnquantizedElements);
+
+    // Vertex buffers in the layout the importers create, one element per buffer
+    struct TestBuffers
+    {
+        VertexLayout::SharedPtr pLayout = VertexLayout::create();
+        std::vector<std::vector<uint8_t>> data;
+
+        template<typename T>
+        void addBuffer(const std::string& name, ResourceFormat format, uint32_t location, const std::vector<T>& values)
+        {
+            VertexBufferLayout::SharedPtr pBufferLayout = VertexBufferLayout::create();
+            pBufferLayout->addElement(name, 0, format, 1, location);
+            pLayout->addBufferLayout((uint32_t)data.size(), pBufferLayout);
+            const uint8_t* pBytes = (const uint8_t*)values.data();
+            data.push_back(std::vector<uint8_t>(pBytes, pBytes + values.size() * sizeof(T)));
+        }
+    };
+
+    static glm::vec3 decodeOctahedral(const int16_t* pValues);
+    static bool checkFormat(const VertexLayout* pLayout, uint32_t buffer, ResourceFormat format, uint32_t location);
+};